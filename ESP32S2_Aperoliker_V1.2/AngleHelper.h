@@ -28,10 +28,42 @@
 // Increments the value by the angle distance given
 void IncrementAngle(int16_t* value, int16_t nextBorder, int16_t previousBorder, int16_t angleDistance_Degrees);
 
+//===============================================================
+// Inline functions (closed form, all angles within 0-359°)
+//===============================================================
+
 // Moves a value in 360 degrees space around the specified positive or negative distance
-int16_t Move360(int16_t value, int16_t distance);
+constexpr int16_t Move360(int16_t value, int16_t distance)
+{
+  return (int16_t)(((value + distance) % 360 + 360) % 360);
+}
 
 // Return the clockwise distance between two angles in an 360° space
-int16_t GetDistanceDegrees(int16_t startAngle, int16_t stopAngle);
+constexpr int16_t GetDistanceDegrees(int16_t startAngle, int16_t stopAngle)
+{
+  return (int16_t)((stopAngle - startAngle + 360) % 360);
+}
+
+// Limits the angle distance, so that the value keeps the minimum
+// distance to the next border (clockwise) or previous border
+// (counter clockwise)
+constexpr int16_t LimitAngleDistance(int16_t value, int16_t nextBorder, int16_t previousBorder, int16_t angleDistance_Degrees)
+{
+  if (angleDistance_Degrees > 0)
+  {
+    // A value on the next border may move one full turn minus the minimum angle
+    int16_t distance_Degrees = GetDistanceDegrees(value, nextBorder);
+    int16_t maxDistance_Degrees = (distance_Degrees == 0 ? 360 : distance_Degrees) - MINANGLE_DEGREES;
+    return max((int16_t)0, min(angleDistance_Degrees, maxDistance_Degrees));
+  }
+  else
+  {
+    // A value one degree after the previous border may pass it (as with
+    // moving degree by degree, where the border itself counts as 360°)
+    int16_t distance_Degrees = GetDistanceDegrees(value, previousBorder);
+    int16_t maxDistance_Degrees = distance_Degrees == 359 ? 361 - MINANGLE_DEGREES : 360 - MINANGLE_DEGREES - distance_Degrees;
+    return -max((int16_t)0, min((int16_t)-angleDistance_Degrees, maxDistance_Degrees));
+  }
+}
 
 #endif
@@ -0,0 +1,227 @@
+/**
+ * Includes all batch dispensing functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include "BatchDispenser.h"
+
+//===============================================================
+// Global variables
+//===============================================================
+BatchDispenser Batch;
+
+//===============================================================
+// Constructor
+//===============================================================
+BatchDispenser::BatchDispenser()
+{
+}
+
+//===============================================================
+// Sets the glass count (1-50)
+//===============================================================
+bool BatchDispenser::SetGlasses(int16_t glasses)
+{
+  if (IsRunning() ||
+    glasses < MIN_BATCH_GLASSES ||
+    glasses > MAX_BATCH_GLASSES)
+  {
+    return false;
+  }
+
+  _glasses = glasses;
+  return true;
+}
+
+//===============================================================
+// Sets the volume per glass in ml (20-500ml)
+//===============================================================
+bool BatchDispenser::SetVolume(int16_t volume_ml)
+{
+  if (IsRunning() ||
+    volume_ml < MIN_BATCH_VOLUME_ML ||
+    volume_ml > MAX_BATCH_VOLUME_ML)
+  {
+    return false;
+  }
+
+  _volume_ml = volume_ml;
+  return true;
+}
+
+//===============================================================
+// Sets the pause for swapping glasses in ms (1000-30000ms)
+//===============================================================
+bool BatchDispenser::SetPause(uint32_t pause_ms)
+{
+  if (IsRunning() ||
+    pause_ms < MIN_BATCH_PAUSE_MS ||
+    pause_ms > MAX_BATCH_PAUSE_MS)
+  {
+    return false;
+  }
+
+  _pause_ms = pause_ms;
+  return true;
+}
+
+//===============================================================
+// Returns the glass count
+//===============================================================
+int16_t BatchDispenser::GetGlasses()
+{
+  return _glasses;
+}
+
+//===============================================================
+// Returns the volume per glass in ml
+//===============================================================
+int16_t BatchDispenser::GetVolume()
+{
+  return _volume_ml;
+}
+
+//===============================================================
+// Returns the pause for swapping glasses in ms
+//===============================================================
+uint32_t BatchDispenser::GetPause()
+{
+  return _pause_ms;
+}
+
+//===============================================================
+// Starts a batch, the first pour must be started by the caller
+//===============================================================
+void BatchDispenser::Start(uint32_t time_ms)
+{
+  _phase = eBatchPouring;
+  _glassesDone = 0;
+  _startTimestamp_ms = time_ms;
+  _glassTimestamp_ms = time_ms;
+  _pourTimestamp_ms = time_ms;
+  _poured_L = 0.0;
+}
+
+//===============================================================
+// Aborts a running batch, the pumps must be stopped by the caller
+//===============================================================
+void BatchDispenser::Abort()
+{
+  if (!IsRunning())
+  {
+    return;
+  }
+
+  _phase = eBatchAborted;
+}
+
+//===============================================================
+// Returns the action the caller has to execute. The poured volume
+// is integrated from the elapsed pump on-time and the flow rate of
+// all pumps together, so it does not depend on when the pump driver
+// books its flow times (e.g. never for a pump at 100% duty)
+//===============================================================
+BatchAction BatchDispenser::Update(uint32_t time_ms, double flowRate_LPerMs)
+{
+  switch (_phase)
+  {
+    case eBatchPouring:
+      {
+        // Add the volume poured since the last update
+        _poured_L += (double)(time_ms - _pourTimestamp_ms) * flowRate_LPerMs;
+        _pourTimestamp_ms = time_ms;
+
+        // Wait for the volume of the current glass
+        if (_poured_L * 1000.0 < _volume_ml)
+        {
+          return eBatchActionNone;
+        }
+
+        _glassesDone++;
+        _glassTimestamp_ms = time_ms;
+
+        // Last glass done
+        if (_glassesDone >= _glasses)
+        {
+          _phase = eBatchFinished;
+          return eBatchActionFinish;
+        }
+
+        // Pause for swapping glasses
+        _phase = eBatchPause;
+        _pauseTimestamp_ms = time_ms;
+        return eBatchActionStopPour;
+      }
+    case eBatchPause:
+      {
+        // Wait for the pause time
+        if ((time_ms - _pauseTimestamp_ms) < _pause_ms)
+        {
+          return eBatchActionNone;
+        }
+
+        // Pour next glass
+        _phase = eBatchPouring;
+        _pourTimestamp_ms = time_ms;
+        _poured_L = 0.0;
+        return eBatchActionStartPour;
+      }
+    default:
+      break;
+  }
+
+  return eBatchActionNone;
+}
+
+//===============================================================
+// Returns true, if the batch is pouring or pausing
+//===============================================================
+bool BatchDispenser::IsRunning()
+{
+  return _phase == eBatchPouring || _phase == eBatchPause;
+}
+
+//===============================================================
+// Returns the current batch phase
+//===============================================================
+BatchPhase BatchDispenser::GetPhase()
+{
+  return _phase;
+}
+
+//===============================================================
+// Returns the number of finished glasses
+//===============================================================
+int16_t BatchDispenser::GetGlassesDone()
+{
+  return _glassesDone;
+}
+
+//===============================================================
+// Returns the volume poured into the current glass in ml
+//===============================================================
+double BatchDispenser::GetPouredVolume()
+{
+  return _phase == eBatchPouring ? _poured_L * 1000.0 : 0.0;
+}
+
+//===============================================================
+// Returns the throughput in glasses per minute (up to the last
+// finished glass, so the value only changes per glass)
+//===============================================================
+double BatchDispenser::GetGlassesPerMinute()
+{
+  uint32_t elapsed_ms = _glassTimestamp_ms - _startTimestamp_ms;
+  if (elapsed_ms == 0)
+  {
+    return 0.0;
+  }
+
+  return (double)_glassesDone * 60000.0 / (double)elapsed_ms;
+}
@@ -0,0 +1,122 @@
+/**
+ * Includes all batch dispensing functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef BATCHDISPENSER_H
+#define BATCHDISPENSER_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+
+//===============================================================
+// Defines
+//===============================================================
+#define DEFAULT_BATCH_GLASSES         6
+#define MIN_BATCH_GLASSES             1
+#define MAX_BATCH_GLASSES             50
+
+#define DEFAULT_BATCH_VOLUME_ML       200
+#define MIN_BATCH_VOLUME_ML           20
+#define MAX_BATCH_VOLUME_ML           500
+
+#define DEFAULT_BATCH_PAUSE_MS        (uint32_t)5000
+#define MIN_BATCH_PAUSE_MS            (uint32_t)1000
+#define MAX_BATCH_PAUSE_MS            (uint32_t)30000
+
+//===============================================================
+// Enums
+//===============================================================
+enum BatchPhase : uint16_t
+{
+  eBatchIdle = 0,
+  eBatchPouring = 1,
+  eBatchPause = 2,
+  eBatchFinished = 3,
+  eBatchAborted = 4
+};
+
+enum BatchAction : uint16_t
+{
+  eBatchActionNone = 0,
+  eBatchActionStartPour = 1,
+  eBatchActionStopPour = 2,
+  eBatchActionFinish = 3
+};
+
+//===============================================================
+// Class for batch dispensing (timing only, the current time and
+// pump flow rate are passed in by the caller)
+//===============================================================
+class BatchDispenser
+{
+  public:
+    // Constructor
+    BatchDispenser();
+
+    // Sets the glass count (1-50)
+    bool SetGlasses(int16_t glasses);
+
+    // Sets the volume per glass in ml (20-500ml)
+    bool SetVolume(int16_t volume_ml);
+
+    // Sets the pause for swapping glasses in ms (1000-30000ms)
+    bool SetPause(uint32_t pause_ms);
+
+    // Returns the batch settings
+    int16_t GetGlasses();
+    int16_t GetVolume();
+    uint32_t GetPause();
+
+    // Starts a batch, the first pour must be started by the caller
+    void Start(uint32_t time_ms);
+
+    // Aborts a running batch, the pumps must be stopped by the caller
+    void Abort();
+
+    // Returns the action the caller has to execute. The flow rate
+    // is the volume of all pumps together while pouring in l/ms
+    BatchAction Update(uint32_t time_ms, double flowRate_LPerMs);
+
+    // Returns true, if the batch is pouring or pausing
+    bool IsRunning();
+
+    // Returns the current batch phase
+    BatchPhase GetPhase();
+
+    // Returns the number of finished glasses
+    int16_t GetGlassesDone();
+
+    // Returns the volume poured into the current glass in ml
+    double GetPouredVolume();
+
+    // Returns the throughput in glasses per minute (up to the last finished glass)
+    double GetGlassesPerMinute();
+
+  private:
+    // Batch settings
+    int16_t _glasses = DEFAULT_BATCH_GLASSES;
+    int16_t _volume_ml = DEFAULT_BATCH_VOLUME_ML;
+    uint32_t _pause_ms = DEFAULT_BATCH_PAUSE_MS;
+
+    // Batch progress
+    BatchPhase _phase = eBatchIdle;
+    int16_t _glassesDone = 0;
+    uint32_t _startTimestamp_ms = 0;
+    uint32_t _glassTimestamp_ms = 0;
+    uint32_t _pauseTimestamp_ms = 0;
+    uint32_t _pourTimestamp_ms = 0;
+    double _poured_L = 0.0;
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+extern BatchDispenser Batch;
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * Includes a bounded lock-free command queue
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef COMMANDQUEUE_H
+#define COMMANDQUEUE_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <atomic>
+
+//===============================================================
+// Bounded lock-free queue for any number of producer tasks and a
+// single consumer task. Every slot carries a sequence, which tells
+// producers and consumer whether the slot is free or filled
+//===============================================================
+template <typename T, uint32_t N>
+class CommandQueue
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "Queue size must be a power of two");
+
+  public:
+    // Constructor
+    CommandQueue()
+    {
+      for (uint32_t index = 0; index < N; index++)
+      {
+        _slots[index].Sequence.store(index, std::memory_order_relaxed);
+      }
+    }
+
+    // Adds a command, returns false if the queue is full (any task)
+    bool Push(const T& command)
+    {
+      uint32_t position = _head.load(std::memory_order_relaxed);
+      while (true)
+      {
+        Slot& slot = _slots[position % N];
+        int32_t difference = (int32_t)(slot.Sequence.load(std::memory_order_acquire) - position);
+
+        if (difference == 0)
+        {
+          // Slot is free, try to reserve it
+          if (_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          {
+            slot.Command = command;
+            slot.Sequence.store(position + 1, std::memory_order_release);
+            return true;
+          }
+        }
+        else if (difference < 0)
+        {
+          // Slot is not consumed yet, queue is full
+          return false;
+        }
+        else
+        {
+          // Another producer was faster
+          position = _head.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    // Removes the oldest command, returns false if the queue is
+    // empty (consumer task only)
+    bool Pop(T* command)
+    {
+      Slot& slot = _slots[_tail % N];
+      if ((int32_t)(slot.Sequence.load(std::memory_order_acquire) - (_tail + 1)) < 0)
+      {
+        return false;
+      }
+
+      *command = slot.Command;
+      slot.Sequence.store(_tail + N, std::memory_order_release);
+      _tail++;
+      return true;
+    }
+
+  private:
+    struct Slot
+    {
+      std::atomic<uint32_t> Sequence;
+      T Command;
+    };
+
+    Slot _slots[N];
+    std::atomic<uint32_t> _head{0};
+    uint32_t _tail = 0;
+};
+
+#endif
@@ -28,12 +28,41 @@
 //#define WILDBERRY
 
 // This means that the ESP will wait 2 seconds each time it is started
-// because the start of the serial debug output on ESP32S2 takes this time
+// because the start of the serial debug output on ESP32S2 takes this time.
+// With core debug level "Debug" the log is a replay trace of the inputs
+// and websocket messages (see test/ReplayHarness.cpp)
 //#define DEBUG_MIXER     // Uncomment for debug build
 
 // Using the mixer without wifi makes the firmware more stable
 //#define WIFI_MIXER      // Uncomment for wifi usage
 
+// All events are sent over the websocket, the separate server sent events
+// endpoint (/events) costs one more connection per client
+//#define WIFI_EVENTSOURCE        // Uncomment to serve the events endpoint additionally
+
+// LittleFS opens and seeks faster than SPIFFS on a nearly full partition.
+// Both use the same "spiffs" partition, the partition scheme stays the
+// same. A partition, which can not be mounted, is never formatted
+// automatically. Upgrade of a device with SPIFFS:
+// 1. Download the pour log (/pourlog.csv) and changed files (/edit)
+// 2. Uncomment STORAGE_LITTLEFS and upload the sketch
+// 3. Upload the data folder as LittleFS image (replaces the partition)
+// Without step 3 the storage is not available until it is formatted in
+// the web editor (/edit?format). Downgrade the same way with SPIFFS
+//#define STORAGE_LITTLEFS        // Uncomment to use LittleFS (see upgrade above)
+
+// Spreading the pump on-times over the cycle (error diffusion) keeps the
+// mixture exact for any pour length, but switches the pumps more often
+//#define ERROR_DIFFUSION_PUMPS   // Uncomment for error diffusion pump modulation
+
+// Number of liquids (pumps) of the mixer (2-6). The variants below are
+// configured for three liquids, names, colors and default angles of
+// more liquids are set at the end of this file, the pump pins in the
+// sketch
+#ifndef LIQUID_COUNT
+#define LIQUID_COUNT                      3
+#endif
+
 // Set the value to 1 or -1 if your encoder is turning in the wrong direction
 #define ENCODER_DIRECTION                 -1
 
@@ -42,25 +71,33 @@
 //===============================================================
 enum MixtureLiquid : uint16_t
 {
-  eLiquid1 = 0,
-  eLiquid2 = 1,
-  eLiquid3 = 2,
-  eLiquidAll = 3,
+  eLiquid1 = 0,                   // Liquids 1 to LIQUID_COUNT are 0 to LIQUID_COUNT - 1
+  eLiquidAll = LIQUID_COUNT,
   eLiquidNone = 0xFFFF
 };
-const int MixtureLiquidDashboardMax = 3;
-const int MixtureLiquidCleaningMax = 4;
+const int MixtureLiquidDashboardMax = LIQUID_COUNT;
+const int MixtureLiquidCleaningMax = LIQUID_COUNT + 1;
 
 enum MixerState : uint16_t
 {
   eMenu = 0,
   eDashboard = 1,
-  eCleaning = 2,
-  eReset = 3,
-  eSettings = 4,
-  eScreenSaver = 5,
+  eBatch = 2,
+  eCleaning = 3,
+  eReset = 4,
+  eSettings = 5,
+  eScreenSaver = 6,
 };
 
+enum BatchSetting : uint16_t
+{
+  eBatchSettingGlasses = 0,
+  eBatchSettingVolume = 1,
+  eBatchSettingPause = 2,
+  eBatchSettingStart = 3
+};
+const int BatchSettingMax = 4;
+
 enum MixerEvent : uint16_t
 {
   eEntry = 0,
@@ -328,4 +365,64 @@ const String startupImageLogo = "/Logo.bmp";
 
 #endif
 
+
+//===============================================================
+// Additional liquids (mixers with more than three pumps)
+//===============================================================
+#ifndef LIQUID4_NAME
+#define LIQUID4_NAME                      "Liquid 4"      // Should not exceed 8 characters
+#define LIQUID5_NAME                      "Liquid 5"      // Should not exceed 8 characters
+#define LIQUID6_NAME                      "Liquid 6"      // Should not exceed 8 characters
+#endif
+
+#ifndef TFT_COLOR_LIQUID_4
+#define TFT_COLOR_LIQUID_4                ST77XX_BLUE
+#define TFT_COLOR_LIQUID_5                ST77XX_MAGENTA
+#define TFT_COLOR_LIQUID_6                ST77XX_GREEN
+#endif
+
+#ifndef WIFI_COLOR_LIQUID_4
+#define WIFI_COLOR_LIQUID_4               0x0000FF
+#define WIFI_COLOR_LIQUID_5               0xFF00FF
+#define WIFI_COLOR_LIQUID_6               0x00FF00
+#endif
+
+//===============================================================
+// Liquid tables
+//===============================================================
+#if LIQUID_COUNT < 2 || LIQUID_COUNT > 6
+#error "LIQUID_COUNT must be between 2 and 6"
+#endif
+
+// Lists an entry per liquid, e.g. { LIQUID_LIST(LIQUID_NAME) } is
+// { LIQUID1_NAME, LIQUID2_NAME, LIQUID3_NAME } for three liquids
+#if LIQUID_COUNT == 2
+#define LIQUID_LIST(ENTRY)                ENTRY(1), ENTRY(2)
+#elif LIQUID_COUNT == 3
+#define LIQUID_LIST(ENTRY)                ENTRY(1), ENTRY(2), ENTRY(3)
+#elif LIQUID_COUNT == 4
+#define LIQUID_LIST(ENTRY)                ENTRY(1), ENTRY(2), ENTRY(3), ENTRY(4)
+#elif LIQUID_COUNT == 5
+#define LIQUID_LIST(ENTRY)                ENTRY(1), ENTRY(2), ENTRY(3), ENTRY(4), ENTRY(5)
+#else
+#define LIQUID_LIST(ENTRY)                ENTRY(1), ENTRY(2), ENTRY(3), ENTRY(4), ENTRY(5), ENTRY(6)
+#endif
+
+#define LIQUID_NAME(liquid)               LIQUID##liquid##_NAME
+#define TFT_COLOR_LIQUID(liquid)          TFT_COLOR_LIQUID_##liquid
+#define WIFI_COLOR_LIQUID(liquid)         WIFI_COLOR_LIQUID_##liquid
+
+// The default mixtures of the variants are recipes for three liquids,
+// other liquid counts are mixed in equal parts
+#if LIQUID_COUNT == 3
+#define LIQUID_DEFAULT_ANGLE(liquid)      LIQUID##liquid##ANGLE_DEGREES
+#else
+#define LIQUID_DEFAULT_ANGLE(liquid)      ((liquid - 1) * 360 / LIQUID_COUNT)
+#endif
+
+static const char* const LiquidNames[LIQUID_COUNT] = { LIQUID_LIST(LIQUID_NAME) };
+static const uint16_t LiquidTftColors[LIQUID_COUNT] = { LIQUID_LIST(TFT_COLOR_LIQUID) };
+static const uint32_t LiquidWifiColors[LIQUID_COUNT] = { LIQUID_LIST(WIFI_COLOR_LIQUID) };
+static const int16_t LiquidDefaultAngles_Degrees[LIQUID_COUNT] = { LIQUID_LIST(LIQUID_DEFAULT_ANGLE) };
+
 #endif
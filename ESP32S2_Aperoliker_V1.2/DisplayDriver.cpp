@@ -21,6 +21,27 @@ static const char* TAG = "display";
 //===============================================================
  DisplayDriver Display;
 
+//===============================================================
+// Measures a display update. Nested draws belong to the outermost
+// update, which is observed when it ends
+//===============================================================
+class RenderMeasurement
+{
+  public:
+    RenderMeasurement(uint8_t& depth) : _depth(depth), _startTime_us(micros()) { _depth++; }
+    ~RenderMeasurement()
+    {
+      if (--_depth == 0)
+      {
+        Metrics.Observe(eMetricDisplayRenderDuration, micros() - _startTime_us);
+      }
+    }
+
+  private:
+    uint8_t& _depth;
+    uint32_t _startTime_us;
+};
+
 //===============================================================
 // Constructor
 //===============================================================
@@ -105,24 +126,28 @@ void DisplayDriver::SetCleaningLiquid(MixtureLiquid liquid)
   _cleaningLiquid = liquid;
 }
 
+//===============================================================
+// Sets the selected batch setting
+//===============================================================
+void DisplayDriver::SetBatchSetting(BatchSetting setting)
+{
+  _batchSetting = setting;
+}
+
 //===============================================================
 // Sets the angles values
 //===============================================================
-void DisplayDriver::SetAngles(int16_t liquid1Angle_Degrees, int16_t liquid2Angle_Degrees, int16_t liquid3Angle_Degrees)
+void DisplayDriver::SetAngles(const int16_t (&angles_Degrees)[LIQUID_COUNT])
 {
-  _liquid1Angle_Degrees = liquid1Angle_Degrees;
-  _liquid2Angle_Degrees = liquid2Angle_Degrees;
-  _liquid3Angle_Degrees = liquid3Angle_Degrees;
+  memcpy(_liquidAngles_Degrees, angles_Degrees, sizeof(_liquidAngles_Degrees));
 }
 
 //===============================================================
 // Sets the percentage values
 //===============================================================
-void DisplayDriver::SetPercentages(double liquid1_Percentage, double liquid2_Percentage, double liquid3_Percentage)
+void DisplayDriver::SetPercentages(const double (&values_Percentage)[LIQUID_COUNT])
 {
-  _liquid1_Percentage = liquid1_Percentage;
-  _liquid2_Percentage = liquid2_Percentage;
-  _liquid3_Percentage = liquid3_Percentage;
+  memcpy(_liquidPercentages, values_Percentage, sizeof(_liquidPercentages));
 }
 
 //===============================================================
@@ -130,6 +155,7 @@ void DisplayDriver::SetPercentages(double liquid1_Percentage, double liquid2_Per
 //===============================================================
 void DisplayDriver::ShowIntroPage()
 {
+  RenderMeasurement measurement(_renderDepth);
   // Set log
   ESP_LOGI(TAG, "Show intro page");
 
@@ -161,6 +187,7 @@ void DisplayDriver::ShowIntroPage()
 //===============================================================
 void DisplayDriver::ShowHelpPage()
 {
+  RenderMeasurement measurement(_renderDepth);
   // Set log
   ESP_LOGI(TAG, "Show help page");
 
@@ -182,15 +209,16 @@ void DisplayDriver::ShowHelpPage()
   _tft->print("Short Press:");
   _tft->setCursor(x, y += SHORTLINEOFFSET);
   _tft->print(" -> Change Setting");
-  _tft->setCursor(x, y += SHORTLINEOFFSET);
-  _tft->print("    ~ ");
-  _tft->print(LIQUID1_NAME);
-  _tft->setCursor(x, y += SHORTLINEOFFSET);
-  _tft->print("    ~ ");
-  _tft->print(LIQUID2_NAME);
-  _tft->setCursor(x, y += SHORTLINEOFFSET);
-  _tft->print("    ~ ");
-  _tft->print(LIQUID3_NAME);
+
+  // More than three liquids are listed in two columns
+  const uint8_t rows = LIQUID_COUNT <= 3 ? LIQUID_COUNT : (LIQUID_COUNT + 1) / 2;
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    _tft->setCursor(x + (liquid / rows) * 110, y + (liquid % rows + 1) * SHORTLINEOFFSET);
+    _tft->print("    ~ ");
+    _tft->print(LiquidNames[liquid]);
+  }
+  y += rows * SHORTLINEOFFSET;
   
   _tft->setCursor(x, y += LONGLINEOFFSET);
   _tft->print("Rotate:");
@@ -208,6 +236,7 @@ void DisplayDriver::ShowHelpPage()
 //===============================================================
 void DisplayDriver::ShowMenuPage()
 {
+  RenderMeasurement measurement(_renderDepth);
   // Set log
   ESP_LOGI(TAG, "Show menu page");
 
@@ -226,6 +255,7 @@ void DisplayDriver::ShowMenuPage()
 //===============================================================
 void DisplayDriver::ShowDashboardPage()
 {
+  RenderMeasurement measurement(_renderDepth);
   // Set log
   ESP_LOGI(TAG, "Show dashboard page");
 
@@ -253,11 +283,31 @@ void DisplayDriver::ShowDashboardPage()
   DrawCenteredString("Enjoy it!", x0, y0, false, 0);
 }
 
+//===============================================================
+// Shows batch page
+//===============================================================
+void DisplayDriver::ShowBatchPage()
+{
+  RenderMeasurement measurement(_renderDepth);
+  // Set log
+  ESP_LOGI(TAG, "Show batch page");
+
+  // Clear screen
+  _tft->fillScreen(TFT_COLOR_BACKGROUND);
+  
+  // Draw header information
+  DrawHeader("Batch Mode");
+
+  // Draw batch settings and progress
+  DrawBatch(true);
+}
+
 //===============================================================
 // Shows cleaning page
 //===============================================================
 void DisplayDriver::ShowCleaningPage()
 {
+  RenderMeasurement measurement(_renderDepth);
   // Set log
   ESP_LOGI(TAG, "Show cleaning page");
 
@@ -276,6 +326,7 @@ void DisplayDriver::ShowCleaningPage()
 //===============================================================
 void DisplayDriver::ShowSettingsPage()
 {
+  RenderMeasurement measurement(_renderDepth);
   // Set log
   ESP_LOGI(TAG, "Show settings page");
 
@@ -288,9 +339,8 @@ void DisplayDriver::ShowSettingsPage()
   // Draw header information
   DrawHeader("Settings");
 
-  double valueLiquid1 = FlowMeter.GetValueLiquid1();
-  double valueLiquid2 = FlowMeter.GetValueLiquid2();
-  double valueLiquid3 = FlowMeter.GetValueLiquid3();
+  double values_L[LIQUID_COUNT] = { };
+  FlowMeter.GetValues(values_L);
 
   // Fill in settings text
   _tft->setTextSize(1);
@@ -305,32 +355,28 @@ void DisplayDriver::ShowSettingsPage()
   _tft->setCursor(x, y += (SHORTLINEOFFSET + 2 * LONGLINEOFFSET));
   _tft->print("Volume of liquid filled:");
   
-  // Draw liquid 1 flow meter value
-  _tft->setTextColor(TFT_COLOR_LIQUID_1);
-  _tft->setCursor(x, y += SHORTLINEOFFSET);
-  _tft->print(LIQUID1_NAME);
-  _tft->print(":");
-  _tft->setCursor(x + 120, y);
-  _tft->print(FormatValue(valueLiquid1, 4, 2));
-  _tft->print(" L");
-  
-  // Draw liquid 2 flow meter value
-  _tft->setTextColor(TFT_COLOR_LIQUID_2);
-  _tft->setCursor(x, y += SHORTLINEOFFSET);
-  _tft->print(LIQUID2_NAME);
-  _tft->print(":");
-  _tft->setCursor(x + 120, y);
-  _tft->print(FormatValue(valueLiquid2, 4, 2));
-  _tft->print(" L");  
-  
-  // Draw liquid 3 flow meter value
-  _tft->setTextColor(TFT_COLOR_LIQUID_3);
-  _tft->setCursor(x, y += SHORTLINEOFFSET);
-  _tft->print(LIQUID3_NAME);
-  _tft->print(":");
-  _tft->setCursor(x + 120, y);
-  _tft->print(FormatValue(valueLiquid3, 4, 2));
-  _tft->print(" L");
+  // Draw liquid flow meter values (more than three liquids are
+  // drawn in two columns with their numbers instead of the names)
+  const uint8_t rows = LIQUID_COUNT <= 3 ? LIQUID_COUNT : (LIQUID_COUNT + 1) / 2;
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    _tft->setTextColor(LiquidTftColors[liquid]);
+    if (LIQUID_COUNT <= 3)
+    {
+      _tft->setCursor(x, y + (liquid + 1) * SHORTLINEOFFSET);
+      _tft->print(LiquidNames[liquid]);
+      _tft->print(":");
+      _tft->setCursor(x + 120, y + (liquid + 1) * SHORTLINEOFFSET);
+    }
+    else
+    {
+      _tft->setCursor(x + (liquid / rows) * 110, y + (liquid % rows + 1) * SHORTLINEOFFSET);
+      _tft->print(liquid + 1);
+      _tft->print(":");
+    }
+    _tft->print(FormatValue(values_L[liquid], 4, 2));
+    _tft->print(" L");
+  }
   
   x = 40;
   y = TFT_HEIGHT - 20;
@@ -351,6 +397,7 @@ void DisplayDriver::ShowSettingsPage()
 //===============================================================
 void DisplayDriver::ShowScreenSaverPage()
 {
+  RenderMeasurement measurement(_renderDepth);
   // Set log
   ESP_LOGI(TAG, "Show screen saver page");
 
@@ -405,6 +452,7 @@ void DisplayDriver::DrawHeader(const String &text, bool withIcons)
 //===============================================================
 void DisplayDriver::DrawWifiIcons(bool isfullUpdate)
 {
+  RenderMeasurement measurement(_renderDepth);
   int16_t x = TFT_WIDTH - 24 - 5;
   int16_t y = 2;
   int16_t width = 24;
@@ -449,6 +497,7 @@ void DisplayDriver::DrawWifiIcons(bool isfullUpdate)
 //===============================================================
 void DisplayDriver::DrawInfoBox(const String &line1, const String &line2)
 {
+  RenderMeasurement measurement(_renderDepth);
   int16_t x = INFOBOX_MARGIN_HORI;
   int16_t y = HEADEROFFSET_Y + INFOBOX_MARGIN_VERT;
   int16_t width = TFT_WIDTH - 2 * INFOBOX_MARGIN_HORI;
@@ -474,6 +523,7 @@ void DisplayDriver::DrawInfoBox(const String &line1, const String &line2)
 //===============================================================
 void DisplayDriver::DrawMenu(bool isfullUpdate)
 {
+  RenderMeasurement measurement(_renderDepth);
   int16_t x = 0;
   int16_t y = 0;
   int16_t width = 0;
@@ -490,6 +540,7 @@ void DisplayDriver::DrawMenu(bool isfullUpdate)
 
     // Draw icons
     _tft->drawXBitmap(x, y,                    icon_dashboard, width, height, TFT_COLOR_FOREGROUND);
+    _tft->drawXBitmap(x, y += MENU_LINEOFFSET, icon_batch,     width, height, TFT_COLOR_FOREGROUND);
     _tft->drawXBitmap(x, y += MENU_LINEOFFSET, icon_cleaning,  width, height, TFT_COLOR_FOREGROUND);
     _tft->drawXBitmap(x, y += MENU_LINEOFFSET, icon_reset,     width, height, TFT_COLOR_FOREGROUND);
     _tft->drawXBitmap(x, y += MENU_LINEOFFSET, icon_settings,  width, height, TFT_COLOR_FOREGROUND);
@@ -503,9 +554,11 @@ void DisplayDriver::DrawMenu(bool isfullUpdate)
     _tft->setCursor(x, y);
     _tft->print("Dashboard");
     _tft->setCursor(x, y += MENU_LINEOFFSET);
+    _tft->print("Batch Mode");
+    _tft->setCursor(x, y += MENU_LINEOFFSET);
     _tft->print("Cleaning Mode");
     _tft->setCursor(x, y += MENU_LINEOFFSET);
-    _tft->print("Reset Mixture");
+    _tft->print("Recipes");
     _tft->setCursor(x, y += MENU_LINEOFFSET);
     _tft->print("Settings");
   }
@@ -535,6 +588,7 @@ void DisplayDriver::DrawMenu(bool isfullUpdate)
 //===============================================================
 void DisplayDriver::DrawCheckBoxes()
 {
+  RenderMeasurement measurement(_renderDepth);
   int16_t x = TFT_WIDTH / 2;
   int16_t y = TFT_HEIGHT / 3;
   
@@ -544,38 +598,133 @@ void DisplayDriver::DrawCheckBoxes()
 
   int16_t boxWidth = 30;
   int16_t boxHeight = 30;
-  int16_t boxDistance = TFT_WIDTH * 2 / 7;
+  int16_t boxDistance = TFT_WIDTH * 2 / (2 * LIQUID_COUNT + 1);
 
-  x = TFT_WIDTH / 7;
+  x = TFT_WIDTH / (2 * LIQUID_COUNT + 1);
   y = HEADEROFFSET_Y + TFT_HEIGHT / 3;
   
   // Draw checkboxes
-  _tft->drawRect(x,                y, boxWidth, boxHeight, TFT_COLOR_FOREGROUND);
-  _tft->drawRect(x += boxDistance, y, boxWidth, boxHeight, TFT_COLOR_FOREGROUND);
-  _tft->drawRect(x += boxDistance, y, boxWidth, boxHeight, TFT_COLOR_FOREGROUND);
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    _tft->drawRect(x + liquid * boxDistance, y, boxWidth, boxHeight, TFT_COLOR_FOREGROUND);
+  }
 
   // Reduce rectangle for infill
-  x = TFT_WIDTH / 7 + 4;
+  x += 4;
   y += 4;
   boxWidth -= 8;
   boxHeight -= 8;
   
   // Draw activated checkboxes
-  _tft->fillRect(x,                y, boxWidth, boxHeight, _cleaningLiquid == eLiquidAll || _cleaningLiquid == eLiquid1 ? TFT_COLOR_STARTPAGE : TFT_COLOR_BACKGROUND);
-  _tft->fillRect(x += boxDistance, y, boxWidth, boxHeight, _cleaningLiquid == eLiquidAll || _cleaningLiquid == eLiquid2 ? TFT_COLOR_STARTPAGE : TFT_COLOR_BACKGROUND);
-  _tft->fillRect(x += boxDistance, y, boxWidth, boxHeight, _cleaningLiquid == eLiquidAll || _cleaningLiquid == eLiquid3 ? TFT_COLOR_STARTPAGE : TFT_COLOR_BACKGROUND);
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    _tft->fillRect(x + liquid * boxDistance, y, boxWidth, boxHeight,
+      _cleaningLiquid == eLiquidAll || _cleaningLiquid == liquid ? TFT_COLOR_STARTPAGE : TFT_COLOR_BACKGROUND);
+  }
 
   // Move under the boxes for liquid names
-  x = TFT_WIDTH / 7 + boxWidth / 2;
+  x += boxWidth / 2 - 4;
   y += 2 * boxHeight;
 
-  // Draw liquid names
-  _tft->setTextColor(TFT_COLOR_LIQUID_1);
-  DrawCenteredString(LIQUID1_NAME, x,                y, false, 0);
-  _tft->setTextColor(TFT_COLOR_LIQUID_2);
-  DrawCenteredString(LIQUID2_NAME, x += boxDistance, y, false, 0);
-  _tft->setTextColor(TFT_COLOR_LIQUID_3);
-  DrawCenteredString(LIQUID3_NAME, x += boxDistance, y, false, 0);
+  // Draw liquid names (staggered in two lines for more than three liquids)
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    _tft->setTextColor(LiquidTftColors[liquid]);
+    DrawCenteredString(LiquidNames[liquid], x + liquid * boxDistance, y + (LIQUID_COUNT > 3 ? (liquid % 2) * SHORTLINEOFFSET : 0), false, 0);
+  }
+}
+
+//===============================================================
+// Draws batch settings and progress
+//===============================================================
+void DisplayDriver::DrawBatch(bool isfullUpdate)
+{
+  RenderMeasurement measurement(_renderDepth);
+  int16_t x = 15;
+  int16_t y = HEADEROFFSET_Y + 25;
+
+  // Collect values, only redraw on changes (the values are only
+  // formatted for a redraw)
+  BatchView batch;
+  batch.Glasses = Batch.GetGlasses();
+  batch.Volume = Batch.GetVolume();
+  batch.Pause_s = Batch.GetPause() / 1000;
+  batch.IsRunning = Batch.IsRunning();
+  batch.GlassesDone = Batch.GetGlassesDone();
+  batch.GlassesPerMinute_Tenths = lround(Batch.GetGlassesPerMinute() * 10.0);
+  batch.Phase = Batch.GetPhase();
+  batch.Setting = _batchSetting;
+  if (batch == _lastDraw_Batch && !isfullUpdate)
+  {
+    return;
+  }
+  _lastDraw_Batch = batch;
+  bool isRunning = batch.IsRunning;
+
+  char glassesString[8];
+  char volumeString[12];
+  char pauseString[16];
+  char progressString[16];
+  char throughputString[16];
+  snprintf(glassesString, sizeof(glassesString), "%d", batch.Glasses);
+  snprintf(volumeString, sizeof(volumeString), "%d ml", batch.Volume);
+  snprintf(pauseString, sizeof(pauseString), "%u s", (unsigned int)batch.Pause_s);
+  snprintf(progressString, sizeof(progressString), "%d / %d", batch.GlassesDone, batch.Glasses);
+  snprintf(throughputString, sizeof(throughputString), "%2.1f", batch.GlassesPerMinute_Tenths / 10.0);
+  const char* startString = isRunning ? "Stop batch" : "Start batch";
+  const char* statusString;
+  switch (batch.Phase)
+  {
+    case eBatchPouring:
+      statusString = "Pouring";
+      break;
+    case eBatchPause:
+      statusString = "Swap glass";
+      break;
+    case eBatchFinished:
+      statusString = "Finished";
+      break;
+    case eBatchAborted:
+      statusString = "Aborted";
+      break;
+    default:
+      statusString = "Ready";
+      break;
+  }
+
+  // Clear old values
+  _tft->fillRect(0, y - SHORTLINEOFFSET + 4, TFT_WIDTH, 7 * SHORTLINEOFFSET + LONGLINEOFFSET, TFT_COLOR_BACKGROUND);
+
+  // Draw settings, selected setting is highlighted
+  _tft->setTextSize(1);
+  const char* labels[BatchSettingMax] = { "Glasses:", "Volume:", "Pause:", "" };
+  const char* values[BatchSettingMax] = { glassesString, volumeString, pauseString, startString };
+  for (int index = 0; index < BatchSettingMax; index++)
+  {
+    bool isSelected = !isRunning && index == _batchSetting;
+    _tft->setTextColor(isSelected || (isRunning && index == eBatchSettingStart) ? TFT_COLOR_MENU_SELECTOR : TFT_COLOR_TEXT_BODY);
+    _tft->setCursor(x, y);
+    _tft->print(isSelected ? "> " : "  ");
+    _tft->print(labels[index]);
+    _tft->setCursor(index == eBatchSettingStart ? x + 15 : x + 120, y);
+    _tft->print(values[index]);
+    y += SHORTLINEOFFSET;
+  }
+
+  // Draw progress
+  _tft->setTextColor(TFT_COLOR_TEXT_BODY);
+  _tft->setCursor(x, y += LONGLINEOFFSET - SHORTLINEOFFSET);
+  _tft->print("Progress:");
+  _tft->setCursor(x + 120, y);
+  _tft->print(progressString);
+  _tft->setCursor(x, y += SHORTLINEOFFSET);
+  _tft->print("Glasses/min:");
+  _tft->setCursor(x + 120, y);
+  _tft->print(throughputString);
+  _tft->setCursor(x, y += SHORTLINEOFFSET);
+  _tft->print("Status:");
+  _tft->setCursor(x + 120, y);
+  _tft->print(statusString);
 }
 
 //===============================================================
@@ -583,6 +732,7 @@ void DisplayDriver::DrawCheckBoxes()
 //===============================================================
 void DisplayDriver::DrawLegend()
 {
+  RenderMeasurement measurement(_renderDepth);
   int16_t x = X_LEGEND;
   int16_t y = Y_LEGEND;
   int16_t width = WIDTH_LEGEND;
@@ -596,16 +746,26 @@ void DisplayDriver::DrawLegend()
   int16_t boxWidth = 30;
   int16_t boxHeight = 10;
 
-  // Move to inner info
-  x = X_LEGEND + WIDTH_LEGEND / 2 - boxWidth / 2;
-  y = Y_LEGEND + marginTop;
-  width = boxWidth;
-  height = boxHeight;
+  // Up to three liquids are listed with a color box above the name,
+  // more liquids with the name in their color
+  int16_t lineOffset = LIQUID_COUNT <= 3 ? LOONGLINEOFFSET : (HEIGHT_LEGEND - marginTop) / LIQUID_COUNT;
+  if (LIQUID_COUNT <= 3)
+  {
+    // Move to inner info
+    x = X_LEGEND + WIDTH_LEGEND / 2 - boxWidth / 2;
+    y = Y_LEGEND + marginTop;
 
-  // Draw liquid color boxes
-  _tft->fillRect(x, y,                    width, height, TFT_COLOR_LIQUID_1);
-  _tft->fillRect(x, y += LOONGLINEOFFSET, width, height, TFT_COLOR_LIQUID_2);
-  _tft->fillRect(x, y += LOONGLINEOFFSET, width, height, TFT_COLOR_LIQUID_3);
+    // Draw liquid color boxes
+    for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+    {
+      _tft->fillRect(x, y + liquid * lineOffset, boxWidth, boxHeight, LiquidTftColors[liquid]);
+    }
+    _tft->setTextColor(TFT_COLOR_TEXT_BODY);
+  }
+  else
+  {
+    marginBetween = 13;
+  }
 
   // Move to inner text
   x = X_LEGEND + WIDTH_LEGEND / 2;
@@ -613,10 +773,14 @@ void DisplayDriver::DrawLegend()
 
   // Draw liquid text
   _tft->setTextSize(1);
-  _tft->setTextColor(TFT_COLOR_TEXT_BODY);  
-  DrawCenteredString(LIQUID1_NAME, x, y,                    true, _dashboardLiquid == eLiquid1 ? TFT_COLOR_FOREGROUND : TFT_COLOR_BACKGROUND);
-  DrawCenteredString(LIQUID2_NAME, x, y += LOONGLINEOFFSET, true, _dashboardLiquid == eLiquid2 ? TFT_COLOR_FOREGROUND : TFT_COLOR_BACKGROUND);
-  DrawCenteredString(LIQUID3_NAME, x, y += LOONGLINEOFFSET, true, _dashboardLiquid == eLiquid3 ? TFT_COLOR_FOREGROUND : TFT_COLOR_BACKGROUND);
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    if (LIQUID_COUNT > 3)
+    {
+      _tft->setTextColor(LiquidTftColors[liquid]);
+    }
+    DrawCenteredString(LiquidNames[liquid], x, y + liquid * lineOffset, true, _dashboardLiquid == liquid ? TFT_COLOR_FOREGROUND : TFT_COLOR_BACKGROUND);
+  }
 }
 
 //===============================================================
@@ -624,96 +788,54 @@ void DisplayDriver::DrawLegend()
 //===============================================================
 void DisplayDriver::DrawCurrentValues(bool isfullUpdate)
 {
-  String liquid1_PercentageString = FormatValue(_liquid1_Percentage, 2, 0) + String("%");
-  String liquid2_PercentageString = FormatValue(_liquid2_Percentage, 2, 0) + String("%");
-  String liquid3_PercentageString = FormatValue(_liquid3_Percentage, 2, 0) + String("%");
-
+  RenderMeasurement measurement(_renderDepth);
   // Set text size
   _tft->setTextSize(1);
   
   int16_t x = 15;
   int16_t y = HEADEROFFSET_Y + 25;
 
-    // Draw base string "Mix [100%, 100%, 100% ]"
-  if (isfullUpdate)
+  // Draw base string "Mix [100%, 100%, 100% ]", more than three
+  // liquids are drawn without the brackets
+  if (isfullUpdate && LIQUID_COUNT <= 3)
   {
     _tft->setTextColor(TFT_COLOR_TEXT_BODY);
     _tft->setCursor(x, y);
     _tft->print("Mix [");
   }
 
-  x += 40;
-  if (_lastDraw_Liquid1String != liquid1_PercentageString || isfullUpdate)
-  {
-    // Reset old string on display
-    _tft->setTextColor(TFT_COLOR_BACKGROUND);
-    _tft->setCursor(x, y);
-    _tft->print(_lastDraw_Liquid1String);
-    
-    // Draw new string on display
-    _tft->setTextColor(TFT_COLOR_LIQUID_1);
-    _tft->setCursor(x, y);
-    _tft->print(liquid1_PercentageString);
-    
-    // Save last drawn string
-    _lastDraw_Liquid1String = liquid1_PercentageString;
-  }
-
-  x += 40;
-  if (isfullUpdate)
-  {
-    _tft->setTextColor(TFT_COLOR_TEXT_BODY);
-    _tft->setCursor(x, y);
-    _tft->print(",");
-  }
-
-  x += 10;
-  if (_lastDraw_Liquid2String != liquid2_PercentageString || isfullUpdate)
-  {
-    // Reset old string on display
-    _tft->setTextColor(TFT_COLOR_BACKGROUND);
-    _tft->setCursor(x, y);
-    _tft->print(_lastDraw_Liquid2String);
-    
-    // Draw new string on display
-    _tft->setTextColor(TFT_COLOR_LIQUID_2);
-    _tft->setCursor(x, y);
-    _tft->print(liquid2_PercentageString);
-
-    // Save last drawn string
-    _lastDraw_Liquid2String = liquid2_PercentageString;
-  }
-  
-  x += 40;
-  if (isfullUpdate)
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
   {
-    _tft->setTextColor(TFT_COLOR_TEXT_BODY);
-    _tft->setCursor(x, y);
-    _tft->print(",");
-  }
-  
-  x += 10;
-  if (_lastDraw_Liquid3String != liquid3_PercentageString || isfullUpdate)
-  {
-    // Reset old string on display
-    _tft->setTextColor(TFT_COLOR_BACKGROUND);
-    _tft->setCursor(x, y);
-    _tft->print(_lastDraw_Liquid3String);
-    
-    // Draw new string on display
-    _tft->setTextColor(TFT_COLOR_LIQUID_3);
-    _tft->setCursor(x, y);
-    _tft->print(liquid3_PercentageString);
+    x = LIQUID_COUNT <= 3 ? 55 + liquid * 50 : 15 + liquid * (TFT_WIDTH - 15) / LIQUID_COUNT;
+    if (isfullUpdate && LIQUID_COUNT <= 3 && liquid > 0)
+    {
+      _tft->setTextColor(TFT_COLOR_TEXT_BODY);
+      _tft->setCursor(x - 10, y);
+      _tft->print(",");
+    }
 
-    // Save last drawn string
-    _lastDraw_Liquid3String = liquid3_PercentageString;
+    String percentageString = FormatValue(_liquidPercentages[liquid], 2, 0) + String("%");
+    if (_lastDraw_LiquidStrings[liquid] != percentageString || isfullUpdate)
+    {
+      // Reset old string on display
+      _tft->setTextColor(TFT_COLOR_BACKGROUND);
+      _tft->setCursor(x, y);
+      _tft->print(_lastDraw_LiquidStrings[liquid]);
+      
+      // Draw new string on display
+      _tft->setTextColor(LiquidTftColors[liquid]);
+      _tft->setCursor(x, y);
+      _tft->print(percentageString);
+      
+      // Save last drawn string
+      _lastDraw_LiquidStrings[liquid] = percentageString;
+    }
   }
 
-  x += 45;
-  if (isfullUpdate)
+  if (isfullUpdate && LIQUID_COUNT <= 3)
   {
     _tft->setTextColor(TFT_COLOR_TEXT_BODY);
-    _tft->setCursor(x, y);
+    _tft->setCursor(x + 45, y);
     _tft->print("]");
   }
 }
@@ -723,6 +845,7 @@ void DisplayDriver::DrawCurrentValues(bool isfullUpdate)
 //===============================================================
 void DisplayDriver::DrawDoughnutChart3()
 {
+  RenderMeasurement measurement(_renderDepth);
   DrawDoughnutChart3(false, true);
 }
 
@@ -731,34 +854,35 @@ void DisplayDriver::DrawDoughnutChart3()
 //===============================================================
 void DisplayDriver::DrawDoughnutChart3(bool clockwise, bool isfullUpdate)
 {
+  RenderMeasurement measurement(_renderDepth);
+
   if (isfullUpdate)
   {
-    // Calculate count of draw_Angle's to draw
-    int16_t liquid1Distance_Degrees = GetDistanceDegrees(_liquid1Angle_Degrees, _liquid2Angle_Degrees);
-    int16_t liquid2Distance_Degrees = GetDistanceDegrees(_liquid2Angle_Degrees, _liquid3Angle_Degrees);
-    int16_t liquid3Distance_Degrees = GetDistanceDegrees(_liquid3Angle_Degrees, _liquid1Angle_Degrees);
-  
-    // Draw doughnut chart parts
-    FillArc(_liquid1Angle_Degrees, liquid1Distance_Degrees, TFT_COLOR_LIQUID_1);
-    FillArc(_liquid2Angle_Degrees, liquid2Distance_Degrees, TFT_COLOR_LIQUID_2);
-    FillArc(_liquid3Angle_Degrees, liquid3Distance_Degrees, TFT_COLOR_LIQUID_3);
+    // Draw doughnut chart parts (to the angle of the next liquid)
+    for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+    {
+      int16_t distance_Degrees = GetDistanceDegrees(_liquidAngles_Degrees[liquid], _liquidAngles_Degrees[(liquid + 1) % LIQUID_COUNT]);
+      FillArc(_liquidAngles_Degrees[liquid], distance_Degrees, LiquidTftColors[liquid]);
+    }
   }
   else
   {
-    DrawPartial(_liquid1Angle_Degrees, _lastDraw_liquid1Angle_Degrees, TFT_COLOR_LIQUID_1, TFT_COLOR_LIQUID_3, clockwise);
-    DrawPartial(_liquid2Angle_Degrees, _lastDraw_liquid2Angle_Degrees, TFT_COLOR_LIQUID_2, TFT_COLOR_LIQUID_1, clockwise);
-    DrawPartial(_liquid3Angle_Degrees, _lastDraw_liquid3Angle_Degrees, TFT_COLOR_LIQUID_3, TFT_COLOR_LIQUID_2, clockwise);
+    // Moved borders are drawn with the colors of the liquid and the previous one
+    for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+    {
+      DrawPartial(_liquidAngles_Degrees[liquid], _lastDraw_liquidAngles_Degrees[liquid], LiquidTftColors[liquid],
+        LiquidTftColors[(liquid + LIQUID_COUNT - 1) % LIQUID_COUNT], clockwise);
+    }
   }
 
   // Draw black spacer and selected white
-  FillArc(Move360(_liquid1Angle_Degrees, -SPACERANGLE_DEGREES), 2 * SPACERANGLE_DEGREES, _dashboardLiquid == eLiquid1 ? TFT_COLOR_FOREGROUND : TFT_COLOR_BACKGROUND);
-  FillArc(Move360(_liquid2Angle_Degrees, -SPACERANGLE_DEGREES), 2 * SPACERANGLE_DEGREES, _dashboardLiquid == eLiquid2 ? TFT_COLOR_FOREGROUND : TFT_COLOR_BACKGROUND);
-  FillArc(Move360(_liquid3Angle_Degrees, -SPACERANGLE_DEGREES), 2 * SPACERANGLE_DEGREES, _dashboardLiquid == eLiquid3 ? TFT_COLOR_FOREGROUND : TFT_COLOR_BACKGROUND);
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    FillArc(Move360(_liquidAngles_Degrees[liquid], -SPACERANGLE_DEGREES), 2 * SPACERANGLE_DEGREES, _dashboardLiquid == liquid ? TFT_COLOR_FOREGROUND : TFT_COLOR_BACKGROUND);
+  }
   
   // Set last drawn angles
-  _lastDraw_liquid1Angle_Degrees = _liquid1Angle_Degrees;
-  _lastDraw_liquid2Angle_Degrees = _liquid2Angle_Degrees;
-  _lastDraw_liquid3Angle_Degrees = _liquid3Angle_Degrees;
+  memcpy(_lastDraw_liquidAngles_Degrees, _liquidAngles_Degrees, sizeof(_lastDraw_liquidAngles_Degrees));
 }
 
 //===============================================================
@@ -823,6 +947,7 @@ void DisplayDriver::FillArc(int16_t start_angle, int16_t distance_Degrees, uint1
 //===============================================================
 void DisplayDriver::DrawSettings(bool isfullUpdate)
 {
+  RenderMeasurement measurement(_renderDepth);
   int16_t x = 15;
   int16_t y = HEADEROFFSET_Y + 25 + LONGLINEOFFSET;
 
@@ -887,6 +1012,7 @@ void DisplayDriver::DrawSettings(bool isfullUpdate)
 //===============================================================
 void DisplayDriver::DrawScreenSaver()
 {
+  RenderMeasurement measurement(_renderDepth);
   bool hasLogo = _imagesAvailable == IMAGE_SUCCESS;
   int16_t logoWidth = hasLogo ? _imageLogo->Width() : 0;
   int16_t logoHeight = hasLogo ? _imageLogo->Height() : 0;
@@ -15,16 +15,18 @@
 #include <Arduino.h>
 #include <SPI.h>
 #include <WiFi.h>
-#include <SPIFFS.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
 #include <Fonts/FreeSans9pt7b.h>
 #include <esp_log.h>
 #include "Config.h"
+#include "StorageDriver.h"
 #include "StateMachine.h"
 #include "SPIFFSImageReader.h"
 #include "AngleHelper.h"
 #include "FlowMeterDriver.h"
+#include "BatchDispenser.h"
+#include "Metrics.h"
 
 //===============================================================
 // Defines
@@ -51,9 +53,9 @@
 #define MENU_MARGIN_HORI            18
 #define MENU_MARGIN_ICON            8
 #define MENU_MARGIN_TEXT            47
-#define MENU_SELECTOR_HEIGHT        38
+#define MENU_SELECTOR_HEIGHT        34
 #define MENU_SELECTOR_CORNERRADIUS  8
-#define MENU_LINEOFFSET             43
+#define MENU_LINEOFFSET             36
 
 #define SHORTLINEOFFSET             20
 #define LONGLINEOFFSET              30
@@ -65,6 +67,18 @@
 //===============================================================
 // Icons
 //===============================================================
+// 'batch', 32x32px
+const unsigned char icon_batch [] PROGMEM =
+{
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x80, 0x00, 0x02, 0x20, 0x80, 0x00, 0x02, 
+	0xa8, 0xa0, 0x82, 0x0a, 0x70, 0xc0, 0x01, 0x07, 0x20, 0x80, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 
+	0x00, 0x00, 0x00, 0x00, 0x02, 0x0a, 0x28, 0x20, 0x02, 0x0a, 0x28, 0x20, 0x02, 0x0a, 0x28, 0x20, 
+	0x02, 0x0a, 0x28, 0x20, 0x02, 0x0a, 0x28, 0x20, 0x02, 0x0a, 0x28, 0x20, 0x02, 0x0a, 0x28, 0x20, 
+	0xfe, 0xfb, 0xef, 0x3f, 0xfe, 0xfb, 0xef, 0x3f, 0xfe, 0xfb, 0xef, 0x3f, 0xfe, 0xfb, 0xef, 0x3f, 
+	0xfe, 0xfb, 0xef, 0x3f, 0xfe, 0xfb, 0xef, 0x3f, 0xfe, 0xfb, 0xef, 0x3f, 0xfe, 0xfb, 0xef, 0x3f, 
+	0xfe, 0xfb, 0xef, 0x3f, 0xfe, 0xfb, 0xef, 0x3f, 0xfe, 0xfb, 0xef, 0x3f, 0xfe, 0xfb, 0xef, 0x3f, 
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
 // 'cleaning', 32x32px
 const unsigned char icon_cleaning [] PROGMEM =
 {
@@ -175,6 +189,29 @@ class Star
     bool FullStars = false;
 };
 
+//===============================================================
+// Class for the values of the batch page (compared with the last
+// drawn values, only changes are drawn)
+//===============================================================
+class BatchView
+{
+  public:
+    int16_t Glasses = 0;
+    int16_t Volume = 0;
+    uint32_t Pause_s = 0;
+    bool IsRunning = false;
+    int16_t GlassesDone = 0;
+    int32_t GlassesPerMinute_Tenths = 0;    // Shown with one decimal place
+    BatchPhase Phase = eBatchIdle;
+    BatchSetting Setting = eBatchSettingGlasses;
+
+    bool operator==(const BatchView& other) const
+    {
+      return Glasses == other.Glasses && Volume == other.Volume && Pause_s == other.Pause_s && IsRunning == other.IsRunning &&
+        GlassesDone == other.GlassesDone && GlassesPerMinute_Tenths == other.GlassesPerMinute_Tenths && Phase == other.Phase && Setting == other.Setting;
+    }
+};
+
 //===============================================================
 // Class for handling display functions
 //===============================================================
@@ -196,11 +233,14 @@ class DisplayDriver
     // Sets the cleaning liquid value
     void SetCleaningLiquid(MixtureLiquid liquid);
 
+    // Sets the selected batch setting
+    void SetBatchSetting(BatchSetting setting);
+
     // Sets the angles values
-    void SetAngles(int16_t liquid1Angle_Degrees, int16_t liquid2Angle_Degrees, int16_t liquid3Angle_Degrees);
+    void SetAngles(const int16_t (&angles_Degrees)[LIQUID_COUNT]);
 
     // Sets the percentage values
-    void SetPercentages(double liquid1_Percentage, double liquid2_Percentage, double liquid3_Percentage);
+    void SetPercentages(const double (&values_Percentage)[LIQUID_COUNT]);
 
     // Shows intro page
     void ShowIntroPage();
@@ -214,6 +254,9 @@ class DisplayDriver
     // Shows dashboard page
     void ShowDashboardPage();
     
+    // Shows batch page
+    void ShowBatchPage();
+
     // Shows cleaning page
     void ShowCleaningPage();
 
@@ -234,6 +277,9 @@ class DisplayDriver
 
     // Draw checkboxes
     void DrawCheckBoxes();
+
+    // Draws batch settings and progress partially
+    void DrawBatch(bool isfullUpdate = false);
     
     // Draws the legend
     void DrawLegend();
@@ -258,6 +304,9 @@ class DisplayDriver
     Adafruit_ST7789* _tft;
     char _output[30];
 
+    // Nesting depth of the running display update (render metric)
+    uint8_t _renderDepth = 0;
+
     // Image pointer
     SPIFFSImage* _imageBottle;
     SPIFFSImage* _imageGlass;
@@ -269,25 +318,16 @@ class DisplayDriver
     MixerState _menuState = eDashboard;
     MixtureLiquid _dashboardLiquid = eLiquid1;
     MixtureLiquid _cleaningLiquid = eLiquidAll;
-    int16_t _liquid1Angle_Degrees = 0;
-    int16_t _liquid2Angle_Degrees = 0;
-    int16_t _liquid3Angle_Degrees = 0;
-    double _liquid1_Percentage = 0.0;
-    double _liquid2_Percentage = 0.0;
-    double _liquid3_Percentage = 0.0;
+    BatchSetting _batchSetting = eBatchSettingGlasses;
+    int16_t _liquidAngles_Degrees[LIQUID_COUNT] = { };
+    double _liquidPercentages[LIQUID_COUNT] = { };
         
     // Last draw values
     MixerState _lastDraw_MenuState = eDashboard;
-    int16_t _lastDraw_liquid1Angle_Degrees = 0;
-    int16_t _lastDraw_liquid2Angle_Degrees = 0;
-    int16_t _lastDraw_liquid3Angle_Degrees = 0;
-    double _lastDraw_liquid1_Percentage = 0.0;
-    double _lastDraw_liquid2_Percentage = 0.0;
-    double _lastDraw_liquid3_Percentage = 0.0;
-    String _lastDraw_Liquid1String = "";
-    String _lastDraw_Liquid2String = "";
-    String _lastDraw_Liquid3String = "";
+    int16_t _lastDraw_liquidAngles_Degrees[LIQUID_COUNT] = { };
+    String _lastDraw_LiquidStrings[LIQUID_COUNT];
     uint32_t _lastDraw_cycleTimespan_ms = 0;
+    BatchView _lastDraw_Batch;
     wifi_mode_t _lastDraw_wifiMode = WIFI_MODE_NULL;
     uint16_t _lastDraw_ConnectedClients = 0;
 
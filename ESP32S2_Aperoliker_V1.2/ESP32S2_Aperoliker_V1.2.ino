@@ -15,6 +15,10 @@
  * - USB Firmware MSC On Boot: "Disabled"
  * - Flash Size: "4Mb (32Mb)"
  * - Partition Scheme: "No OTA (2MB APP/2MB SPIFFS)"
+ * - Data upload: SPIFFS image (LittleFS image with STORAGE_LITTLEFS,
+ *   switching the file system is an upgrade step, see Config.h).
+ *   Optional: 'python3 tools/BuildWebAssets.py data <folder>' gzips
+ *   the web page with content hashed names, upload <folder> instead
  * - PSRAM: "Enabled"
  * - Upload Mode: "Internal USB"
  * - Upload Speed: "921600"
@@ -39,18 +43,21 @@
 #include <Arduino.h>
 #include <USB.h>
 #include <SPI.h>
-#include <SPIFFS.h>
 #include <WiFi.h>
 #include <Adafruit_ST7789.h>
 #include <esp_log.h>
 #include "Config.h"
 #include "SystemHelper.h"
+#include "StorageDriver.h"
 #include "StateMachine.h"
 #include "EncoderButtonDriver.h"
 #include "PumpDriver.h"
 #include "DisplayDriver.h"
 #include "FlowMeterDriver.h"
+#include "PourLogger.h"
+#include "PresetStore.h"
 #include "WifiHandler.h"
+#include "InputEventQueue.h"
 
 //===============================================================
 // Constants
@@ -69,9 +76,16 @@ static const char* TAG = "main";
 #define PIN_PUMP_1              1     // GPIO 1  -> pump 1 power
 #define PIN_PUMP_2              2     // GPIO 2  -> pump 2 power
 #define PIN_PUMP_3              4     // GPIO 4  -> pump 3 power
+#define PIN_PUMP_4              5     // GPIO 5  -> pump 4 power (LIQUID_COUNT >= 4)
+#define PIN_PUMP_5              9     // GPIO 9  -> pump 5 power (LIQUID_COUNT >= 5)
+#define PIN_PUMP_6              14    // GPIO 14 -> pump 6 power (LIQUID_COUNT >= 6)
+#define PIN_PUMP(liquid)        PIN_PUMP_##liquid
 #define PIN_PUMPS_ENABLE        12    // GPIO 12 -> dispensing lever pumps enable, input
 #define PIN_PUMPS_ENABLE_GND    13    // GPIO 13 -> dispensing lever pumps enable, GND
 
+// Pump pins of the liquids
+static const uint8_t PumpPins[LIQUID_COUNT] = { LIQUID_LIST(PIN_PUMP) };
+
 // Display pin defines
 #define PIN_TFT_DC              37    // GPIO 37 -> TFT data/command
 #define PIN_TFT_RST             38    // GPIO 38 -> TFT reset
@@ -107,6 +121,9 @@ const uint32_t AliveTime_ms = 2000;
 uint32_t blinkTimestamp = 0;
 const uint32_t BlinkTime_ms = 100;
 
+// Timer variable for pump update period (delay of the loop task)
+uint32_t pumpUpdateTimestamp_us = 0;
+
 // Task handles
 TaskHandle_t mainTaskHandle = NULL;
 TaskHandle_t timerTaskHandle = NULL;
@@ -118,11 +135,15 @@ void IRAM_ATTR ISR_Pumps_Enable()
 {
   // If rising edge (button was released) -> disable pumps
   // If falling edge (button was pressed) -> enable pumps
-  if (digitalRead(PIN_PUMPS_ENABLE))
+  bool released = digitalRead(PIN_PUMPS_ENABLE);
+  if (released)
   {
     // Disable pump power
     Pumps.Disable();
 
+    // Stop pour log event (after the last flow time is added)
+    PourLog.StopPour();
+
     // Request save flow values to flash
     FlowMeter.RequestSaveAsync();
   }
@@ -131,10 +152,17 @@ void IRAM_ATTR ISR_Pumps_Enable()
   {
     // Enable pump power
      Pumps.Enable();
+
+    // Start pour log event
+    PourLog.StartPour(Statemachine.GetCurrentState());
   }
 
-  // Update last user interaction
-  Systemhelper.SetLastUserAction();
+  // Queue lever event and wake main task
+  InputEvents.Push(eInputLever, released ? 0 : 1);
+  if (Statemachine.WakeFromISR())
+  {
+    portYIELD_FROM_ISR();
+  }
 }
 
 //===============================================================
@@ -143,22 +171,21 @@ void IRAM_ATTR ISR_Pumps_Enable()
 void IRAM_ATTR ISR_EncoderButton()
 {
   EncoderButton.ButtonEvent();
+  InputEvents.Push(eInputButton, digitalRead(PIN_ENCODER_BUTTON) ? 0 : 1);
+  if (Statemachine.WakeFromISR())
+  {
+    portYIELD_FROM_ISR();
+  }
 }
 
 //===============================================================
-// Interrupt on encoder out A
-//===============================================================
-void IRAM_ATTR ISR_EncoderA()
-{
-  EncoderButton.DoEncoderA();
-}
-
-//===============================================================
-// Interrupt on encoder out B
+// Interrupt on encoder detent (from pulse counter, which yields
+// to the woken main task)
 //===============================================================
-void IRAM_ATTR ISR_EncoderB()
+bool IRAM_ATTR ISR_EncoderDetent(int8_t direction)
 {
-  EncoderButton.DoEncoderB();
+  InputEvents.Push(eInputEncoder, direction);
+  return Statemachine.WakeFromISR();
 }
 
 //===============================================================
@@ -177,10 +204,9 @@ void setup(void)
 #endif
   ESP_LOGI(TAG, "Setup %s %s", MIXER_NAME, APP_VERSION);
 
-  // Initialize SPIFFS
-  ESP_LOGI(TAG, "Initialize SPIFFS");
-  SPIFFS.end(); // Close first for begin with 'formatOnFail'
-  bool spiffsAvailable = SPIFFS.begin(true);
+  // Initialize storage
+  ESP_LOGI(TAG, "Initialize storage");
+  bool spiffsAvailable = Storage.Begin();
 
   // Initialize system helper
   Systemhelper.Begin();
@@ -225,14 +251,16 @@ void setup(void)
 
   // Initialize encoder button
   ESP_LOGI(TAG, "Initialize encoder button");
-  EncoderButton.Begin(PIN_ENCODER_OUTA, PIN_ENCODER_OUTB, PIN_ENCODER_BUTTON);
-  attachInterrupt(digitalPinToInterrupt(PIN_ENCODER_OUTA), ISR_EncoderA, CHANGE);
-  attachInterrupt(digitalPinToInterrupt(PIN_ENCODER_OUTB), ISR_EncoderB, CHANGE);
+  EncoderButton.Begin(PIN_ENCODER_OUTA, PIN_ENCODER_OUTB, PIN_ENCODER_BUTTON, ISR_EncoderDetent);
   attachInterrupt(digitalPinToInterrupt(PIN_ENCODER_BUTTON), ISR_EncoderButton, CHANGE);
 
-  // Initialize flow values from EEPROM
-  ESP_LOGI(TAG, "Initialize flow values from EEPROM");
-  FlowMeter.Load();
+  // Initialize flow meter with values from flash
+  ESP_LOGI(TAG, "Initialize flow meter");
+  FlowMeter.Begin(spiffsAvailable);
+
+  // Initialize pour logger
+  ESP_LOGI(TAG, "Initialize pour logger");
+  PourLog.Begin(spiffsAvailable);
 
   // Get VCC voltage (Only for Custom PCB)
   double vccVoltage = analogReadMilliVolts(PIN_VCC) * VCC_CONVERSION_FACTOR;
@@ -240,14 +268,21 @@ void setup(void)
   
   // Initialize pump driver
   ESP_LOGI(TAG, "Initialize pump driver");
-  Pumps.Begin(PIN_PUMP_1, PIN_PUMP_2, PIN_PUMP_3, vccVoltage);
+  Pumps.Begin(PumpPins, vccVoltage);
+
+  // Initialize recipe presets
+  ESP_LOGI(TAG, "Initialize preset store");
+  Presets.Begin();
 
   // Initialize state machine
   ESP_LOGI(TAG, "Initialize state machine");
   Statemachine.Begin(PIN_BUZZER);
   
   // Wait for the rest of the intro time
-  while ((millis() - startupTime_ms) < INTRO_TIME_MS) { };
+  while ((millis() - startupTime_ms) < INTRO_TIME_MS)
+  {
+    delay(1);
+  }
 
   // Allow interrupts for encoder button
   sei();
@@ -297,6 +332,7 @@ void setup(void)
   // Start main task
   ESP_LOGI(TAG, "Start main task");
   xTaskCreate(Main_Task, "Main_Task", 4096, NULL, 10, &mainTaskHandle);
+  Statemachine.SetTaskHandle(mainTaskHandle);
 
   // Final output
   ESP_LOGI(TAG, "Setup Finished");
@@ -319,6 +355,9 @@ void loop()
     // Print memory information
     ESP_LOGI(TAG, "%s", Systemhelper.GetMemoryInfoString().c_str());
 
+    // Publish flow meter values for the metrics endpoint
+    FlowMeter.PublishMetrics();
+
     // Toggle status LED
     digitalWrite(PIN_LEDSTATUS, !digitalRead(PIN_LEDSTATUS));
   }
@@ -340,11 +379,20 @@ void loop()
   }
 
   // Update pump outputs
+  uint32_t pumpUpdate_us = micros();
+  if (pumpUpdateTimestamp_us != 0)
+  {
+    Metrics.Observe(eMetricPumpUpdatePeriod, pumpUpdate_us - pumpUpdateTimestamp_us);
+  }
+  pumpUpdateTimestamp_us = pumpUpdate_us;
   Pumps.Update();
 
   // Save flow meter values to flash if requested
   FlowMeter.SaveAsync();
 
+  // Write pour log records to flash
+  PourLog.Update();
+
 #if defined(WIFI_MIXER)
   // Update wifi, webserver and clients
   Wifihandler.Update();
@@ -358,11 +406,15 @@ void Main_Task(void *arg)
 {
   while(1)
   {
-    // Run statemachine with main task event
+    // Take input events and run statemachine with main task event
+    uint32_t startTime_us = micros();
+    Statemachine.ProcessInputEvents();
     Statemachine.Execute(eMain);
+    Metrics.Observe(eMetricLoopDuration, micros() - startTime_us);
 
-    // Execution time for the other tasks
-    vTaskDelay(pdMS_TO_TICKS(5));
+    // Wait for new events (input interrupts, wifi) or the next cycle
+    // required by the current state. Gives execution time to the other tasks
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(Statemachine.GetCycleTime_ms()));
   }
 }
 
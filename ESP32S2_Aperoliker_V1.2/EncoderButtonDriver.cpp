@@ -31,7 +31,7 @@ EncoderButtonDriver::EncoderButtonDriver()
 //===============================================================
 // Initializes the encoder and button driver
 //===============================================================
-void EncoderButtonDriver::Begin(uint8_t pinEncoderOutA, uint8_t pinEncoderOutB, uint8_t pinEncoderButton)
+void EncoderButtonDriver::Begin(uint8_t pinEncoderOutA, uint8_t pinEncoderOutB, uint8_t pinEncoderButton, EncoderDetentCallback detentCallback)
 {
   // Log startup info
   ESP_LOGI(TAG, "Begin initializing encoder and button driver");
@@ -40,8 +40,15 @@ void EncoderButtonDriver::Begin(uint8_t pinEncoderOutA, uint8_t pinEncoderOutB,
   _pinEncoderOutA = pinEncoderOutA;
   _pinEncoderOutB = pinEncoderOutB;
   _pinEncoderButton = pinEncoderButton;
+  _detentCallback = detentCallback;
 
-  // Initialize GPIOs
+  // Initialize pulse counter (quadrature decoding in hardware)
+  if (!BeginPulseCounter())
+  {
+    ESP_LOGE(TAG, "Could not initialize pulse counter, encoder disabled");
+  }
+
+  // Initialize GPIOs (after pulse counter, to keep the pull-ups)
   pinMode(_pinEncoderOutA, INPUT_PULLUP);
   pinMode(_pinEncoderOutB, INPUT_PULLUP);
   pinMode(_pinEncoderButton, INPUT_PULLUP);
@@ -55,21 +62,21 @@ void EncoderButtonDriver::Begin(uint8_t pinEncoderOutA, uint8_t pinEncoderOutB,
 //===============================================================
 bool EncoderButtonDriver::IsButtonPress()
 {
+  // Classify new button edges
+  ProcessButtonEdges();
+
   // Save current state
-  bool isButtonPress = _isButtonPress;
+  bool isButtonPress = _isButtonPress && !IsInputSuppressed();
+
+  // Reset button press flag
+  _isButtonPress = false;
   
-  if (_isButtonPress)
+  if (isButtonPress)
   {
-    // Debounce
-    delay(100);
-    
     // Update last user interaction
     Systemhelper.SetLastUserAction();
   }
 
-  // Reset button press flag
-  _isButtonPress = false;
-  
   // Return result
   return isButtonPress;
 }
@@ -79,17 +86,16 @@ bool EncoderButtonDriver::IsButtonPress()
 //===============================================================
 bool EncoderButtonDriver::IsLongButtonPress()
 {
-  // Save current state
-  uint32_t lastButtonPress_ms = _lastButtonPress_ms;
+  // Classify new button edges
+  ProcessButtonEdges();
  
-  // Check if long press condition is true (button currently pressed & time longer than threshold)
-  bool isLongButtonPress = !digitalRead(_pinEncoderButton) && (millis() - lastButtonPress_ms) >= MINIMUMLONGTIMEPRESS_MS;
+  // Check if long press condition is true (button currently pressed & time longer than threshold,
+  // reported once per press)
+  bool isLongButtonPress = !IsInputSuppressed() && _isButtonDown && !_suppressShortButtonPress &&
+    (millis() - _lastButtonPress_ms) >= MINIMUMLONGTIMEPRESS_MS;
     
   if (isLongButtonPress)
   {
-    // Reset button press timestamp
-    _lastButtonPress_ms = 0;
-
     // Suppress upcoming next short button press (Long button press appears while pressing
     // the button. Next button press release is therefore no short button press)
     _suppressShortButtonPress = true;
@@ -103,78 +109,231 @@ bool EncoderButtonDriver::IsLongButtonPress()
 }
 
 //===============================================================
-// Returns the counted encoder pulses since the last query and 
-// resets the counter
+// Return true, if the button is currently held down
 //===============================================================
-int16_t EncoderButtonDriver::GetEncoderIncrements()
+bool EncoderButtonDriver::IsButtonDown()
 {
-  // Save current increments value
-  int16_t currentEncoderIncrements = _encoderIncrements;
-  
-  // Reset the counter
-  _encoderIncrements = 0;
+  // Classify new button edges
+  ProcessButtonEdges();
+
+  return _isButtonDown;
+}
 
-  if (currentEncoderIncrements != 0)
+//===============================================================
+// Returns the counted encoder detents since the last query and 
+// resets the counter. Accelerated increments grow with the
+// turning speed
+//===============================================================
+int16_t EncoderButtonDriver::GetEncoderIncrements(bool accelerated)
+{
+  int count = GetEncoderCount();
+
+  // Discard input while suppressed
+  if (IsInputSuppressed())
   {
-    // Update last user interaction
-    Systemhelper.SetLastUserAction();
+    _encoderCount = count;
+    return 0;
+  }
+
+  // Full detents since the last query (partial detents are kept)
+  int16_t detents = (count - _encoderCount) / ENCODER_COUNTS_PER_DETENT;
+  _encoderCount += detents * ENCODER_COUNTS_PER_DETENT;
+
+  if (detents == 0)
+  {
+    return 0;
   }
 
+  // Calculate increments from the turning speed
+  uint32_t elapsed_ms = millis() - _encoderTimestamp_ms;
+  _encoderTimestamp_ms = millis();
+  int16_t currentEncoderIncrements = ENCODER_DIRECTION * (accelerated ? AccelerateEncoderIncrements(detents, elapsed_ms) : detents);
+
+  // Update last user interaction
+  Systemhelper.SetLastUserAction();
+
   // Return increments
   return currentEncoderIncrements;
 }
 
 //===============================================================
-// Interrupt on button changing state
+// Discards pending input and ignores new input for the given time
+// (replaces blocking debounce delays)
+//===============================================================
+void EncoderButtonDriver::SuppressInput(uint32_t duration_ms)
+{
+  _suppressInputTimestamp_ms = millis();
+  _suppressInputDuration_ms = duration_ms;
+
+  // Discard pending input
+  _encoderCount = GetEncoderCount();
+  ProcessButtonEdges();
+  _isButtonPress = false;
+}
+
+//===============================================================
+// Return true, if input is currently ignored
+//===============================================================
+bool EncoderButtonDriver::IsInputSuppressed()
+{
+  return IsInputSuppressed(millis());
+}
+
+//===============================================================
+// Return true, if input was ignored at the given time
+//===============================================================
+bool EncoderButtonDriver::IsInputSuppressed(uint32_t timestamp_ms)
+{
+  return (timestamp_ms - _suppressInputTimestamp_ms) < _suppressInputDuration_ms;
+}
+
+//===============================================================
+// Interrupt on button changing state. Only queues the edge, the
+// classification is done by the main task
 //===============================================================
 void EncoderButtonDriver::ButtonEvent()
 {
-  // Check for falling edge (Pressed)
-  if (!digitalRead(_pinEncoderButton))
+  // Drop edge, if the main task is not keeping up
+  uint32_t head = _buttonEdgesHead.load(std::memory_order_relaxed);
+  if ((head - _buttonEdgesTail.load(std::memory_order_acquire)) >= BUTTON_EDGE_FIFO_SIZE)
   {
-    // Save press button timestamp
-    _lastButtonPress_ms = millis();
-  }
-  // Check for rising edge (Released)
-  else
-  {
-    // Show short button press
-    // Is linked with the suppress flag (flag is true, if it was a long button press and we have to discard this)
-    _isButtonPress = !_suppressShortButtonPress;
-    _suppressShortButtonPress = false;
+    _buttonEdgesLost = true;
+    return;
   }
+
+  _buttonEdges[head % BUTTON_EDGE_FIFO_SIZE] = { millis(), !digitalRead(_pinEncoderButton) };
+  _buttonEdgesHead.store(head + 1, std::memory_order_release);
 }
 
 //===============================================================
-// Should be called if encoder edge A changed
+// Classifies the button edges from the interrupt service routine
+// into short presses (on release) and press timestamps for long
+// presses. Presses shorter than the minimum time are bounce
 //===============================================================
-void EncoderButtonDriver::DoEncoderA()
+void EncoderButtonDriver::ProcessButtonEdges()
 {
-  if (digitalRead(_pinEncoderOutA) != _A_set)
+  uint32_t tail = _buttonEdgesTail.load(std::memory_order_relaxed);
+  while (tail != _buttonEdgesHead.load(std::memory_order_acquire))
   {
-    _A_set = !_A_set;
-    
-    // Adjust counter if A leads B in positive direction
-    if (_A_set && !_B_set) 
+    ButtonEdge edge = _buttonEdges[tail % BUTTON_EDGE_FIFO_SIZE];
+    _buttonEdgesTail.store(++tail, std::memory_order_release);
+
+    // Skip repeated levels (bounce between two samples)
+    if (edge.Pressed == _isButtonDown)
+    {
+      continue;
+    }
+    _isButtonDown = edge.Pressed;
+
+    // Check for falling edge (Pressed)
+    if (edge.Pressed)
     {
-      _encoderIncrements = _encoderIncrements + ENCODER_DIRECTION;
+      // Save press button timestamp
+      _lastButtonPress_ms = edge.Timestamp_ms;
     }
+    // Check for rising edge (Released)
+    else
+    {
+      // Show short button press
+      // Is linked with the suppress flag (flag is true, if it was a long button press and we have to discard this)
+      _isButtonPress = _isButtonPress ||
+        (!_suppressShortButtonPress &&
+        !IsInputSuppressed(edge.Timestamp_ms) &&
+        (edge.Timestamp_ms - _lastButtonPress_ms) >= MINIMUMSHORTTIMEPRESS_MS);
+      _suppressShortButtonPress = false;
+    }
+  }
+
+  // Resynchronize button state after lost edges
+  if (_buttonEdgesLost.exchange(false))
+  {
+    ESP_LOGE(TAG, "Button edges lost");
+    _isButtonDown = !digitalRead(_pinEncoderButton);
+    _suppressShortButtonPress = _isButtonDown;
   }
 }
 
 //===============================================================
-// Should be called if encoder edge B changed
+// Initializes the pulse counter for quadrature decoding. Both
+// channels count all edges (4 per detent), the counter wraps at
+// one detent and accumulates, so the watch points fire once per
+// detent to wake the main task
 //===============================================================
-void EncoderButtonDriver::DoEncoderB()
+bool EncoderButtonDriver::BeginPulseCounter()
 {
-  if (digitalRead(_pinEncoderOutB) != _B_set)
+  pcnt_unit_config_t unitConfig = { };
+  unitConfig.low_limit = -ENCODER_COUNTS_PER_DETENT;
+  unitConfig.high_limit = ENCODER_COUNTS_PER_DETENT;
+  unitConfig.flags.accum_count = true;
+  if (pcnt_new_unit(&unitConfig, &_pcntUnit) != ESP_OK)
   {
-    _B_set = !_B_set;
-    
-    // Adjust counter if B leads A in negative direction
-    if (_B_set && !_A_set) 
-    {
-      _encoderIncrements = _encoderIncrements - ENCODER_DIRECTION;
-    }
+    return false;
+  }
+
+  pcnt_glitch_filter_config_t filterConfig = { };
+  filterConfig.max_glitch_ns = ENCODER_GLITCH_FILTER_NS;
+  pcnt_unit_set_glitch_filter(_pcntUnit, &filterConfig);
+
+  // Channel A counts on edges of A, direction from level of B
+  pcnt_chan_config_t channelAConfig = { };
+  channelAConfig.edge_gpio_num = _pinEncoderOutA;
+  channelAConfig.level_gpio_num = _pinEncoderOutB;
+  pcnt_channel_handle_t channelA = NULL;
+  if (pcnt_new_channel(_pcntUnit, &channelAConfig, &channelA) != ESP_OK)
+  {
+    return false;
+  }
+  pcnt_channel_set_edge_action(channelA, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+  pcnt_channel_set_level_action(channelA, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+
+  // Channel B counts on edges of B, direction from level of A
+  pcnt_chan_config_t channelBConfig = { };
+  channelBConfig.edge_gpio_num = _pinEncoderOutB;
+  channelBConfig.level_gpio_num = _pinEncoderOutA;
+  pcnt_channel_handle_t channelB = NULL;
+  if (pcnt_new_channel(_pcntUnit, &channelBConfig, &channelB) != ESP_OK)
+  {
+    return false;
+  }
+  pcnt_channel_set_edge_action(channelB, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+  pcnt_channel_set_level_action(channelB, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+
+  // Watch points on the limits are required for accumulating the count
+  pcnt_unit_add_watch_point(_pcntUnit, -ENCODER_COUNTS_PER_DETENT);
+  pcnt_unit_add_watch_point(_pcntUnit, ENCODER_COUNTS_PER_DETENT);
+  pcnt_event_callbacks_t callbacks = { };
+  callbacks.on_reach = OnDetent;
+  pcnt_unit_register_event_callbacks(_pcntUnit, &callbacks, this);
+
+  return pcnt_unit_enable(_pcntUnit) == ESP_OK &&
+    pcnt_unit_clear_count(_pcntUnit) == ESP_OK &&
+    pcnt_unit_start(_pcntUnit) == ESP_OK;
+}
+
+//===============================================================
+// Returns the current pulse counter value
+//===============================================================
+int EncoderButtonDriver::GetEncoderCount()
+{
+  int count = 0;
+  if (_pcntUnit != NULL)
+  {
+    pcnt_unit_get_count(_pcntUnit, &count);
+  }
+  return count;
+}
+
+//===============================================================
+// Called by the pulse counter on every encoder detent. Returns
+// true, if a higher priority task was woken (the pulse counter
+// driver yields at the end of the interrupt)
+//===============================================================
+bool EncoderButtonDriver::OnDetent(pcnt_unit_handle_t unit, const pcnt_watch_event_data_t* eventData, void* userContext)
+{
+  EncoderButtonDriver* driver = (EncoderButtonDriver*)userContext;
+  if (driver->_detentCallback == NULL)
+  {
+    return false;
   }
+  return driver->_detentCallback(eventData->watch_point_value > 0 ? ENCODER_DIRECTION : -ENCODER_DIRECTION);
 }
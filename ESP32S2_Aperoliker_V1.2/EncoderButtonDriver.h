@@ -13,7 +13,9 @@
 // Includes
 //===============================================================
 #include <Arduino.h>
+#include <atomic>
 #include <esp_log.h>
+#include <driver/pulse_cnt.h>
 #include "Config.h"
 #include "SystemHelper.h"
 
@@ -21,6 +23,50 @@
 // Defines
 //===============================================================
 #define MINIMUMLONGTIMEPRESS_MS   500
+#define MINIMUMSHORTTIMEPRESS_MS  30      // Shorter presses are contact bounce
+#define BUTTON_EDGE_FIFO_SIZE     16      // Button edges between interrupt and main task (power of two)
+
+#define ENCODER_COUNTS_PER_DETENT 4       // Quadrature edges per encoder detent
+#define ENCODER_GLITCH_FILTER_NS  1000    // Pulses shorter than 1us are ignored (EMI spikes, contact bounce is handled by the quadrature decoding)
+#define ENCODER_ACCEL_MIN_RATE    10      // Detents per second without acceleration
+#define ENCODER_ACCEL_MAX_RATE    40      // Detents per second for maximum acceleration
+#define ENCODER_ACCEL_MAX_FACTOR  4       // Maximum increments per detent
+
+//===============================================================
+// Structs
+//===============================================================
+// Button edge captured by the interrupt service routine
+struct ButtonEdge
+{
+  uint32_t Timestamp_ms;
+  bool Pressed;
+};
+
+//===============================================================
+// Typedefs
+//===============================================================
+// Called from interrupt service routine on every encoder detent
+// with the turning direction (+1/-1). Returns true, if a higher
+// priority task was woken
+typedef bool (*EncoderDetentCallback)(int8_t direction);
+
+//===============================================================
+// Returns the increments for the detents turned within the elapsed
+// time. Fast spins result in up to ENCODER_ACCEL_MAX_FACTOR
+// increments per detent
+//===============================================================
+constexpr int16_t AccelerateEncoderIncrements(int16_t detents, uint32_t elapsed_ms)
+{
+  // Detents per second (elapsed time of 0ms is treated as 1ms)
+  uint32_t rate = (uint32_t)(detents < 0 ? -detents : detents) * 1000 / (elapsed_ms > 0 ? elapsed_ms : 1);
+
+  // Linear factor between minimum and maximum rate
+  int16_t factor = rate <= ENCODER_ACCEL_MIN_RATE ? 1 :
+    rate >= ENCODER_ACCEL_MAX_RATE ? ENCODER_ACCEL_MAX_FACTOR :
+    1 + (int16_t)((rate - ENCODER_ACCEL_MIN_RATE) * (ENCODER_ACCEL_MAX_FACTOR - 1) / (ENCODER_ACCEL_MAX_RATE - ENCODER_ACCEL_MIN_RATE));
+
+  return detents * factor;
+}
 
 //===============================================================
 // Class for handling encoder and button functions
@@ -32,7 +78,7 @@ class EncoderButtonDriver
     EncoderButtonDriver();
 
     // Initializes the encoder and button driver
-    void Begin(uint8_t pinEncoderOutA, uint8_t pinEncoderOutB, uint8_t pinEncoderButton);
+    void Begin(uint8_t pinEncoderOutA, uint8_t pinEncoderOutB, uint8_t pinEncoderButton, EncoderDetentCallback detentCallback = NULL);
     
     // Return true, if a button press is pending. Otherwise false
     bool IsButtonPress();
@@ -40,15 +86,19 @@ class EncoderButtonDriver
     // Return true, if a long button press is pending. Otherwise false
     bool IsLongButtonPress();
 
-    // Returns the counted encoder pulses since the last query and resets the counter
-    int16_t GetEncoderIncrements();
+    // Return true, if the button is currently held down
+    bool IsButtonDown();
 
-    // Should be called if encoder edge A changed
-    void IRAM_ATTR DoEncoderA();
+    // Returns the counted encoder detents since the last query and resets the counter.
+    // Accelerated increments grow with the turning speed
+    int16_t GetEncoderIncrements(bool accelerated = false);
+
+    // Discards pending input and ignores new input for the given time
+    void SuppressInput(uint32_t duration_ms);
+
+    // Return true, if input is currently ignored
+    bool IsInputSuppressed();
 
-    // Should be called if encoder edge B changed
-    void IRAM_ATTR DoEncoderB();
-    
     // Should be called if button was pressed or released
     void IRAM_ATTR ButtonEvent();
 
@@ -58,17 +108,44 @@ class EncoderButtonDriver
     uint8_t _pinEncoderOutB;
     uint8_t _pinEncoderButton;
 
-    // Interrupt service routine variables
-    bool _A_set = false;
-    bool _B_set = false;
+    // Pulse counter variables
+    pcnt_unit_handle_t _pcntUnit = NULL;
+    EncoderDetentCallback _detentCallback = NULL;
+
+    // Rotary encoder variables (count of the last query)
+    int _encoderCount = 0;
+    uint32_t _encoderTimestamp_ms = 0;
 
-    // Rotary encoder variables
-    int16_t _encoderIncrements = 0;
+    // Button edges (single producer interrupt, single consumer main task)
+    ButtonEdge _buttonEdges[BUTTON_EDGE_FIFO_SIZE];
+    std::atomic<uint32_t> _buttonEdgesHead{0};
+    std::atomic<uint32_t> _buttonEdgesTail{0};
+    std::atomic<bool> _buttonEdgesLost{false};
 
-    // Encoder state variables
+    // Button state variables (only accessed by main task)
+    bool _isButtonDown = false;
     bool _isButtonPress = false;
     uint32_t _lastButtonPress_ms = 0;
     bool _suppressShortButtonPress = false;
+
+    // Input suppression window
+    uint32_t _suppressInputTimestamp_ms = 0;
+    uint32_t _suppressInputDuration_ms = 0;
+
+    // Classifies the button edges from the interrupt service routine
+    void ProcessButtonEdges();
+
+    // Return true, if input was ignored at the given time
+    bool IsInputSuppressed(uint32_t timestamp_ms);
+
+    // Initializes the pulse counter for quadrature decoding
+    bool BeginPulseCounter();
+
+    // Returns the current pulse counter value
+    int GetEncoderCount();
+
+    // Called by the pulse counter on every encoder detent
+    static bool IRAM_ATTR OnDetent(pcnt_unit_handle_t unit, const pcnt_watch_event_data_t* eventData, void* userContext);
 };
 
 //===============================================================
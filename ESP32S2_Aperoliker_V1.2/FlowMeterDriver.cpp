@@ -15,6 +15,7 @@
 // Constants
 //===============================================================
 static const char* TAG = "flowmeter";
+static const char* const LegacyFlowKeys[] = { KEY_FLOW_LIQUID1, KEY_FLOW_LIQUID2, KEY_FLOW_LIQUID3 };
 
 //===============================================================
 // Global variables
@@ -31,11 +32,14 @@ FlowMeterDriver::FlowMeterDriver()
 //===============================================================
 // Initializes the flow meter driver
 //===============================================================
-void FlowMeterDriver::Begin()
+void FlowMeterDriver::Begin(bool spiffsAvailable)
 {
   // Log startup info
   ESP_LOGI(TAG, "Begin initializing flow meter driver");
 
+  // Journal is only used, if the storage is available
+  _spiffsAvailable = spiffsAvailable;
+
   // Load settings from flash
   Load();
 
@@ -44,91 +48,206 @@ void FlowMeterDriver::Begin()
 }
 
 //===============================================================
-// Load settings from flash
+// Load settings from flash and replay journal
 //===============================================================
 void FlowMeterDriver::Load()
 {
-  if (_preferences.begin(SETTINGS_NAME, true))
+  FlowBase base = { };
+  
+  // Read only access fails, if the namespace does not exist yet (first start)
+  _baseLoaded = false;
+  if (_preferences.begin(SETTINGS_NAME, true) ||
+    _preferences.begin(SETTINGS_NAME, false))
   {
-    _valueLiquid1_L = _preferences.getDouble(KEY_FLOW_LIQUID1, 0.0);
-    _valueLiquid2_L = _preferences.getDouble(KEY_FLOW_LIQUID2, 0.0);
-    _valueLiquid3_L = _preferences.getDouble(KEY_FLOW_LIQUID3, 0.0);
+    if (_preferences.getBytesLength(KEY_FLOW_BASE) == sizeof(FlowBase))
+    {
+      _preferences.getBytes(KEY_FLOW_BASE, &base, sizeof(FlowBase));
+    }
+    else
+    {
+      // Values of older versions are stored in liters, convert them to flow times
+      for (uint8_t liquid = 0; liquid < LIQUID_COUNT && liquid < sizeof(LegacyFlowKeys) / sizeof(LegacyFlowKeys[0]); liquid++)
+      {
+        base.FlowTimes_ms[liquid] = (uint32_t)(_preferences.getDouble(LegacyFlowKeys[liquid], 0.0) / FlowRates[liquid] + 0.5);
+      }
+    }
     _preferences.end();
+    _baseLoaded = true;
     
     ESP_LOGI(TAG, "Preferences successfully loaded from '%s'", SETTINGS_NAME);
   }
   else
   {
+    // Base and journal stay untouched, the values of this run are not saved
     ESP_LOGE(TAG, "Could not open preferences '%s'", SETTINGS_NAME);
+    _spiffsAvailable = false;
+  }
+
+  // Replay journal records on top of the base values
+  _journalSequence = base.Sequence;
+  _journalRecords = 0;
+  bool journalValid = ReplayJournal(&base);
+
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    _flowTimes_ms[liquid] = base.FlowTimes_ms[liquid];
+    _savedFlowTimes_ms[liquid] = base.FlowTimes_ms[liquid];
+  }
+
+  // Drop damaged journal tail (e.g. power loss while appending)
+  if (!journalValid &&
+    _baseLoaded)
+  {
+    ESP_LOGE(TAG, "Journal '%s' damaged after %d records, compacting", FLOW_JOURNAL_FILE, _journalRecords);
+    if (!Compact(base.FlowTimes_ms))
+    {
+      // Records appended behind the damaged tail would be lost
+      _spiffsAvailable = false;
+    }
   }
 }
 
 //===============================================================
-// Save settings to flash
+// Save settings to flash and compact journal
 //===============================================================
 void FlowMeterDriver::Save()
 {
-  if (_preferences.begin(SETTINGS_NAME, false))
+  // Get consistent snapshot of all values
+  uint32_t flowTimes_ms[LIQUID_COUNT];
+  if (!GetFlowTimes(flowTimes_ms))
   {
-    _preferences.putDouble(KEY_FLOW_LIQUID1, _valueLiquid1_L);
-    _preferences.putDouble(KEY_FLOW_LIQUID2, _valueLiquid2_L);
-    _preferences.putDouble(KEY_FLOW_LIQUID3, _valueLiquid3_L); 
-    _preferences.end();
-
-    ESP_LOGI(TAG, "Preferences successfully saved to '%s'", SETTINGS_NAME);
-  }
-  else
-  {
-    ESP_LOGE(TAG, "Could not open preferences '%s'", SETTINGS_NAME);
+    // Every value is complete on its own, a write in progress is
+    // only saved partly and the remainder with the next save
+    ESP_LOGW(TAG, "Flow times changed while saving");
   }
+
+  Compact(flowTimes_ms);
 }
 
 //===============================================================
-// Returns true, if a save call is pending to be executed by the
-// loop task
+// Appends a journal record, if an async request is pending and
+// the batch interval or batch volume is reached. Must be called
+// from the loop task only
 //===============================================================
 void FlowMeterDriver::SaveAsync()
 {
-  if (_isSavePending)
+  if (!_isSavePending.exchange(false))
   {
-    _isSavePending = false;
-    ESP_LOGI(TAG, "Save flow meter is pending");
-    Save();
+    return;
+  }
+
+  // Get consistent snapshot of all values
+  uint32_t flowTimes_ms[LIQUID_COUNT];
+  if (!GetFlowTimes(flowTimes_ms))
+  {
+    // Keep request pending for the next call
+    _isSavePending = true;
+    return;
+  }
+
+  // Check batch interval and batch volume
+  double unsaved_L = 0.0;
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    unsaved_L += (double)(flowTimes_ms[liquid] - _savedFlowTimes_ms[liquid]) * FlowRates[liquid];
+  }
+  if ((millis() - _journalTimestamp) < FLOW_JOURNAL_INTERVAL_MS &&
+    unsaved_L < (FLOW_JOURNAL_BATCH_ML / 1000.0))
+  {
+    // Keep request pending for the next call
+    _isSavePending = true;
+    return;
+  }
+  _journalTimestamp = millis();
+
+  ESP_LOGI(TAG, "Save flow meter is pending");
+
+  // Fall back to preferences, if journal is not available
+  if (!AppendJournal(flowTimes_ms) ||
+    _journalRecords >= FLOW_JOURNAL_MAX_RECORDS)
+  {
+    Compact(flowTimes_ms);
   }
 }
 
 //===============================================================
-// Returns current flow meter value for liquid 1
+// Returns current flow meter value of a liquid
 //===============================================================
-double FlowMeterDriver::GetValueLiquid1()
+double FlowMeterDriver::GetValue(uint8_t liquid)
 {
-  return _valueLiquid1_L;
+  return liquid < LIQUID_COUNT ? (double)_flowTimes_ms[liquid].load() * FlowRates[liquid] : 0.0;
 }
 
 //===============================================================
-// Returns current flow meter value for liquid 2
+// Returns a snapshot of all flow meter values, false if writes
+// were in progress until the retries ran out (see GetFlowTimes)
 //===============================================================
-double FlowMeterDriver::GetValueLiquid2()
+bool FlowMeterDriver::GetValues(double (&values_L)[LIQUID_COUNT])
 {
-  return _valueLiquid2_L;
+  uint32_t flowTimes_ms[LIQUID_COUNT];
+  bool consistent = GetFlowTimes(flowTimes_ms);
+
+  // Convert flow times to liters outside of the interrupt context
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    values_L[liquid] = (double)flowTimes_ms[liquid] * FlowRates[liquid];
+  }
+  return consistent;
+}
+
+//===============================================================
+// Publishes the flow meter values to the metrics. Must be called
+// from the loop task only: flow times are written by interrupts
+// and higher priority tasks, which never leave a write in progress
+// while the loop task runs, so the snapshot never has to wait
+//===============================================================
+void FlowMeterDriver::PublishMetrics()
+{
+  double values_L[LIQUID_COUNT];
+  GetValues(values_L);
+
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    Metrics.SetGauge((MetricGauge)(eMetricFlowLiquid + liquid), (int32_t)(values_L[liquid] * 1000.0));
+  }
 }
 
 //===============================================================
-// Returns current flow meter value for liquid 3
+// Returns the current flow times from interrupt service routine.
+// Does not wait for a task write in progress, the remainder of
+// such a write is visible with the next call
 //===============================================================
-double FlowMeterDriver::GetValueLiquid3()
+void FlowMeterDriver::GetFlowTimesFromISR(uint32_t (&flowTimes_ms)[LIQUID_COUNT])
 {
-  return _valueLiquid3_L;
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    flowTimes_ms[liquid] = _flowTimes_ms[liquid].load();
+  }
 }
 
 //===============================================================
-// Adds flow time (@100% pump power) to flow meter
+// Adds flow times (@100% pump power) to flow meter. May be called
+// from interrupt and task context at the same time
 //===============================================================
-void FlowMeterDriver::AddFlowTime(uint32_t valueLiquid1_ms, uint32_t valueLiquid2_ms, uint32_t valueLiquid3_ms)
+void FlowMeterDriver::AddFlowTime(const uint32_t (&values_ms)[LIQUID_COUNT])
 {
-  _valueLiquid1_L += (double)valueLiquid1_ms * FLOWRATE1;
-  _valueLiquid2_L += (double)valueLiquid2_ms * FLOWRATE2;
-  _valueLiquid3_L += (double)valueLiquid3_ms * FLOWRATE3;
+  uint32_t anyValue_ms = 0;
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    anyValue_ms |= values_ms[liquid];
+  }
+  if (anyValue_ms == 0)
+  {
+    return;
+  }
+
+  // Mark write in progress, add values and mark write finished
+  _writeBegin.fetch_add(1);
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    _flowTimes_ms[liquid].fetch_add(values_ms[liquid]);
+  }
+  _writeEnd.fetch_add(1);
 }
 
 //===============================================================
@@ -138,3 +257,187 @@ void FlowMeterDriver::RequestSaveAsync()
 {
   _isSavePending = true;
 }
+
+//===============================================================
+// Returns a consistent snapshot of all flow times. Must not be
+// called from interrupt context. Gives up after a few retries
+// (e.g. a writer task stalled in the middle of a write) and
+// returns the last read values, every value is complete on its
+// own, but the values may miss parts of the same write
+//===============================================================
+bool FlowMeterDriver::GetFlowTimes(uint32_t (&flowTimes_ms)[LIQUID_COUNT])
+{
+  for (uint32_t retry = 0; retry < FLOW_SNAPSHOT_MAX_RETRIES; retry++)
+  {
+    // Check for a write in progress (all started writes are finished)
+    uint32_t writeEnd = _writeEnd.load();
+    uint32_t writeBegin = _writeBegin.load();
+
+    // Read values
+    for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+    {
+      flowTimes_ms[liquid] = _flowTimes_ms[liquid].load();
+    }
+
+    if (writeBegin != writeEnd)
+    {
+      // The writer may be a preempted lower priority task
+      vTaskDelay(1);
+      continue;
+    }
+
+    // Snapshot is consistent, if no write started while reading
+    if (_writeBegin.load() == writeBegin)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//===============================================================
+// Replays the journal on top of the base values. Returns false
+// if the journal contains damaged or unexpected records
+//===============================================================
+bool FlowMeterDriver::ReplayJournal(FlowBase* base)
+{
+  if (!_spiffsAvailable ||
+    !Storage.Exists(FLOW_JOURNAL_FILE))
+  {
+    return true;
+  }
+
+  File file = Storage.Open(FLOW_JOURNAL_FILE, FILE_READ);
+  if (!file)
+  {
+    return false;
+  }
+
+  bool journalValid = true;
+  FlowJournalRecord record;
+  while (file.available() > 0)
+  {
+    // Incomplete or damaged record -> stop replay
+    if (file.read((uint8_t*)&record, sizeof(FlowJournalRecord)) != sizeof(FlowJournalRecord) ||
+      record.Crc != esp_rom_crc32_le(0, (const uint8_t*)&record, offsetof(FlowJournalRecord, Crc)))
+    {
+      journalValid = false;
+      break;
+    }
+
+    _journalRecords++;
+
+    // Skip records which are already included in the base values
+    // (e.g. power loss while compacting)
+    if (record.Sequence <= base->Sequence)
+    {
+      continue;
+    }
+
+    // Sequence gap -> stop replay
+    if (record.Sequence != base->Sequence + 1)
+    {
+      journalValid = false;
+      break;
+    }
+
+    base->Sequence = record.Sequence;
+    for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+    {
+      base->FlowTimes_ms[liquid] += record.FlowTimes_ms[liquid];
+    }
+  }
+  file.close();
+
+  _journalSequence = base->Sequence;
+  
+  ESP_LOGI(TAG, "Journal '%s' replayed up to sequence %d", FLOW_JOURNAL_FILE, _journalSequence);
+  return journalValid;
+}
+
+//===============================================================
+// Appends the flow time deltas since the last save to the journal
+//===============================================================
+bool FlowMeterDriver::AppendJournal(const uint32_t (&flowTimes_ms)[LIQUID_COUNT])
+{
+  if (!_spiffsAvailable)
+  {
+    return false;
+  }
+
+  FlowJournalRecord record;
+  record.Sequence = _journalSequence + 1;
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    record.FlowTimes_ms[liquid] = flowTimes_ms[liquid] - _savedFlowTimes_ms[liquid];
+  }
+  record.Crc = esp_rom_crc32_le(0, (const uint8_t*)&record, offsetof(FlowJournalRecord, Crc));
+
+  File file = Storage.Open(FLOW_JOURNAL_FILE, FILE_APPEND);
+  if (!file)
+  {
+    ESP_LOGE(TAG, "Could not open journal '%s'", FLOW_JOURNAL_FILE);
+    return false;
+  }
+  size_t written = file.write((const uint8_t*)&record, sizeof(FlowJournalRecord));
+  file.close();
+
+  if (written != sizeof(FlowJournalRecord))
+  {
+    ESP_LOGE(TAG, "Could not write journal '%s'", FLOW_JOURNAL_FILE);
+    return false;
+  }
+
+  _journalSequence = record.Sequence;
+  _journalRecords++;
+  memcpy(_savedFlowTimes_ms, flowTimes_ms, sizeof(_savedFlowTimes_ms));
+
+  ESP_LOGI(TAG, "Journal record %d successfully appended", _journalSequence);
+  return true;
+}
+
+//===============================================================
+// Writes the given flow times as base to preferences and removes
+// the journal. The base blob is written atomically, journal
+// records left over by a power loss are skipped by sequence
+//===============================================================
+bool FlowMeterDriver::Compact(const uint32_t (&flowTimes_ms)[LIQUID_COUNT])
+{
+  FlowBase base;
+  base.Sequence = _journalSequence;
+  memcpy(base.FlowTimes_ms, flowTimes_ms, sizeof(base.FlowTimes_ms));
+
+  // Never overwrite a stored base, which could not be loaded
+  if (!_baseLoaded)
+  {
+    ESP_LOGE(TAG, "Flow base not loaded, not overwritten");
+    return false;
+  }
+
+  if (!_preferences.begin(SETTINGS_NAME, false))
+  {
+    ESP_LOGE(TAG, "Could not open preferences '%s'", SETTINGS_NAME);
+    return false;
+  }
+  size_t written = _preferences.putBytes(KEY_FLOW_BASE, &base, sizeof(FlowBase));
+  _preferences.end();
+
+  if (written != sizeof(FlowBase))
+  {
+    ESP_LOGE(TAG, "Could not write flow base to '%s'", SETTINGS_NAME);
+    return false;
+  }
+
+  memcpy(_savedFlowTimes_ms, flowTimes_ms, sizeof(_savedFlowTimes_ms));
+
+  if (_spiffsAvailable &&
+    Storage.Exists(FLOW_JOURNAL_FILE))
+  {
+    Storage.Remove(FLOW_JOURNAL_FILE);
+  }
+  _journalRecords = 0;
+
+  ESP_LOGI(TAG, "Preferences successfully saved to '%s'", SETTINGS_NAME);
+  return true;
+}
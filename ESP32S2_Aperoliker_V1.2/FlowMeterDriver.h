@@ -13,9 +13,13 @@
 // Includes
 //===============================================================
 #include <Arduino.h>
+#include <atomic>
 #include <Preferences.h>
 #include <esp_log.h>
+#include <esp_rom_crc.h>
 #include "Config.h"
+#include "StorageDriver.h"
+#include "Metrics.h"
 
 //===============================================================
 // Defines
@@ -23,10 +27,45 @@
 #define FLOWRATE1             0.00000416667   // 250 ml/min (pump 1 specification @ 24V) => 5e-6 l/ms
 #define FLOWRATE2             0.00000416667   // 250 ml/min (pump 2 specification @ 24V) => 5e-6 l/ms
 #define FLOWRATE3             0.00000416667   // 250 ml/min (pump 3 specification @ 24V) => 5e-6 l/ms
+#define FLOWRATE4             0.00000416667   // 250 ml/min (pump 4 specification @ 24V) => 5e-6 l/ms
+#define FLOWRATE5             0.00000416667   // 250 ml/min (pump 5 specification @ 24V) => 5e-6 l/ms
+#define FLOWRATE6             0.00000416667   // 250 ml/min (pump 6 specification @ 24V) => 5e-6 l/ms
+#define FLOWRATE(liquid)      FLOWRATE##liquid
 
 #define KEY_FLOW_LIQUID1      "FlowLiquid1"   // Key name: Maximum string length is 15 bytes, excluding a zero terminator.
 #define KEY_FLOW_LIQUID2      "FlowLiquid2"   // Key name: Maximum string length is 15 bytes, excluding a zero terminator.
 #define KEY_FLOW_LIQUID3      "FlowLiquid3"   // Key name: Maximum string length is 15 bytes, excluding a zero terminator.
+#define KEY_FLOW_BASE         "FlowBase"      // Key name: Maximum string length is 15 bytes, excluding a zero terminator.
+
+#define FLOW_JOURNAL_FILE         "/flowjournal.bin"
+#define FLOW_JOURNAL_MAX_RECORDS  512     // Compact journal into preferences after 512 records (10kB)
+#define FLOW_JOURNAL_INTERVAL_MS  30000   // Append journal record at most every 30 seconds...
+#define FLOW_JOURNAL_BATCH_ML     100     // ...or earlier, if at least 100 ml were dispensed
+#define FLOW_SNAPSHOT_MAX_RETRIES 10      // Snapshot attempts while writes are in progress
+
+//===============================================================
+// Constants
+//===============================================================
+static const double FlowRates[LIQUID_COUNT] = { LIQUID_LIST(FLOWRATE) };
+
+//===============================================================
+// Structs
+//===============================================================
+// Compacted flow meter values, stored as one preferences blob (a
+// blob of another liquid count is not loaded)
+struct FlowBase
+{
+  uint32_t Sequence;              // Sequence of last journal record included
+  uint32_t FlowTimes_ms[LIQUID_COUNT];
+};
+
+// Journal record with flow time deltas since the previous record
+struct FlowJournalRecord
+{
+  uint32_t Sequence;
+  uint32_t FlowTimes_ms[LIQUID_COUNT];
+  uint32_t Crc;                   // CRC32 of all fields above
+};
 
 //===============================================================
 // Class for flow measuring
@@ -38,36 +77,70 @@ class FlowMeterDriver
     FlowMeterDriver();
     
     // Initializes the flow meter driver
-    void Begin();
+    void Begin(bool spiffsAvailable);
     
-    // Load settings from flash
+    // Load settings from flash and replay journal
     void Load();
 
-    // Save settings to flash
+    // Save settings to flash and compact journal
     void Save();
 
-    // Save settings to flash if async request is pending
+    // Append journal record if async request is pending
     void SaveAsync();
 
-    // Returns current flow meter values
-    double GetValueLiquid1();
-    double GetValueLiquid2();
-    double GetValueLiquid3();
+    // Returns current flow meter value of a liquid
+    double GetValue(uint8_t liquid);
+
+    // Returns a snapshot of all flow meter values, false if it is not consistent
+    bool GetValues(double (&values_L)[LIQUID_COUNT]);
+
+    // Publishes the flow meter values to the metrics (loop task only)
+    void PublishMetrics();
 
-    // Adds flow time (@100% pump power) to flow meter
-    void IRAM_ATTR AddFlowTime(uint32_t valueLiquid1_ms, uint32_t valueLiquid2_ms, uint32_t valueLiquid3_ms);
+    // Returns the current flow times from interrupt service routine
+    void IRAM_ATTR GetFlowTimesFromISR(uint32_t (&flowTimes_ms)[LIQUID_COUNT]);
+
+    // Adds flow times (@100% pump power) to flow meter
+    void IRAM_ATTR AddFlowTime(const uint32_t (&values_ms)[LIQUID_COUNT]);
 
     // Requests a save values from interrupt service routine
     void IRAM_ATTR RequestSaveAsync();
     
   private:
-    // Flow meter variables
+    // Preferences variable
     Preferences _preferences;
-    double _valueLiquid1_L;
-    double _valueLiquid2_L;
-    double _valueLiquid3_L;
+
+    // Journal variables (only accessed by the loop task)
+    bool _baseLoaded = false;
+    bool _spiffsAvailable = false;
+    uint32_t _journalSequence = 0;
+    uint32_t _journalRecords = 0;
+    uint32_t _journalTimestamp = 0;
+    uint32_t _savedFlowTimes_ms[LIQUID_COUNT] = { };
+
+    // Flow meter variables (pump on-time @100% pump power in ms, uint32
+    // covers ~49 days of on-time per pump). Integer atomics keep the
+    // interrupt path free of floating point and lost updates
+    std::atomic<uint32_t> _flowTimes_ms[LIQUID_COUNT] = { };
+
+    // Write counters for consistent snapshots (begin is incremented
+    // before, end after each write)
+    std::atomic<uint32_t> _writeBegin{0};
+    std::atomic<uint32_t> _writeEnd{0};
     
-    bool _isSavePending = false;
+    std::atomic<bool> _isSavePending{false};
+
+    // Returns a snapshot of all flow times, false if it is not consistent
+    bool GetFlowTimes(uint32_t (&flowTimes_ms)[LIQUID_COUNT]);
+
+    // Replays the journal on top of the base values, returns false if the journal is damaged
+    bool ReplayJournal(FlowBase* base);
+
+    // Appends the flow time deltas since the last save to the journal
+    bool AppendJournal(const uint32_t (&flowTimes_ms)[LIQUID_COUNT]);
+
+    // Writes the given flow times as base to preferences and removes the journal
+    bool Compact(const uint32_t (&flowTimes_ms)[LIQUID_COUNT]);
 };
 
 //===============================================================
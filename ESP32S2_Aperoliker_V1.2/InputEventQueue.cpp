@@ -0,0 +1,92 @@
+/**
+ * Includes the input event queue
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include "InputEventQueue.h"
+#include "Metrics.h"
+
+//===============================================================
+// Global variables
+//===============================================================
+InputEventQueue InputEvents;
+
+//===============================================================
+// Adds an event with the current time, returns false if the queue
+// is full (interrupt service routine or task)
+//===============================================================
+bool InputEventQueue::Push(InputEventType type, int32_t value)
+{
+  bool pushed = false;
+
+  portENTER_CRITICAL_SAFE(&_mux);
+  if ((_head - _tail) < INPUT_EVENT_QUEUE_SIZE)
+  {
+    _events[_head % INPUT_EVENT_QUEUE_SIZE] = { millis(), type, value };
+    _head++;
+    pushed = true;
+  }
+  portEXIT_CRITICAL_SAFE(&_mux);
+
+  if (!pushed)
+  {
+    _dropped = true;
+    Metrics.Add(eMetricInputEventsDropped);
+  }
+  return pushed;
+}
+
+//===============================================================
+// Removes the oldest event, returns false if the queue is empty
+// (main task only)
+//===============================================================
+bool InputEventQueue::Pop(InputEvent* event)
+{
+  bool popped = false;
+
+  portENTER_CRITICAL(&_mux);
+  if (_tail != _head)
+  {
+    *event = _events[_tail % INPUT_EVENT_QUEUE_SIZE];
+    _tail++;
+    popped = true;
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  return popped;
+}
+
+//===============================================================
+// Returns true once, if events were dropped since the last call
+// (main task only)
+//===============================================================
+bool InputEventQueue::TakeDropped()
+{
+  return _dropped.exchange(false);
+}
+
+//===============================================================
+// Returns the name of an event type
+//===============================================================
+const char* InputEventQueue::GetTypeName(InputEventType type)
+{
+  switch (type)
+  {
+    case eInputEncoder:
+      return "encoder";
+    case eInputButton:
+      return "button";
+    case eInputLever:
+      return "lever";
+    case eInputWifi:
+      return "wifi";
+    default:
+      return "unknown";
+  }
+}
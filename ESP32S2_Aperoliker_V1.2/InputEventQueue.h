@@ -0,0 +1,84 @@
+/**
+ * Includes the input event queue
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef INPUTEVENTQUEUE_H
+#define INPUTEVENTQUEUE_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+
+//===============================================================
+// Defines
+//===============================================================
+#define INPUT_EVENT_QUEUE_SIZE    32      // Input events between interrupts/wifi and main task
+
+//===============================================================
+// Enums
+//===============================================================
+enum InputEventType : uint8_t
+{
+  eInputEncoder = 0,      // Value: detent direction (+1/-1)
+  eInputButton = 1,       // Value: 1 pressed, 0 released
+  eInputLever = 2,        // Value: 1 pressed, 0 released
+  eInputWifi = 3,         // Value: wifi command type
+  eInputEventTypeCount
+};
+
+//===============================================================
+// Structs
+//===============================================================
+// Input event with the time it occurred
+struct InputEvent
+{
+  uint32_t Timestamp_ms;
+  InputEventType Type;
+  int32_t Value;
+};
+
+//===============================================================
+// Class for the typed input events of the interrupts and the wifi
+// handler, which are drained by the main task. The events tell
+// the main task which inputs have to be read, the drivers keep
+// their own state (pulse counter, button edges)
+//===============================================================
+class InputEventQueue
+{
+  public:
+    // Adds an event with the current time, returns false if the
+    // queue is full (interrupt service routine or task)
+    bool IRAM_ATTR Push(InputEventType type, int32_t value);
+
+    // Removes the oldest event, returns false if the queue is
+    // empty (main task only)
+    bool Pop(InputEvent* event);
+
+    // Returns true once, if events were dropped since the last
+    // call (main task only)
+    bool TakeDropped();
+
+    // Returns the name of an event type
+    static const char* GetTypeName(InputEventType type);
+
+  private:
+    InputEvent _events[INPUT_EVENT_QUEUE_SIZE];
+    uint32_t _head = 0;
+    uint32_t _tail = 0;
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    std::atomic<bool> _dropped{false};
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+extern InputEventQueue InputEvents;
+
+#endif
@@ -0,0 +1,178 @@
+/**
+ * Includes all metrics functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include "Metrics.h"
+
+//===============================================================
+// Structs
+//===============================================================
+// Metric description (metrics with labels share name and help)
+struct MetricInfo
+{
+  const char* Name;
+  const char* Labels;
+  const char* Help;
+};
+
+//===============================================================
+// Defines
+//===============================================================
+#define PUMP_STARTS_INFO(pump)      { "mixer_pump_starts_total", "pump=\"" #pump "\"", "Number of pump switch-on edges" }
+#define FLOW_LIQUID_INFO(liquid)    { "mixer_flow_millilitres", "liquid=\"" #liquid "\"", "Dispensed liquid (flow meter)" }
+
+//===============================================================
+// Constants
+//===============================================================
+static const MetricInfo CounterInfos[eMetricCounterCount] =
+{
+  LIQUID_LIST(PUMP_STARTS_INFO),
+  { "mixer_state_transitions_total", NULL, "Number of state machine transitions" },
+  { "mixer_wifi_messages_total", NULL, "Number of received websocket messages" },
+  { "mixer_wifi_commands_dropped_total", NULL, "Number of wifi commands dropped on a full queue" },
+  { "mixer_input_events_total", "type=\"encoder\"", "Number of input events handled by the main task" },
+  { "mixer_input_events_total", "type=\"button\"", "Number of input events handled by the main task" },
+  { "mixer_input_events_total", "type=\"lever\"", "Number of input events handled by the main task" },
+  { "mixer_input_events_total", "type=\"wifi\"", "Number of input events handled by the main task" },
+  { "mixer_input_events_dropped_total", NULL, "Number of input events dropped on a full queue" },
+  { "mixer_wifi_broadcasts_total", "result=\"sent\"", "Number of state updates to the websocket clients" },
+  { "mixer_wifi_broadcasts_total", "result=\"coalesced\"", "Number of state updates to the websocket clients" },
+  { "mixer_wifi_broadcasts_total", "result=\"skipped\"", "Number of state updates to the websocket clients" },
+  { "mixer_wifi_broadcasts_total", "result=\"deferred\"", "Number of state updates to the websocket clients" },
+  { "mixer_wifi_frames_rebased_total", NULL, "Number of liquid frames rebased onto a newer mixture version" },
+  { "mixer_wifi_frames_stale_total", NULL, "Number of liquid frames dropped, the mixture was reset since their version" }
+};
+
+static const MetricInfo GaugeInfos[eMetricGaugeCount] =
+{
+  LIQUID_LIST(FLOW_LIQUID_INFO),
+  { "mixer_wifi_clients", NULL, "Number of connected websocket clients" },
+  { "mixer_free_heap_bytes", NULL, "Free heap" },
+  { "mixer_min_free_heap_bytes", NULL, "Lowest free heap since start" },
+  { "mixer_uptime_seconds", NULL, "Time since start" }
+};
+
+static const MetricInfo HistogramInfos[eMetricHistogramCount] =
+{
+  { "mixer_loop_duration_us", NULL, "Duration of one state machine cycle" },
+  { "mixer_display_render_duration_us", NULL, "Duration of a display update (page or partial draw)" },
+  { "mixer_wifi_message_duration_us", NULL, "Duration of handling one websocket message (web server task)" },
+  { "mixer_pump_update_period_us", NULL, "Time between two pump updates (loop task)" }
+};
+
+static const uint32_t BucketBounds_us[METRICS_BUCKET_COUNT] = { 100, 500, 1000, 5000, 10000, 50000, 100000, 500000 };
+
+//===============================================================
+// Global variables
+//===============================================================
+MetricsRegistry Metrics;
+
+//===============================================================
+// Adds a value to a counter
+//===============================================================
+void MetricsRegistry::Add(MetricCounter counter, uint32_t value)
+{
+  _counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+//===============================================================
+// Sets a gauge to the current value
+//===============================================================
+void MetricsRegistry::SetGauge(MetricGauge gauge, int32_t value)
+{
+  _gauges[gauge].store(value, std::memory_order_relaxed);
+}
+
+//===============================================================
+// Adds an observed duration to a histogram
+//===============================================================
+void MetricsRegistry::Observe(MetricHistogram histogram, uint32_t duration_us)
+{
+  uint8_t bucket = 0;
+  while (bucket < METRICS_BUCKET_COUNT &&
+    duration_us > BucketBounds_us[bucket])
+  {
+    bucket++;
+  }
+
+  _histograms[histogram].Buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  _histograms[histogram].Sum_us.fetch_add(duration_us, std::memory_order_relaxed);
+}
+
+//===============================================================
+// Returns the current value of a counter
+//===============================================================
+uint32_t MetricsRegistry::GetCounter(MetricCounter counter)
+{
+  return _counters[counter].load(std::memory_order_relaxed);
+}
+
+//===============================================================
+// Prints all metrics in Prometheus text format
+//===============================================================
+void MetricsRegistry::PrintMetrics(Print& output)
+{
+  const char* lastName = NULL;
+
+  for (uint8_t counter = 0; counter < eMetricCounterCount; counter++)
+  {
+    const MetricInfo& info = CounterInfos[counter];
+    PrintHeader(output, info.Name, info.Help, "counter", &lastName);
+    output.printf(info.Labels ? "%s{%s} %u\n" : "%s%s %u\n", info.Name, info.Labels ? info.Labels : "",
+      _counters[counter].load(std::memory_order_relaxed));
+  }
+
+  for (uint8_t gauge = 0; gauge < eMetricGaugeCount; gauge++)
+  {
+    const MetricInfo& info = GaugeInfos[gauge];
+    PrintHeader(output, info.Name, info.Help, "gauge", &lastName);
+    output.printf(info.Labels ? "%s{%s} %d\n" : "%s%s %d\n", info.Name, info.Labels ? info.Labels : "",
+      _gauges[gauge].load(std::memory_order_relaxed));
+  }
+
+  for (uint8_t histogram = 0; histogram < eMetricHistogramCount; histogram++)
+  {
+    const MetricInfo& info = HistogramInfos[histogram];
+    PrintHeader(output, info.Name, info.Help, "histogram", &lastName);
+
+    // Buckets are cumulative in the export
+    uint32_t count = 0;
+    for (uint8_t bucket = 0; bucket <= METRICS_BUCKET_COUNT; bucket++)
+    {
+      count += _histograms[histogram].Buckets[bucket].load(std::memory_order_relaxed);
+      if (bucket < METRICS_BUCKET_COUNT)
+      {
+        output.printf("%s_bucket{le=\"%u\"} %u\n", info.Name, BucketBounds_us[bucket], count);
+      }
+      else
+      {
+        output.printf("%s_bucket{le=\"+Inf\"} %u\n", info.Name, count);
+      }
+    }
+    output.printf("%s_sum %llu\n", info.Name, (unsigned long long)_histograms[histogram].Sum_us.load(std::memory_order_relaxed));
+    output.printf("%s_count %u\n", info.Name, count);
+  }
+}
+
+//===============================================================
+// Prints help and type, if the metric name changes
+//===============================================================
+void MetricsRegistry::PrintHeader(Print& output, const char* name, const char* help, const char* type, const char** lastName)
+{
+  if (*lastName != NULL &&
+    strcmp(*lastName, name) == 0)
+  {
+    return;
+  }
+
+  output.printf("# HELP %s %s\n", name, help);
+  output.printf("# TYPE %s %s\n", name, type);
+  *lastName = name;
+}
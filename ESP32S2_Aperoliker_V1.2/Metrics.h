@@ -0,0 +1,114 @@
+/**
+ * Includes all metrics functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <atomic>
+#include "Config.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#define METRICS_BUCKET_COUNT    8       // Histogram buckets (without +Inf)
+
+//===============================================================
+// Enums
+//===============================================================
+// Counters (only increase)
+enum MetricCounter : uint8_t
+{
+  eMetricPumpStarts = 0,                            // One counter per pump
+  eMetricStateTransitions = eMetricPumpStarts + LIQUID_COUNT,
+  eMetricWifiMessages,
+  eMetricWifiCommandsDropped,
+  eMetricInputEventsEncoder,
+  eMetricInputEventsButton,
+  eMetricInputEventsLever,
+  eMetricInputEventsWifi,
+  eMetricInputEventsDropped,
+  eMetricWifiBroadcastsSent,
+  eMetricWifiBroadcastsCoalesced,
+  eMetricWifiBroadcastsSkipped,
+  eMetricWifiBroadcastsDeferred,
+  eMetricWifiFramesRebased,
+  eMetricWifiFramesStale,
+  eMetricCounterCount
+};
+
+// Gauges (set to the current value)
+enum MetricGauge : uint8_t
+{
+  eMetricFlowLiquid = 0,                            // One gauge per liquid
+  eMetricWifiClients = eMetricFlowLiquid + LIQUID_COUNT,
+  eMetricFreeHeap,
+  eMetricMinFreeHeap,
+  eMetricUptime,
+  eMetricGaugeCount
+};
+
+// Histograms (durations in microseconds)
+enum MetricHistogram : uint8_t
+{
+  eMetricLoopDuration = 0,
+  eMetricDisplayRenderDuration,
+  eMetricWifiMessageDuration,
+  eMetricPumpUpdatePeriod,
+  eMetricHistogramCount
+};
+
+//===============================================================
+// Class for internal metrics. Updates are single relaxed atomic
+// operations (usable from interrupts), the metrics are exported
+// in Prometheus text format
+//===============================================================
+class MetricsRegistry
+{
+  public:
+    // Adds a value to a counter
+    void IRAM_ATTR Add(MetricCounter counter, uint32_t value = 1);
+
+    // Sets a gauge to the current value
+    void SetGauge(MetricGauge gauge, int32_t value);
+
+    // Adds an observed duration to a histogram
+    void Observe(MetricHistogram histogram, uint32_t duration_us);
+
+    // Returns the current value of a counter
+    uint32_t GetCounter(MetricCounter counter);
+
+    // Prints all metrics in Prometheus text format
+    void PrintMetrics(Print& output);
+
+  private:
+    // Histogram values (bucket counts are not cumulative, the last
+    // bucket counts all values above the bounds)
+    struct Histogram
+    {
+      std::atomic<uint32_t> Buckets[METRICS_BUCKET_COUNT + 1];
+      std::atomic<uint64_t> Sum_us;
+    };
+
+    std::atomic<uint32_t> _counters[eMetricCounterCount] = { };
+    std::atomic<int32_t> _gauges[eMetricGaugeCount] = { };
+    Histogram _histograms[eMetricHistogramCount] = { };
+
+    // Prints help and type, if the metric name changes
+    void PrintHeader(Print& output, const char* name, const char* help, const char* type, const char** lastName);
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+extern MetricsRegistry Metrics;
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * Includes the mixture functions for any number of liquids
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef MIXTURE_H
+#define MIXTURE_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include "AngleHelper.h"
+
+//===============================================================
+// Class for a mixture of N liquids. Each liquid starts at its
+// angle and ends at the angle of the next liquid (clockwise),
+// so all liquids together always result in 360° (100%)
+//===============================================================
+template <uint8_t N>
+class Mixture
+{
+  static_assert(N >= 2, "A mixture needs at least two liquids");
+  static_assert(N * MINANGLE_DEGREES <= 360, "Too many liquids for the minimum angle");
+
+  public:
+    // Number of liquids
+    static constexpr uint8_t Count = N;
+
+    // Sets all angles (must be clockwise ordered with minimum distance)
+    void SetAngles(const int16_t (&angles_Degrees)[N])
+    {
+      for (uint8_t index = 0; index < N; index++)
+      {
+        _angles_Degrees[index] = angles_Degrees[index];
+      }
+      UpdatePercentages();
+      _revision++;
+    }
+
+    // Increments the angle of a liquid by the angle distance given,
+    // the neighbouring angles are used as borders
+    void IncrementAngle(uint8_t liquid, int16_t angleDistance_Degrees)
+    {
+      if (liquid >= N)
+      {
+        return;
+      }
+
+      int16_t angle_Degrees = _angles_Degrees[liquid];
+      ::IncrementAngle(&_angles_Degrees[liquid], _angles_Degrees[Next(liquid)], _angles_Degrees[Previous(liquid)], angleDistance_Degrees);
+
+      // Recalculate only if the angle was not limited to its old value
+      if (_angles_Degrees[liquid] != angle_Degrees)
+      {
+        UpdatePercentages();
+        _revision++;
+      }
+    }
+
+    // Returns the angle of a liquid or -1 for an invalid liquid
+    int16_t GetAngle(uint8_t liquid) const
+    {
+      return liquid < N ? _angles_Degrees[liquid] : -1;
+    }
+
+    // Returns the percentage of a liquid or 0% for an invalid liquid
+    double GetPercentage(uint8_t liquid) const
+    {
+      return liquid < N ? _percentages[liquid] : 0.0;
+    }
+
+    // Returns the revision, which changes with every angle change
+    uint32_t GetRevision() const
+    {
+      return _revision;
+    }
+
+    // Returns the sum of all percentages
+    double GetSum() const
+    {
+      double sum_Percentage = 0.0;
+      for (uint8_t index = 0; index < N; index++)
+      {
+        sum_Percentage += _percentages[index];
+      }
+      return sum_Percentage;
+    }
+
+  private:
+    int16_t _angles_Degrees[N] = { };
+    double _percentages[N] = { };
+    uint32_t _revision = 0;
+
+    // Returns the neighbouring liquids
+    static constexpr uint8_t Next(uint8_t liquid) { return liquid + 1 < N ? liquid + 1 : 0; }
+    static constexpr uint8_t Previous(uint8_t liquid) { return liquid > 0 ? liquid - 1 : N - 1; }
+
+    // Calculates the percentages from the angles
+    void UpdatePercentages()
+    {
+      int16_t distances_Degrees[N];
+      for (uint8_t index = 0; index < N; index++)
+      {
+        distances_Degrees[index] = GetDistanceDegrees(_angles_Degrees[index], _angles_Degrees[Next(index)]);
+      }
+
+      // Avoid minimal setable value >0%. If an angle is at its min angle, mute
+      // it to zero and add the angle distance to the greatest one of the others
+      // (the last one on equal distances)
+      for (uint8_t index = 0; index < N; index++)
+      {
+        if (distances_Degrees[index] != MINANGLE_DEGREES)
+        {
+          continue;
+        }
+
+        uint8_t greatest = Next(index);
+        for (uint8_t other = 0; other < N; other++)
+        {
+          if (other != index &&
+            distances_Degrees[other] >= distances_Degrees[greatest])
+          {
+            greatest = other;
+          }
+        }
+
+        distances_Degrees[greatest] += distances_Degrees[index];
+        distances_Degrees[index] = 0;
+      }
+
+      // Calculate percentage values
+      for (uint8_t index = 0; index < N; index++)
+      {
+        _percentages[index] = (double)distances_Degrees[index] * 100.0 / 360.0;
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,378 @@
+/**
+ * Includes all pour log functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <inttypes.h>
+#include "PourLogger.h"
+
+//===============================================================
+// Constants
+//===============================================================
+static const char* TAG = "pourlog";
+
+//===============================================================
+// Global variables
+//===============================================================
+PourLogger PourLog;
+
+//===============================================================
+// Constructor
+//===============================================================
+PourLogger::PourLogger()
+{
+}
+
+//===============================================================
+// Initializes the pour logger
+//===============================================================
+void PourLogger::Begin(bool spiffsAvailable)
+{
+  // Log startup info
+  ESP_LOGI(TAG, "Begin initializing pour logger");
+
+  // Pour log is only written, if the storage is available
+  _spiffsAvailable = spiffsAvailable && Open();
+
+  // Log startup info
+  ESP_LOGI(TAG, "Finished initializing pour logger");
+}
+
+//===============================================================
+// Publishes the mixture angles for the next pours. The inactive
+// buffer is written and activated afterwards, so the interrupt
+// service routine (which cannot be interrupted by the main task on
+// the single core ESP32-S2) always copies a complete mixture
+//===============================================================
+void PourLogger::SetMixture(const int16_t (&angles_Degrees)[LIQUID_COUNT])
+{
+  uint8_t index = _mixtureIndex.load(std::memory_order_relaxed) ^ 1;
+  memcpy(_mixtureAngles[index], angles_Degrees, sizeof(_mixtureAngles[index]));
+  _mixtureIndex.store(index, std::memory_order_release);
+}
+
+//===============================================================
+// Starts a pour from interrupt service routine (lever pressed) or
+// main task (batch). The mixture is taken at the lever edge, it
+// may be changed by encoder or wifi while pouring
+//===============================================================
+void PourLogger::StartPour(MixerState state)
+{
+  portENTER_CRITICAL_SAFE(&_pourMux);
+
+  if (!_isPouring)
+  {
+    _isPouring = true;
+    _currentEvent.Start_ms = millis();
+    _currentEvent.State = state;
+    memcpy(_currentEvent.Angles, _mixtureAngles[_mixtureIndex.load(std::memory_order_acquire)], sizeof(_currentEvent.Angles));
+    FlowMeter.GetFlowTimesFromISR(_currentEvent.StartFlowTimes_ms);
+  }
+
+  portEXIT_CRITICAL_SAFE(&_pourMux);
+}
+
+//===============================================================
+// Stops a pour from interrupt service routine (lever released) or
+// main task (batch). Pumps must be disabled before, to include the
+// last flow time
+//===============================================================
+void PourLogger::StopPour()
+{
+  portENTER_CRITICAL_SAFE(&_pourMux);
+
+  if (_isPouring)
+  {
+    _isPouring = false;
+    _currentEvent.Stop_ms = millis();
+    FlowMeter.GetFlowTimesFromISR(_currentEvent.StopFlowTimes_ms);
+
+    // Drop event, if the loop task is not keeping up
+    uint32_t head = _pendingHead.load(std::memory_order_relaxed);
+    if ((head - _pendingTail.load(std::memory_order_acquire)) >= POURLOG_PENDING_EVENTS)
+    {
+      _droppedEvents.fetch_add(1);
+    }
+    else
+    {
+      _pendingEvents[head % POURLOG_PENDING_EVENTS] = _currentEvent;
+      _pendingHead.store(head + 1, std::memory_order_release);
+    }
+  }
+
+  portEXIT_CRITICAL_SAFE(&_pourMux);
+}
+
+//===============================================================
+// Collects pour events and writes buffered records to flash.
+// Must be called from the loop task only
+//===============================================================
+void PourLogger::Update()
+{
+  // Collect pending events from interrupt service routine
+  uint32_t tail = _pendingTail.load(std::memory_order_relaxed);
+  while (tail != _pendingHead.load(std::memory_order_acquire))
+  {
+    PourEvent event = _pendingEvents[tail % POURLOG_PENDING_EVENTS];
+    _pendingTail.store(++tail, std::memory_order_release);
+
+    if (!_spiffsAvailable)
+    {
+      continue;
+    }
+
+    // Make room in buffer
+    if (_bufferCount >= POURLOG_BUFFER_RECORDS)
+    {
+      Flush();
+    }
+
+    if (_bufferCount == 0)
+    {
+      _bufferTimestamp = millis();
+    }
+
+    // Create record
+    PourRecord& record = _bufferRecords[_bufferCount++];
+    record.Sequence = ++_lastSequence;
+    record.Timestamp_ms = event.Start_ms;
+    record.Duration_ms = event.Stop_ms - event.Start_ms;
+    for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+    {
+      record.FlowTimes_ms[liquid] = event.StopFlowTimes_ms[liquid] - event.StartFlowTimes_ms[liquid];
+      record.Angles[liquid] = event.Angles[liquid];
+    }
+    record.State = (uint16_t)event.State;
+  }
+
+  // Log dropped events
+  uint32_t droppedEvents = _droppedEvents.exchange(0);
+  if (droppedEvents > 0)
+  {
+    ESP_LOGE(TAG, "%d pour events dropped", droppedEvents);
+  }
+
+  // Write buffered records if the buffer is full or the interval passed
+  if (_bufferCount > 0 &&
+    (_bufferCount >= POURLOG_BUFFER_RECORDS || (millis() - _bufferTimestamp) >= POURLOG_FLUSH_INTERVAL_MS))
+  {
+    Flush();
+  }
+}
+
+//===============================================================
+// Prepares an export of all records written to flash
+//===============================================================
+void PourLogger::BeginExport(PourLogExport* context)
+{
+  context->LastSequence = _lastWrittenSequence.load();
+  context->NextSequence = context->LastSequence > POURLOG_MAX_RECORDS ? context->LastSequence - POURLOG_MAX_RECORDS + 1 : 1;
+  context->HeaderDone = false;
+  context->LineLength = 0;
+  context->LineOffset = 0;
+}
+
+//===============================================================
+// Fills the buffer with the next part of the CSV export, returns
+// 0 if the export is finished. Lines are carried over to the
+// next call if they do not fit into the buffer
+//===============================================================
+size_t PourLogger::ReadExport(PourLogExport* context, uint8_t* buffer, size_t maxLen)
+{
+  size_t length = 0;
+  File* file = NULL;
+
+  while (length < maxLen)
+  {
+    // Copy (rest of) current line
+    if (context->LineOffset < context->LineLength)
+    {
+      size_t count = min(context->LineLength - context->LineOffset, maxLen - length);
+      memcpy(buffer + length, context->Line + context->LineOffset, count);
+      context->LineOffset += count;
+      length += count;
+      continue;
+    }
+    context->LineOffset = 0;
+    context->LineLength = 0;
+
+    // Header line
+    if (!context->HeaderDone)
+    {
+      context->LineLength = snprintf(context->Line, sizeof(context->Line), "sequence,timestamp_ms,duration_ms");
+      for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+      {
+        context->LineLength += snprintf(context->Line + context->LineLength, sizeof(context->Line) - context->LineLength,
+          ",flowtime%d_ms", liquid + 1);
+      }
+      for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+      {
+        context->LineLength += snprintf(context->Line + context->LineLength, sizeof(context->Line) - context->LineLength,
+          ",angle%d", liquid + 1);
+      }
+      context->LineLength += snprintf(context->Line + context->LineLength, sizeof(context->Line) - context->LineLength, ",state\n");
+      context->HeaderDone = true;
+      continue;
+    }
+
+    // All records exported
+    if (context->NextSequence > context->LastSequence)
+    {
+      break;
+    }
+
+    if (file == NULL &&
+      (file = Storage.OpenCached(POURLOG_FILE)) == NULL)
+    {
+      ESP_LOGE(TAG, "Could not open pour log '%s'", POURLOG_FILE);
+      break;
+    }
+
+    // Skip records overwritten since the export started
+    PourRecord record;
+    file->seek(((context->NextSequence - 1) % POURLOG_MAX_RECORDS) * sizeof(PourRecord));
+    bool valid = file->read((uint8_t*)&record, sizeof(PourRecord)) == sizeof(PourRecord) &&
+      record.Sequence == context->NextSequence;
+    context->NextSequence++;
+    if (!valid)
+    {
+      continue;
+    }
+
+    context->LineLength = snprintf(context->Line, sizeof(context->Line), "%" PRIu32 ",%" PRIu32 ",%" PRIu32,
+      record.Sequence, record.Timestamp_ms, record.Duration_ms);
+    for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+    {
+      context->LineLength += snprintf(context->Line + context->LineLength, sizeof(context->Line) - context->LineLength,
+        ",%" PRIu32, record.FlowTimes_ms[liquid]);
+    }
+    for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+    {
+      context->LineLength += snprintf(context->Line + context->LineLength, sizeof(context->Line) - context->LineLength,
+        ",%d", record.Angles[liquid]);
+    }
+    context->LineLength += snprintf(context->Line + context->LineLength, sizeof(context->Line) - context->LineLength,
+      ",%d\n", record.State);
+  }
+
+  Storage.CloseCached(file);
+  return length;
+}
+
+//===============================================================
+// Creates the preallocated ring file or finds the last sequence
+// in an existing one
+//===============================================================
+bool PourLogger::Open()
+{
+  const size_t fileSize = POURLOG_MAX_RECORDS * sizeof(PourRecord);
+
+  File file = Storage.Open(POURLOG_FILE, FILE_READ);
+  if (file &&
+    file.size() == fileSize)
+  {
+    // Find last sequence (buffer is used as read cache)
+    size_t bytesRead = 0;
+    while ((bytesRead = file.read((uint8_t*)_bufferRecords, sizeof(_bufferRecords))) > 0)
+    {
+      for (uint32_t index = 0; index < bytesRead / sizeof(PourRecord); index++)
+      {
+        _lastSequence = max(_lastSequence, _bufferRecords[index].Sequence);
+      }
+    }
+    file.close();
+
+    _lastWrittenSequence = _lastSequence;
+    ESP_LOGI(TAG, "Pour log '%s' opened at sequence %d", POURLOG_FILE, _lastSequence);
+    return true;
+  }
+  if (file)
+  {
+    file.close();
+  }
+
+  // Preallocate ring file with empty records
+  ESP_LOGI(TAG, "Create pour log '%s'", POURLOG_FILE);
+  if (!(file = Storage.Open(POURLOG_FILE, FILE_WRITE)))
+  {
+    ESP_LOGE(TAG, "Could not create pour log '%s'", POURLOG_FILE);
+    return false;
+  }
+
+  memset(_bufferRecords, 0, sizeof(_bufferRecords));
+  size_t written = 0;
+  for (size_t index = 0; index < fileSize; index += sizeof(_bufferRecords))
+  {
+    written += file.write((const uint8_t*)_bufferRecords, sizeof(_bufferRecords));
+  }
+  file.close();
+
+  if (written != fileSize)
+  {
+    ESP_LOGE(TAG, "Could not preallocate pour log '%s'", POURLOG_FILE);
+    Storage.Remove(POURLOG_FILE);
+    return false;
+  }
+
+  _lastSequence = 0;
+  _lastWrittenSequence = 0;
+  return true;
+}
+
+//===============================================================
+// Writes the buffered records to flash. The written sequence only
+// advances past records, which were written completely. The other
+// records are kept for the next flush after the interval, unless
+// the buffer is full (then they are lost)
+//===============================================================
+void PourLogger::Flush()
+{
+  uint32_t written = 0;
+  File file = Storage.Open(POURLOG_FILE, "r+");
+  if (file)
+  {
+    while (written < _bufferCount)
+    {
+      PourRecord& record = _bufferRecords[written];
+      if (!file.seek(((record.Sequence - 1) % POURLOG_MAX_RECORDS) * sizeof(PourRecord)) ||
+        file.write((const uint8_t*)&record, sizeof(PourRecord)) != sizeof(PourRecord))
+      {
+        break;
+      }
+      written++;
+    }
+    file.close();
+  }
+
+  if (written > 0)
+  {
+    _lastWrittenSequence = _bufferRecords[written - 1].Sequence;
+    ESP_LOGI(TAG, "%d pour records written", written);
+  }
+
+  if (written == _bufferCount)
+  {
+    _bufferCount = 0;
+    return;
+  }
+
+  if (written == 0 &&
+    _bufferCount >= POURLOG_BUFFER_RECORDS)
+  {
+    ESP_LOGE(TAG, "Could not write pour log '%s', %d records lost", POURLOG_FILE, _bufferCount);
+    _bufferCount = 0;
+    return;
+  }
+
+  // Keep the records not written and retry after the interval
+  ESP_LOGE(TAG, "Could not write pour log '%s', %d records pending", POURLOG_FILE, _bufferCount - written);
+  memmove(_bufferRecords, _bufferRecords + written, (_bufferCount - written) * sizeof(PourRecord));
+  _bufferCount -= written;
+  _bufferTimestamp = millis();
+}
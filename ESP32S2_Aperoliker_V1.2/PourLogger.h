@@ -0,0 +1,145 @@
+/**
+ * Includes all pour log functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef POURLOGGER_H
+#define POURLOGGER_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <atomic>
+#include <esp_log.h>
+#include "Config.h"
+#include "StorageDriver.h"
+#include "FlowMeterDriver.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#define POURLOG_FILE                  "/pourlog.bin"
+#define POURLOG_MAX_RECORDS           1024    // Ring file with 1024 records (32kB)
+#define POURLOG_PENDING_EVENTS        8       // Pour events between interrupt and loop task (power of two)
+#define POURLOG_BUFFER_RECORDS        16      // Records buffered in RAM before writing to flash
+#define POURLOG_FLUSH_INTERVAL_MS     10000   // Write buffered records at the latest after 10 seconds
+
+//===============================================================
+// Structs
+//===============================================================
+// Fixed size pour record (32 bytes for three liquids), sequence 0
+// marks an empty slot. A ring file of another liquid count has
+// another size and is created again
+struct PourRecord
+{
+  uint32_t Sequence;                        // Continuous over restarts
+  uint32_t Timestamp_ms;                    // Time since startup on lever press
+  uint32_t Duration_ms;                     // Lever press to release
+  uint32_t FlowTimes_ms[LIQUID_COUNT];      // Pump on-time @100% pump power
+  int16_t Angles[LIQUID_COUNT];
+  uint16_t State;
+};
+
+// Pour event captured by the interrupt service routine
+struct PourEvent
+{
+  uint32_t Start_ms;
+  uint32_t Stop_ms;
+  uint32_t StartFlowTimes_ms[LIQUID_COUNT];
+  uint32_t StopFlowTimes_ms[LIQUID_COUNT];
+  int16_t Angles[LIQUID_COUNT];   // Mixture on lever press
+  MixerState State;
+};
+
+// State of a running pour log export
+struct PourLogExport
+{
+  uint32_t NextSequence;
+  uint32_t LastSequence;
+  bool HeaderDone;
+  char Line[32 + LIQUID_COUNT * 32];  // Header line has 100 characters for three liquids
+  size_t LineLength;
+  size_t LineOffset;
+};
+
+//===============================================================
+// Class for pour logging
+//===============================================================
+class PourLogger
+{
+  public:
+    // Constructor
+    PourLogger();
+
+    // Initializes the pour logger
+    void Begin(bool spiffsAvailable);
+
+    // Publishes the mixture angles for the next pours (main task)
+    void SetMixture(const int16_t (&angles_Degrees)[LIQUID_COUNT]);
+
+    // Starts a pour from interrupt service routine (lever pressed)
+    // or main task (batch)
+    void IRAM_ATTR StartPour(MixerState state);
+
+    // Stops a pour from interrupt service routine (lever released)
+    // or main task (batch)
+    void IRAM_ATTR StopPour();
+
+    // Collects pour events and writes buffered records to flash
+    void Update();
+
+    // Prepares an export of all records written to flash
+    void BeginExport(PourLogExport* context);
+
+    // Fills the buffer with the next part of the CSV export,
+    // returns 0 if the export is finished
+    size_t ReadExport(PourLogExport* context, uint8_t* buffer, size_t maxLen);
+
+  private:
+    // SPIFFS state
+    bool _spiffsAvailable = false;
+
+    // Mixture angles (double buffer, written by main task and read
+    // by interrupt service routine)
+    int16_t _mixtureAngles[2][LIQUID_COUNT] = { };
+    std::atomic<uint8_t> _mixtureIndex{0};
+
+    // Current pour (guarded by the spinlock, lever interrupt and main
+    // task start and stop pours)
+    portMUX_TYPE _pourMux = portMUX_INITIALIZER_UNLOCKED;
+    bool _isPouring = false;
+    PourEvent _currentEvent;
+
+    // Pending events (producers serialized by the spinlock, single
+    // consumer loop task)
+    PourEvent _pendingEvents[POURLOG_PENDING_EVENTS];
+    std::atomic<uint32_t> _pendingHead{0};
+    std::atomic<uint32_t> _pendingTail{0};
+    std::atomic<uint32_t> _droppedEvents{0};
+
+    // Record buffer (only accessed by loop task)
+    PourRecord _bufferRecords[POURLOG_BUFFER_RECORDS];
+    uint32_t _bufferCount = 0;
+    uint32_t _bufferTimestamp = 0;
+
+    // Sequence of the last record created and written to flash
+    uint32_t _lastSequence = 0;
+    std::atomic<uint32_t> _lastWrittenSequence{0};
+
+    // Creates the ring file or finds the last sequence in it
+    bool Open();
+
+    // Writes all buffered records to flash
+    void Flush();
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+extern PourLogger PourLog;
+
+#endif
@@ -0,0 +1,272 @@
+/**
+ * Includes all recipe preset functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include "PresetStore.h"
+
+//===============================================================
+// Constants
+//===============================================================
+static const char* TAG = "presets";
+
+//===============================================================
+// Global variables
+//===============================================================
+PresetStore Presets;
+
+//===============================================================
+// Constructor
+//===============================================================
+PresetStore::PresetStore()
+{
+  SetDefaults();
+}
+
+//===============================================================
+// Initializes the preset store
+//===============================================================
+void PresetStore::Begin()
+{
+  // Log startup info
+  ESP_LOGI(TAG, "Begin initializing preset store");
+
+  // Load presets from flash
+  Load();
+
+  // Log startup info
+  ESP_LOGI(TAG, "Finished initializing preset store");
+}
+
+//===============================================================
+// Load presets from flash. Damaged or outdated blobs are replaced
+// by the compile time default recipe
+//===============================================================
+void PresetStore::Load()
+{
+  bool valid = false;
+
+  if (_preferences.begin(SETTINGS_NAME, true))
+  {
+    size_t length = _preferences.getBytesLength(KEY_PRESETS);
+    if (length >= sizeof(PresetHeader) &&
+      length <= sizeof(PresetBlob))
+    {
+      _preferences.getBytes(KEY_PRESETS, &_blob, length);
+
+      valid = _blob.Header.Version == PRESET_VERSION &&
+        _blob.Header.Count > 0 &&
+        _blob.Header.Count <= PRESET_MAX_COUNT &&
+        length == GetBlobSize(_blob.Header.Count) &&
+        _blob.Header.Crc == esp_rom_crc32_le(0, (const uint8_t*)_blob.Presets, _blob.Header.Count * sizeof(Preset));
+
+      for (uint16_t index = 0; valid && index < _blob.Header.Count; index++)
+      {
+        _blob.Presets[index].Name[PRESET_NAME_LENGTH - 1] = '\0';
+        valid = IsValid(_blob.Presets[index].Angles_Degrees);
+      }
+    }
+    _preferences.end();
+
+    ESP_LOGI(TAG, "Preferences successfully loaded from '%s'", SETTINGS_NAME);
+  }
+  else
+  {
+    ESP_LOGE(TAG, "Could not open preferences '%s'", SETTINGS_NAME);
+  }
+
+  if (!valid)
+  {
+    SetDefaults();
+  }
+
+  ESP_LOGI(TAG, "%d presets available", _blob.Header.Count);
+}
+
+//===============================================================
+// Save presets to flash (only the used presets are written)
+//===============================================================
+bool PresetStore::Save()
+{
+  _blob.Header.Version = PRESET_VERSION;
+  _blob.Header.Crc = esp_rom_crc32_le(0, (const uint8_t*)_blob.Presets, _blob.Header.Count * sizeof(Preset));
+
+  if (!_preferences.begin(SETTINGS_NAME, false))
+  {
+    ESP_LOGE(TAG, "Could not open preferences '%s'", SETTINGS_NAME);
+    return false;
+  }
+  size_t length = GetBlobSize(_blob.Header.Count);
+  size_t written = _preferences.putBytes(KEY_PRESETS, &_blob, length);
+  _preferences.end();
+
+  if (written != length)
+  {
+    ESP_LOGE(TAG, "Could not write presets to '%s'", SETTINGS_NAME);
+    return false;
+  }
+
+  ESP_LOGI(TAG, "Preferences successfully saved to '%s'", SETTINGS_NAME);
+  return true;
+}
+
+//===============================================================
+// Returns the number of presets (at least one)
+//===============================================================
+uint8_t PresetStore::GetCount()
+{
+  return _blob.Header.Count;
+}
+
+//===============================================================
+// Returns the name of a preset or an empty string for an invalid
+// index
+//===============================================================
+const char* PresetStore::GetName(uint8_t index)
+{
+  return index < _blob.Header.Count ? _blob.Presets[index].Name : "";
+}
+
+//===============================================================
+// Copies the angles of a preset, returns false for an invalid
+// index
+//===============================================================
+bool PresetStore::GetAngles(uint8_t index, int16_t (&angles_Degrees)[LIQUID_COUNT])
+{
+  if (index >= _blob.Header.Count)
+  {
+    return false;
+  }
+
+  memcpy(angles_Degrees, _blob.Presets[index].Angles_Degrees, sizeof(angles_Degrees));
+  return true;
+}
+
+//===============================================================
+// Sets a preset (index == count appends a new one) and saves all
+// presets
+//===============================================================
+bool PresetStore::SetPreset(uint8_t index, const char* name, const int16_t (&angles_Degrees)[LIQUID_COUNT])
+{
+  if (index > _blob.Header.Count ||
+    index >= PRESET_MAX_COUNT ||
+    !IsValid(angles_Degrees))
+  {
+    return false;
+  }
+
+  // Copy name, the separators of the names string are replaced
+  Preset& preset = _blob.Presets[index];
+  memset(preset.Name, 0, PRESET_NAME_LENGTH);
+  for (uint8_t pos = 0; name != NULL && name[pos] != '\0' && pos < PRESET_NAME_LENGTH - 1; pos++)
+  {
+    preset.Name[pos] = (name[pos] == ';' || name[pos] < ' ') ? ' ' : name[pos];
+  }
+  if (preset.Name[0] == '\0')
+  {
+    snprintf(preset.Name, PRESET_NAME_LENGTH, "Preset %d", index + 1);
+  }
+  memcpy(preset.Angles_Degrees, angles_Degrees, sizeof(angles_Degrees));
+
+  if (index == _blob.Header.Count)
+  {
+    _blob.Header.Count++;
+  }
+
+  return Save();
+}
+
+//===============================================================
+// Removes a preset (the last remaining preset is kept) and saves
+// all presets
+//===============================================================
+bool PresetStore::RemovePreset(uint8_t index)
+{
+  if (index >= _blob.Header.Count ||
+    _blob.Header.Count <= 1)
+  {
+    return false;
+  }
+
+  memmove(&_blob.Presets[index], &_blob.Presets[index + 1], (_blob.Header.Count - index - 1) * sizeof(Preset));
+  _blob.Header.Count--;
+
+  return Save();
+}
+
+//===============================================================
+// Returns all preset names separated by ';'
+//===============================================================
+String PresetStore::GetNamesString()
+{
+  String returnString;
+  returnString.reserve(_blob.Header.Count * PRESET_NAME_LENGTH);
+
+  for (uint16_t index = 0; index < _blob.Header.Count; index++)
+  {
+    if (index > 0)
+    {
+      returnString += ";";
+    }
+    returnString += _blob.Presets[index].Name;
+  }
+
+  return returnString;
+}
+
+//===============================================================
+// Sets the compile time default recipe as only preset
+//===============================================================
+void PresetStore::SetDefaults()
+{
+  memset(&_blob, 0, sizeof(PresetBlob));
+  _blob.Header.Version = PRESET_VERSION;
+  _blob.Header.Count = 1;
+
+  Preset& preset = _blob.Presets[0];
+  strncpy(preset.Name, "Default", PRESET_NAME_LENGTH - 1);
+  memcpy(preset.Angles_Degrees, LiquidDefaultAngles_Degrees, sizeof(preset.Angles_Degrees));
+}
+
+//===============================================================
+// Returns true, if the angles form a valid mixture (clockwise
+// ordered with at least the minimum distance)
+//===============================================================
+bool PresetStore::IsValid(const int16_t (&angles_Degrees)[LIQUID_COUNT])
+{
+  int16_t sum_Degrees = 0;
+  for (uint8_t index = 0; index < LIQUID_COUNT; index++)
+  {
+    int16_t angle_Degrees = angles_Degrees[index];
+    int16_t nextAngle_Degrees = angles_Degrees[index + 1 < LIQUID_COUNT ? index + 1 : 0];
+    if (angle_Degrees < 0 || angle_Degrees >= 360 ||
+      nextAngle_Degrees < 0 || nextAngle_Degrees >= 360)
+    {
+      return false;
+    }
+
+    int16_t distance_Degrees = GetDistanceDegrees(angle_Degrees, nextAngle_Degrees);
+    if (distance_Degrees < MINANGLE_DEGREES)
+    {
+      return false;
+    }
+    sum_Degrees += distance_Degrees;
+  }
+
+  // Angles out of order wrap around more than once
+  return sum_Degrees == 360;
+}
+
+//===============================================================
+// Returns the blob size of the used presets
+//===============================================================
+size_t PresetStore::GetBlobSize(uint16_t count)
+{
+  return sizeof(PresetHeader) + count * sizeof(Preset);
+}
@@ -0,0 +1,116 @@
+/**
+ * Includes all recipe preset functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef PRESETSTORE_H
+#define PRESETSTORE_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+#include "Config.h"
+#include "AngleHelper.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#define PRESET_MAX_COUNT      24          // Maximum number of recipe presets
+#define PRESET_NAME_LENGTH    16          // Including zero terminator
+#define PRESET_VERSION        1           // Blob version, increment on layout changes
+
+#define KEY_PRESETS           "Presets"   // Key name: Maximum string length is 15 bytes, excluding a zero terminator.
+
+//===============================================================
+// Structs
+//===============================================================
+// Named recipe, angles as used by the mixture
+struct Preset
+{
+  char Name[PRESET_NAME_LENGTH];
+  int16_t Angles_Degrees[LIQUID_COUNT];
+};
+
+// Preset blob header, stored in front of the used presets
+struct PresetHeader
+{
+  uint16_t Version;
+  uint16_t Count;
+  uint32_t Crc;                   // CRC32 of all used presets
+};
+
+// Preset blob, stored as one preferences blob (only the used presets)
+struct PresetBlob
+{
+  PresetHeader Header;
+  Preset Presets[PRESET_MAX_COUNT];
+};
+
+//===============================================================
+// Class for recipe presets. All presets are loaded once into RAM,
+// changes are written back as one blob. Must be used from the main
+// task only
+//===============================================================
+class PresetStore
+{
+  public:
+    // Constructor
+    PresetStore();
+
+    // Initializes the preset store
+    void Begin();
+
+    // Load presets from flash
+    void Load();
+
+    // Save presets to flash
+    bool Save();
+
+    // Returns the number of presets (at least one)
+    uint8_t GetCount();
+
+    // Returns the name of a preset or an empty string for an invalid index
+    const char* GetName(uint8_t index);
+
+    // Copies the angles of a preset, returns false for an invalid index
+    bool GetAngles(uint8_t index, int16_t (&angles_Degrees)[LIQUID_COUNT]);
+
+    // Sets a preset (index == count appends a new one) and saves all presets
+    bool SetPreset(uint8_t index, const char* name, const int16_t (&angles_Degrees)[LIQUID_COUNT]);
+
+    // Removes a preset (the last remaining preset is kept) and saves all presets
+    bool RemovePreset(uint8_t index);
+
+    // Returns all preset names separated by ';'
+    String GetNamesString();
+
+  private:
+    // Preferences variable
+    Preferences _preferences;
+
+    // Presets in RAM, in the same layout as on flash
+    PresetBlob _blob;
+
+    // Sets the compile time default recipe as only preset
+    void SetDefaults();
+
+    // Returns true, if the angles form a valid mixture
+    bool IsValid(const int16_t (&angles_Degrees)[LIQUID_COUNT]);
+
+    // Returns the blob size of the used presets
+    size_t GetBlobSize(uint16_t count);
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+extern PresetStore Presets;
+
+#endif
@@ -31,15 +31,13 @@ PumpDriver::PumpDriver()
 //===============================================================
 // Initializes the pump driver
 //===============================================================
-void PumpDriver::Begin(uint8_t pinPump1, uint8_t pinPump2, uint8_t pinPump3, double vccVoltage)
+void PumpDriver::Begin(const uint8_t (&pinPumps)[LIQUID_COUNT], double vccVoltage)
 {
   // Log startup info
   ESP_LOGI(TAG, "Begin initializing pump driver");
 
   // Set pins
-  _pinPump1 = pinPump1;
-  _pinPump2 = pinPump2;
-  _pinPump3 = pinPump3;
+  memcpy(_pinPumps, pinPumps, sizeof(_pinPumps));
 
   // Save VCC voltage
   _vccVoltage = vccVoltage;
@@ -65,6 +63,10 @@ void PumpDriver::Load()
     _cycleTimespan_ms = _preferences.getLong(KEY_CYCLETIMESPAN_MS, DEFAULT_CYCLE_TIMESPAN_MS);
     _preferences.end();
 
+#if defined(ERROR_DIFFUSION_PUMPS)
+    _slotTimespan_ms = _cycleTimespan_ms / PUMP_SLOTS_PER_CYCLE;
+#endif
+
     ESP_LOGI(TAG, "Preferences successfully loaded from '%s'", SETTINGS_NAME);
   }
   else
@@ -93,45 +95,57 @@ void PumpDriver::Save()
 }
 
 //===============================================================
-// Enables pump output
+// Enables pump output (interrupt service routine or task)
 //===============================================================
 void PumpDriver::Enable()
 {
-  if (_isPumpEnabled)
+  portENTER_CRITICAL_SAFE(&_pumpMux);
+
+  bool wasEnabled = _isPumpEnabled;
+  if (!wasEnabled)
   {
-    return;
+    // Enable internal gpios
+    EnableInternal();
+
+    // Set enabled flag to true
+    // -> Update function is unlocked
+    _isPumpEnabled = true;
   }
 
-  // Enable internal gpios
-  EnableInternal();
- 
-  // Set enabled flag to true
-  // -> Update function is unlocked
-  _isPumpEnabled = true;
+  portEXIT_CRITICAL_SAFE(&_pumpMux);
 
-  // Set log info
-  ESP_LOGI(TAG, "Pumps enabled");
+  if (!wasEnabled)
+  {
+    // Set log info
+    ESP_LOGI(TAG, "Pumps enabled");
+  }
 }
 
 //===============================================================
-// Disables pump output
+// Disables pump output (interrupt service routine or task)
 //===============================================================
 void PumpDriver::Disable()
 {
-  if (!_isPumpEnabled)
+  portENTER_CRITICAL_SAFE(&_pumpMux);
+
+  bool wasEnabled = _isPumpEnabled;
+  if (wasEnabled)
   {
-    return;
+    // Set enabled flag to false 
+    // -> Update function is locked
+    _isPumpEnabled = false;
+
+    // Disable internal gpios
+    DisableInternal();
   }
-  
-  // Set enabled flag to false 
-  // -> Update function is locked
-  _isPumpEnabled = false;
 
-  // Disable internal gpios
-  DisableInternal();
-  
-  // Set log info
-  ESP_LOGI(TAG, "Pumps disabled");
+  portEXIT_CRITICAL_SAFE(&_pumpMux);
+
+  if (wasEnabled)
+  {
+    // Set log info
+    ESP_LOGI(TAG, "Pumps disabled");
+  }
 }
 
 //===============================================================
@@ -140,9 +154,15 @@ void PumpDriver::Disable()
 void PumpDriver::EnableInternal()
 {
   // Set pins to output direction (enable)
-  pinMode(_pinPump1, OUTPUT);
-  pinMode(_pinPump2, OUTPUT);
-  pinMode(_pinPump3, OUTPUT);
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    pinMode(_pinPumps[pump], OUTPUT);
+  }
+
+#if defined(ERROR_DIFFUSION_PUMPS)
+  // Start with a new slot at the next update
+  _lastPumpCycleStart_ms = millis() - _slotTimespan_ms;
+#endif
 }
 
 //===============================================================
@@ -151,30 +171,52 @@ void PumpDriver::EnableInternal()
 void PumpDriver::DisableInternal()
 {
   // Set pins to input direction (disable)
-  pinMode(_pinPump1, INPUT);
-  pinMode(_pinPump2, INPUT);
-  pinMode(_pinPump3, INPUT);
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    pinMode(_pinPumps[pump], INPUT);
+  }
   
   // Disable pumps, just to be sure
-  digitalWrite(_pinPump1, LOW);
-  digitalWrite(_pinPump2, LOW);
-  digitalWrite(_pinPump3, LOW);
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    digitalWrite(_pinPumps[pump], LOW);
+  }
+
+  uint32_t flowTimes_ms[LIQUID_COUNT];
+#if defined(ERROR_DIFFUSION_PUMPS)
+  // Save timestamp
+  uint32_t offTimestamp_ms = millis();
 
+  // The current slot is cut short. Only the unused rest of the slot
+  // is latched here, the carried errors are corrected by the next
+  // update (no divisions in the interrupt service routine)
+  uint32_t passedSlot_ms = offTimestamp_ms - _lastPumpCycleStart_ms;
+  uint32_t remainingSlot_ms = passedSlot_ms < _slotTimespan_ms ? _slotTimespan_ms - passedSlot_ms : 0;
+  _disabledSlot_ms += remainingSlot_ms;
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    _disabledOnSlotPumps_ms[pump] += _lastEnablePumps[pump] == true ? remainingSlot_ms : 0;
+
+    // Add already passed flow time to flow meter if pump is not already off
+    flowTimes_ms[pump] = _lastEnablePumps[pump] == true ? offTimestamp_ms - _onTimestampPumps_ms[pump] : 0;
+  }
+  FlowMeter.AddFlowTime(flowTimes_ms);
+#else
   // Save timestamp
   uint32_t onTimestamp_ms = _lastPumpCycleStart_ms;
   uint32_t offTimestamp_ms = millis();
 
   // Add already passed flow time to flow meter if pump is not already off
   uint32_t passedFlowTime = offTimestamp_ms - onTimestamp_ms;
-  uint32_t flowTime1_ms = _lastEnablePump1 == true ? passedFlowTime : 0;
-  uint32_t flowTime2_ms = _lastEnablePump2 == true ? passedFlowTime : 0;
-  uint32_t flowTime3_ms = _lastEnablePump3 == true ? passedFlowTime : 0;
-  FlowMeter.AddFlowTime(flowTime1_ms, flowTime2_ms, flowTime3_ms);
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    flowTimes_ms[pump] = _lastEnablePumps[pump] == true ? passedFlowTime : 0;
+  }
+  FlowMeter.AddFlowTime(flowTimes_ms);
+#endif
 
   // All pumps are now disabled
-  _lastEnablePump1 = false;
-  _lastEnablePump2 = false;
-  _lastEnablePump3 = false;
+  memset(_lastEnablePumps, 0, sizeof(_lastEnablePumps));
 }
 
 //===============================================================
@@ -188,21 +230,59 @@ bool PumpDriver::IsEnabled()
 //===============================================================
 // Sets pumps from percentage (0-100%)
 //===============================================================
-void PumpDriver::SetPumps(double value1_Percentage, double value2_Percentage, double value3_Percentage)
+void PumpDriver::SetPumps(const double (&values_Percentage)[LIQUID_COUNT])
 {
   // Check min and max borders (0-100%)
-  double pump1Clip_Percentage = min(max(value1_Percentage, 0.0), 100.0);
-  double pump2Clip_Percentage = min(max(value2_Percentage, 0.0), 100.0);
-  double pump3Clip_Percentage = min(max(value3_Percentage, 0.0), 100.0);
+  double clip_Percentage[LIQUID_COUNT];
+  double maxValue_Percentage = 1.0; // 1.0->avoid divison by zero if all values are zero
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    clip_Percentage[pump] = min(max(values_Percentage[pump], 0.0), 100.0);
+    maxValue_Percentage = max(maxValue_Percentage, clip_Percentage[pump]);
+  }
 
   // Calculate pwm timings (pump with the highest value is set
-  // to 100% pwm and the other two in relative to the max one)
-  double maxValue_Percentage = max(1.0, max(pump1Clip_Percentage, max(pump2Clip_Percentage, pump3Clip_Percentage))); // 1.0->avoid divison by zero if all values are zero
-  _pwmPump1_ms = (uint32_t)(pump1Clip_Percentage / maxValue_Percentage * _cycleTimespan_ms);
-  _pwmPump2_ms = (uint32_t)(pump2Clip_Percentage / maxValue_Percentage * _cycleTimespan_ms);
-  _pwmPump3_ms = (uint32_t)(pump3Clip_Percentage / maxValue_Percentage * _cycleTimespan_ms);
+  // to 100% pwm and the others in relative to the max one)
+  uint32_t pwmPumps_ms[LIQUID_COUNT];
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    pwmPumps_ms[pump] = (uint32_t)(clip_Percentage[pump] / maxValue_Percentage * _cycleTimespan_ms);
+  }
+
+#if defined(ERROR_DIFFUSION_PUMPS)
+  // Calculate duties in fixed point (Q16), rounded instead of truncated
+  int32_t dutyPumps[LIQUID_COUNT];
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    dutyPumps[pump] = (int32_t)(clip_Percentage[pump] / maxValue_Percentage * PUMP_DUTY_FULL + 0.5);
+  }
+#endif
+
+  // Apply all values at once (the update runs in another task)
+  portENTER_CRITICAL(&_pumpMux);
 
-  ESP_LOGI(TAG, "Pump values changed to %d|%d|%d ms", _pwmPump1_ms, _pwmPump2_ms, _pwmPump3_ms);
+  memcpy(_pwmPumps_ms, pwmPumps_ms, sizeof(_pwmPumps_ms));
+
+#if defined(ERROR_DIFFUSION_PUMPS)
+  memcpy(_dutyPumps, dutyPumps, sizeof(_dutyPumps));
+
+  // Carried error of the old mixture must not distort the new one
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    _errorPumps[pump] = constrain(_errorPumps[pump], 0, PUMP_DUTY_FULL - 1);
+  }
+#endif
+
+  portEXIT_CRITICAL(&_pumpMux);
+
+  // Log pwm timings ("1000|" per pump)
+  char values[LIQUID_COUNT * 6];
+  size_t length = 0;
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    length += snprintf(values + length, sizeof(values) - length, pump == 0 ? "%d" : "|%d", (int)pwmPumps_ms[pump]);
+  }
+  ESP_LOGI(TAG, "Pump values changed to %s ms", values);
 }
 
 //===============================================================
@@ -218,7 +298,12 @@ bool PumpDriver::SetCycleTimespan(uint32_t value_ms)
   }
 
   // Set new value
+  portENTER_CRITICAL(&_pumpMux);
   _cycleTimespan_ms = value_ms;
+#if defined(ERROR_DIFFUSION_PUMPS)
+  _slotTimespan_ms = value_ms / PUMP_SLOTS_PER_CYCLE;
+#endif
+  portEXIT_CRITICAL(&_pumpMux);
   ESP_LOGI(TAG, "Cycle timespan changed to %d ms", _cycleTimespan_ms);
   
   return true;
@@ -233,18 +318,90 @@ uint32_t PumpDriver::GetCycleTimespan()
 }
 
 //===============================================================
-// Should be called every < 50 ms
+// Returns the flow rate of all pumps together while enabled in
+// l/ms (on-time share of the cycle times the pump flow rate)
+//===============================================================
+double PumpDriver::GetFlowRate()
+{
+  double flowRate = 0.0;
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+#if defined(ERROR_DIFFUSION_PUMPS)
+    flowRate += (double)_dutyPumps[pump] * FlowRates[pump] / PUMP_DUTY_FULL;
+#else
+    flowRate += (double)_pwmPumps_ms[pump] * FlowRates[pump] / _cycleTimespan_ms;
+#endif
+  }
+  return flowRate;
+}
+
+//===============================================================
+// Should be called every < 50 ms. The lever interrupt cannot
+// enable or disable the pumps in the middle of an update
 //===============================================================
 void PumpDriver::Update()
 {
-  if (!_isPumpEnabled)
+  portENTER_CRITICAL(&_pumpMux);
+
+#if defined(ERROR_DIFFUSION_PUMPS)
+  // Correct the carried errors by slots cut short by the lever
+  ApplyDisabledSlots();
+#endif
+
+  if (_isPumpEnabled)
+  {
+    UpdateOutputs(millis());
+  }
+
+  portEXIT_CRITICAL(&_pumpMux);
+}
+
+//===============================================================
+// Updates the pump outputs (called with the spinlock held)
+//===============================================================
+void PumpDriver::UpdateOutputs(uint32_t absoluteTime_ms)
+{
+#if defined(ERROR_DIFFUSION_PUMPS)
+  // Wait for the next slot (slots are kept on a fixed grid unless an update was missed)
+  if ((absoluteTime_ms - _lastPumpCycleStart_ms) < _slotTimespan_ms)
   {
     return;
   }
-  
-  // Save absolute time for pwm calculations
-  uint32_t absoluteTime_ms = millis();
+  _lastPumpCycleStart_ms += _slotTimespan_ms;
+  if ((absoluteTime_ms - _lastPumpCycleStart_ms) >= _slotTimespan_ms)
+  {
+    _lastPumpCycleStart_ms = absoluteTime_ms;
+  }
+
+  // Sigma-delta: a pump is on for this slot, if its carried error reaches 100%
+  bool enablePumps[LIQUID_COUNT];
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    _errorPumps[pump] += _dutyPumps[pump];
+    enablePumps[pump] = _errorPumps[pump] >= PUMP_DUTY_FULL;
+    _errorPumps[pump] -= enablePumps[pump] ? PUMP_DUTY_FULL : 0;
+  }
 
+  // Write digital pins
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    digitalWrite(_pinPumps[pump], enablePumps[pump] ? HIGH : LOW);
+  }
+
+  // Add measured flow times when powering off (falling edge)
+  uint32_t flowTimes_ms[LIQUID_COUNT];
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    flowTimes_ms[pump] = _lastEnablePumps[pump] == true && enablePumps[pump] == false ? absoluteTime_ms - _onTimestampPumps_ms[pump] : 0;
+  }
+  FlowMeter.AddFlowTime(flowTimes_ms);
+
+  // Save timestamps when powering on (rising edge)
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    _onTimestampPumps_ms[pump] = _lastEnablePumps[pump] == false && enablePumps[pump] == true ? absoluteTime_ms : _onTimestampPumps_ms[pump];
+  }
+#else
   // New cycle starts, reset last pump cycle timestamp
   if ((absoluteTime_ms - _lastPumpCycleStart_ms) > _cycleTimespan_ms)
   {
@@ -255,23 +412,58 @@ void PumpDriver::Update()
   uint32_t relativeTime_ms = absoluteTime_ms - _lastPumpCycleStart_ms;
 
   // Check if pumps must be powered on or off
-  bool enablePump1 = relativeTime_ms < _pwmPump1_ms;
-  bool enablePump2 = relativeTime_ms < _pwmPump2_ms;
-  bool enablePump3 = relativeTime_ms < _pwmPump3_ms;
+  bool enablePumps[LIQUID_COUNT];
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    enablePumps[pump] = relativeTime_ms < _pwmPumps_ms[pump];
+  }
 
   // Write digital pins
-  digitalWrite(_pinPump1, enablePump1 ? HIGH : LOW);
-  digitalWrite(_pinPump2, enablePump2 ? HIGH : LOW);
-  digitalWrite(_pinPump3, enablePump3 ? HIGH : LOW);
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    digitalWrite(_pinPumps[pump], enablePumps[pump] ? HIGH : LOW);
+  }
 
   // Add flow times when powering off (falling edge)
-  uint32_t flowTime1_ms = _lastEnablePump1 == true && enablePump1 == false ? _pwmPump1_ms : 0;
-  uint32_t flowTime2_ms = _lastEnablePump2 == true && enablePump2 == false ? _pwmPump2_ms : 0;
-  uint32_t flowTime3_ms = _lastEnablePump3 == true && enablePump3 == false ? _pwmPump3_ms : 0;
-  FlowMeter.AddFlowTime(flowTime1_ms, flowTime2_ms, flowTime3_ms);
-
-  // Save enabled state for next update
-  _lastEnablePump1 = enablePump1;
-  _lastEnablePump2 = enablePump2;
-  _lastEnablePump3 = enablePump3;
+  uint32_t flowTimes_ms[LIQUID_COUNT];
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    flowTimes_ms[pump] = _lastEnablePumps[pump] == true && enablePumps[pump] == false ? _pwmPumps_ms[pump] : 0;
+  }
+  FlowMeter.AddFlowTime(flowTimes_ms);
+#endif
+
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    // Count pump starts (rising edge)
+    if (_lastEnablePumps[pump] == false && enablePumps[pump] == true) { Metrics.Add((MetricCounter)(eMetricPumpStarts + pump)); }
+
+    // Save enabled state for next update
+    _lastEnablePumps[pump] = enablePumps[pump];
+  }
+}
+
+#if defined(ERROR_DIFFUSION_PUMPS)
+//===============================================================
+// Corrects the carried errors by the slot rests cut short by
+// disabling (called with the spinlock held): running pumps get the
+// rest credited, all pumps are debited with their duty for it. The
+// difference is dispensed with the next lever press
+//===============================================================
+void PumpDriver::ApplyDisabledSlots()
+{
+  if (_disabledSlot_ms == 0)
+  {
+    return;
+  }
+
+  int64_t disabledSlot_ms = _disabledSlot_ms;
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    _errorPumps[pump] += (int32_t)(((int64_t)_disabledOnSlotPumps_ms[pump] * PUMP_DUTY_FULL - _dutyPumps[pump] * disabledSlot_ms) / _slotTimespan_ms);
+    _disabledOnSlotPumps_ms[pump] = 0;
+  }
+
+  _disabledSlot_ms = 0;
 }
+#endif
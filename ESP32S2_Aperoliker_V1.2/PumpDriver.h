@@ -16,6 +16,7 @@
 #include <esp_log.h>
 #include "Config.h"
 #include "FlowMeterDriver.h"
+#include "Metrics.h"
 
 //===============================================================
 // Defines
@@ -24,6 +25,9 @@
 #define MIN_CYCLE_TIMESPAN_MS         (uint32_t)200
 #define MAX_CYCLE_TIMESPAN_MS         (uint32_t)1000
 
+#define PUMP_SLOTS_PER_CYCLE          10            // Error diffusion: on/off decision per 1/10 cycle
+#define PUMP_DUTY_FULL                (int32_t)65536  // Error diffusion: fixed point 100% duty (Q16)
+
 #define KEY_CYCLETIMESPAN_MS          "CycleTimespan" // Key name: Maximum string length is 15 bytes, excluding a zero terminator.
 
 //===============================================================
@@ -36,7 +40,7 @@ class PumpDriver
     PumpDriver();
 
     // Initializes the pump driver
-    void Begin(uint8_t pinPump1, uint8_t pinPump2, uint8_t pinPump3, double vccVoltage);
+    void Begin(const uint8_t (&pinPumps)[LIQUID_COUNT], double vccVoltage);
     
     // Load settings from flash
     void Load();
@@ -44,23 +48,26 @@ class PumpDriver
     // Save settings to flash
     void Save();
 
-    // Enables pump output
+    // Enables pump output (interrupt service routine or task)
     void IRAM_ATTR Enable();
     
-    // Disables pump output
+    // Disables pump output (interrupt service routine or task)
     void IRAM_ATTR Disable();
 
     // Return true, if the pumps are enabled. Otherwise false
     bool IsEnabled();
 
     // Sets pumps from percentage (0-100%)
-    void SetPumps(double value1_Percentage, double value2_Percentage, double value3_Percentage);
+    void SetPumps(const double (&values_Percentage)[LIQUID_COUNT]);
 
     // Sets the cycle timespan in ms (200-1000ms)
     bool SetCycleTimespan(uint32_t value_ms);
 
     // Returns the current cycle timespan
     uint32_t GetCycleTimespan();
+
+    // Returns the flow rate of all pumps together while enabled in l/ms
+    double GetFlowRate();
     
     // Should be called every < 50 ms
     void IRAM_ATTR Update();
@@ -70,31 +77,50 @@ class PumpDriver
     Preferences _preferences;
 
     // Pin definitions
-    uint8_t _pinPump1;
-    uint8_t _pinPump2;
-    uint8_t _pinPump3;
+    uint8_t _pinPumps[LIQUID_COUNT];
 
     // VCC voltage
     double _vccVoltage;
 
+    // Guards the pump state against the lever interrupt (enable and
+    // disable) while the pump update or new pump values are applied
+    portMUX_TYPE _pumpMux = portMUX_INITIALIZER_UNLOCKED;
+
     // Timing values
     uint32_t _cycleTimespan_ms = DEFAULT_CYCLE_TIMESPAN_MS;
     bool _isPumpEnabled = false;
-    uint32_t _pwmPump1_ms = 0;
-    uint32_t _pwmPump2_ms = 0;
-    uint32_t _pwmPump3_ms = 0;
+    uint32_t _pwmPumps_ms[LIQUID_COUNT] = { };
+
+#if defined(ERROR_DIFFUSION_PUMPS)
+    // Error diffusion values (duty and carried error in Q16)
+    int32_t _dutyPumps[LIQUID_COUNT] = { };
+    int32_t _errorPumps[LIQUID_COUNT] = { };
+    uint32_t _onTimestampPumps_ms[LIQUID_COUNT] = { };
+    uint32_t _slotTimespan_ms = DEFAULT_CYCLE_TIMESPAN_MS / PUMP_SLOTS_PER_CYCLE;
+
+    // Slot rests cut short by disabling (latched by the interrupt
+    // service routine, applied to the carried errors by the update)
+    uint32_t _disabledSlot_ms = 0;
+    uint32_t _disabledOnSlotPumps_ms[LIQUID_COUNT] = { };
+#endif
 
     // Last variables for edge detection
-    bool _lastEnablePump1 = false;
-    bool _lastEnablePump2 = false;
-    bool _lastEnablePump3 = false;
+    bool _lastEnablePumps[LIQUID_COUNT] = { };
     uint32_t _lastPumpCycleStart_ms = 0;
     
     // Enables pump output (internal)
-    void EnableInternal();
+    void IRAM_ATTR EnableInternal();
 
     // Disables pump output (internal)
-    void DisableInternal();
+    void IRAM_ATTR DisableInternal();
+
+    // Updates the pump outputs (called with the spinlock held)
+    void UpdateOutputs(uint32_t absoluteTime_ms);
+
+#if defined(ERROR_DIFFUSION_PUMPS)
+    // Corrects the carried errors by the slot rests cut short
+    void ApplyDisabledSlots();
+#endif
 };
 
 //===============================================================
@@ -9,6 +9,7 @@
 //===============================================================
 // Includes
 //===============================================================
+#include <memory>
 #include "SPIFFSEditor.h"
 
 //===============================================================
@@ -16,6 +17,11 @@
 //=============================================================== 
 #define edit_html_gz_len              4249
 
+//===============================================================
+// Constants
+//===============================================================
+static const char* TAG = "editor";
+
 //===============================================================
 // https://mischianti.org/online-converter-file-to-cpp-gzip-byte-array-3/
 // File: edit.html.gz, Size: 4249
@@ -293,8 +299,7 @@ const uint8_t edit_html_gz[] PROGMEM =
 //===============================================================
 // Constructor
 //===============================================================
-SPIFFSEditor::SPIFFSEditor() :
-  _startTime(0)
+SPIFFSEditor::SPIFFSEditor()
 {
 }
 
@@ -308,6 +313,7 @@ bool SPIFFSEditor::canHandle(AsyncWebServerRequest* request) const
     if (request->method() == HTTP_GET)
     {
       if (request->hasParam("list") ||
+        request->hasParam("progress") ||
         request->hasParam("systeminfo") ||
         request->hasParam("format"))
       {
@@ -315,7 +321,7 @@ bool SPIFFSEditor::canHandle(AsyncWebServerRequest* request) const
       }
       else if (request->hasParam("edit"))
       {
-        request->_tempFile = SPIFFS.open(request->arg("edit"), "r");
+        request->_tempFile = Storage.Open(request->arg("edit").c_str());
         if (!request->_tempFile)
         {
           return false;
@@ -329,7 +335,7 @@ bool SPIFFSEditor::canHandle(AsyncWebServerRequest* request) const
       }
       else if (request->hasParam("download"))
       {
-        request->_tempFile = SPIFFS.open(request->arg("download"), "r");
+        request->_tempFile = Storage.Open(request->arg("download").c_str());
         if (!request->_tempFile)
         {
           return false;
@@ -356,6 +362,60 @@ bool SPIFFSEditor::canHandle(AsyncWebServerRequest* request) const
   return false;
 }
 
+//===============================================================
+// Fills the buffer with the next part of the JSON directory
+// listing, returns 0 if the listing is finished
+//===============================================================
+size_t SPIFFSEditor::ReadListing(SPIFFSListing* context, uint8_t* buffer, size_t maxLen)
+{
+  size_t length = 0;
+
+  while (length < maxLen)
+  {
+    // Copy (rest of) current line
+    if (context->LineOffset < context->LineLength)
+    {
+      size_t count = min(context->LineLength - context->LineOffset, maxLen - length);
+      memcpy(buffer + length, context->Line + context->LineOffset, count);
+      context->LineOffset += count;
+      length += count;
+      continue;
+    }
+    context->LineOffset = 0;
+    context->LineLength = 0;
+
+    if (context->Done)
+    {
+      break;
+    }
+
+    // Array start
+    if (!context->HeaderDone)
+    {
+      context->LineLength = snprintf(context->Line, sizeof(context->Line), "[");
+      context->HeaderDone = true;
+      continue;
+    }
+
+    // Next entry or array end
+    File entry = context->Directory ? context->Directory.openNextFile() : File();
+    if (!entry)
+    {
+      context->Directory.close();
+      context->LineLength = snprintf(context->Line, sizeof(context->Line), "]");
+      context->Done = true;
+      continue;
+    }
+
+    context->LineLength = snprintf(context->Line, sizeof(context->Line), "%s{\"type\":\"file\",\"name\":\"%s\",\"size\":%u}",
+      context->Entries > 0 ? "," : "", entry.name(), (unsigned int)entry.size());
+    context->LineLength = min(context->LineLength, sizeof(context->Line) - 1);
+    context->Entries++;
+  }
+
+  return length;
+}
+
 //===============================================================
 // Handles the request
 //===============================================================
@@ -365,49 +425,39 @@ void SPIFFSEditor::handleRequest(AsyncWebServerRequest* request)
   {
     if (request->hasParam("format"))
     {
-      SPIFFS.format();
-      request->send(200, "", "FORMAT: SPIFFS sucessfully formatted");
+      if (Storage.Format())
+      {
+        request->send(200, "", String("FORMAT: ") + Storage.GetName() + " sucessfully formatted");
+      }
+      else
+      {
+        request->send(500, "", String("FORMAT: ") + Storage.GetName() + " could not be formatted");
+      }
+    }
+    else if (request->hasParam("progress"))
+    {
+      // Progress of the running upload (zero without upload)
+      char progress[48];
+      snprintf(progress, sizeof(progress), "{\"received\":%u,\"total\":%u}",
+        _activeUpload != NULL ? (unsigned int)_activeUpload->Received : 0,
+        _activeUpload != NULL ? (unsigned int)_activeUpload->Total : 0);
+      request->send(200, "application/json", progress);
     }
     else if (request->hasParam("systeminfo"))
     {
-      request->send(200, "", Systemhelper.GetSystemInfoString());
+      AsyncResponseStream* response = request->beginResponseStream("text/plain");
+      Systemhelper.PrintSystemInfo(*response);
+      request->send(response);
     }
     else if (request->hasParam("list"))
     {
-      String path = request->getParam("list")->value();
-      
-      // Open directory
-      File dir = SPIFFS.open(path);
-      
-      path = String();
-      String output = "[";
-
-      // Open first file
-      File entry = dir.openNextFile();
-
-      // Iterate through all files
-      while (entry)
+      // Stream the listing entry by entry (no growing string)
+      std::shared_ptr<SPIFFSListing> context = std::make_shared<SPIFFSListing>();
+      context->Directory = Storage.Open(request->getParam("list")->value().c_str());
+      request->send(request->beginChunkedResponse("application/json", [context](uint8_t* buffer, size_t maxLen, size_t index) -> size_t
       {
-        if (output != "[")
-        {
-          output += ',';
-        }
-        output += "{\"type\":\"";
-        output += "file";
-        output += "\",\"name\":\"";
-        output += String(entry.name());
-        output += "\",\"size\":";
-        output += String(entry.size());
-        output += "}";
-
-        entry = dir.openNextFile();
-      }
-
-      dir.close();
-
-      output += "]";
-      request->send(200, "application/json", output);
-      output = String();
+        return ReadListing(context.get(), buffer, maxLen);
+      }));
     }
     else if (request->hasParam("edit") ||
       request->hasParam("download"))
@@ -439,9 +489,9 @@ void SPIFFSEditor::handleRequest(AsyncWebServerRequest* request)
       return;
     }
 
-    if (!SPIFFS.remove(request->getParam("path", true)->value()))
+    if (!Storage.Remove(request->getParam("path", true)->value().c_str()))
     {
-      request->send(404, "", "DELETE: Error deleting file, SPIFFS error");
+      request->send(404, "", "DELETE: Error deleting file, storage error");
       return;
     }
 
@@ -449,8 +499,16 @@ void SPIFFSEditor::handleRequest(AsyncWebServerRequest* request)
   }
   else if (request->method() == HTTP_POST)
   {
-    if (request->hasParam("data", true, true) &&
-      SPIFFS.exists(request->getParam("data", true, true)->value()))
+    SPIFFSUpload* upload = (SPIFFSUpload*)request->_tempObject;
+    if (upload == NULL &&
+      _activeUpload != NULL)
+    {
+      request->send(409, "", "UPLOAD: Another upload is in progress");
+    }
+    else if (upload != NULL &&
+      !upload->Failed &&
+      request->hasParam("data", true, true) &&
+      Storage.Exists(request->getParam("data", true, true)->value().c_str()))
     {
       request->send(200, "", "UPLOAD: " + request->getParam("data", true, true)->value());
     }
@@ -462,24 +520,146 @@ void SPIFFSEditor::handleRequest(AsyncWebServerRequest* request)
 }
 
 //===============================================================
-// Handles the upload
+// Handles the upload. Data is collected to whole flash pages and
+// written to a temp file, which replaces the target file at the
+// end (a failed upload leaves the old file untouched). Only one
+// upload runs at a time, the data of further uploads is ignored
 //===============================================================
 void SPIFFSEditor::handleUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final)
 {
+  SPIFFSUpload* upload = (SPIFFSUpload*)request->_tempObject;
+
   if (!index)
   {
-    request->_tempFile = SPIFFS.open(filename, "w");
-    _startTime = millis();
-  }
-  if (request->_tempFile)
-  {
-    if (len)
+    if (upload == NULL &&
+      _activeUpload != NULL)
+    {
+      ESP_LOGE(TAG, "Upload '%s' rejected, another upload is in progress", filename.c_str());
+      return;
+    }
+
+    // Context is freed by the request
+    if (upload == NULL &&
+      (upload = (SPIFFSUpload*)malloc(sizeof(SPIFFSUpload))) == NULL)
     {
-      request->_tempFile.write(data,len);
+      ESP_LOGE(TAG, "Could not allocate upload buffer for '%s'", filename.c_str());
+      return;
     }
-    if (final)
+    request->_tempObject = upload;
+
+    memset(upload, 0, offsetof(SPIFFSUpload, Buffer));
+    upload->Start_ms = millis();
+    upload->LastLog_ms = upload->Start_ms;
+    upload->Total = request->contentLength();
+    _activeUpload = upload;
+
+    // The upload ends with the request. The temp file of an aborted
+    // upload is removed
+    request->onDisconnect([this, request]()
+    {
+      SPIFFSUpload* upload = (SPIFFSUpload*)request->_tempObject;
+      if (upload == _activeUpload)
+      {
+        _activeUpload = NULL;
+      }
+
+      if (upload != NULL &&
+        !upload->Done &&
+        upload->TempPath[0] != '\0')
+      {
+        request->_tempFile.close();
+        Storage.Remove(upload->TempPath);
+        ESP_LOGE(TAG, "Upload '%s' aborted", upload->TempPath);
+      }
+    });
+
+    if (filename.length() + strlen(EDITOR_UPLOAD_TEMP_SUFFIX) >= EDITOR_UPLOAD_PATH_LENGTH)
     {
-      request->_tempFile.close();
+      ESP_LOGE(TAG, "Upload path '%s' too long", filename.c_str());
+      upload->Failed = true;
+      return;
     }
+    snprintf(upload->TempPath, sizeof(upload->TempPath), "%s%s", filename.c_str(), EDITOR_UPLOAD_TEMP_SUFFIX);
+
+    request->_tempFile = Storage.Open(upload->TempPath, FILE_WRITE);
+    if (!request->_tempFile)
+    {
+      ESP_LOGE(TAG, "Could not create '%s'", upload->TempPath);
+      upload->Failed = true;
+      upload->TempPath[0] = '\0';
+      return;
+    }
+  }
+
+  if (upload == NULL ||
+    upload->Failed)
+  {
+    return;
+  }
+
+  // Collect data, full buffers are written
+  upload->Received += len;
+  while (len > 0)
+  {
+    size_t count = min(len, (size_t)EDITOR_UPLOAD_BUFFER_SIZE - upload->BufferLength);
+    memcpy(upload->Buffer + upload->BufferLength, data, count);
+    upload->BufferLength += count;
+    data += count;
+    len -= count;
+
+    if (upload->BufferLength == EDITOR_UPLOAD_BUFFER_SIZE)
+    {
+      FlushUpload(request, upload);
+    }
+  }
+
+  if (millis() - upload->LastLog_ms >= EDITOR_UPLOAD_LOG_INTERVAL_MS)
+  {
+    upload->LastLog_ms = millis();
+    ESP_LOGI(TAG, "Upload '%s' %d/%d bytes", filename.c_str(), upload->Received, upload->Total);
+  }
+
+  if (!final)
+  {
+    return;
+  }
+
+  // Write rest and replace target file
+  FlushUpload(request, upload);
+  request->_tempFile.close();
+  upload->Done = true;
+
+  if (upload->Failed ||
+    !Storage.Rename(upload->TempPath, filename.c_str()))
+  {
+    ESP_LOGE(TAG, "Upload '%s' failed", filename.c_str());
+    Storage.Remove(upload->TempPath);
+    upload->Failed = true;
+    return;
+  }
+
+  uint32_t duration_ms = max((uint32_t)1, millis() - upload->Start_ms);
+  ESP_LOGI(TAG, "Upload '%s' finished, %d bytes in %d ms (%d KB/s)", filename.c_str(),
+    upload->Written, duration_ms, (uint32_t)((uint64_t)upload->Written * 1000 / 1024 / duration_ms));
+}
+
+//===============================================================
+// Writes the buffered upload data to the temp file
+//===============================================================
+void SPIFFSEditor::FlushUpload(AsyncWebServerRequest* request, SPIFFSUpload* upload)
+{
+  if (upload->BufferLength == 0 ||
+    upload->Failed)
+  {
+    return;
+  }
+
+  size_t written = request->_tempFile.write(upload->Buffer, upload->BufferLength);
+  upload->Written += written;
+  if (written != upload->BufferLength)
+  {
+    ESP_LOGE(TAG, "Could not write '%s', storage full?", upload->TempPath);
+    upload->Failed = true;
   }
+  upload->BufferLength = 0;
 }
@@ -13,9 +13,47 @@
 // Includes
 //===============================================================
 #include <Arduino.h>
-#include <SPIFFS.h>
 #include <ESPAsyncWebServer.h>
 #include "SystemHelper.h"
+#include "StorageDriver.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#define EDITOR_UPLOAD_BUFFER_SIZE     4096    // Writes are collected to whole flash pages
+#define EDITOR_UPLOAD_PATH_LENGTH     64      // Including zero terminator
+#define EDITOR_UPLOAD_TEMP_SUFFIX     ".tmp"  // Uploads are written to a temp file first
+#define EDITOR_UPLOAD_LOG_INTERVAL_MS 1000    // Progress log interval
+
+//===============================================================
+// Structs
+//===============================================================
+// Context of a streamed directory listing
+struct SPIFFSListing
+{
+  File Directory;
+  bool HeaderDone;
+  bool Done;
+  uint32_t Entries;
+  char Line[96];
+  size_t LineLength;
+  size_t LineOffset;
+};
+
+// Context of an upload (plain data, freed by the request)
+struct SPIFFSUpload
+{
+  char TempPath[EDITOR_UPLOAD_PATH_LENGTH];
+  uint32_t Start_ms;
+  uint32_t LastLog_ms;
+  uint32_t Total;
+  uint32_t Received;
+  uint32_t Written;
+  bool Failed;
+  bool Done;
+  size_t BufferLength;
+  uint8_t Buffer[EDITOR_UPLOAD_BUFFER_SIZE];
+};
 
 //===============================================================
 // SPIFFS editor class
@@ -42,7 +80,16 @@ class SPIFFSEditor: public AsyncWebHandler
     }
     
   private:
-    uint32_t _startTime;
+    // Running upload (only one at a time, further uploads are
+    // rejected). All handler functions run in the web server task
+    SPIFFSUpload* _activeUpload = NULL;
+
+    // Fills the buffer with the next part of the JSON directory
+    // listing, returns 0 if the listing is finished
+    static size_t ReadListing(SPIFFSListing* context, uint8_t* buffer, size_t maxLen);
+
+    // Writes the buffered upload data to the temp file
+    static void FlushUpload(AsyncWebServerRequest* request, SPIFFSUpload* upload);
 };
 
 #endif
@@ -145,14 +145,11 @@ SPIFFSImageReader::SPIFFSImageReader()
 //===============================================================
 SPIFFSImageReader::~SPIFFSImageReader()
 {
-  if (_file)
-  {
-    _file.close();
-  }
+  Storage.CloseCached(_file);
 }
 
 //===============================================================
-// Loads BMP image file from SPIFFS into RAM
+// Loads BMP image file from storage into RAM
 //===============================================================
 ImageReturnCode SPIFFSImageReader::LoadBMP(const char *filename, SPIFFSImage *img)
 {
@@ -169,7 +166,7 @@ ImageReturnCode SPIFFSImageReader::LoadBMP(const char *filename, SPIFFSImage *im
   uint8_t sdbuf[3 * BUFPIXELS] = {};          // BMP read buf (R+G+B/pixel)
   uint16_t srcidx = sizeof sdbuf;             // Source buffer pointer
   bool flip = true;                           // BMP is stored bottom-to-top
-  uint32_t bmpPos = 0;                        // Next pixel position in file
+  uint32_t padding;                           // Scanline padding bytes
   int16_t row;                                // Current pixel position row
   int16_t column;                             // Current pixel position column
   uint8_t r;                                  // Current pixel color red
@@ -180,8 +177,8 @@ ImageReturnCode SPIFFSImageReader::LoadBMP(const char *filename, SPIFFSImage *im
   // free its contents as it's about to be overwritten with new stuff
   img->Dealloc();
 
-  // Open requested file on SPIFFS
-  if (!(_file = SPIFFS.open(filename, FILE_READ)))
+  // Open requested file (cached read handle)
+  if ((_file = Storage.OpenCached(filename)) == NULL)
   {
     return IMAGE_ERR_FILE_NOT_FOUND;
   }
@@ -191,7 +188,8 @@ ImageReturnCode SPIFFSImageReader::LoadBMP(const char *filename, SPIFFSImage *im
   // esoteric (e.g. OS/2 struct bitmap array) and NOT supported here!
   if (ReadLE16() != 0x4D42)
   {
-    _file.close();
+    Storage.CloseCached(_file);
+    _file = NULL;
     return IMAGE_ERR_FORMAT;
   }
 
@@ -218,7 +216,8 @@ ImageReturnCode SPIFFSImageReader::LoadBMP(const char *filename, SPIFFSImage *im
   // Check for correct color depth
   if (depth != 24)
   {
-    _file.close();
+    Storage.CloseCached(_file);
+    _file = NULL;
     return IMAGE_ERR_FORMAT;
   }
 
@@ -237,51 +236,43 @@ ImageReturnCode SPIFFSImageReader::LoadBMP(const char *filename, SPIFFSImage *im
   // Only uncompressed is handled
   if (planes != 1 || compression != 0)
   {
-    _file.close();
+    Storage.CloseCached(_file);
+    _file = NULL;
     return IMAGE_ERR_FORMAT;
   }
 
   // BMP rows are padded (if needed) to 4-byte boundary
   rowSize = ((depth * bmpWidth + 31) / 32) * 4;
+  padding = rowSize - 3 * bmpWidth;
 
   // Loading to RAM -- allocate GFX 16-bit canvas type
   // Check for alloc OK
   if (!(img->Canvas16 = new GFXcanvas16(bmpWidth, bmpHeight)))
   {
-    _file.close();
+    Storage.CloseCached(_file);
+    _file = NULL;
     return IMAGE_ERR_MALLOC;
   }
 
   // Get working buffer pointer
   dest = img->Canvas16->getBuffer();
 
+  // Seek once to the image data. The scanlines are read in file
+  // order and flipped in RAM, so the file is read sequentially
+  _file->seek(offset);
+
   // For each scanline...
   for (row = 0; row < bmpHeight; row++)
   {
     yield();
 
-    // Seek to start of scan line.  It might seem labor-intensive
-    // to be doing this on every line, but this method covers a
-    // lot of gritty details like cropping, flip and scanline
-    // padding. Also, the seek only takes place if the file
-    // position actually needs to change (avoids a lot of cluster
-    // math in SD library).
     if (flip) // Bitmap is stored bottom-to-top order (normal BMP)
     {
-      bmpPos = offset + (bmpHeight - 1 - row) * rowSize;
+      destidx = (bmpHeight - 1 - row) * bmpWidth;
     }
     else // Bitmap is stored top-to-bottom
     {
-      bmpPos = offset + row * rowSize;
-    }
-    
-    // Need seek?
-    if (_file.position() != bmpPos)
-    { 
-      _file.seek(bmpPos);
-
-      // Force buffer reload
-      srcidx = sizeof sdbuf;
+      destidx = row * bmpWidth;
     }
 
     // For each pixel...
@@ -290,8 +281,8 @@ ImageReturnCode SPIFFSImageReader::LoadBMP(const char *filename, SPIFFSImage *im
       // Time to load more?
       if (srcidx >= sizeof sdbuf)
       {
-        // Read file from SPIFFS
-        _file.read(sdbuf, sizeof sdbuf);
+        // Read file from storage
+        _file->read(sdbuf, sizeof sdbuf);
 
         // Reset bmp buf index
         srcidx = 0;
@@ -304,10 +295,22 @@ ImageReturnCode SPIFFSImageReader::LoadBMP(const char *filename, SPIFFSImage *im
       dest[destidx++] = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
 
     } // end column loop
+
+    // Skip scanline padding
+    for (uint32_t pad = 0; pad < padding; pad++)
+    {
+      if (srcidx >= sizeof sdbuf)
+      {
+        _file->read(sdbuf, sizeof sdbuf);
+        srcidx = 0;
+      }
+      srcidx++;
+    }
   } // end row loop
 
-  // Close file
-  _file.close();
+  // Give file back
+  Storage.CloseCached(_file);
+  _file = NULL;
 
   return IMAGE_SUCCESS;
 }
@@ -320,7 +323,7 @@ ImageReturnCode SPIFFSImageReader::LoadBMP(const char *filename, SPIFFSImage *im
 uint16_t SPIFFSImageReader::ReadLE16()
 {
   // Big-endian or unknown. Byte-by-byte read will perform reversal if needed.
-  return _file.read() | ((uint16_t)_file.read() << 8);
+  return _file->read() | ((uint16_t)_file->read() << 8);
 }
 
 //===============================================================
@@ -331,7 +334,7 @@ uint16_t SPIFFSImageReader::ReadLE16()
 uint32_t SPIFFSImageReader::ReadLE32()
 {
   // Big-endian or unknown. Byte-by-byte read will perform reversal if needed.
-  return _file.read() | ((uint32_t)_file.read() << 8) | ((uint32_t)_file.read() << 16) | ((uint32_t)_file.read() << 24);
+  return _file->read() | ((uint32_t)_file->read() << 8) | ((uint32_t)_file->read() << 16) | ((uint32_t)_file->read() << 24);
 }
 
 //===============================================================
@@ -13,9 +13,9 @@
 // Inlcudes
 //===============================================================
 #include <Arduino.h>
-#include <SPIFFS.h>
 #include <Adafruit_SPITFT.h>
 #include "Config.h"
+#include "StorageDriver.h"
 
 //===============================================================
 // Enums
@@ -78,15 +78,15 @@ class SPIFFSImageReader
     // Destructor
     ~SPIFFSImageReader();
 
-    // Loads BMP image file from SPIFFS into RAM
+    // Loads BMP image file from storage into RAM
     ImageReturnCode LoadBMP(const char *filename, SPIFFSImage *img);
 
     // Print error code string to stream
     String PrintStatus(ImageReturnCode stat);
 
   private:
-    // File object for reading image data
-    File _file;
+    // Cached file handle for reading image data
+    File* _file = NULL;
 
     // Reads a little-endian 16-bit
     uint16_t ReadLE16();
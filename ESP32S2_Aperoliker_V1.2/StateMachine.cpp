@@ -26,6 +26,9 @@ StateMachine Statemachine;
 //===============================================================
 StateMachine::StateMachine()
 {
+#if defined(WIFI_MIXER)
+  _pendingPresetListClientID = WIFI_NO_UPDATE;
+#endif
 }
 
 //===============================================================
@@ -49,6 +52,65 @@ void StateMachine::Begin(uint8_t pinBuzzer)
   ESP_LOGI(TAG, "Finished initializing state machine");
 }
 
+//===============================================================
+// Sets the main task, which is woken on new events
+//===============================================================
+void StateMachine::SetTaskHandle(TaskHandle_t taskHandle)
+{
+  _taskHandle = taskHandle;
+}
+
+//===============================================================
+// Wakes the main task from interrupt service routine. Returns
+// true, if the interrupt has to yield to the main task
+//===============================================================
+bool StateMachine::WakeFromISR()
+{
+  if (_taskHandle == NULL)
+  {
+    return false;
+  }
+
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  vTaskNotifyGiveFromISR(_taskHandle, &higherPriorityTaskWoken);
+  return higherPriorityTaskWoken == pdTRUE;
+}
+
+//===============================================================
+// Wakes the main task from other tasks
+//===============================================================
+void StateMachine::Wake()
+{
+  if (_taskHandle == NULL)
+  {
+    return;
+  }
+
+  xTaskNotifyGive(_taskHandle);
+}
+
+//===============================================================
+// Returns the maximum time the main task may wait for new events.
+// Input interrupts and wifi wake the task earlier
+//===============================================================
+uint32_t StateMachine::GetCycleTime_ms()
+{
+  // Screen saver animation, reset timer, batch progress and long
+  // button press detection need the short cycle time
+  if (_currentState == eScreenSaver ||
+    _currentState == eReset ||
+    Batch.IsRunning() ||
+    EncoderButton.IsButtonDown())
+  {
+    return CYCLETIME_ACTIVE_MS;
+  }
+
+  // Otherwise wait at the latest until the screen saver timeout
+  uint32_t idleTime_ms = millis() - Systemhelper.GetLastUserAction();
+  uint32_t cycleTime_ms = idleTime_ms <= SCREENSAVER_TIMEOUT_MS ? SCREENSAVER_TIMEOUT_MS - idleTime_ms + 1 : 0;
+  return constrain(cycleTime_ms, (uint32_t)CYCLETIME_ACTIVE_MS, (uint32_t)CYCLETIME_IDLE_MS);
+}
+
 #if defined(WIFI_MIXER)
 //===============================================================
 // Updates cycle timespan value from wifi
@@ -62,18 +124,8 @@ bool StateMachine::UpdateValuesFromWifi(uint32_t clientID, uint32_t cycleTimespa
     return false;
   }
 
-  // Check if ready for update
-  if (_newCycleTimespan)
-  {
-    return false;
-  }
-
   // Signalize new data to state machine
-  _newCycleTimespanClientID = clientID;
-  _newCycleTimespan_ms = cycleTimespan_ms;
-  _newCycleTimespan = true;
-
-  return true;
+  return PushWifiCommand(clientID, eWifiCommandCycleTimespan, eLiquidNone, cycleTimespan_ms);
 }
 
 //===============================================================
@@ -90,7 +142,7 @@ bool StateMachine::UpdateValuesFromWifi(uint32_t clientID, bool save)
 //===============================================================
 // Updates a liquid value from wifi
 //===============================================================
-bool StateMachine::UpdateValuesFromWifi(uint32_t clientID, MixtureLiquid liquid, int16_t increments_Degrees)
+bool StateMachine::UpdateValuesFromWifi(uint32_t clientID, MixtureLiquid liquid, int16_t increments_Degrees, uint16_t clientSequence, uint32_t baseVersion)
 {
   // Check angle for 360 degrees increment or decrement max
   if (increments_Degrees < -360 ||
@@ -99,18 +151,61 @@ bool StateMachine::UpdateValuesFromWifi(uint32_t clientID, MixtureLiquid liquid,
     return false;
   }
 
-  // Check if ready for update
-  if (_newLiquid != eLiquidNone)
+  // Check liquid
+  if (liquid >= LIQUID_COUNT)
   {
     return false;
   }
 
   // Signalize new data to state machine
-  _newLiquidClientID = clientID;
-  _newLiquid = liquid;
-  _newLiquidIncrements_Degrees = increments_Degrees;
+  return PushWifiCommand(clientID, eWifiCommandLiquid, liquid, increments_Degrees, NULL, clientSequence, baseVersion);
+}
 
-  return true;
+//===============================================================
+// Applies, saves, deletes or lists presets from wifi
+//===============================================================
+bool StateMachine::UpdatePresetsFromWifi(uint32_t clientID, WifiCommandType type, int32_t index, const char* name)
+{
+  // Check command type
+  if (type != eWifiCommandPresetApply &&
+    type != eWifiCommandPresetSave &&
+    type != eWifiCommandPresetDelete &&
+    type != eWifiCommandPresetList)
+  {
+    return false;
+  }
+
+  // Check preset index (the presets itself are only accessed by the main task)
+  if (index < 0 ||
+    index >= PRESET_MAX_COUNT)
+  {
+    return false;
+  }
+
+  // Preset list requests of several clients are answered at once
+  // (connect bursts would otherwise overflow the command queue)
+  if (type == eWifiCommandPresetList)
+  {
+    uint32_t pending = _pendingPresetListClientID.load();
+    while (!_pendingPresetListClientID.compare_exchange_weak(pending,
+      (pending == WIFI_NO_UPDATE || pending == clientID) ? clientID : 0))
+    {
+    }
+
+    if (pending == WIFI_NO_UPDATE)
+    {
+      InputEvents.Push(eInputWifi, type);
+      Wake();
+    }
+    else
+    {
+      Metrics.Add(eMetricWifiBroadcastsCoalesced);
+    }
+    return true;
+  }
+
+  // Signalize new data to state machine
+  return PushWifiCommand(clientID, type, eLiquidNone, index, name);
 }
 #endif
 
@@ -119,19 +214,15 @@ bool StateMachine::UpdateValuesFromWifi(uint32_t clientID, MixtureLiquid liquid,
 //===============================================================
 int16_t StateMachine::GetAngle(MixtureLiquid liquid)
 {
-  switch (liquid)
-  {
-    case eLiquid1:
-      return _liquid1Angle_Degrees;
-    case eLiquid2:
-      return _liquid2Angle_Degrees;
-    case eLiquid3:
-      return _liquid3Angle_Degrees;
-    default:
-      break;
-  }
+  return _mixture.GetAngle(liquid);
+}
 
-  return -1;
+//===============================================================
+// Returns the mixture revision (changes once per recalculation)
+//===============================================================
+uint32_t StateMachine::GetMixtureRevision()
+{
+  return _mixture.GetRevision();
 }
 
 //===============================================================
@@ -144,82 +235,256 @@ MixerState StateMachine::GetCurrentState()
 
 #if defined(WIFI_MIXER)
 //===============================================================
-// Handles new wifi data, should be called in state machine
+// Handles new wifi data, should be called in state machine.
+// Consecutive commands of the same client, liquid and base version
+// are merged and executed at once (one update to the clients per
+// group)
 //===============================================================
 void StateMachine::HandleNewWifiData(MixerEvent event)
 {
-  // General new wifi liquid data handler
-  if (_newLiquid != eLiquidNone)
-  {
-    // Save values for drawing
-    uint32_t newLiquidClientID = _newLiquidClientID;
-    MixtureLiquid newLiquid = _newLiquid;
-    int16_t newLiquidIcrements_Degrees = _newLiquidIncrements_Degrees;
+  WifiCommand mergedCommand;
+  bool hasMergedCommand = false;
 
-    // Reset wifi data
-    _newLiquidClientID = 0;
-    _newLiquid = eLiquidNone;
-    _newLiquidIncrements_Degrees = 0;
-
-    // Increment or decrement angle
-    switch (newLiquid)
+  WifiCommand command;
+  while (_wifiCommands.Pop(&command))
+  {
+    if (hasMergedCommand &&
+      (command.Type == eWifiCommandLiquid || command.Type == eWifiCommandCycleTimespan) &&
+      command.ClientID == mergedCommand.ClientID &&
+      command.Type == mergedCommand.Type &&
+      command.Liquid == mergedCommand.Liquid &&
+      command.BaseVersion == mergedCommand.BaseVersion)
     {
-      case eLiquid1:
-        IncrementAngle(&_liquid1Angle_Degrees, _liquid2Angle_Degrees, _liquid3Angle_Degrees, newLiquidIcrements_Degrees);
-        break;
-      case eLiquid2:
-        IncrementAngle(&_liquid2Angle_Degrees, _liquid3Angle_Degrees, _liquid1Angle_Degrees, newLiquidIcrements_Degrees);
-        break;
-      case eLiquid3:
-        IncrementAngle(&_liquid3Angle_Degrees, _liquid1Angle_Degrees, _liquid2Angle_Degrees, newLiquidIcrements_Degrees);
-        break;
-      default:
-        break;
+      // Liquid increments add up, the last cycle timespan wins
+      mergedCommand.Value = command.Type == eWifiCommandLiquid ? constrain(mergedCommand.Value + command.Value, -360, 360) : command.Value;
+      mergedCommand.Sequence = command.Sequence;
+      mergedCommand.ClientSequence = command.ClientSequence;
+      continue;
     }
 
-    // Update display and pump values
-    UpdateValues(newLiquidClientID);
-
-    // Draw new values in dashboard mode and at main event
-    if (_currentState == eDashboard &&
-      event == eMain)
+    if (hasMergedCommand)
     {
-      // Draw current value string and doughnut chart in partial updating mode
-      Display.DrawCurrentValues();
-      Display.DrawDoughnutChart3(newLiquidIcrements_Degrees > 0);
+      ExecuteWifiCommand(mergedCommand, event);
     }
+    mergedCommand = command;
+    hasMergedCommand = true;
   }
 
-  // General new wifi cycle timespan data handler 
-  if (_newCycleTimespan)
+  if (hasMergedCommand)
   {
-    // Save values for drawing
-    uint32_t newCycleTimespanClientID = _newCycleTimespanClientID;
-    uint32_t newCycleTimespan_ms = _newCycleTimespan_ms;
+    ExecuteWifiCommand(mergedCommand, event);
+  }
 
-    // Reset wifi data flag
-    _newCycleTimespanClientID = 0;
-    _newCycleTimespan = false;
-    _newCycleTimespan_ms = 0;
-    
-    // Set cycle timespan value
-    if (Pumps.SetCycleTimespan(newCycleTimespan_ms))
-    {
-      // Update wifi clients
-      Wifihandler.UpdateCycleTimespanToClients(newCycleTimespanClientID);
+  // Answer pending preset list requests (after preset changes)
+  uint32_t presetListClientID = _pendingPresetListClientID.exchange(WIFI_NO_UPDATE);
+  if (presetListClientID != WIFI_NO_UPDATE)
+  {
+    Wifihandler.UpdatePresetsToClients(presetListClientID);
+  }
+}
 
-      // Draw new values in settings mode and at main event
-      if (_currentState == eSettings &&
-        event == eMain)
+//===============================================================
+// Adds a wifi command to the queue
+//===============================================================
+bool StateMachine::PushWifiCommand(uint32_t clientID, WifiCommandType type, MixtureLiquid liquid, int32_t value, const char* name, uint16_t clientSequence, uint32_t baseVersion)
+{
+  WifiCommand command = { clientID, _wifiCommandSequence.fetch_add(1) + 1, clientSequence, baseVersion, type, liquid, value, { } };
+  if (name != NULL)
+  {
+    strncpy(command.Name, name, PRESET_NAME_LENGTH - 1);
+  }
+  if (!_wifiCommands.Push(command))
+  {
+    ESP_LOGE(TAG, "Wifi command %d of client %d dropped", command.Sequence, clientID);
+    Metrics.Add(eMetricWifiCommandsDropped);
+    return false;
+  }
+
+  InputEvents.Push(eInputWifi, type);
+  Wake();
+  return true;
+}
+
+//===============================================================
+// Executes a merged wifi command
+//===============================================================
+void StateMachine::ExecuteWifiCommand(const WifiCommand& command, MixerEvent event)
+{
+  _lastWifiCommandSequence = command.Sequence;
+
+  switch (command.Type)
+  {
+    case eWifiCommandLiquid:
       {
-        // Draw settings in partial update mode
-        Display.DrawSettings();
+        // Increments are relative and rebased onto the current mixture, if
+        // they are based on an older version. A reset since the base version
+        // replaced the whole mixture, the increments are stale then
+        if (command.BaseVersion != 0 &&
+          (command.BaseVersion < _mixtureResetVersion || command.BaseVersion > _mixture.GetRevision()))
+        {
+          ESP_LOGW(TAG, "Stale increments of client %d (version %d, reset at %d)", command.ClientID, command.BaseVersion, _mixtureResetVersion);
+          Metrics.Add(eMetricWifiFramesStale);
+        }
+        else
+        {
+          if (command.BaseVersion != 0 &&
+            command.BaseVersion < _mixture.GetRevision())
+          {
+            Metrics.Add(eMetricWifiFramesRebased);
+          }
+
+          // Increment or decrement angle
+          _mixture.IncrementAngle(command.Liquid, command.Value);
+        }
+
+        // Acknowledge frame with the version including it, the client drops
+        // its local increments up to it
+        if (command.ClientSequence != 0)
+        {
+          Wifihandler.AcknowledgeToClient(command.ClientID, command.ClientSequence, _mixture.GetRevision());
+        }
+
+        // Update display and pump values
+        UpdateValues(command.ClientID);
+
+        // Draw new values in dashboard mode and at main event
+        if (_currentState == eDashboard &&
+          event == eMain)
+        {
+          // Draw current value string and doughnut chart in partial updating mode
+          Display.DrawCurrentValues();
+          Display.DrawDoughnutChart3(command.Value > 0);
+        }
       }
-    }
+      break;
+    case eWifiCommandCycleTimespan:
+      {
+        // Set cycle timespan value
+        if (Pumps.SetCycleTimespan(command.Value))
+        {
+          // Update wifi clients
+          Wifihandler.UpdateCycleTimespanToClients(command.ClientID);
+
+          // Draw new values in settings mode and at main event
+          if (_currentState == eSettings &&
+            event == eMain)
+          {
+            // Draw settings in partial update mode
+            Display.DrawSettings();
+          }
+        }
+      }
+      break;
+    case eWifiCommandPresetApply:
+      {
+        // Set mixture to preset (all clients get the new angles, including the sender)
+        if (ApplyPreset(command.Value))
+        {
+          UpdateValues();
+
+          // Draw new values in dashboard mode and at main event
+          if (_currentState == eDashboard &&
+            event == eMain)
+          {
+            // Draw current value string and doughnut chart in full updating mode
+            Display.DrawCurrentValues();
+            Display.DrawDoughnutChart3();
+          }
+        }
+      }
+      break;
+    case eWifiCommandPresetSave:
+      {
+        // Save current mixture as preset
+        int16_t angles_Degrees[LIQUID_COUNT];
+        for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+        {
+          angles_Degrees[liquid] = _mixture.GetAngle(liquid);
+        }
+
+        if (Presets.SetPreset(command.Value, command.Name, angles_Degrees))
+        {
+          Wifihandler.UpdatePresetsToClients(0);
+        }
+      }
+      break;
+    case eWifiCommandPresetDelete:
+      {
+        if (Presets.RemovePreset(command.Value))
+        {
+          Wifihandler.UpdatePresetsToClients(0);
+        }
+      }
+      break;
+    default:
+      break;
   }
 }
 #endif
 
+//===============================================================
+// Takes the input events of the interrupts and the wifi handler.
+// Every event is a user action. The states only read the encoder
+// and button with events in this cycle (all inputs, if events were
+// dropped), wifi commands are taken from their own queue
+//===============================================================
+void StateMachine::ProcessInputEvents()
+{
+  _inputEvents = 0;
+
+  InputEvent event;
+  while (InputEvents.Pop(&event))
+  {
+    _inputEvents |= 1 << event.Type;
+    Systemhelper.SetLastUserAction();
+    Metrics.Add((MetricCounter)(eMetricInputEventsEncoder + event.Type));
+    ESP_LOGD(TAG, "Input %u %s %d", (unsigned int)event.Timestamp_ms, InputEventQueue::GetTypeName(event.Type), event.Value);
+  }
+
+  if (InputEvents.TakeDropped())
+  {
+    _inputEvents = (1 << eInputEventTypeCount) - 1;
+  }
+}
+
+//===============================================================
+// Returns true, if an input event of the type was taken in the
+// current main cycle
+//===============================================================
+bool StateMachine::HasInput(InputEventType type)
+{
+  return (_inputEvents & (1 << type)) != 0;
+}
+
+//===============================================================
+// Returns the encoder increments (resets the counter value), if
+// the encoder was turned in this cycle. Otherwise 0
+//===============================================================
+int16_t StateMachine::GetEncoderIncrements(bool accelerated)
+{
+  return HasInput(eInputEncoder) ? EncoderButton.GetEncoderIncrements(accelerated) : 0;
+}
+
+//===============================================================
+// Returns true on a short button press. Presses are classified on
+// the release edge, so only button events are checked
+//===============================================================
+bool StateMachine::IsButtonPress()
+{
+  return HasInput(eInputButton) && EncoderButton.IsButtonPress();
+}
+
+//===============================================================
+// Returns true on a long button press. The press is detected while
+// the button is held down (no event), so the button state is
+// checked on events and while it is down
+//===============================================================
+bool StateMachine::IsLongButtonPress()
+{
+  return (HasInput(eInputButton) || EncoderButton.IsButtonDown()) &&
+    EncoderButton.IsLongButtonPress();
+}
+
 //===============================================================
 // General state machine execution function
 //===============================================================
@@ -230,6 +495,9 @@ void StateMachine::Execute(MixerEvent event)
     case eMenu:
       FctMenu(event);
       break;
+    case eBatch:
+      FctBatch(event);
+      break;
     case eCleaning:
       FctCleaning(event);
       break;
@@ -249,6 +517,20 @@ void StateMachine::Execute(MixerEvent event)
   }
 }
 
+//===============================================================
+// Exits the current state and enters the new state. Every state
+// change is logged with time and the last executed wifi command,
+// so the order of state changes and wifi updates can be traced
+//===============================================================
+void StateMachine::ChangeState(MixerState state)
+{
+  Execute(eExit);
+  Metrics.Add(eMetricStateTransitions);
+  ESP_LOGI(TAG, "State %d -> %d at %d ms (last wifi command %d)", _currentState, state, millis(), _lastWifiCommandSequence);
+  _currentState = state;
+  Execute(eEntry);
+}
+
 //===============================================================
 // Function menu state
 //===============================================================
@@ -265,18 +547,14 @@ void StateMachine::FctMenu(MixerEvent event)
         ESP_LOGI(TAG, "Enter menu mode");
         Display.ShowMenuPage();
 
-        // Debounce page change
-        delay(500);
-
-        // Reset and ignore user input
-        EncoderButton.GetEncoderIncrements();
-        EncoderButton.IsButtonPress();
+        // Debounce page change (discards pending input)
+        EncoderButton.SuppressInput(PAGECHANGE_DEBOUNCE_MS);
       }
       break;
     case eMain:
       {
         // Read encoder increments (resets the counter value)
-        int16_t currentEncoderIncrements = EncoderButton.GetEncoderIncrements();
+        int16_t currentEncoderIncrements = GetEncoderIncrements();
 
         // Check for changed encoder value
         if (currentEncoderIncrements != 0)
@@ -285,10 +563,13 @@ void StateMachine::FctMenu(MixerEvent event)
           switch (_currentMenuState)
           {
             case eDashboard:
+              _currentMenuState = currentEncoderIncrements > 0 ? eDashboard : eBatch;
+              break;
+            case eBatch:
               _currentMenuState = currentEncoderIncrements > 0 ? eDashboard : eCleaning;
               break;
             case eCleaning:
-              _currentMenuState = currentEncoderIncrements > 0 ? eDashboard : eReset;
+              _currentMenuState = currentEncoderIncrements > 0 ? eBatch : eReset;
               break;
             case eReset:
               _currentMenuState = currentEncoderIncrements > 0 ? eCleaning : eSettings;
@@ -316,15 +597,13 @@ void StateMachine::FctMenu(MixerEvent event)
 #endif
 
         // Check for button press
-        if (EncoderButton.IsButtonPress())
+        if (IsButtonPress())
         {
           // Short beep sound
           tone(_pinBuzzer, 500, 40);
 
           // Exit menu and enter new selected mode
-          Execute(eExit);
-          _currentState = _currentMenuState;
-          Execute(eEntry);
+          ChangeState(_currentMenuState);
           return;
         }
 
@@ -332,10 +611,8 @@ void StateMachine::FctMenu(MixerEvent event)
         if (millis() - Systemhelper.GetLastUserAction() > SCREENSAVER_TIMEOUT_MS)
         {
           // Exit menu mode and enter screen saver mode
-          Execute(eExit);
           _lastState = eMenu;
-          _currentState = eScreenSaver;
-          Execute(eEntry);
+          ChangeState(eScreenSaver);
           return;
         }
       }
@@ -362,38 +639,20 @@ void StateMachine::FctDashboard(MixerEvent event)
         ESP_LOGI(TAG, "Enter dashboard mode");
         Display.ShowDashboardPage();
 
-        // Debounce page change
-        delay(500);
-
-        // Reset and ignore user input
-        EncoderButton.GetEncoderIncrements();
-        EncoderButton.IsLongButtonPress();
-        EncoderButton.IsButtonPress();
+        // Debounce page change (discards pending input)
+        EncoderButton.SuppressInput(PAGECHANGE_DEBOUNCE_MS);
       }
       break;
     case eMain:
       {
-        // Read encoder increments (resets the counter value)
-        int16_t currentEncoderIncrements = EncoderButton.GetEncoderIncrements();
+        // Read accelerated encoder increments (resets the counter value)
+        int16_t currentEncoderIncrements = GetEncoderIncrements(true);
 
         // Will be true, if new encoder position is available
         if (currentEncoderIncrements != 0)
         {
           // Increment or decrement angle
-          switch (_dashboardLiquid)
-          {
-            case eLiquid1:
-              IncrementAngle(&_liquid1Angle_Degrees, _liquid2Angle_Degrees, _liquid3Angle_Degrees, currentEncoderIncrements * STEPANGLE_DEGREES);
-              break;
-            case eLiquid2:
-              IncrementAngle(&_liquid2Angle_Degrees, _liquid3Angle_Degrees, _liquid1Angle_Degrees, currentEncoderIncrements * STEPANGLE_DEGREES);
-              break;
-            case eLiquid3:
-              IncrementAngle(&_liquid3Angle_Degrees, _liquid1Angle_Degrees, _liquid2Angle_Degrees, currentEncoderIncrements * STEPANGLE_DEGREES);
-              break;
-            default:
-              break;
-          }
+          _mixture.IncrementAngle(_dashboardLiquid, currentEncoderIncrements * STEPANGLE_DEGREES);
 
           // Update display and pump values
           UpdateValues();
@@ -404,7 +663,7 @@ void StateMachine::FctDashboard(MixerEvent event)
         }
 
         // Check for button press
-        if (EncoderButton.IsButtonPress())
+        if (IsButtonPress())
         {
           // Short beep sound
           tone(_pinBuzzer, 500, 40);
@@ -420,7 +679,7 @@ void StateMachine::FctDashboard(MixerEvent event)
           Display.DrawDoughnutChart3(false);
           
           // Debounce settings change
-          delay(200);
+          EncoderButton.SuppressInput(SETTINGCHANGE_DEBOUNCE_MS);
         }
 
 #if defined(WIFI_MIXER)
@@ -432,16 +691,14 @@ void StateMachine::FctDashboard(MixerEvent event)
 #endif
 
         // Check for long button press
-        if (EncoderButton.IsLongButtonPress())
+        if (IsLongButtonPress())
         {
           // Short beep sound
           tone(_pinBuzzer, 800, 40);
 
           // Exit dashboard and enter menu mode
-          Execute(eExit);
-          _currentState = eMenu;
           _currentMenuState = eDashboard;
-          Execute(eEntry);
+          ChangeState(eMenu);
           return;
         }
 
@@ -449,20 +706,199 @@ void StateMachine::FctDashboard(MixerEvent event)
         if (millis() - Systemhelper.GetLastUserAction() > SCREENSAVER_TIMEOUT_MS)
         {
           // Exit dashboard mode and enter screen saver mode
-          Execute(eExit);
           _lastState = eDashboard;
-          _currentState = eScreenSaver;
-          Execute(eEntry);
+          ChangeState(eScreenSaver);
+          return;
+        }
+      }
+      break;
+    case eExit:
+    default:
+      break;
+  }
+}
+
+//===============================================================
+// Function batch state
+//===============================================================
+void StateMachine::FctBatch(MixerEvent event)
+{
+  switch(event)
+  {
+    case eEntry:
+      {
+        // Update display and pump values
+        UpdateValues();
+
+        // Show batch page
+        ESP_LOGI(TAG, "Enter batch mode");
+        Display.ShowBatchPage();
+
+        // Debounce page change (discards pending input)
+        EncoderButton.SuppressInput(PAGECHANGE_DEBOUNCE_MS);
+      }
+      break;
+    case eMain:
+      {
+        // Read encoder increments (resets the counter value)
+        int16_t currentEncoderIncrements = GetEncoderIncrements();
+
+        if (Batch.IsRunning())
+        {
+          // Abort on button press or if the pumps were disabled by the lever
+          if (IsButtonPress() ||
+            (Batch.GetPhase() == eBatchPouring && !Pumps.IsEnabled()))
+          {
+            StopBatchPour();
+            Batch.Abort();
+            ESP_LOGI(TAG, "Batch aborted after %d glasses", Batch.GetGlassesDone());
+
+            // Long beep sound
+            tone(_pinBuzzer, 800, 500);
+          }
+          else
+          {
+            // Execute batch action
+            switch (Batch.Update(millis(), Pumps.GetFlowRate()))
+            {
+              case eBatchActionStartPour:
+                StartBatchPour();
+                break;
+              case eBatchActionStopPour:
+                StopBatchPour();
+                tone(_pinBuzzer, 500, 40);
+                break;
+              case eBatchActionFinish:
+                StopBatchPour();
+                ESP_LOGI(TAG, "Batch finished with %0.2f glasses/min", Batch.GetGlassesPerMinute());
+                tone(_pinBuzzer, 800, 500);
+                break;
+              default:
+                break;
+            }
+          }
+
+          // No screen saver while the batch is running
+          Systemhelper.SetLastUserAction();
+        }
+        else
+        {
+          // Will be true, if new encoder position is available
+          if (currentEncoderIncrements != 0)
+          {
+            // Change selected setting
+            switch (_batchSetting)
+            {
+              case eBatchSettingGlasses:
+                Batch.SetGlasses(Batch.GetGlasses() + currentEncoderIncrements);
+                break;
+              case eBatchSettingVolume:
+                Batch.SetVolume(Batch.GetVolume() + currentEncoderIncrements * 10);
+                break;
+              case eBatchSettingPause:
+                Batch.SetPause(Batch.GetPause() + currentEncoderIncrements * 1000);
+                break;
+              default:
+                break;
+            }
+          }
+
+          // Check for button press
+          if (IsButtonPress())
+          {
+            // Short beep sound
+            tone(_pinBuzzer, 500, 40);
+
+            if (_batchSetting == eBatchSettingStart)
+            {
+              // Start batch with the first pour
+              ESP_LOGI(TAG, "Batch started with %d glasses of %d ml", Batch.GetGlasses(), Batch.GetVolume());
+              Batch.Start(millis());
+              StartBatchPour();
+              _batchSetting = eBatchSettingGlasses;
+            }
+            else
+            {
+              // Incrementing the setting value taking into account the overflow
+              _batchSetting = _batchSetting + 1 >= (BatchSetting)BatchSettingMax ? eBatchSettingGlasses : (BatchSetting)(_batchSetting + 1);
+            }
+
+            // Update display and pump values
+            UpdateValues();
+          }
+        }
+
+        // Draw batch settings and progress in partial update mode
+        Display.DrawBatch();
+
+#if defined(WIFI_MIXER)
+        // Update batch progress in connected clients
+        Wifihandler.UpdateBatchProgressToClients();
+
+        // Draw wifi icons
+        Display.DrawWifiIcons();
+
+        // Check for new wifi data and handle it if required
+        HandleNewWifiData(event);
+#endif
+
+        // Check for long button press
+        if (IsLongButtonPress())
+        {
+          // Short beep sound
+          tone(_pinBuzzer, 800, 40);
+
+          // Exit batch mode and return to menu mode
+          _currentMenuState = eBatch;
+          ChangeState(eMenu);
+          return;
+        }
+        
+        // Check for screen saver timeout
+        if (millis() - Systemhelper.GetLastUserAction() > SCREENSAVER_TIMEOUT_MS)
+        {
+          // Exit batch mode and enter screen saver mode
+          _lastState = eBatch;
+          ChangeState(eScreenSaver);
           return;
         }
       }
       break;
     case eExit:
+      {
+        // Never leave pumps running
+        if (Batch.IsRunning())
+        {
+          StopBatchPour();
+          Batch.Abort();
+        }
+      }
+      break;
     default:
       break;
   }
 }
 
+//===============================================================
+// Starts a batch pour, logged like a lever pour
+//===============================================================
+void StateMachine::StartBatchPour()
+{
+  Pumps.Enable();
+  PourLog.StartPour(eBatch);
+}
+
+//===============================================================
+// Stops a batch pour, logged like a lever pour (after the last
+// flow time is added)
+//===============================================================
+void StateMachine::StopBatchPour()
+{
+  Pumps.Disable();
+  PourLog.StopPour();
+  FlowMeter.RequestSaveAsync();
+}
+
 //===============================================================
 // Function cleaning state
 //===============================================================
@@ -479,18 +915,14 @@ void StateMachine::FctCleaning(MixerEvent event)
         ESP_LOGI(TAG, "Enter cleaning mode");
         Display.ShowCleaningPage();
 
-        // Debounce page change
-        delay(500);
-
-        // Reset and ignore user input
-        EncoderButton.IsButtonPress();
-        EncoderButton.IsLongButtonPress();
+        // Debounce page change (discards pending input)
+        EncoderButton.SuppressInput(PAGECHANGE_DEBOUNCE_MS);
       }
       break;
     case eMain:
       {
         // Check for button press
-        if (EncoderButton.IsButtonPress())
+        if (IsButtonPress())
         {
           // Short beep sound
           tone(_pinBuzzer, 500, 40);
@@ -505,7 +937,7 @@ void StateMachine::FctCleaning(MixerEvent event)
           Display.DrawCheckBoxes();
 
           // Debounce settings change
-          delay(200);
+          EncoderButton.SuppressInput(SETTINGCHANGE_DEBOUNCE_MS);
         }
 
 #if defined(WIFI_MIXER)
@@ -517,16 +949,14 @@ void StateMachine::FctCleaning(MixerEvent event)
 #endif
 
         // Check for long button press
-        if (EncoderButton.IsLongButtonPress())
+        if (IsLongButtonPress())
         {
           // Short beep sound
           tone(_pinBuzzer, 800, 40);
 
           // Exit cleaning mode and return to menu mode
-          Execute(eExit);
-          _currentState = eMenu;
           _currentMenuState = eCleaning;
-          Execute(eEntry);
+          ChangeState(eMenu);
           return;
         }
         
@@ -534,10 +964,8 @@ void StateMachine::FctCleaning(MixerEvent event)
         if (millis() - Systemhelper.GetLastUserAction() > SCREENSAVER_TIMEOUT_MS)
         {
           // Exit cleaning mode and enter screen saver mode
-          Execute(eExit);
           _lastState = eCleaning;
-          _currentState = eScreenSaver;
-          Execute(eEntry);
+          ChangeState(eScreenSaver);
           return;
         }
       }
@@ -549,7 +977,8 @@ void StateMachine::FctCleaning(MixerEvent event)
 }
 
 //===============================================================
-// Function reset state
+// Function reset state. Recalls the presets, beginning with the
+// first one, each encoder step applies the next preset instantly
 //===============================================================
 void StateMachine::FctReset(MixerEvent event)
 {
@@ -557,38 +986,61 @@ void StateMachine::FctReset(MixerEvent event)
   {
     case eEntry:
       {
-        // Reset mixture
-        SetMixtureDefaults();
+        // Set mixture to first preset
+        _presetIndex = 0;
+        ApplyPreset(_presetIndex);
         
         // Update all values
         UpdateValues();
         
-        // Draw reset info box over current page
+        // Draw preset info box over current page
         ESP_LOGI(TAG, "Enter reset mode");
-        Display.DrawInfoBox("Mixture", "reset!");
+        Display.DrawInfoBox(String("Preset ") + String(_presetIndex + 1) + "/" + String(Presets.GetCount()), Presets.GetName(_presetIndex));
 
         // Save reset page start time
         _resetTimestamp = millis();
 
+        // Debounce page change (discards pending input)
+        EncoderButton.SuppressInput(PAGECHANGE_DEBOUNCE_MS);
+
         // Long beep sound
         tone(_pinBuzzer, 800, 500);
       }
       break;
     case eMain:
       {
+        // Read encoder increments (resets the counter value)
+        int16_t currentEncoderIncrements = GetEncoderIncrements();
+
+        // Will be true, if new encoder position is available
+        if (currentEncoderIncrements != 0)
+        {
+          // Select next or previous preset (ring)
+          uint8_t count = Presets.GetCount();
+          _presetIndex = (uint8_t)(((_presetIndex + currentEncoderIncrements) % count + count) % count);
+          ApplyPreset(_presetIndex);
+
+          // Update all values
+          UpdateValues();
+
+          // Draw preset info box
+          Display.DrawInfoBox(String("Preset ") + String(_presetIndex + 1) + "/" + String(count), Presets.GetName(_presetIndex));
+
+          // Restart reset page display time
+          _resetTimestamp = millis();
+        }
 
 #if defined(WIFI_MIXER)
         // Check for new wifi data and handle it if required
         HandleNewWifiData(event);
 #endif
 
-        // Wait for the reset page display time
-        if ((millis() - _resetTimestamp) > ResetTime_ms)
+        // Wait for the reset page display time or confirm by button press
+        if ((millis() - _resetTimestamp) > ResetTime_ms ||
+          IsButtonPress())
         {
           // Exit reset mode and return to dashboard mode
-          Execute(eExit);
-          _currentState = eDashboard;
-          Execute(eEntry);
+          ChangeState(eDashboard);
           return;
         }
       }
@@ -615,19 +1067,14 @@ void StateMachine::FctSettings(MixerEvent event)
         ESP_LOGI(TAG, "Enter settings mode");
         Display.ShowSettingsPage();
         
-        // Debounce page change
-        delay(500);
-
-        // Reset and ignore user input
-        EncoderButton.GetEncoderIncrements();
-        EncoderButton.IsLongButtonPress(); 
-        EncoderButton.IsButtonPress();
+        // Debounce page change (discards pending input)
+        EncoderButton.SuppressInput(PAGECHANGE_DEBOUNCE_MS);
       }
       break;
     case eMain:
       {
         // Read encoder increments (resets the counter value)
-        int16_t currentEncoderIncrements = EncoderButton.GetEncoderIncrements();
+        int16_t currentEncoderIncrements = GetEncoderIncrements();
 
         // Will be true, if new encoder position is available
         if (currentEncoderIncrements != 0)
@@ -646,7 +1093,7 @@ void StateMachine::FctSettings(MixerEvent event)
 
 #if defined(WIFI_MIXER)
         // Check for short button press
-        if (EncoderButton.IsButtonPress())
+        if (IsButtonPress())
         {
           // Update wifi mode
           Wifihandler.SetWifiMode(Wifihandler.GetWifiMode() == WIFI_MODE_AP ? WIFI_MODE_NULL : WIFI_MODE_AP);
@@ -667,16 +1114,14 @@ void StateMachine::FctSettings(MixerEvent event)
 #endif
 
         // Check for long button press
-        if (EncoderButton.IsLongButtonPress())
+        if (IsLongButtonPress())
         {
           // Short beep sound
           tone(_pinBuzzer, 800, 40);
 
           // Exit cleaning mode and return to menu mode
-          Execute(eExit);
-          _currentState = eMenu;
           _currentMenuState = eSettings;
-          Execute(eEntry);
+          ChangeState(eMenu);
           return;
         }
 
@@ -684,10 +1129,8 @@ void StateMachine::FctSettings(MixerEvent event)
         if (millis() - Systemhelper.GetLastUserAction() > SCREENSAVER_TIMEOUT_MS)
         {
           // Exit settings mode and enter screen saver mode
-          Execute(eExit);
           _lastState = eSettings;
-          _currentState = eScreenSaver;
-          Execute(eEntry);
+          ChangeState(eScreenSaver);
           return;
         }
       }
@@ -732,18 +1175,16 @@ void StateMachine::FctScreenSaver(MixerEvent event)
         // Draw screen saver
         Display.DrawScreenSaver();
 
-        // Check user input (Last user interaction will be set)
-        EncoderButton.GetEncoderIncrements();
-        EncoderButton.IsLongButtonPress(); 
-        EncoderButton.IsButtonPress();
+        // Discard user input (Last user interaction is set by the events)
+        GetEncoderIncrements();
+        IsLongButtonPress();
+        IsButtonPress();
         
         // Check for last user interaction
         if (millis() - Systemhelper.GetLastUserAction() <= SCREENSAVER_TIMEOUT_MS)
         {
           // Exit screen saver mode and return to last mode
-          Execute(eExit);
-          _currentState = _lastState;
-          Execute(eEntry);
+          ChangeState(_lastState);
           return;
         }
       }
@@ -760,9 +1201,25 @@ void StateMachine::FctScreenSaver(MixerEvent event)
 void StateMachine::SetMixtureDefaults()
 { 
   // Set mixture to default
-  _liquid1Angle_Degrees = LIQUID1ANGLE_DEGREES;
-  _liquid2Angle_Degrees = LIQUID2ANGLE_DEGREES;
-  _liquid3Angle_Degrees = LIQUID3ANGLE_DEGREES;
+  _mixture.SetAngles(LiquidDefaultAngles_Degrees);
+  _mixtureResetVersion = _mixture.GetRevision();
+}
+
+//===============================================================
+// Sets the mixture to a preset recipe
+//===============================================================
+bool StateMachine::ApplyPreset(uint8_t index)
+{
+  int16_t angles_Degrees[LIQUID_COUNT];
+  if (!Presets.GetAngles(index, angles_Degrees))
+  {
+    return false;
+  }
+
+  ESP_LOGI(TAG, "Apply preset '%s'", Presets.GetName(index));
+  _mixture.SetAngles(angles_Degrees);
+  _mixtureResetVersion = _mixture.GetRevision();
+  return true;
 }
 
 //===============================================================
@@ -770,96 +1227,84 @@ void StateMachine::SetMixtureDefaults()
 //===============================================================
 void StateMachine::UpdateValues(uint32_t clientID)
 {
-  int16_t liquid1Distance_Degrees = GetDistanceDegrees(_liquid1Angle_Degrees, _liquid2Angle_Degrees);
-  int16_t liquid2Distance_Degrees = GetDistanceDegrees(_liquid2Angle_Degrees, _liquid3Angle_Degrees);
-  int16_t liquid3Distance_Degrees = GetDistanceDegrees(_liquid3Angle_Degrees, _liquid1Angle_Degrees);
+  // Update display driver
+  Display.SetMenuState(_currentMenuState);
+  Display.SetDashboardLiquid(_dashboardLiquid);
+  Display.SetCleaningLiquid(_cleaningLiquid);
+  Display.SetBatchSetting(_batchSetting);
 
-  // Avoid minimal setable value >0%. If an angle is at its min angle, mute
-  // it to zero and add the angle distance to the greater one of the two others
-  if (liquid1Distance_Degrees == MINANGLE_DEGREES)
+  int16_t angles_Degrees[LIQUID_COUNT];
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
   {
-    if (liquid2Distance_Degrees > liquid3Distance_Degrees)
-    {
-      liquid2Distance_Degrees += liquid1Distance_Degrees;
-    }
-    else
-    {
-      liquid3Distance_Degrees += liquid1Distance_Degrees;
-    }
-    liquid1Distance_Degrees = 0;
+    angles_Degrees[liquid] = _mixture.GetAngle(liquid);
   }
 
-  // Avoid minimal setable value >0%. If an angle is at its min angle, mute
-  // it to zero and add the angle distance to the greater one of the two others
-  if (liquid2Distance_Degrees == MINANGLE_DEGREES)
+  // Update display mixture (only on changes)
+  if (_displayMixtureRevision != _mixture.GetRevision())
   {
-    if (liquid1Distance_Degrees > liquid3Distance_Degrees)
-    {
-      liquid1Distance_Degrees += liquid2Distance_Degrees;
-    }
-    else
+    _displayMixtureRevision = _mixture.GetRevision();
+
+    double percentages[LIQUID_COUNT];
+    for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
     {
-      liquid3Distance_Degrees += liquid2Distance_Degrees;
+      percentages[liquid] = _mixture.GetPercentage(liquid);
     }
-    liquid2Distance_Degrees = 0;
+    Display.SetAngles(angles_Degrees);
+    Display.SetPercentages(percentages);
   }
-
-  // Avoid minimal setable value >0%. If an angle is at its min angle, mute
-  // it to zero and add the angle distance to the greater one of the two others
-  if (liquid3Distance_Degrees == MINANGLE_DEGREES)
+  
+  // Update pump driver (only on changes of the mixture or of the pump values
+  // of the current state, pump timings depend on the cycle timespan)
+  if (_pumpMixtureRevision != _mixture.GetRevision() ||
+    _pumpState != _currentState ||
+    _pumpCleaningLiquid != _cleaningLiquid ||
+    _pumpCycleTimespan_ms != Pumps.GetCycleTimespan())
   {
-    if (liquid1Distance_Degrees > liquid2Distance_Degrees)
-    {
-      liquid1Distance_Degrees += liquid3Distance_Degrees;
-    }
-    else
+    _pumpMixtureRevision = _mixture.GetRevision();
+    _pumpState = _currentState;
+    _pumpCleaningLiquid = _cleaningLiquid;
+    _pumpCycleTimespan_ms = Pumps.GetCycleTimespan();
+
+    // Pump values for the current state
+    double pumpPercentages[LIQUID_COUNT];
+    for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
     {
-      liquid2Distance_Degrees += liquid3Distance_Degrees;
+      switch (_currentState)
+      {
+        case eDashboard:
+        case eBatch:
+          pumpPercentages[liquid] = _mixture.GetPercentage(liquid);
+          break;
+        case eCleaning:
+          pumpPercentages[liquid] = (_cleaningLiquid == eLiquidAll || _cleaningLiquid == liquid) ? 100.0 : 0.0;
+          break;
+        default:
+        case eMenu:
+        case eReset:
+        case eSettings:
+          pumpPercentages[liquid] = 0.0; // zero (0%)
+          break;
+      }
     }
-    liquid3Distance_Degrees = 0;
+    Pumps.SetPumps(pumpPercentages);
   }
 
-  // Calculate percentage values
-  _liquid1_Percentage = (double)liquid1Distance_Degrees * 100.0 / 360.0;
-  _liquid2_Percentage = (double)liquid2Distance_Degrees * 100.0 / 360.0;
-  _liquid3_Percentage = (double)liquid3Distance_Degrees * 100.0 / 360.0;
-
-  // Update display driver
-  Display.SetMenuState(_currentMenuState);
-  Display.SetDashboardLiquid(_dashboardLiquid);
-  Display.SetCleaningLiquid(_cleaningLiquid);
-  Display.SetAngles(_liquid1Angle_Degrees, _liquid2Angle_Degrees, _liquid3Angle_Degrees);
-  Display.SetPercentages(_liquid1_Percentage, _liquid2_Percentage, _liquid3_Percentage);
-  
-  // Update pump driver
-  switch (_currentState)
+  // Update pour log mixture (only on changes, taken on lever press)
+  if (_pourLogMixtureRevision != _mixture.GetRevision())
   {
-    case eDashboard:
-      {
-        Pumps.SetPumps(_liquid1_Percentage, _liquid2_Percentage, _liquid3_Percentage);
-      }
-      break;
-    case eCleaning:
-      {
-        double cleaningLiquid1_Percentage = (_cleaningLiquid == eLiquidAll || _cleaningLiquid == eLiquid1) ? 100.0 : 0.0;
-        double cleaningLiquid2_Percentage = (_cleaningLiquid == eLiquidAll || _cleaningLiquid == eLiquid2) ? 100.0 : 0.0;
-        double cleaningLiquid3_Percentage = (_cleaningLiquid == eLiquidAll || _cleaningLiquid == eLiquid3) ? 100.0 : 0.0;
-        Pumps.SetPumps(cleaningLiquid1_Percentage, cleaningLiquid2_Percentage, cleaningLiquid3_Percentage);
-      }
-      break;
-    default:
-    case eMenu:
-    case eReset:
-    case eSettings:
-      {
-        Pumps.SetPumps(0.0, 0.0, 0.0); // zero (0%)
-      }
-      break;
+    _pourLogMixtureRevision = _mixture.GetRevision();
+    PourLog.SetMixture(angles_Degrees);
   }
 
 #if defined(WIFI_MIXER)
-  // Update wifi clients
-  Wifihandler.UpdateLiquidAnglesToClients(clientID);
+  // Update wifi clients (only on changes or as answer to a client, whose
+  // values may differ after limiting the angles)
+  if (_wifiMixtureRevision != _mixture.GetRevision() ||
+    clientID != 0)
+  {
+    _wifiMixtureRevision = _mixture.GetRevision();
+    Wifihandler.UpdateLiquidAnglesToClients(clientID, _mixture.GetRevision(), angles_Degrees);
+  }
 #endif
 }
 
@@ -869,14 +1314,15 @@ void StateMachine::UpdateValues(uint32_t clientID)
 String StateMachine::GetMixtureString()
 {
   // Calculate sum
-  double sum_Percentage = _liquid1_Percentage + _liquid2_Percentage + _liquid3_Percentage;
+  double sum_Percentage = _mixture.GetSum();
   
   // Build string output
   String returnString;
 
-  returnString += String(LIQUID1_NAME) + ": " + String(_liquid1_Percentage) + "% (" + String(_liquid1Angle_Degrees) + "°), ";
-  returnString += String(LIQUID2_NAME) + ": " + String(_liquid2_Percentage) + "% (" + String(_liquid2Angle_Degrees) + "°), ";
-  returnString += String(LIQUID3_NAME) + ": " + String(_liquid3_Percentage) + "% (" + String(_liquid3Angle_Degrees) + "°), ";
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    returnString += String(LiquidNames[liquid]) + ": " + String(_mixture.GetPercentage(liquid)) + "% (" + String(_mixture.GetAngle(liquid)) + "°), ";
+  }
   returnString += "Sum: " + String(sum_Percentage) + "%";
   
   if ((sum_Percentage - 100.0) > 0.1 || (sum_Percentage - 100.0) < -0.1)
@@ -17,16 +17,57 @@
 #include <esp_log.h>
 #include "Config.h"
 #include "AngleHelper.h"
+#include "Mixture.h"
+#include "PresetStore.h"
+#include "CommandQueue.h"
+#include "InputEventQueue.h"
+#include "Metrics.h"
 #include "EncoderButtonDriver.h"
 #include "PumpDriver.h"
 #include "DisplayDriver.h"
 #include "FlowMeterDriver.h"
+#include "PourLogger.h"
+#include "BatchDispenser.h"
 #include "WifiHandler.h"
 
 //===============================================================
 // Defines
 //===============================================================
 #define SCREENSAVER_TIMEOUT_MS      30000     // 30 seconds
+#define PAGECHANGE_DEBOUNCE_MS      500       // Input is ignored after a page change
+#define SETTINGCHANGE_DEBOUNCE_MS   200       // Input is ignored after a setting change
+#define CYCLETIME_ACTIVE_MS         5         // Cycle time while animating, batch dispensing or waiting for a long button press
+#define WIFI_COMMAND_QUEUE_SIZE     32        // Pending wifi commands (power of two)
+#define CYCLETIME_IDLE_MS           200       // Maximum cycle time without new events
+
+//===============================================================
+// Enums
+//===============================================================
+enum WifiCommandType : uint16_t
+{
+  eWifiCommandLiquid = 0,
+  eWifiCommandCycleTimespan = 1,
+  eWifiCommandPresetApply = 2,
+  eWifiCommandPresetSave = 3,
+  eWifiCommandPresetDelete = 4,
+  eWifiCommandPresetList = 5
+};
+
+//===============================================================
+// Structs
+//===============================================================
+// Command from a wifi client to the state machine
+struct WifiCommand
+{
+  uint32_t ClientID;
+  uint32_t Sequence;
+  uint16_t ClientSequence;    // Frame sequence of the client (0 -> not acknowledged)
+  uint32_t BaseVersion;       // Mixture version the client increments are based on (0 -> current)
+  WifiCommandType Type;
+  MixtureLiquid Liquid;
+  int32_t Value;              // Liquid increments in degrees, cycle timespan in ms or preset index
+  char Name[PRESET_NAME_LENGTH];  // Preset name (preset save only)
+};
 
 //===============================================================
 // Class for state machine handling
@@ -40,6 +81,19 @@ class StateMachine
     // Initializes the state machine
     void Begin(uint8_t pinBuzzer);
 
+    // Sets the main task, which is woken on new events
+    void SetTaskHandle(TaskHandle_t taskHandle);
+
+    // Wakes the main task from interrupt service routine. Returns
+    // true, if the interrupt has to yield to the main task
+    bool IRAM_ATTR WakeFromISR();
+
+    // Wakes the main task from other tasks
+    void Wake();
+
+    // Returns the maximum time the main task may wait for new events
+    uint32_t GetCycleTime_ms();
+
 #if defined(WIFI_MIXER)
     // Updates cycle timespan value from wifi
     bool UpdateValuesFromWifi(uint32_t clientID, uint32_t cycletimespan_ms);
@@ -47,16 +101,26 @@ class StateMachine
     // Updates non volatile values from wifi
     bool UpdateValuesFromWifi(uint32_t clientID, bool save);
 
-    // Updates a liquid values from wifi
-    bool UpdateValuesFromWifi(uint32_t clientID, MixtureLiquid liquid, int16_t increments_Degrees);
+    // Updates a liquid values from wifi (client sequence is acknowledged after execution,
+    // increments against an older base version are rebased onto the current mixture)
+    bool UpdateValuesFromWifi(uint32_t clientID, MixtureLiquid liquid, int16_t increments_Degrees, uint16_t clientSequence = 0, uint32_t baseVersion = 0);
+
+    // Applies, saves, deletes or lists presets from wifi
+    bool UpdatePresetsFromWifi(uint32_t clientID, WifiCommandType type, int32_t index, const char* name = NULL);
 #endif
 
     // Returns the angle for a given liquid
     int16_t GetAngle(MixtureLiquid liquid);
 
+    // Returns the mixture revision (changes once per recalculation)
+    uint32_t GetMixtureRevision();
+
     // Returns the current mixer state of the state machine
     MixerState IRAM_ATTR GetCurrentState();
 
+    // Takes the input events of the interrupts and the wifi handler
+    void ProcessInputEvents();
+
     // General state machine execution function
     void Execute(MixerEvent event);
 
@@ -67,6 +131,9 @@ class StateMachine
     // Pin definitions
     uint8_t _pinBuzzer;
 
+    // Main task, which is woken on new events
+    TaskHandle_t _taskHandle = NULL;
+
     // State machine variables
     MixerState _currentState = eDashboard;
     MixerState _lastState = eDashboard;
@@ -74,45 +141,96 @@ class StateMachine
 
     // Dashboard mode settings
     MixtureLiquid _dashboardLiquid = eLiquid1;
-    int16_t _liquid1Angle_Degrees = 0;
-    int16_t _liquid2Angle_Degrees = 0;
-    int16_t _liquid3Angle_Degrees = 0;
-    double _liquid1_Percentage = 0;
-    double _liquid2_Percentage = 0;
-    double _liquid3_Percentage = 0;
+    Mixture<LIQUID_COUNT> _mixture;
+
+    // The mixture revision is the version of the mixture for the wifi
+    // clients. Increments based on a version before the last reset
+    // (defaults, preset) are stale and dropped
+    uint32_t _mixtureResetVersion = 0;
+
+    // Mixture revisions last propagated to the display, pump driver, pour
+    // log and wifi clients (the mixture starts with revision 1)
+    uint32_t _displayMixtureRevision = 0;
+    uint32_t _pumpMixtureRevision = 0;
+    MixerState _pumpState = eDashboard;
+    MixtureLiquid _pumpCleaningLiquid = eLiquidNone;
+    uint32_t _pumpCycleTimespan_ms = 0;
+    uint32_t _wifiMixtureRevision = 0;
+    uint32_t _pourLogMixtureRevision = 0;
+
+    // Batch mode settings
+    BatchSetting _batchSetting = eBatchSettingGlasses;
 
     // Cleaning mode settings
     MixtureLiquid _cleaningLiquid = eLiquidAll;
 
+    // Preset recall settings
+    uint8_t _presetIndex = 0;
+
     // Timer variables for reset counter
     uint32_t _resetTimestamp = 0;
     const uint32_t ResetTime_ms = 2000;
 
-    // Wifi new liquid data variables
-    uint32_t _newLiquidClientID = 0;
-    MixtureLiquid _newLiquid = eLiquidNone;
-    int16_t _newLiquidIncrements_Degrees = 0;
+    // Input event types of the current main cycle (bit per type),
+    // the states only read the inputs with events
+    uint8_t _inputEvents = 0;
 
-    // Wifi new cycle timespan data variables
-    uint32_t _newCycleTimespanClientID = 0;
-    bool _newCycleTimespan = false;
-    uint32_t _newCycleTimespan_ms = 0;
+    // Wifi commands (producer async tcp task, consumer main task)
+    CommandQueue<WifiCommand, WIFI_COMMAND_QUEUE_SIZE> _wifiCommands;
+    std::atomic<uint32_t> _wifiCommandSequence{0};
+    uint32_t _lastWifiCommandSequence = 0;
+
+#if defined(WIFI_MIXER)
+    // Pending preset list request (client ID, 0 for all clients or
+    // WIFI_NO_UPDATE), coalesced instead of queued, as every client
+    // requests the list on connect
+    std::atomic<uint32_t> _pendingPresetListClientID;
+#endif
 
 #if defined(WIFI_MIXER)
     // Handles new wifi data, should be called in state machine
     void HandleNewWifiData(MixerEvent event);
+
+    // Adds a wifi command to the queue
+    bool PushWifiCommand(uint32_t clientID, WifiCommandType type, MixtureLiquid liquid, int32_t value, const char* name = NULL, uint16_t clientSequence = 0, uint32_t baseVersion = 0);
+
+    // Executes a merged wifi command
+    void ExecuteWifiCommand(const WifiCommand& command, MixerEvent event);
 #endif
 
+    // Returns true, if an input event of the type was taken in the
+    // current main cycle
+    bool HasInput(InputEventType type);
+
+    // Returns the encoder increments, if the encoder was turned
+    int16_t GetEncoderIncrements(bool accelerated = false);
+
+    // Returns true on a short button press (button events)
+    bool IsButtonPress();
+
+    // Returns true on a long button press (button held down)
+    bool IsLongButtonPress();
+
+    // Exits the current state and enters the new state
+    void ChangeState(MixerState state);
+
     // Function menu state
     void FctMenu(MixerEvent event);
 
     // Function dashboard state
     void FctDashboard(MixerEvent event);
 
+    // Function batch state
+    void FctBatch(MixerEvent event);
+
+    // Starts and stops a batch pour
+    void StartBatchPour();
+    void StopBatchPour();
+
     // Function cleaning state
     void FctCleaning(MixerEvent event);
 
-    // Function reset state
+    // Function reset state (recalls presets)
     void FctReset(MixerEvent event);
 
     // Function settings state
@@ -124,6 +242,9 @@ class StateMachine
     // Resets the mixture to default recipe
     void SetMixtureDefaults();
 
+    // Sets the mixture to a preset recipe
+    bool ApplyPreset(uint8_t index);
+
     // Updates all values in display, pumps driver and wifi
     void UpdateValues(uint32_t clientID = 0);
 };
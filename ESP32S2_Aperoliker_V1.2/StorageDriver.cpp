@@ -0,0 +1,433 @@
+/**
+ * Includes all storage functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include "StorageDriver.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#if defined(STORAGE_LITTLEFS)
+#define STORAGE_FS            LittleFS
+#define STORAGE_NAME          "LittleFS"
+#else
+#define STORAGE_FS            SPIFFS
+#define STORAGE_NAME          "SPIFFS"
+#endif
+
+//===============================================================
+// Constants
+//===============================================================
+static const char* TAG = "storage";
+
+//===============================================================
+// Global variables
+//===============================================================
+StorageDriver Storage;
+
+//===============================================================
+// Constructor
+//===============================================================
+StorageDriver::StorageDriver()
+{
+}
+
+//===============================================================
+// Mounts the file system. A partition, which can not be mounted,
+// is never formatted here: it may hold the data of the other file
+// system (see the storage upgrade in Config.h)
+//===============================================================
+bool StorageDriver::Begin()
+{
+  // Log startup info
+  ESP_LOGI(TAG, "Begin initializing storage (%s)", STORAGE_NAME);
+
+  _mutex = xSemaphoreCreateMutex();
+
+  _available = STORAGE_FS.begin(false);
+  if (!_available)
+  {
+    ESP_LOGE(TAG, "Could not mount %s, upload a %s image or format the partition in the web editor", STORAGE_NAME, STORAGE_NAME);
+  }
+
+  // Log startup info
+  ESP_LOGI(TAG, "Finished initializing storage (%s)", _available ? "available" : "not available");
+
+  return _available;
+}
+
+//===============================================================
+// Returns true, if the file system is mounted
+//===============================================================
+bool StorageDriver::IsAvailable()
+{
+  return _available;
+}
+
+//===============================================================
+// Returns the name of the file system backend
+//===============================================================
+const char* StorageDriver::GetName()
+{
+  return STORAGE_NAME;
+}
+
+//===============================================================
+// Returns the file system (e.g. for the static web server)
+//===============================================================
+fs::FS& StorageDriver::GetFS()
+{
+  return STORAGE_FS;
+}
+
+//===============================================================
+// Returns the size of the file system
+//===============================================================
+size_t StorageDriver::GetTotalBytes()
+{
+  return _available ? STORAGE_FS.totalBytes() : 0;
+}
+
+//===============================================================
+// Returns the used bytes of the file system
+//===============================================================
+size_t StorageDriver::GetUsedBytes()
+{
+  return _available ? STORAGE_FS.usedBytes() : 0;
+}
+
+//===============================================================
+// Formats the file system (explicit user request only) and mounts
+// it, if it was not mounted before
+//===============================================================
+bool StorageDriver::Format()
+{
+  Invalidate(NULL);
+
+  ESP_LOGI(TAG, "Format %s", STORAGE_NAME);
+  if (!STORAGE_FS.format())
+  {
+    ESP_LOGE(TAG, "Could not format %s", STORAGE_NAME);
+    return false;
+  }
+
+  if (!_available)
+  {
+    _available = STORAGE_FS.begin(false);
+  }
+  return _available;
+}
+
+//===============================================================
+// Opens a file. Cached handles of the file are dropped, if it is
+// opened for writing
+//===============================================================
+File StorageDriver::Open(const char* path, const char* mode)
+{
+  if (!_available)
+  {
+    return File();
+  }
+
+  if (strcmp(mode, FILE_READ) != 0)
+  {
+    Invalidate(path);
+  }
+
+  return STORAGE_FS.open(path, mode);
+}
+
+//===============================================================
+// Returns true, if the file exists
+//===============================================================
+bool StorageDriver::Exists(const char* path)
+{
+  return _available && STORAGE_FS.exists(path);
+}
+
+//===============================================================
+// Removes a file
+//===============================================================
+bool StorageDriver::Remove(const char* path)
+{
+  if (!_available)
+  {
+    return false;
+  }
+
+  Invalidate(path);
+  return STORAGE_FS.remove(path);
+}
+
+//===============================================================
+// Renames a file, an existing target file is replaced (LittleFS
+// replaces it in one step, SPIFFS needs the target removed first)
+//===============================================================
+bool StorageDriver::Rename(const char* fromPath, const char* toPath)
+{
+  if (!_available)
+  {
+    return false;
+  }
+
+  Invalidate(fromPath);
+  Invalidate(toPath);
+  if (STORAGE_FS.rename(fromPath, toPath))
+  {
+    return true;
+  }
+
+  return STORAGE_FS.exists(toPath) &&
+    STORAGE_FS.remove(toPath) &&
+    STORAGE_FS.rename(fromPath, toPath);
+}
+
+//===============================================================
+// Returns a cached read handle positioned at the file start or
+// NULL. The handle is exclusive until it is given back
+//===============================================================
+File* StorageDriver::OpenCached(const char* path)
+{
+  if (!_available ||
+    strlen(path) >= STORAGE_PATH_LENGTH)
+  {
+    return NULL;
+  }
+
+  xSemaphoreTake(_mutex, portMAX_DELAY);
+
+  // Reuse a free handle of the file, otherwise replace the least
+  // recently used free handle
+  CachedFile* entry = NULL;
+  for (uint8_t index = 0; index < STORAGE_CACHE_SIZE; index++)
+  {
+    CachedFile& cached = _cache[index];
+    if (cached.InUse)
+    {
+      continue;
+    }
+
+    if (cached.Handle &&
+      strcmp(cached.Path, path) == 0)
+    {
+      entry = &cached;
+      break;
+    }
+
+    if (entry == NULL ||
+      !cached.Handle ||
+      (entry->Handle && cached.LastUse_ms < entry->LastUse_ms))
+    {
+      entry = &cached;
+    }
+  }
+
+  if (entry == NULL)
+  {
+    xSemaphoreGive(_mutex);
+    ESP_LOGE(TAG, "No free cached handle for '%s'", path);
+    return NULL;
+  }
+
+  if (entry->Handle &&
+    strcmp(entry->Path, path) == 0)
+  {
+    entry->Handle.seek(0);
+    _cacheHits++;
+  }
+  else
+  {
+    if (entry->Handle)
+    {
+      entry->Handle.close();
+    }
+
+    strncpy(entry->Path, path, STORAGE_PATH_LENGTH - 1);
+    entry->Path[STORAGE_PATH_LENGTH - 1] = '\0';
+    entry->Handle = STORAGE_FS.open(path, FILE_READ);
+    _cacheMisses++;
+
+    if (!entry->Handle ||
+      entry->Handle.isDirectory())
+    {
+      entry->Handle.close();
+      entry->Path[0] = '\0';
+      xSemaphoreGive(_mutex);
+      return NULL;
+    }
+  }
+
+  entry->InUse = true;
+  entry->Stale = false;
+  entry->LastUse_ms = millis();
+
+  ESP_LOGD(TAG, "Cached handle '%s' (%d hits, %d misses)", path, _cacheHits, _cacheMisses);
+
+  xSemaphoreGive(_mutex);
+  return &entry->Handle;
+}
+
+//===============================================================
+// Gives a cached read handle back
+//===============================================================
+void StorageDriver::CloseCached(File* file)
+{
+  if (file == NULL)
+  {
+    return;
+  }
+
+  xSemaphoreTake(_mutex, portMAX_DELAY);
+
+  for (uint8_t index = 0; index < STORAGE_CACHE_SIZE; index++)
+  {
+    CachedFile& cached = _cache[index];
+    if (&cached.Handle != file)
+    {
+      continue;
+    }
+
+    // File was changed while the handle was in use
+    if (cached.Stale)
+    {
+      cached.Handle.close();
+      cached.Path[0] = '\0';
+    }
+    cached.InUse = false;
+    cached.Stale = false;
+    break;
+  }
+
+  xSemaphoreGive(_mutex);
+}
+
+//===============================================================
+// Returns the CRC32 of the file content (cached until the file is
+// written, removed or renamed). Returns false, if the file can not
+// be read
+//===============================================================
+bool StorageDriver::GetContentHash(const char* path, uint32_t& hash)
+{
+  if (!_available ||
+    strlen(path) >= STORAGE_PATH_LENGTH)
+  {
+    return false;
+  }
+
+  xSemaphoreTake(_mutex, portMAX_DELAY);
+
+  for (uint8_t index = 0; index < STORAGE_HASH_CACHE_SIZE; index++)
+  {
+    CachedHash& cached = _hashes[index];
+    if (cached.Path[0] != '\0' &&
+      strcmp(cached.Path, path) == 0)
+    {
+      hash = cached.Hash;
+      cached.LastUse = ++_hashUses;
+      xSemaphoreGive(_mutex);
+      return true;
+    }
+  }
+  uint32_t generation = _generation;
+
+  xSemaphoreGive(_mutex);
+
+  // Read the file without the lock (other files stay accessible)
+  File file = STORAGE_FS.open(path, FILE_READ);
+  if (!file ||
+    file.isDirectory())
+  {
+    return false;
+  }
+
+  uint8_t buffer[STORAGE_HASH_BUFFER_SIZE];
+  size_t length;
+  hash = 0;
+  while ((length = file.read(buffer, sizeof(buffer))) > 0)
+  {
+    hash = esp_rom_crc32_le(hash, buffer, length);
+  }
+  file.close();
+
+  xSemaphoreTake(_mutex, portMAX_DELAY);
+
+  // Cache the hash in a free or the least recently used entry, if
+  // no file was changed meanwhile
+  if (generation == _generation)
+  {
+    CachedHash* entry = NULL;
+    for (uint8_t index = 0; index < STORAGE_HASH_CACHE_SIZE; index++)
+    {
+      CachedHash& cached = _hashes[index];
+      if (entry == NULL ||
+        cached.Path[0] == '\0' ||
+        (entry->Path[0] != '\0' && cached.LastUse < entry->LastUse))
+      {
+        entry = &cached;
+      }
+    }
+
+    strncpy(entry->Path, path, STORAGE_PATH_LENGTH - 1);
+    entry->Path[STORAGE_PATH_LENGTH - 1] = '\0';
+    entry->Hash = hash;
+    entry->LastUse = ++_hashUses;
+  }
+
+  xSemaphoreGive(_mutex);
+  return true;
+}
+
+//===============================================================
+// Closes all cached handles and drops the content hashes of a file
+// (NULL for all files). Handles in use are closed when they are
+// given back
+//===============================================================
+void StorageDriver::Invalidate(const char* path)
+{
+  if (_mutex == NULL)
+  {
+    return;
+  }
+
+  xSemaphoreTake(_mutex, portMAX_DELAY);
+
+  _generation++;
+  for (uint8_t index = 0; index < STORAGE_HASH_CACHE_SIZE; index++)
+  {
+    CachedHash& cached = _hashes[index];
+    if (path == NULL ||
+      strcmp(cached.Path, path) == 0)
+    {
+      cached.Path[0] = '\0';
+    }
+  }
+
+  for (uint8_t index = 0; index < STORAGE_CACHE_SIZE; index++)
+  {
+    CachedFile& cached = _cache[index];
+    if (!cached.Handle ||
+      (path != NULL && strcmp(cached.Path, path) != 0))
+    {
+      continue;
+    }
+
+    if (cached.InUse)
+    {
+      cached.Stale = true;
+    }
+    else
+    {
+      cached.Handle.close();
+      cached.Path[0] = '\0';
+    }
+  }
+
+  xSemaphoreGive(_mutex);
+}
@@ -0,0 +1,139 @@
+/**
+ * Includes all storage functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef STORAGEDRIVER_H
+#define STORAGEDRIVER_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <FS.h>
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "Config.h"
+#if defined(STORAGE_LITTLEFS)
+#include <LittleFS.h>
+#else
+#include <SPIFFS.h>
+#endif
+
+//===============================================================
+// Defines
+//===============================================================
+#define STORAGE_CACHE_SIZE          4       // Open read handles kept for hot files
+#define STORAGE_PATH_LENGTH         32      // Including zero terminator
+#define STORAGE_HASH_CACHE_SIZE     8       // Content hashes kept (e.g. web server ETags)
+#define STORAGE_HASH_BUFFER_SIZE    256     // Read buffer of the content hash
+
+//===============================================================
+// Class for the flash file system. Wraps the selected backend
+// (LittleFS or SPIFFS) and keeps a small cache of open read
+// handles for files which are read again and again
+//===============================================================
+class StorageDriver
+{
+  public:
+    // Constructor
+    StorageDriver();
+
+    // Mounts the file system (never formats it)
+    bool Begin();
+
+    // Returns true, if the file system is mounted
+    bool IsAvailable();
+
+    // Returns the name of the file system backend
+    const char* GetName();
+
+    // Returns the file system (e.g. for the static web server)
+    fs::FS& GetFS();
+
+    // Returns the size of the file system
+    size_t GetTotalBytes();
+
+    // Returns the used bytes of the file system
+    size_t GetUsedBytes();
+
+    // Formats and mounts the file system
+    bool Format();
+
+    // Opens a file. Cached handles of the file are dropped, if it
+    // is opened for writing
+    File Open(const char* path, const char* mode = FILE_READ);
+
+    // Returns true, if the file exists
+    bool Exists(const char* path);
+
+    // Removes a file
+    bool Remove(const char* path);
+
+    // Renames a file, an existing target file is replaced
+    bool Rename(const char* fromPath, const char* toPath);
+
+    // Returns a cached read handle positioned at the file start or
+    // NULL. The handle is exclusive until it is given back
+    File* OpenCached(const char* path);
+
+    // Gives a cached read handle back
+    void CloseCached(File* file);
+
+    // Returns the CRC32 of the file content (cached until the file
+    // is written, removed or renamed). Returns false, if the file
+    // can not be read
+    bool GetContentHash(const char* path, uint32_t& hash);
+
+  private:
+    // Cached read handle
+    struct CachedFile
+    {
+      char Path[STORAGE_PATH_LENGTH] = { };
+      File Handle;
+      bool InUse = false;
+      bool Stale = false;         // Closed on give back
+      uint32_t LastUse_ms = 0;
+    };
+
+    // Cached content hash
+    struct CachedHash
+    {
+      char Path[STORAGE_PATH_LENGTH] = { };
+      uint32_t Hash = 0;
+      uint32_t LastUse = 0;       // Use counter (requests within one ms)
+    };
+
+    // Mount state
+    bool _available = false;
+
+    // Cache of read handles, guarded by the mutex (web server and
+    // main task read files)
+    CachedFile _cache[STORAGE_CACHE_SIZE];
+    SemaphoreHandle_t _mutex = NULL;
+    uint32_t _cacheHits = 0;
+    uint32_t _cacheMisses = 0;
+
+    // Cache of content hashes, guarded by the mutex. The generation
+    // changes with every invalidation, a hash calculated meanwhile
+    // is not cached
+    CachedHash _hashes[STORAGE_HASH_CACHE_SIZE];
+    uint32_t _hashUses = 0;
+    uint32_t _generation = 0;
+
+    // Closes all cached handles and drops the content hashes of a
+    // file (NULL for all files)
+    void Invalidate(const char* path);
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+extern StorageDriver Storage;
+
+#endif
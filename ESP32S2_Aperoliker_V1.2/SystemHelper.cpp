@@ -47,8 +47,17 @@ void SystemHelper::Begin()
 //===============================================================
 String SystemHelper::GetSystemInfoString()
 {
-  String returnString;
-  
+  StreamString output;
+  PrintSystemInfo(output);
+  return output;
+}
+
+//===============================================================
+// Prints the complete system info directly to the output (e.g. a
+// web response stream, no temporary strings)
+//===============================================================
+void SystemHelper::PrintSystemInfo(Print& output)
+{
   uint32_t chipId = 0;
 	for (int i = 0; i < 17; i = i + 8)
   {
@@ -56,34 +65,32 @@ String SystemHelper::GetSystemInfoString()
 	}
   
   // Chip-Information
-  returnString += "** Chip-Information: **\n";
-  returnString += "Chip-ID:         0x" + String(chipId, HEX) + "\n";
-  returnString += "Model:           " + String(ESP.getChipModel()) + "\n";
-  returnString += "Revision:        " + String(ESP.getChipRevision()) + "\n";
-  returnString += "SDK Version:     " + String(ESP.getSdkVersion()) + "\n";
-  returnString += "\n";
+  output.print("** Chip-Information: **\n");
+  output.printf("Chip-ID:         0x%x\n", chipId);
+  output.printf("Model:           %s\n", ESP.getChipModel());
+  output.printf("Revision:        %d\n", ESP.getChipRevision());
+  output.printf("SDK Version:     %s\n", ESP.getSdkVersion());
+  output.print("\n");
 
   // CPU-Information
-  returnString += "** CPU-Information: **\n";
-  returnString += "CPU-Frequency:   " + String(ESP.getCpuFreqMHz()) + " MHz\n";
-  returnString += "CPU Count:       " + String(ESP.getChipCores()) + "\n";
-  returnString += "\n";
+  output.print("** CPU-Information: **\n");
+  output.printf("CPU-Frequency:   %d MHz\n", ESP.getCpuFreqMHz());
+  output.printf("CPU Count:       %d\n", ESP.getChipCores());
+  output.print("\n");
 
   // WLAN-Information
-  returnString += "** WLAN-Information: **\n";
-  returnString += "MAC:             " + String(WiFi.macAddress()) + "\n";
-  returnString += "SSID:            " + String(WiFi.SSID()) + "\n";
-  returnString += "BSSID:           " + String(WiFi.BSSIDstr()) + "\n";
-  returnString += "Channel:         " + String(WiFi.channel()) + "\n";
-  returnString += "TX Power:        " + WifiPowerToString(WiFi.getTxPower()) + "\n";
-  returnString += "\n";
+  output.print("** WLAN-Information: **\n");
+  output.printf("MAC:             %s\n", WiFi.macAddress().c_str());
+  output.printf("SSID:            %s\n", WiFi.SSID().c_str());
+  output.printf("BSSID:           %s\n", WiFi.BSSIDstr().c_str());
+  output.printf("Channel:         %d\n", WiFi.channel());
+  output.printf("TX Power:        %s\n", WifiPowerToString(WiFi.getTxPower()).c_str());
+  output.print("\n");
 
   // Memory-Tnformation
-  returnString += "** Memory-Information: **\n";
-  returnString += GetMemoryInfoString(true);
-  returnString += "\n";
-
-  return returnString;
+  output.print("** Memory-Information: **\n");
+  PrintMemoryInfo(output, true);
+  output.print("\n");
 }
 
 //===============================================================
@@ -91,33 +98,39 @@ String SystemHelper::GetSystemInfoString()
 //===============================================================
 String SystemHelper::GetMemoryInfoString(bool all)
 {
-  String returnString;
+  StreamString output;
+  PrintMemoryInfo(output, all);
+  return output;
+}
 
-  double spiffsTotal = max(1.0, (double)SPIFFS.totalBytes());
-  double spiffsUsed = (double)SPIFFS.usedBytes();
-  double spiffsUsage = spiffsUsed / spiffsTotal * 100.0;
+//===============================================================
+// Prints the memory info directly to the output
+//===============================================================
+void SystemHelper::PrintMemoryInfo(Print& output, bool all)
+{
+  double storageTotal = max(1.0, (double)Storage.GetTotalBytes());
+  double storageUsed = (double)Storage.GetUsedBytes();
+  double storageUsage = storageUsed / storageTotal * 100.0;
 
   if (all)
   {
-    returnString += "Flash-Size:      " + String((double)ESP.getFlashChipSize() / (1024.0 * 1024.0), 6) + " MB\n";
-    returnString += "SRAM-Size:       " + String((double)ESP.getFreeHeap() / (1024.0 * 1024.0), 6) + " MB\n";
-    returnString += "PRAM-Size:       " + String((double)ESP.getPsramSize() / (1024.0 * 1024.0), 6) + " MB\n";
-    returnString += "\n";
-    returnString += "Sketch-Size:     " + String((double)ESP.getSketchSize() / (1024.0 * 1024.0), 6) + " MB\n";
-    returnString += "FreeSketch-Size: " + String((double)ESP.getFreeSketchSpace() / (1024.0 * 1024.0), 6) + " MB\n";
-    returnString += "\n";
-    returnString += "SPIFFS Ready:    " + String(SPIFFS.begin(false) ? "true\n" : "false\n");
-    returnString += "SPIFFS-Total:    " + String(spiffsTotal / (1024.0 * 1024.0), 6) + " MB\n";
-    returnString += "SPIFFS-Used:     " + String(spiffsUsed / (1024.0 * 1024.0), 6) + " MB (" + spiffsUsage + "%)\n";
-    returnString += "Free-Heap:       " + String((double)ESP.getFreeHeap() / (1024.0 * 1024.0), 6) + " MB\n";
+    output.printf("Flash-Size:      %.6f MB\n", (double)ESP.getFlashChipSize() / (1024.0 * 1024.0));
+    output.printf("SRAM-Size:       %.6f MB\n", (double)ESP.getFreeHeap() / (1024.0 * 1024.0));
+    output.printf("PRAM-Size:       %.6f MB\n", (double)ESP.getPsramSize() / (1024.0 * 1024.0));
+    output.print("\n");
+    output.printf("Sketch-Size:     %.6f MB\n", (double)ESP.getSketchSize() / (1024.0 * 1024.0));
+    output.printf("FreeSketch-Size: %.6f MB\n", (double)ESP.getFreeSketchSpace() / (1024.0 * 1024.0));
+    output.print("\n");
+    output.printf("Storage Ready:   %s (%s)\n", Storage.IsAvailable() ? "true" : "false", Storage.GetName());
+    output.printf("Storage-Total:   %.6f MB\n", storageTotal / (1024.0 * 1024.0));
+    output.printf("Storage-Used:    %.6f MB (%.2f%%)\n", storageUsed / (1024.0 * 1024.0), storageUsage);
+    output.printf("Free-Heap:       %.6f MB\n", (double)ESP.getFreeHeap() / (1024.0 * 1024.0));
   }
   else
   {
-    returnString += "SPIFFS-Used: " + String(spiffsUsed / (1024.0 * 1024.0), 6) + " MB (" + spiffsUsage + "%), ";
-    returnString += "Free-Heap: " + String((double)ESP.getFreeHeap() / (1024.0 * 1024.0), 6) + " MB\n";
+    output.printf("Storage-Used: %.6f MB (%.2f%%), ", storageUsed / (1024.0 * 1024.0), storageUsage);
+    output.printf("Free-Heap: %.6f MB\n", (double)ESP.getFreeHeap() / (1024.0 * 1024.0));
   }
-
-  return returnString;
 }
 
 //===============================================================
@@ -15,9 +15,10 @@
 #include <Arduino.h>
 #include <ESP.h>
 #include <WiFi.h>
-#include <SPIFFS.h>
+#include <StreamString.h>
 #include <esp_log.h>
 #include <esp32s2/rom/rtc.h>
+#include "StorageDriver.h"
 
 //===============================================================
 // Class for system handling
@@ -31,9 +32,15 @@ class SystemHelper
     // Returns the complete system info as string
     String GetSystemInfoString();
 
+    // Prints the complete system info directly to the output
+    void PrintSystemInfo(Print& output);
+
     // Returns memory info string
     String GetMemoryInfoString(bool all = false);
 
+    // Prints the memory info directly to the output
+    void PrintMemoryInfo(Print& output, bool all = false);
+
     // Returns a string for a wifi power
     String WifiPowerToString(wifi_power_t power);
 
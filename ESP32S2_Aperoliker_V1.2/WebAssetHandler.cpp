@@ -0,0 +1,153 @@
+/**
+ * Includes all web asset functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include "WebAssetHandler.h"
+
+//===============================================================
+// Constants
+//===============================================================
+static const char* TAG = "webassets";
+
+//===============================================================
+// Constructor
+//===============================================================
+WebAssetHandler::WebAssetHandler()
+{
+}
+
+//===============================================================
+// Returns true, if the requested file (or its gzipped variant)
+// exists. The path of the stored file is kept in the request
+//===============================================================
+bool WebAssetHandler::canHandle(AsyncWebServerRequest* request) const
+{
+  if (request->method() != HTTP_GET ||
+    !Storage.IsAvailable())
+  {
+    return false;
+  }
+
+  String path = request->url();
+  if (path.endsWith("/"))
+  {
+    path += WEB_ASSET_DEFAULT_FILE;
+  }
+
+  // Gzipped variant first
+  String gzipPath = path + ".gz";
+  const String* candidates[2] = { &gzipPath, &path };
+  for (const String* candidate : candidates)
+  {
+    if (candidate->length() < STORAGE_PATH_LENGTH &&
+      Storage.Exists(candidate->c_str()))
+    {
+      request->_tempObject = strdup(candidate->c_str());
+      return request->_tempObject != NULL;
+    }
+  }
+  return false;
+}
+
+//===============================================================
+// Handles the request. Clients revalidate files with fixed names
+// by the ETag (CRC32 of the stored content, independent of the
+// write time, which is not set without a clock), files with a
+// content hash in the name are cached without revalidation
+//===============================================================
+void WebAssetHandler::handleRequest(AsyncWebServerRequest* request)
+{
+  String filePath = (const char*)request->_tempObject;
+  free(request->_tempObject);
+  request->_tempObject = NULL;
+
+  uint32_t hash;
+  if (!Storage.GetContentHash(filePath.c_str(), hash))
+  {
+    request->send(404);
+    return;
+  }
+
+  char etag[WEB_ASSET_HASH_LENGTH + 3];
+  snprintf(etag, sizeof(etag), "\"%08x\"", (unsigned int)hash);
+  const char* cacheControl = IsHashedName(filePath.c_str()) ? WEB_ASSET_CACHE_IMMUTABLE : WEB_ASSET_CACHE_REVALIDATE;
+
+  // Unchanged file
+  if (request->hasHeader("If-None-Match") &&
+    request->header("If-None-Match") == etag)
+  {
+    ESP_LOGD(TAG, "Not modified '%s'", filePath.c_str());
+    AsyncWebServerResponse* response = request->beginResponse(304);
+    response->addHeader("Cache-Control", cacheControl);
+    response->addHeader("ETag", etag);
+    request->send(response);
+    return;
+  }
+
+  File file = Storage.Open(filePath.c_str());
+  if (!file)
+  {
+    request->send(404);
+    return;
+  }
+
+  // Content type of the requested name, gzip content encoding of
+  // the stored name
+  String path = filePath.endsWith(".gz") ? filePath.substring(0, filePath.length() - 3) : filePath;
+  AsyncWebServerResponse* response = request->beginResponse(file, path);
+  response->addHeader("Cache-Control", cacheControl);
+  response->addHeader("ETag", etag);
+  request->send(response);
+}
+
+//===============================================================
+// Returns true, if the file name contains a content hash
+// (e.g. '/index.0123abcd.js.gz')
+//===============================================================
+bool WebAssetHandler::IsHashedName(const char* path)
+{
+  const char* name = strrchr(path, '/');
+  name = (name != NULL) ? name + 1 : path;
+
+  // Hash is the second last part without the gzip extension
+  size_t length = strlen(name);
+  if (length > 3 &&
+    strcmp(name + length - 3, ".gz") == 0)
+  {
+    length -= 3;
+  }
+
+  const char* extension = NULL;
+  const char* hash = NULL;
+  for (const char* character = name; character < name + length; character++)
+  {
+    if (*character == '.')
+    {
+      hash = extension;
+      extension = character;
+    }
+  }
+  if (hash == NULL ||
+    extension - hash - 1 != WEB_ASSET_HASH_LENGTH)
+  {
+    return false;
+  }
+
+  // Lower case hex digits (tools/BuildWebAssets.py)
+  for (const char* character = hash + 1; character < extension; character++)
+  {
+    if (!((*character >= '0' && *character <= '9') ||
+      (*character >= 'a' && *character <= 'f')))
+    {
+      return false;
+    }
+  }
+  return true;
+}
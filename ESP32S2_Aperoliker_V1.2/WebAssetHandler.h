@@ -0,0 +1,59 @@
+/**
+ * Includes all web asset functions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+ 
+#ifndef WEBASSETHANDLER_H
+#define WEBASSETHANDLER_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <esp_log.h>
+#include "StorageDriver.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#define WEB_ASSET_DEFAULT_FILE        "index.html"
+#define WEB_ASSET_HASH_LENGTH         8       // Hex digits of the content hash in file names (e.g. 'index.0123abcd.js')
+#define WEB_ASSET_CACHE_REVALIDATE    "no-cache"                            // Files with fixed names (e.g. 'index.html', uploads)
+#define WEB_ASSET_CACHE_IMMUTABLE     "public, max-age=31536000, immutable" // Files with content hash in the name
+
+//===============================================================
+// Web asset handler class. Serves the files of the storage (the
+// gzipped variant first) with a content hash ETag and answers
+// revalidations with 304. The hashed and gzipped files are created
+// by tools/BuildWebAssets.py
+//===============================================================
+class WebAssetHandler: public AsyncWebHandler
+{
+  public:
+    // Constructor
+    WebAssetHandler();
+
+    // Returns true, if the requested file (or its gzipped variant)
+    // exists
+    bool canHandle(AsyncWebServerRequest* request) const override final;
+    
+    // Handles the request
+    void handleRequest(AsyncWebServerRequest* request) override final;
+    
+    // Returns true (no request body)
+    bool isRequestHandlerTrivial() const override final
+    {
+      return true;
+    }
+
+  private:
+    // Returns true, if the file name contains a content hash
+    // (e.g. '/index.0123abcd.js.gz')
+    static bool IsHashedName(const char* path);
+};
+
+#endif
@@ -9,6 +9,7 @@
 //===============================================================
 // Inlcudes
 //===============================================================
+#include <memory>
 #include "WifiHandler.h"
 
 //===============================================================
@@ -46,6 +47,8 @@ void WifiHandler::Begin()
   // Log startup info
   ESP_LOGI(TAG, "Begin initializing wifi handler");
 
+  _mutex = xSemaphoreCreateMutex();
+
   // Load wifi settings
   Load();
 
@@ -163,35 +166,272 @@ uint16_t WifiHandler::GetConnectedClients()
 }
 
 //===============================================================
-// Updates cycle timespan in connected clients
+// Requests a cycle timespan update in connected clients (sent by
+// Update)
 //===============================================================
 void WifiHandler::UpdateCycleTimespanToClients(uint32_t clientID)
 {
-  if (_webevents == NULL)
+  RequestUpdate(&_pendingCycleTimespanClientID, clientID);
+}
+
+//===============================================================
+// Sets the mixture state of the state machine and requests a
+// liquid angles update in connected clients (sent by Update, main
+// task)
+//===============================================================
+void WifiHandler::UpdateLiquidAnglesToClients(uint32_t clientID, uint32_t version, const int16_t (&angles_Degrees)[LIQUID_COUNT])
+{
+  Lock();
+  _mixtureVersion = version;
+  memcpy(_mixtureAngles_Degrees, angles_Degrees, sizeof(_mixtureAngles_Degrees));
+  Unlock();
+
+  RequestUpdate(&_pendingAnglesClientID, clientID);
+}
+
+//===============================================================
+// Acknowledges an executed liquid frame of a client with the
+// mixture version including it (main task). Only the last frame
+// of a client is kept, it acknowledges all frames before
+//===============================================================
+void WifiHandler::AcknowledgeToClient(uint32_t clientID, uint16_t sequence, uint32_t version)
+{
+  Lock();
+  auto ack = _acks.find(clientID);
+  if (ack != _acks.end())
+  {
+    ack->second.Sequence = sequence;
+    ack->second.Version = version;
+  }
+  Unlock();
+}
+
+//===============================================================
+// Locks the shared state (before Begin only the setup runs)
+//===============================================================
+void WifiHandler::Lock()
+{
+  if (_mutex != NULL)
+  {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+  }
+}
+
+//===============================================================
+// Unlocks the shared state
+//===============================================================
+void WifiHandler::Unlock()
+{
+  if (_mutex != NULL)
+  {
+    xSemaphoreGive(_mutex);
+  }
+}
+
+//===============================================================
+// Marks a state update as pending (any task). A pending update of
+// another client is coalesced to an update for all clients
+//===============================================================
+void WifiHandler::RequestUpdate(std::atomic<uint32_t>* pendingClientID, uint32_t clientID)
+{
+  uint32_t pending = pendingClientID->load();
+  while (!pendingClientID->compare_exchange_weak(pending,
+    (pending == WIFI_NO_UPDATE || pending == clientID) ? clientID : 0))
+  {
+  }
+
+  if (pending != WIFI_NO_UPDATE)
+  {
+    Metrics.Add(eMetricWifiBroadcastsCoalesced);
+  }
+}
+
+//===============================================================
+// Sends pending state updates (rate limited, loop task). Values
+// equal to the last sent ones are skipped, except as answer to
+// a client, whose values may differ after limiting. Liquid angles
+// are sent with their version and the client frames included in
+// this version: "version:angle1,angle2,angle3:clientID=sequence;..."
+//===============================================================
+void WifiHandler::SendPendingUpdates()
+{
+  if (millis() - _lastBroadcast_ms < WIFI_BROADCAST_INTERVAL_MS)
   {
     return;
   }
 
-  uint32_t cycleTimepan_ms = Pumps.GetCycleTimespan();
-  _webevents->send((String(clientID) + ":" + String(cycleTimepan_ms)).c_str(), "CYCLE_TIMESPAN");
+  // Keep updates pending while the clients are busy (slow phones)
+  if (!_websocket->availableForWriteAll())
+  {
+    if (_pendingAnglesClientID.load() != WIFI_NO_UPDATE ||
+      _pendingCycleTimespanClientID.load() != WIFI_NO_UPDATE)
+    {
+      Metrics.Add(eMetricWifiBroadcastsDeferred);
+    }
+    return;
+  }
+
+  uint32_t clientID = _pendingAnglesClientID.exchange(WIFI_NO_UPDATE);
+  if (clientID != WIFI_NO_UPDATE)
+  {
+    // Version, angles (up to 4 characters each) and the acknowledges
+    // included in the version (ID up to 10 digits, sequence up to 5)
+    Lock();
+    uint32_t version = _mixtureVersion;
+    String data;
+    data.reserve(12 + LIQUID_COUNT * 5 + _acks.size() * 18);
+    data += version;
+    for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+    {
+      data += liquid > 0 ? "," : ":";
+      data += _mixtureAngles_Degrees[liquid];
+    }
+    data += ":";
+    bool acknowledged = false;
+    for (auto& ack : _acks)
+    {
+      if (ack.second.Sequence != 0 &&
+        ack.second.Version <= version)
+      {
+        data += acknowledged ? ";" : "";
+        data += ack.first;
+        data += "=";
+        data += ack.second.Sequence;
+        ack.second.Sequence = 0;
+        acknowledged = true;
+      }
+    }
+    Unlock();
+
+    if (clientID != 0 ||
+      !_anglesSent ||
+      version != _lastMixtureVersion ||
+      acknowledged)
+    {
+      _lastMixtureVersion = version;
+      _anglesSent = true;
+      SendEvent("LIQUID_ANGLES", data.c_str());
+      Metrics.Add(eMetricWifiBroadcastsSent);
+      _lastBroadcast_ms = millis();
+    }
+    else
+    {
+      Metrics.Add(eMetricWifiBroadcastsSkipped);
+    }
+  }
+
+  clientID = _pendingCycleTimespanClientID.exchange(WIFI_NO_UPDATE);
+  if (clientID != WIFI_NO_UPDATE)
+  {
+    uint32_t cycleTimepan_ms = Pumps.GetCycleTimespan();
+
+    if (clientID != 0 ||
+      cycleTimepan_ms != _lastCycleTimespan_ms)
+    {
+      _lastCycleTimespan_ms = cycleTimepan_ms;
+      char data[24];
+      snprintf(data, sizeof(data), "%u:%u", (unsigned int)clientID, (unsigned int)cycleTimepan_ms);
+      SendEvent("CYCLE_TIMESPAN", data);
+      Metrics.Add(eMetricWifiBroadcastsSent);
+      _lastBroadcast_ms = millis();
+    }
+    else
+    {
+      Metrics.Add(eMetricWifiBroadcastsSkipped);
+    }
+  }
 }
 
 //===============================================================
-// Updates all liquid angles in connected clients
+// Updates preset names in the given client (client ID = 0 -> all
+// clients). Must be called from the main task, which owns the
+// presets
 //===============================================================
-void WifiHandler::UpdateLiquidAnglesToClients(uint32_t clientID)
+void WifiHandler::UpdatePresetsToClients(uint32_t clientID)
 {
-  if (!_webevents)
+  if (!_websocket)
+  {
+    return;
+  }
+
+  String presets = "PRESETS:" + Presets.GetNamesString();
+  if (clientID == 0)
+  {
+    _websocket->textAll(presets.c_str());
+  }
+  else
+  {
+    _websocket->text(clientID, presets.c_str());
+  }
+}
+
+//===============================================================
+// Updates batch progress in connected clients (only on changes)
+//===============================================================
+void WifiHandler::UpdateBatchProgressToClients()
+{
+  if (!_websocket)
   {
     return;
   }
 
-  int16_t angle1 = Statemachine.GetAngle(eLiquid1);
-  int16_t angle2 = Statemachine.GetAngle(eLiquid2);
-  int16_t angle3 = Statemachine.GetAngle(eLiquid3);
+  // Glasses done, glass count, glasses per minute (two decimal
+  // places) and batch phase, only formatted on changes
+  int16_t glassesDone = Batch.GetGlassesDone();
+  int16_t glasses = Batch.GetGlasses();
+  int32_t glassesPerMinute_Hundredths = lround(Batch.GetGlassesPerMinute() * 100.0);
+  BatchPhase phase = Batch.GetPhase();
+  if (_batchProgressSent &&
+    glassesDone == _lastBatchGlassesDone &&
+    glasses == _lastBatchGlasses &&
+    glassesPerMinute_Hundredths == _lastBatchGlassesPerMinute_Hundredths &&
+    phase == _lastBatchPhase)
+  {
+    return;
+  }
+  _batchProgressSent = true;
+  _lastBatchGlassesDone = glassesDone;
+  _lastBatchGlasses = glasses;
+  _lastBatchGlassesPerMinute_Hundredths = glassesPerMinute_Hundredths;
+  _lastBatchPhase = phase;
+
+  char batchProgress[48];
+  snprintf(batchProgress, sizeof(batchProgress), "%d,%d,%ld.%02ld,%d", glassesDone, glasses,
+    (long)(glassesPerMinute_Hundredths / 100), (long)(glassesPerMinute_Hundredths % 100), (int)phase);
 
   // Send events from variables to all connected websockets
-  _webevents->send((String(clientID) + ":" + String(angle1) + "," + String(angle2)  + "," + String(angle3)).c_str(), "LIQUID_ANGLES");
+  SendEvent("BATCH_PROGRESS", batchProgress);
+}
+
+//===============================================================
+// Sends an event to all clients as typed websocket message
+// 'EVENT:<event>:<data>' (and over the events endpoint, if enabled).
+// The message is written once into a buffer shared by all clients
+//===============================================================
+void WifiHandler::SendEvent(const char* event, const char* data)
+{
+  if (_websocket)
+  {
+    size_t eventLength = strlen(event);
+    size_t dataLength = strlen(data);
+    AsyncWebSocketMessageBuffer* buffer = _websocket->makeBuffer(6 + eventLength + 1 + dataLength);
+    if (buffer != NULL)
+    {
+      uint8_t* message = buffer->get();
+      memcpy(message, "EVENT:", 6);
+      memcpy(message + 6, event, eventLength);
+      message[6 + eventLength] = ':';
+      memcpy(message + 6 + eventLength + 1, data, dataLength);
+      _websocket->textAll(buffer);
+    }
+  }
+
+#if defined(WIFI_EVENTSOURCE)
+  if (_webevents)
+  {
+    _webevents->send(data, event);
+  }
+#endif
 }
 
 //===============================================================
@@ -205,13 +445,26 @@ void WifiHandler::Update()
     _websocket->cleanupClients();
   }
 
-  if (_webevents)
+  if (_websocket)
   {
-    // Send alive signal every second
-    if (millis() - _lastAlive_ms > 1000)
+    // Resync all values in a long interval (an update may have been
+    // lost in a full client queue)
+    if (millis() - _lastSync_ms > WIFI_SYNC_INTERVAL_MS)
     {
-      //_webevents->send("", "ALIVE");
-      UpdateLiquidAnglesToClients(0); // Use liquid angles instead (long time sync and alive in once)
+      _anglesSent = false;
+      _lastCycleTimespan_ms = 0;
+      RequestUpdate(&_pendingAnglesClientID, 0);
+      UpdateCycleTimespanToClients(0);
+      _lastSync_ms = millis();
+    }
+
+    // Send pending state updates
+    SendPendingUpdates();
+
+    // Send cheap alive signal every second
+    if (millis() - _lastAlive_ms > WIFI_HEARTBEAT_INTERVAL_MS)
+    {
+      SendEvent("ALIVE", "1");
       _lastAlive_ms = millis();
     }
   }
@@ -225,89 +478,248 @@ void WifiHandler::OnWebsocketEvent(AsyncWebSocket* server, AsyncWebSocketClient*
   // Client connected
   if (type == WS_EVT_CONNECT)
   {
+    ESP_LOGD(TAG, "Websocket %u %u connect", (unsigned int)millis(), (unsigned int)client->id());
+
+    // Add acknowledge state of the client
+    Lock();
+    _acks[(uint32_t)client->id()] = { };
+    Unlock();
+
     // Send all static settings to mixer on websocket connect
     client->printf("Connected Client Number %u", (uint16_t)client->id());
     UpdateSettingsToClient(client);
+    Statemachine.UpdatePresetsFromWifi((uint32_t)client->id(), eWifiCommandPresetList, 0);
     client->ping();
     ESP_LOGI(TAG, "Client connected");
   }
-  //else if (type == WS_EVT_DISCONNECT)
+  else if (type == WS_EVT_DISCONNECT)
+  {
+    ESP_LOGD(TAG, "Websocket %u %u disconnect", (unsigned int)millis(), (unsigned int)client->id());
+
+    // Remove acknowledge state of the client
+    Lock();
+    _acks.erase((uint32_t)client->id());
+    Unlock();
+  }
   //else if (type == WS_EVT_ERROR)
   //else if (type == WS_EVT_PONG)
   else if (type == WS_EVT_DATA)
   {
+    Metrics.Add(eMetricWifiMessages);
+    uint32_t startTime_us = micros();
+
     AwsFrameInfo* info = (AwsFrameInfo*)arg;
-    String msg = "";
     if (info->final &&
       info->index == 0 &&
       info->len == len)
     {
+      // Record the message in the replay trace format
+      LogWebsocketMessage(client, info->opcode, data, len);
+
       // The whole message is in a single frame and we got all of it's data
-      if (info->opcode == WS_TEXT)
+      if (info->opcode == WS_BINARY)
       {
-        for (size_t index = 0; index < info->len; index++)
-        {
-          msg += (char)data[index];
-        }
+        // Update last user interaction
+        Systemhelper.SetLastUserAction();
 
+        OnWebsocketFrame(client, data, len);
+      }
+      else if (info->opcode == WS_TEXT)
+      {
         // Update last user interaction
         Systemhelper.SetLastUserAction();
 
-        if (msg.startsWith("FULLUPDATE"))
-        {
-          // Send all static settings to mixer on websocket connect
-          client->text("Valid Fullupdate received!");
-          UpdateSettingsToClient(client);
-          client->ping();
-        }
-        else if (msg.startsWith("LIQUID_INCREMENT:"))
-        {
-          // Split the message by a pre-defined delimiter
-          int delimiter = msg.indexOf(":");
-          int delimiter_1 = msg.indexOf(",", delimiter + 1);
-
-          String liquid_String = msg.substring(delimiter + 1, delimiter_1);
-          String liquidAngle_String = msg.substring(delimiter_1 + 1);
-
-          MixtureLiquid liquid = (MixtureLiquid)liquid_String.toInt();
-          int16_t liquidIncrements_Degrees = (int16_t)liquidAngle_String.toInt();
-
-          if (Statemachine.UpdateValuesFromWifi((uint32_t)client->id(), liquid, liquidIncrements_Degrees))
-          {
-            client->text("Valid liquid increments received!");
-          }
-          else
-          {
-            client->text("Invalid liquid increments received!");
-          }
-        }
-        else if (msg.startsWith("CYCLE_TIMESPAN:"))
-        {
-          String cycleTimespan_String = msg.substring(msg.indexOf(":") + 1);
-          uint32_t cycleTimespan_ms = cycleTimespan_String.toInt();
-
-          if (Statemachine.UpdateValuesFromWifi((uint32_t)client->id(), cycleTimespan_ms))
-          {
-            client->text("Valid cycle timespan received!");
-          }
-          else
-          {
-            client->text("Invalid cycle timespan received!");
-          }
-        }
-        else if (msg.startsWith("SAVE"))
-        {
-          if (Statemachine.UpdateValuesFromWifi((uint32_t)client->id(), true))
-          {
-            client->text("Valid save received!");
-          }
-          else
-          {
-            client->text("Invalid save received!");
-          }
-        }
+        // Text messages are kept as fallback for older clients
+        OnWebsocketText(client, data, len);
       }
     }
+
+    Metrics.Observe(eMetricWifiMessageDuration, micros() - startTime_us);
+  }
+}
+
+//===============================================================
+// Logs a received websocket message as replay trace line (debug
+// builds, see test/ReplayHarness.cpp)
+//===============================================================
+void WifiHandler::LogWebsocketMessage(AsyncWebSocketClient* client, uint8_t opcode, const uint8_t* data, size_t len)
+{
+#if defined(DEBUG_MIXER)
+  if (opcode == WS_TEXT)
+  {
+    ESP_LOGD(TAG, "Websocket %u %u text %.*s", (unsigned int)millis(), (unsigned int)client->id(), (int)len, (const char*)data);
+  }
+  else if (opcode == WS_BINARY)
+  {
+    char hex[2 * WIFI_FRAME_LOG_LENGTH + 1];
+    size_t count = min(len, (size_t)WIFI_FRAME_LOG_LENGTH);
+    for (size_t index = 0; index < count; index++)
+    {
+      snprintf(hex + 2 * index, 3, "%02x", data[index]);
+    }
+    hex[2 * count] = 0;
+    ESP_LOGD(TAG, "Websocket %u %u binary %s", (unsigned int)millis(), (unsigned int)client->id(), hex);
+  }
+#endif
+}
+
+//===============================================================
+// Parses and executes a text websocket message (fallback for older
+// clients) in a fixed buffer: "COMMAND:value,value". Longer messages
+// are truncated, preset names are limited anyway
+//===============================================================
+void WifiHandler::OnWebsocketText(AsyncWebSocketClient* client, const uint8_t* data, size_t len)
+{
+  char msg[WIFI_TEXT_MESSAGE_LENGTH];
+  size_t length = min(len, sizeof(msg) - 1);
+  memcpy(msg, data, length);
+  msg[length] = 0;
+
+  // Values after the first colon and the first comma (missing
+  // values are read as 0 or an empty name)
+  const char* value = strchr(msg, ':');
+  value = value != NULL ? value + 1 : msg + length;
+  const char* comma = strchr(value, ',');
+  const char* name = comma != NULL ? comma + 1 : "";
+  uint32_t clientID = (uint32_t)client->id();
+
+  if (StartsWith(msg, "FULLUPDATE"))
+  {
+    // Send all static settings to mixer on websocket connect
+    client->text("Valid Fullupdate received!");
+    UpdateSettingsToClient(client);
+    Statemachine.UpdatePresetsFromWifi(clientID, eWifiCommandPresetList, 0);
+    client->ping();
+  }
+  else if (StartsWith(msg, "LIQUID_INCREMENT:"))
+  {
+    MixtureLiquid liquid = (MixtureLiquid)atol(value);
+    int16_t liquidIncrements_Degrees = (int16_t)(comma != NULL ? atol(comma + 1) : 0);
+
+    if (Statemachine.UpdateValuesFromWifi(clientID, liquid, liquidIncrements_Degrees))
+    {
+      client->text("Valid liquid increments received!");
+    }
+    else
+    {
+      client->text("Invalid liquid increments received!");
+    }
+  }
+  else if (StartsWith(msg, "CYCLE_TIMESPAN:"))
+  {
+    uint32_t cycleTimespan_ms = (uint32_t)atol(value);
+
+    if (Statemachine.UpdateValuesFromWifi(clientID, cycleTimespan_ms))
+    {
+      client->text("Valid cycle timespan received!");
+    }
+    else
+    {
+      client->text("Invalid cycle timespan received!");
+    }
+  }
+  else if (StartsWith(msg, "PRESET_APPLY:") ||
+    StartsWith(msg, "PRESET_SAVE:") ||
+    StartsWith(msg, "PRESET_DELETE:"))
+  {
+    WifiCommandType type = StartsWith(msg, "PRESET_APPLY:") ? eWifiCommandPresetApply : (StartsWith(msg, "PRESET_SAVE:") ? eWifiCommandPresetSave : eWifiCommandPresetDelete);
+
+    if (Statemachine.UpdatePresetsFromWifi(clientID, type, atol(value), name))
+    {
+      client->text("Valid preset command received!");
+    }
+    else
+    {
+      client->text("Invalid preset command received!");
+    }
+  }
+  else if (StartsWith(msg, "SAVE"))
+  {
+    if (Statemachine.UpdateValuesFromWifi(clientID, true))
+    {
+      client->text("Valid save received!");
+    }
+    else
+    {
+      client->text("Invalid save received!");
+    }
+  }
+}
+
+//===============================================================
+// Returns true, if the text starts with the prefix
+//===============================================================
+bool WifiHandler::StartsWith(const char* text, const char* prefix)
+{
+  return strncmp(text, prefix, strlen(prefix)) == 0;
+}
+
+//===============================================================
+// Parses and executes a binary websocket frame in place (no heap
+// use). Valid frames are not answered to keep the traffic low
+//===============================================================
+void WifiHandler::OnWebsocketFrame(AsyncWebSocketClient* client, const uint8_t* data, size_t len)
+{
+  if (len < WIFI_FRAME_HEADER_LENGTH ||
+    data[0] != WIFI_FRAME_VERSION)
+  {
+    client->text("Invalid frame received!");
+    return;
+  }
+
+  uint8_t opcode = data[1];
+  uint16_t sequence = (uint16_t)(data[2] | (data[3] << 8));
+  const uint8_t* payload = data + WIFI_FRAME_HEADER_LENGTH;
+  size_t payloadLength = len - WIFI_FRAME_HEADER_LENGTH;
+  uint32_t clientID = (uint32_t)client->id();
+
+  bool valid = false;
+  switch (opcode)
+  {
+    case eFrameLiquidIncrement:
+      // Increments are relative, the state machine rebases them onto
+      // the current mixture or drops them as stale (base version)
+      valid = (payloadLength == 3 || payloadLength == 7) &&
+        Statemachine.UpdateValuesFromWifi(clientID, (MixtureLiquid)payload[0], (int16_t)(payload[1] | (payload[2] << 8)), sequence,
+          payloadLength == 7 ? (uint32_t)(payload[3] | (payload[4] << 8) | (payload[5] << 16) | ((uint32_t)payload[6] << 24)) : 0);
+      break;
+    case eFrameCycleTimespan:
+      valid = payloadLength == 2 &&
+        Statemachine.UpdateValuesFromWifi(clientID, (uint32_t)(payload[0] | (payload[1] << 8)));
+      break;
+    case eFrameSave:
+      valid = payloadLength == 0 &&
+        Statemachine.UpdateValuesFromWifi(clientID, true);
+      break;
+    case eFramePresetApply:
+      valid = payloadLength == 1 &&
+        Statemachine.UpdatePresetsFromWifi(clientID, eWifiCommandPresetApply, payload[0]);
+      break;
+    case eFramePresetSave:
+      if (payloadLength >= 1 &&
+        payloadLength <= PRESET_NAME_LENGTH)
+      {
+        char name[PRESET_NAME_LENGTH] = { };
+        memcpy(name, payload + 1, payloadLength - 1);
+        valid = Statemachine.UpdatePresetsFromWifi(clientID, eWifiCommandPresetSave, payload[0], name);
+      }
+      break;
+    case eFramePresetDelete:
+      valid = payloadLength == 1 &&
+        Statemachine.UpdatePresetsFromWifi(clientID, eWifiCommandPresetDelete, payload[0]);
+      break;
+    case eFrameFullUpdate:
+      UpdateSettingsToClient(client);
+      valid = Statemachine.UpdatePresetsFromWifi(clientID, eWifiCommandPresetList, 0);
+      break;
+    default:
+      break;
+  }
+
+  if (!valid)
+  {
+    ESP_LOGE(TAG, "Invalid frame %d (opcode %d) of client %d", sequence, opcode, clientID);
+    client->text("Invalid frame received!");
   }
 }
 
@@ -341,6 +753,7 @@ bool WifiHandler::StartWebServer()
     return false;
   }
 
+#if defined(WIFI_EVENTSOURCE)
   // Create web events
   ESP_LOGI(TAG, "Create web events");
   _webevents = new AsyncEventSource("/events");
@@ -348,19 +761,44 @@ bool WifiHandler::StartWebServer()
   {
     return false;
   }
+#endif
   
-  // Add root URL handler to web server
-  ESP_LOGI(TAG, "Add root URL handler");
-  _webserver->on("/", HTTP_GET, [](AsyncWebServerRequest * request)
-  {
-    request->send(SPIFFS, "/index.html", "text/html");
-  });
-
   // Add system info URL handler to web server
   ESP_LOGI(TAG, "Add system info URL handler");
   _webserver->on("/systeminfo", HTTP_GET, [](AsyncWebServerRequest * request)
   {
-    request->send(200, "text/plain", Systemhelper.GetSystemInfoString());
+    AsyncResponseStream* response = request->beginResponseStream("text/plain");
+    Systemhelper.PrintSystemInfo(*response);
+    request->send(response);
+  });
+
+  // Add metrics URL handler to web server (Prometheus text format)
+  ESP_LOGI(TAG, "Add metrics URL handler");
+  _webserver->on("/metrics", HTTP_GET, [this](AsyncWebServerRequest * request)
+  {
+    // Gauges are sampled at scrape time, the flow meter gauges are
+    // published by the loop task (the handler must not wait for a
+    // flow meter write in progress)
+    Metrics.SetGauge(eMetricWifiClients, _websocket->count());
+    Metrics.SetGauge(eMetricFreeHeap, ESP.getFreeHeap());
+    Metrics.SetGauge(eMetricMinFreeHeap, ESP.getMinFreeHeap());
+    Metrics.SetGauge(eMetricUptime, millis() / 1000);
+
+    AsyncResponseStream* response = request->beginResponseStream("text/plain; version=0.0.4");
+    Metrics.PrintMetrics(*response);
+    request->send(response);
+  });
+
+  // Add pour log URL handler to web server (streamed in chunks)
+  ESP_LOGI(TAG, "Add pour log URL handler");
+  _webserver->on("/pourlog.csv", HTTP_GET, [](AsyncWebServerRequest * request)
+  {
+    std::shared_ptr<PourLogExport> context = std::make_shared<PourLogExport>();
+    PourLog.BeginExport(context.get());
+    request->send(request->beginChunkedResponse("text/csv", [context](uint8_t* buffer, size_t maxLen, size_t index) -> size_t
+    {
+      return PourLog.ReadExport(context.get(), buffer, maxLen);
+    }));
   });
 
   // Add SPIFFS handler to web server
@@ -382,13 +820,18 @@ bool WifiHandler::StartWebServer()
   _websocket->onEvent(onWsEvent);
   _webserver->addHandler(_websocket);
 
+#if defined(WIFI_EVENTSOURCE)
   // Add event handler to web server
   ESP_LOGI(TAG, "Add event handler");
   _webserver->addHandler(_webevents);
+#endif
 
-  // Add static files handler to web server
-  ESP_LOGI(TAG, "Add static files handler");
-  _webserver->serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
+  // Add web asset handler to web server (also serves the root URL).
+  // Gzipped files (e.g. 'index.js.gz') are preferred and sent with gzip
+  // content encoding. Clients revalidate cached files by their ETag
+  // (content hash) and get an empty 304 answer, if nothing changed
+  ESP_LOGI(TAG, "Add web asset handler");
+  _webserver->addHandler(new WebAssetHandler());
   
   // Start web server
   ESP_LOGI(TAG, "Start web server");
@@ -411,16 +854,34 @@ void WifiHandler::UpdateSettingsToClient(AsyncWebSocketClient* client)
     return;
   }
 
-  int16_t angle1 = Statemachine.GetAngle(eLiquid1);
-  int16_t angle2 = Statemachine.GetAngle(eLiquid2);
-  int16_t angle3 = Statemachine.GetAngle(eLiquid3);
+  Lock();
+  uint32_t version = _mixtureVersion;
+  int16_t angles_Degrees[LIQUID_COUNT];
+  memcpy(angles_Degrees, _mixtureAngles_Degrees, sizeof(angles_Degrees));
+  Unlock();
   uint32_t cycleTimepan_ms = Pumps.GetCycleTimespan();
 
+  // Comma separated lists of all liquids
+  char names[LIQUID_COUNT * 32];
+  char colors[LIQUID_COUNT * 12];
+  char angles[LIQUID_COUNT * 8];
+  size_t namesLength = 0;
+  size_t colorsLength = 0;
+  size_t anglesLength = 0;
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    const char* separator = liquid == 0 ? "" : ",";
+    namesLength = min(namesLength + snprintf(names + namesLength, sizeof(names) - namesLength, "%s%s", separator, LiquidNames[liquid]), sizeof(names) - 1);
+    colorsLength += snprintf(colors + colorsLength, sizeof(colors) - colorsLength, "%s%u", separator, (unsigned int)LiquidWifiColors[liquid]);
+    anglesLength += snprintf(angles + anglesLength, sizeof(angles) - anglesLength, "%s%d", separator, angles_Degrees[liquid]);
+  }
+
   client->printf("CLIENT_ID:%s", String(client->id()).c_str());
   client->printf("MIXER_NAME:%s", MIXER_NAME);
-  client->printf("LIQUID_NAMES:%s,%s,%s", LIQUID1_NAME, LIQUID2_NAME, LIQUID3_NAME);
-  client->printf("LIQUID_COLORS:%s,%s,%s", String(WIFI_COLOR_LIQUID_1).c_str(), String(WIFI_COLOR_LIQUID_2).c_str(), String(WIFI_COLOR_LIQUID_3).c_str());
-  client->printf("LIQUID_ANGLES:%s,%s,%s", String(angle1).c_str(), String(angle2).c_str(), String(angle3).c_str());
+  client->printf("LIQUID_NAMES:%s", names);
+  client->printf("LIQUID_COLORS:%s", colors);
+  client->printf("MIXTURE_VERSION:%u", (unsigned int)version);
+  client->printf("LIQUID_ANGLES:%s", angles);
   client->printf("CYCLE_TIMESPAN:%s", String(cycleTimepan_ms).c_str());
 }
 
@@ -13,17 +13,24 @@
 // Includes
 //===============================================================
 #include <Arduino.h>
+#include <atomic>
+#include <map>
 #include <Preferences.h>
-#include <SPIFFS.h>
 #include <WiFi.h>
 #include <ESPmDNS.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
 #include <SPIFFSEditor.h>
+#include "WebAssetHandler.h"
 #include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include "Config.h"
+#include "StorageDriver.h"
 #include "SystemHelper.h"
 #include "StateMachine.h"
+#include "PourLogger.h"
+#include "Metrics.h"
 
 #if defined(WIFI_MIXER)
 //===============================================================
@@ -31,6 +38,41 @@
 //===============================================================
 #define KEY_WIFIMODE      "WifiMode"   // Key name: Maximum string length is 15 bytes, excluding a zero terminator.
 
+#define WIFI_BROADCAST_INTERVAL_MS  100     // Send state updates at most 10 times per second
+#define WIFI_HEARTBEAT_INTERVAL_MS  1000    // Alive signal
+#define WIFI_SYNC_INTERVAL_MS       10000   // Full state resync (e.g. after deferred updates)
+#define WIFI_NO_UPDATE              0xFFFFFFFF
+
+#define WIFI_FRAME_VERSION        1       // Binary websocket frame version
+#define WIFI_FRAME_HEADER_LENGTH  4       // Version, opcode and client sequence (uint16, little endian)
+#define WIFI_FRAME_LOG_LENGTH     32      // Logged bytes of a binary frame (replay trace)
+#define WIFI_TEXT_MESSAGE_LENGTH  48      // Text messages (fallback) including zero terminator, longer ones are truncated
+
+//===============================================================
+// Enums
+//===============================================================
+// Opcodes of binary websocket frames (payload little endian)
+enum WifiFrameOpcode : uint8_t
+{
+  eFrameLiquidIncrement = 1,      // uint8 liquid, int16 increments in degrees, optional uint32 base mixture version (rebased or dropped as stale)
+  eFrameCycleTimespan = 2,        // uint16 cycle timespan in ms
+  eFrameSave = 3,                 // No payload
+  eFramePresetApply = 4,          // uint8 preset index
+  eFramePresetSave = 5,           // uint8 preset index, name (up to 15 bytes, not terminated)
+  eFramePresetDelete = 6,         // uint8 preset index
+  eFrameFullUpdate = 7            // No payload
+};
+
+//===============================================================
+// Structs
+//===============================================================
+// Liquid frame acknowledge of a client
+struct WifiClientAck
+{
+  uint16_t Sequence;      // Last executed liquid frame (0 -> nothing to acknowledge)
+  uint32_t Version;       // Mixture version including the frame
+};
+
 //===============================================================
 // Class for wifi handling
 //===============================================================
@@ -58,11 +100,23 @@ class WifiHandler
     // Returns the amount of connected clients
     uint16_t GetConnectedClients();
 
-    // Updates cycle timespan in connected clients
+    // Requests a cycle timespan update in connected clients (sent by Update)
     void UpdateCycleTimespanToClients(uint32_t clientID);
 
-    // Updates all liquid angles in connected clients
-    void UpdateLiquidAnglesToClients(uint32_t clientID);
+    // Sets the mixture state of the state machine and requests a liquid
+    // angles update in connected clients (sent by Update, main task)
+    void UpdateLiquidAnglesToClients(uint32_t clientID, uint32_t version, const int16_t (&angles_Degrees)[LIQUID_COUNT]);
+
+    // Acknowledges an executed liquid frame of a client with the mixture
+    // version including it (sent with the liquid angles of this version
+    // or newer, main task)
+    void AcknowledgeToClient(uint32_t clientID, uint16_t sequence, uint32_t version);
+
+    // Updates preset names in the given client (client ID = 0 -> all clients)
+    void UpdatePresetsToClients(uint32_t clientID);
+
+    // Updates batch progress in connected clients (only on changes)
+    void UpdateBatchProgressToClients();
 
     // Updates the web server and clients
     void Update();
@@ -86,16 +140,71 @@ class WifiHandler
     // Web server variables
     AsyncWebServer* _webserver;
     AsyncWebSocket* _websocket;
+#if defined(WIFI_EVENTSOURCE)
     AsyncEventSource* _webevents;
+#endif
 
-    // Alive counter variable
+    // Alive and sync counter variables
     uint32_t _lastAlive_ms = 0;
+    uint32_t _lastSync_ms = 0;
+
+    // Pending state updates (client ID of the change, 0 for several
+    // clients or WIFI_NO_UPDATE) and rate limiting
+    std::atomic<uint32_t> _pendingAnglesClientID{WIFI_NO_UPDATE};
+    std::atomic<uint32_t> _pendingCycleTimespanClientID{WIFI_NO_UPDATE};
+    uint32_t _lastBroadcast_ms = 0;
+
+    // Mixture state of the state machine (version and angles) and the
+    // liquid frame acknowledges of the connected clients. Guarded by
+    // the mutex (main task, loop task and async tcp task)
+    SemaphoreHandle_t _mutex = NULL;
+    uint32_t _mixtureVersion = 0;
+    int16_t _mixtureAngles_Degrees[LIQUID_COUNT] = { };
+    std::map<uint32_t, WifiClientAck> _acks;
+
+    // Last sent state values
+    uint32_t _lastMixtureVersion = 0;
+    bool _anglesSent = false;
+    uint32_t _lastCycleTimespan_ms = 0;
+
+    // Last sent batch progress
+    bool _batchProgressSent = false;
+    int16_t _lastBatchGlassesDone = 0;
+    int16_t _lastBatchGlasses = 0;
+    int32_t _lastBatchGlassesPerMinute_Hundredths = 0;
+    BatchPhase _lastBatchPhase = eBatchIdle;
+
+    // Locks and unlocks the shared state (before Begin only the
+    // setup runs, which needs no lock)
+    void Lock();
+    void Unlock();
 
     // Starts the web server
     bool StartWebServer();
 
     // Updates all settings in given client
     void UpdateSettingsToClient(AsyncWebSocketClient* client);
+
+    // Marks a state update as pending, coalesces it with a pending one
+    void RequestUpdate(std::atomic<uint32_t>* pendingClientID, uint32_t clientID);
+
+    // Sends pending state updates (rate limited)
+    void SendPendingUpdates();
+
+    // Sends an event to all clients
+    void SendEvent(const char* event, const char* data);
+
+    // Parses and executes a binary websocket frame in place
+    void OnWebsocketFrame(AsyncWebSocketClient* client, const uint8_t* data, size_t len);
+
+    // Parses and executes a text websocket message (fallback)
+    void OnWebsocketText(AsyncWebSocketClient* client, const uint8_t* data, size_t len);
+
+    // Returns true, if the text starts with the prefix
+    static bool StartsWith(const char* text, const char* prefix);
+
+    // Logs a received websocket message as replay trace line
+    void LogWebsocketMessage(AsyncWebSocketClient* client, uint8_t opcode, const uint8_t* data, size_t len);
 };
 
 //===============================================================
@@ -12,6 +12,25 @@ var websocket = null;
 var clientID = 0;
 var websocketConnected = false;
 var lastAliveTimestamp = new Date(0);
+var frameSequence = 0;
+var eventHandlers = {};
+
+// Versioned mixture state. Own liquid frames are shown at once and kept
+// until the mixer acknowledges them, mixer angles are applied afterwards
+var mixtureVersion = 0;
+var mixtureAngles = null;
+var pendingShifts = [];
+const PENDING_SHIFT_TIMEOUT_MS = 1000;
+
+// Binary websocket frame format (version, opcode, client sequence, payload)
+const FRAME_VERSION = 1;
+const FRAME_HEADER_LENGTH = 4;
+const FRAME_LIQUID_INCREMENT = 1;
+const FRAME_CYCLE_TIMESPAN = 2;
+const FRAME_SAVE = 3;
+const FRAME_PRESET_APPLY = 4;
+const FRAME_PRESET_SAVE = 5;
+const FRAME_PRESET_DELETE = 6;
 
 (function()
 {
@@ -39,6 +58,11 @@ var lastAliveTimestamp = new Date(0);
       adjustButton.onclick = AdjustClick;
     });
     
+    // Initialize preset controls
+    document.getElementById('buttonPresetApply').onclick = OnPresetApply;
+    document.getElementById('buttonPresetSave').onclick = OnPresetSave;
+    document.getElementById('buttonPresetDelete').onclick = OnPresetDelete;
+    
     // Initialize checkbox
     var checkboxExpert = document.getElementById('ExpertSettings');
     checkboxExpert.onclick = OnToggleExpertSettings;
@@ -76,8 +100,8 @@ var lastAliveTimestamp = new Date(0);
     setInterval(CheckAlive, 500);
     
     // Start web socket and web events
+    SetupEvents();
     StartSocket();
-    StartEvents();
   }
 
   // Starts the websocket
@@ -114,6 +138,20 @@ var lastAliveTimestamp = new Date(0);
       console.log("Websocket new message:" + e.data);
       lastAliveTimestamp = Date.now();
       
+      if (e.data.startsWith("EVENT:"))
+      {
+        // Split the message by a pre-defined delimiter and call event handler
+        var delimiter_0 = e.data.indexOf(":");
+        var delimiter_1 = e.data.indexOf(":", delimiter_0 + 1);
+        var handler = eventHandlers[e.data.substring(delimiter_0 + 1, delimiter_1)];
+        
+        if (handler)
+        {
+          handler({ data: e.data.substring(delimiter_1 + 1, e.data.length) });
+        }
+        return;
+      }
+      
       if (e.data.startsWith("CLIENT_ID:"))
       {
         // Split the message by a pre-defined delimiter
@@ -138,6 +176,15 @@ var lastAliveTimestamp = new Date(0);
         
         console.log("Set [CLIENT_ID] = " + value_int);
       }
+      else if (e.data.startsWith("MIXTURE_VERSION:"))
+      {
+        // Full update: mixer angles follow, local frames are dropped
+        mixtureVersion = parseInt(e.data.substring(e.data.indexOf(":") + 1));
+        mixtureAngles = null;
+        pendingShifts = [];
+        
+        console.log("Set [MIXTURE_VERSION] = " + mixtureVersion);
+      }
       else if (e.data.startsWith("MIXER_NAME:"))
       {
         // Split the message by a pre-defined delimiter
@@ -160,14 +207,8 @@ var lastAliveTimestamp = new Date(0);
         e.data.startsWith("LIQUID_COLORS:") ||
         e.data.startsWith("LIQUID_ANGLES:"))
       {
-        // Split the message by a pre-defined delimiter
-        var delimiter_0 = e.data.indexOf(":");
-        var delimiter_1 = e.data.indexOf(",", delimiter_0 + 1);
-        var delimiter_2 = e.data.indexOf(",", delimiter_1 + 1);
-
-        var value1_String = e.data.substring(delimiter_0 + 1, delimiter_1);
-        var value2_String = e.data.substring(delimiter_1 + 1, delimiter_2);
-        var value3_String = e.data.substring(delimiter_2 + 1, e.data.length);
+        // Split the message by a pre-defined delimiter (one value per liquid)
+        var values = e.data.substring(e.data.indexOf(":") + 1, e.data.length).split(",");
         
         if (!doughnutchart)
         {
@@ -177,59 +218,73 @@ var lastAliveTimestamp = new Date(0);
         
         if (e.data.startsWith("LIQUID_NAMES:"))
         {
+          // The names define the liquid count of the mixer
+          SetLiquidCount(values.length);
+          
           // Set new names
-          var names = [ value1_String, value2_String, value3_String ];
-          doughnutchart.Setnames(names);
+          doughnutchart.Setnames(values);
       
-          console.log("Set [LIQUID_NAMES] = " + names);
+          console.log("Set [LIQUID_NAMES] = " + values);
         }
         else if (e.data.startsWith("LIQUID_COLORS:"))
         {
-          var value1_int = parseInt(value1_String);
-          var value2_int = parseInt(value2_String);
-          var value3_int = parseInt(value3_String);
+          var colors_int = values.map(function(value) { return parseInt(value); });
           
-          if (value1_int == NaN || value2_int == NaN || value3_int == NaN)
+          if (colors_int.some(isNaN))
           {
             console.log("Data for liquid colors not matching (NaN is not allowed)");
             return;
           }
           
-          var color1_string = "#" + value1_int.toString(16).padStart(6, "0");
-          var color2_string = "#" + value2_int.toString(16).padStart(6, "0");
-          var color3_string = "#" + value3_int.toString(16).padStart(6, "0");
-          
           // Set new colors
-          var colors = [ color1_string, color2_string, color3_string ];
+          var colors = colors_int.map(function(color) { return "#" + color.toString(16).padStart(6, "0"); });
           doughnutchart.Setcolors(colors);
         
           console.log("Set [LIQUID_COLORS] = " + colors);
         }
         else if (e.data.startsWith("LIQUID_ANGLES:"))
         {
-          var angle1 = parseInt(value1_String);
-          var angle2 = parseInt(value2_String);
-          var angle3 = parseInt(value3_String);
+          var angles = values.map(function(value) { return parseInt(value); });
           
-          if (angle1 == NaN || angle2 == NaN || angle3 == NaN)
+          if (angles.some(isNaN))
           {
             console.log("Data for liquid angles not matching (NaN is not allowed)");
             return;
           }
           
-          if (angle1 < 0 || angle1 > 360 || angle2 < 0 || angle2 > 360 || angle3 < 0 || angle3 > 360)
+          if (angles.some(function(angle) { return angle < 0 || angle > 360; }))
           {
             console.log("Data for liquid angles not matching (must be within 0° and 360°)");
             return;
           }
           
           // Set new angles
-          var angles = [ angle1, angle2, angle3 ];
           doughnutchart.Setangles(angles);
         
           console.log("Set [LIQUID_ANGLES] = " + angles);
         }
       }
+      else if (e.data.startsWith("PRESETS:"))
+      {
+        // Split the message by a pre-defined delimiter
+        var delimiter = e.data.indexOf(":");
+        var names = e.data.substring(delimiter + 1, e.data.length).split(";");
+        
+        // Set new preset names (keep selection if possible)
+        var select = document.getElementById('selectPreset');
+        var selectedIndex = Math.max(select.selectedIndex, 0);
+        select.innerHTML = "";
+        for (var index = 0; index < names.length; index++)
+        {
+          var option = document.createElement("option");
+          option.value = index;
+          option.text = names[index];
+          select.appendChild(option);
+        }
+        select.selectedIndex = Math.min(selectedIndex, names.length - 1);
+        
+        console.log("Set [PRESETS] = " + names);
+      }
       else if (e.data.startsWith("CYCLE_TIMESPAN:"))
       {
         // Split the message by a pre-defined delimiter
@@ -262,96 +317,75 @@ var lastAliveTimestamp = new Date(0);
     };
   }
   
-  // Starts the events
-  function StartEvents()
+  // Sets up the event handlers (events are received as typed websocket
+  // messages 'EVENT:<event>:<data>')
+  function SetupEvents()
   {
-    var events = new EventSource('/events');
-    events.onopen = function(e)
-    {
-      console.log("Events Opened");
-      lastAliveTimestamp = Date.now();
-    };
-    
-    events.onerror = function(e)
-    {
-      if (e.target.readyState !== EventSource.OPEN)
-      {
-        console.log("Events Closed");
-      }
-    };
-    
-    events.onmessage = function(e)
-    {
-      console.log("Event: " + e.data);
-      lastAliveTimestamp = Date.now();
-    };
-    
-    events.addEventListener('ALIVE', function(e)
+    eventHandlers['ALIVE'] = function(e)
     {
       lastAliveTimestamp = Date.now();
       console.log("Set [ALIVE] = true");
       
-    }, false);
+    };
     
-    events.addEventListener('LIQUID_ANGLES', function(e)
+    eventHandlers['LIQUID_ANGLES'] = function(e)
     {
       console.log("Event[LIQUID_ANGLES]:" + e.data);
       lastAliveTimestamp = Date.now();
       
-      // Split the message by a pre-defined delimiter
-      var delimiter = e.data.indexOf(":");
-      var clientID_String = e.data.substring(0, delimiter);
-      var angles_String = e.data.substring(delimiter + 1, e.data.length);
-      
-      var clientID_int = parseInt(clientID_String);
+      // Split the message (version:angle1,angle2,angle3:clientID=sequence;...)
+      const parts = e.data.split(":", 3);
+      var version_int = parseInt(parts[0]);
+      var angles_String = parts.length > 1 ? parts[1] : "";
+      var acks_String = parts.length > 2 ? parts[2] : "";
       
-      if (clientID_int == NaN)
+      if (isNaN(version_int))
       {
-        console.log("Data for client ID not matching (NaN is not allowed)");
+        console.log("Data for mixture version not matching (NaN is not allowed)");
         return;
       }
       
       // Split angle data
-      const angles = angles_String.split(",", 3);
+      const angles = angles_String.split(",").map(function(value) { return parseInt(value); });
       
       // Check for correct length
-      if (angles.length !== 3)
+      if (!doughnutchart ||
+        angles.length !== doughnutchart.data.length)
       {
-        console.log("Data length for liquid angles not matching (must be 3)");
+        console.log("Data length for liquid angles not matching (must be " + (doughnutchart ? doughnutchart.data.length : 0) + ")");
         return;
       }
       
-      // Get liquid angle values
-      var angle1_int = parseInt(angles[0]);
-      var angle2_int = parseInt(angles[1]);
-      var angle3_int = parseInt(angles[2]);
-      
-      if (angle1_int < 0 || angle1_int > 360 || angle2_int < 0 || angle2_int > 360 || angle3_int < 0 || angle3_int > 360)
+      if (angles.some(function(angle) { return isNaN(angle) || angle < 0 || angle > 360; }))
       {
         console.log("Data for liquid angles not matching (must be within 0° and 360°)");
         return;
       }
       
-      // Check for own client ID
-      if (clientID_int == clientID)
+      // Drop own frames acknowledged by the mixer
+      acks_String.split(";").forEach(function(ack)
       {
-        console.log("NOT Set [LIQUID_ANGLES] = " + angle1_int + "," + angle2_int + "," + angle3_int + " (Own Client ID)");
-        return;
-      }
+        const values = ack.split("=", 2);
+        if (values.length == 2 &&
+          parseInt(values[0]) == clientID)
+        {
+          AcknowledgeShifts(parseInt(values[1]));
+        }
+      });
       
-      if (!doughnutchart)
+      // Older states are ignored
+      if (version_int < mixtureVersion)
       {
-        console.log("Doughnutchart is null");
+        console.log("NOT Set [LIQUID_ANGLES] = " + angles + " (Version " + version_int + " < " + mixtureVersion + ")");
         return;
       }
+      mixtureVersion = version_int;
+      mixtureAngles = angles;
       
-      doughnutchart.Setangles([angle1_int, angle2_int, angle3_int]);
-      
-      console.log("Set [LIQUID_ANGLES] = " + angle1_int + "," + angle2_int + "," + angle3_int);
-      
-    }, false);
+      ApplyMixtureAngles();
+    };
     
-    events.addEventListener('CYCLE_TIMESPAN', function(e)
+    eventHandlers['CYCLE_TIMESPAN'] = function(e)
     {
       console.log("Event[CYCLE_TIMESPAN]:" + e.data);
       lastAliveTimestamp = Date.now();
@@ -393,7 +427,32 @@ var lastAliveTimestamp = new Date(0);
       
       console.log("Set [CYCLE_TIMESPAN] = " + cycletimespan_int + "ms");
     
-    }, false);
+    };
+    
+    eventHandlers['BATCH_PROGRESS'] = function(e)
+    {
+      console.log("Event[BATCH_PROGRESS]:" + e.data);
+      lastAliveTimestamp = Date.now();
+      
+      // Split batch data (glasses done, glass count, glasses per minute, phase)
+      const progress = e.data.split(",", 4);
+      
+      // Check for correct length
+      if (progress.length !== 4)
+      {
+        console.log("Data length for batch progress not matching (must be 4)");
+        return;
+      }
+      
+      const phases = ["Ready", "Pouring", "Swap glass", "Finished", "Aborted"];
+      var phase_int = parseInt(progress[3]);
+      var output = document.getElementById('batchProgress');
+      
+      output.innerHTML = "Batch: " + progress[0] + " / " + progress[1] + " glasses, " + progress[2] + " glasses/min (" + (phases[phase_int] || "") + ")";
+      
+      console.log("Set [BATCH_PROGRESS] = " + e.data);
+      
+    };
   }
   
   // Function checks every 500ms if the communication is online. Timeout is 1.5s
@@ -403,6 +462,83 @@ var lastAliveTimestamp = new Date(0);
     {
       doughnutchart.Setonline(Date.now() - lastAliveTimestamp < 1500);
     }
+    
+    // Frames without acknowledge were lost (e.g. full command queue)
+    if (pendingShifts.length > 0)
+    {
+      ApplyMixtureAngles();
+    }
+  }
+  
+  // Drops own frames up to the acknowledged sequence (wraps at 16 bit)
+  function AcknowledgeShifts(sequence)
+  {
+    pendingShifts = pendingShifts.filter(function(shift)
+    {
+      return ((sequence - shift.sequence) & 0xFFFF) >= 0x8000;
+    });
+  }
+  
+  // Sets the mixer angles, if no own frames are pending. Pending frames
+  // are already shown and will be included in the next mixer angles
+  function ApplyMixtureAngles()
+  {
+    pendingShifts = pendingShifts.filter(function(shift)
+    {
+      return Date.now() - shift.timestamp < PENDING_SHIFT_TIMEOUT_MS;
+    });
+    
+    if (pendingShifts.length > 0 ||
+      !mixtureAngles ||
+      !doughnutchart)
+    {
+      return;
+    }
+    
+    doughnutchart.Setangles(mixtureAngles);
+    mixtureAngles = null;
+    
+    console.log("Set [LIQUID_ANGLES] = " + doughnutchart.data.map(function(segment) { return segment.angle; }) + " (Version " + mixtureVersion + ")");
+  }
+  
+  // Sets the liquid count of the mixer. The doughnut chart and the
+  // proportions table are built again, if the count has changed
+  function SetLiquidCount(count)
+  {
+    if (count < 1 ||
+      doughnutchart.data.length === count)
+    {
+      return;
+    }
+    
+    // Equal parts until the mixer angles are received
+    var data = [];
+    for (var index = 0; index < count; index++)
+    {
+      data.push({ label: '', color: "#969696", angle: Math.round(index * 360 / count) });
+    }
+    doughnutchart.data = data;
+    
+    // One column per liquid
+    var table = document.getElementById('proportions-table');
+    var headerRow = table.rows[0];
+    var valueRow = table.rows[1];
+    headerRow.innerHTML = "";
+    valueRow.innerHTML = "";
+    for (var index = 0; index < count; index++)
+    {
+      headerRow.insertAdjacentHTML('beforeend', '<th id="labelLiquid' + index + '" class="bordered-cell">Liquid ' + (index + 1) + '</th>');
+      valueRow.insertAdjacentHTML('beforeend', '<td class="bordered-cell">' +
+        '<div class="adjust-button" data-i="' + index + '" data-d="1">&#8722;</div>' +
+        '<var id="varLiquid' + index + '">0%</var>' +
+        '<div class="adjust-button" data-i="' + index + '" data-d="-1">&#43;</div></td>');
+    }
+    [].forEach.call(valueRow.getElementsByClassName('adjust-button'), function (adjustButton)
+    {
+      adjustButton.onclick = AdjustClick;
+    });
+    
+    console.log("Set liquid count = " + count);
   }
   
   // Will be called if a value of the doughnutchart has changed
@@ -430,23 +566,71 @@ var lastAliveTimestamp = new Date(0);
   // Will be called if an angle of the doughnutchart has shifted. increments is signed and in degrees
   function OnDoughnutChartShift(index, increments)
   {
-    // Build websocket message
-    var websocketMessage = "LIQUID_INCREMENT:" + index + "," + increments.toFixed(0);
+    // Build websocket frame against the last known mixture version
+    var frame = BuildFrame(FRAME_LIQUID_INCREMENT, 7);
+    frame.setUint8(FRAME_HEADER_LENGTH, index);
+    frame.setInt16(FRAME_HEADER_LENGTH + 1, Math.round(increments), true);
+    frame.setUint32(FRAME_HEADER_LENGTH + 3, mixtureVersion, true);
+    
+    // Keep frame until it is acknowledged
+    pendingShifts.push({ sequence: frameSequence, timestamp: Date.now() });
   
     // Send websocket
-    if (websocketConnected)
+    SendFrame(frame, "LIQUID_INCREMENT:" + index + "," + increments.toFixed(0));
+  }
+
+  // Will be called if the apply preset button is clicked
+  function OnPresetApply()
+  {
+    var select = document.getElementById('selectPreset');
+    if (select.selectedIndex >= 0)
     {
-      websocket.send(websocketMessage);
-      console.log("Websocket send:" + websocketMessage + " -> success");
+      SendPresetFrame(FRAME_PRESET_APPLY, select.selectedIndex, "");
     }
-    else
+  }
+  
+  // Will be called if the save preset button is clicked. Saves the current
+  // mixture as preset with the given name (existing name -> overwrite)
+  function OnPresetSave()
+  {
+    var select = document.getElementById('selectPreset');
+    var name = document.getElementById('inputPresetName').value.replace(/[;,]/g, " ").trim();
+    if (name.length == 0)
     {
-      console.log("Websocket send:" + websocketMessage + " -> no websocket..");
-      if (confirm("The control is not connected. Reload page?"))
+      return;
+    }
+    
+    var index = select.options.length;
+    for (var option = 0; option < select.options.length; option++)
+    {
+      if (select.options[option].text == name)
       {
-        window.location.reload();
+        index = option;
       }
     }
+    SendPresetFrame(FRAME_PRESET_SAVE, index, name);
+  }
+  
+  // Will be called if the delete preset button is clicked
+  function OnPresetDelete()
+  {
+    var select = document.getElementById('selectPreset');
+    if (select.selectedIndex >= 0 &&
+      confirm("Delete recipe '" + select.options[select.selectedIndex].text + "'?"))
+    {
+      SendPresetFrame(FRAME_PRESET_DELETE, select.selectedIndex, "");
+    }
+  }
+  
+  // Sends a preset frame (name is only used for saving, max 15 bytes)
+  function SendPresetFrame(opcode, index, name)
+  {
+    var nameBytes = new TextEncoder().encode(name).slice(0, 15);
+    var frame = BuildFrame(opcode, 1 + nameBytes.length);
+    frame.setUint8(FRAME_HEADER_LENGTH, index);
+    new Uint8Array(frame.buffer).set(nameBytes, FRAME_HEADER_LENGTH + 1);
+    
+    SendFrame(frame, "PRESET:" + opcode + "," + index + "," + name);
   }
 
   // Toggle visibillity on checked changed
@@ -481,36 +665,42 @@ var lastAliveTimestamp = new Date(0);
     
     output.innerHTML = slider.value + "ms";
     
-    // Build websocket message
-    var websocketMessage = "CYCLE_TIMESPAN:" + slider.value;
+    // Build websocket frame
+    var frame = BuildFrame(FRAME_CYCLE_TIMESPAN, 2);
+    frame.setUint16(FRAME_HEADER_LENGTH, parseInt(slider.value), true);
     
     // Send websocket
-    if (websocketConnected)
-    {
-      websocket.send(websocketMessage);
-      console.log("Websocket send:" + websocketMessage + "ms -> success");
-    }
-    else
-    {
-      console.log("Websocket send:" + websocketMessage + "ms -> no websocket..");
-      if (confirm("The control is not connected. Reload page?"))
-      {
-        window.location.reload();
-      }
-    }
+    SendFrame(frame, "CYCLE_TIMESPAN:" + slider.value + "ms");
   }
 
   // Will be called if new slider value is changed
   function OnChangeCycleTimespan()
+  {
+    SendFrame(BuildFrame(FRAME_SAVE, 0), "SAVE");
+  }
+  
+  // Builds a binary websocket frame with header and empty payload
+  function BuildFrame(opcode, payloadLength)
+  {
+    var frame = new DataView(new ArrayBuffer(FRAME_HEADER_LENGTH + payloadLength));
+    frameSequence = (frameSequence % 0xFFFF) + 1;   // 0 is never acknowledged
+    frame.setUint8(0, FRAME_VERSION);
+    frame.setUint8(1, opcode);
+    frame.setUint16(2, frameSequence, true);
+    return frame;
+  }
+  
+  // Sends a binary websocket frame (description for log only)
+  function SendFrame(frame, description)
   {
     if (websocketConnected)
     {
-      websocket.send("SAVE");
-      console.log("Websocket send:SAVE");
+      websocket.send(frame.buffer);
+      console.log("Websocket send:" + description + " -> success");
     }
     else
     {
-      console.log("SAVE: no websocket..");
+      console.log("Websocket send:" + description + " -> no websocket..");
       if (confirm("The control is not connected. Reload page?"))
       {
         window.location.reload();
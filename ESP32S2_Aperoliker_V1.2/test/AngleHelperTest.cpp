@@ -0,0 +1,186 @@
+/**
+ * Host tests for the angle functions. All angle pairs are checked
+ * against the degree by degree reference implementation
+ *
+ * Benchmark: closed form against stepping increment (host time)
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <chrono>
+#include "TestHelper.h"
+#include "AngleHelper.h"
+
+//===============================================================
+// Compile time checks of the closed form functions
+//===============================================================
+static_assert(Move360(350, 20) == 10, "Clockwise overflow");
+static_assert(Move360(10, -20) == 350, "Counter clockwise overflow");
+static_assert(Move360(0, 720) == 0, "Multiple turns");
+static_assert(GetDistanceDegrees(350, 10) == 20, "Distance over 0°");
+static_assert(GetDistanceDegrees(10, 350) == 340, "Distance without overflow");
+static_assert(GetDistanceDegrees(42, 42) == 0, "Same angle");
+static_assert(LimitAngleDistance(100, 120, 0, 30) == 14, "Limited by the next border");
+static_assert(LimitAngleDistance(100, 120, 0, -100) == -94, "Limited by the previous border");
+
+//===============================================================
+// Reference implementation, moves the value degree by degree (as
+// the firmware did before the closed form functions)
+//===============================================================
+static void ReferenceIncrementAngle(int16_t* value, int16_t nextBorder, int16_t previousBorder, int16_t angleDistance_Degrees)
+{
+  bool clockwise = angleDistance_Degrees > 0;
+
+  for (uint16_t index = 0; index < abs(angleDistance_Degrees); index++)
+  {
+    int16_t newValue = (int16_t)((*value + (clockwise ? 1 : 359)) % 360);
+    int16_t distanceToNextBorder_Degrees = (int16_t)(((clockwise ? nextBorder : previousBorder) - newValue + 360) % 360);
+    distanceToNextBorder_Degrees = clockwise ? distanceToNextBorder_Degrees : 360 - distanceToNextBorder_Degrees;
+
+    if (distanceToNextBorder_Degrees >= MINANGLE_DEGREES)
+    {
+      *value = newValue;
+    }
+    else
+    {
+      break;
+    }
+  }
+}
+
+//===============================================================
+// Move360 and GetDistanceDegrees for all angles and distances
+// (counted degree by degree)
+//===============================================================
+static void TestMoveAndDistance()
+{
+  for (int16_t value = 0; value < 360; value++)
+  {
+    int16_t expected = value;
+    for (int16_t distance = 0; distance < 360; distance++)
+    {
+      CHECK_EQUAL(expected, Move360(value, distance));
+      CHECK_EQUAL(expected, Move360(value, distance - 360));
+      CHECK_EQUAL(distance, GetDistanceDegrees(value, expected));
+      expected = expected == 359 ? 0 : expected + 1;
+    }
+  }
+}
+
+//===============================================================
+// The closed form increment matches the stepping implementation
+// for all pairs of value and border and all distances up to one
+// turn in both directions. Clockwise increments only depend on
+// the next border, counter clockwise ones on the previous border.
+// The stepping implementation with one more degree continues
+// from the result of the shorter distance (it stops at the
+// border for good)
+//===============================================================
+static void TestIncrementMatchesStepping()
+{
+  int mismatches = 0;
+
+  for (int16_t value = 0; value < 360; value++)
+  {
+    for (int16_t border = 0; border < 360; border++)
+    {
+      for (int16_t direction : { 1, -1 })
+      {
+        int16_t expected = value;
+        for (int16_t distance_Degrees = 1; distance_Degrees <= 360; distance_Degrees++)
+        {
+          ReferenceIncrementAngle(&expected, border, border, direction);
+          int16_t actual = value;
+          IncrementAngle(&actual, border, border, direction * distance_Degrees);
+          if (expected != actual && mismatches++ < 10)
+          {
+            fprintf(stderr, "IncrementAngle(%d, border %d, %d): %d != %d\n", value, border, direction * distance_Degrees, expected, actual);
+          }
+        }
+      }
+    }
+  }
+
+  CHECK_EQUAL(0, mismatches);
+}
+
+//===============================================================
+// Increments stop at the minimum angle to the borders
+//===============================================================
+static void TestIncrementLimits()
+{
+  int16_t value = 100;
+  IncrementAngle(&value, 120, 0, 3);
+  CHECK_EQUAL(103, value);
+  IncrementAngle(&value, 120, 0, 30);
+  CHECK_EQUAL(114, value);
+  IncrementAngle(&value, 120, 0, 3);
+  CHECK_EQUAL(114, value);
+  IncrementAngle(&value, 120, 0, -200);
+  CHECK_EQUAL(6, value);
+
+  // Over 0°
+  value = 3;
+  IncrementAngle(&value, 120, 300, -10);
+  CHECK_EQUAL(353, value);
+  IncrementAngle(&value, 120, 300, -100);
+  CHECK_EQUAL(306, value);
+
+  // No movement
+  value = 50;
+  IncrementAngle(&value, 120, 0, 0);
+  CHECK_EQUAL(50, value);
+}
+
+//===============================================================
+// Returns the mean duration of an increment over all pairs of
+// value and border in both directions (host time)
+//===============================================================
+static double BenchmarkIncrement(void (*increment)(int16_t*, int16_t, int16_t, int16_t), int16_t distance_Degrees)
+{
+  volatile int32_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int16_t value = 0; value < 360; value++)
+  {
+    for (int16_t border = 0; border < 360; border++)
+    {
+      int16_t clockwise = value;
+      int16_t counterClockwise = value;
+      increment(&clockwise, border, border, distance_Degrees);
+      increment(&counterClockwise, border, border, -distance_Degrees);
+      sum = sum + clockwise + counterClockwise;
+    }
+  }
+  std::chrono::duration<double, std::nano> duration = std::chrono::steady_clock::now() - start;
+  return duration.count() / (360 * 360 * 2);
+}
+
+//===============================================================
+// Prints the increment durations of an encoder step and of half
+// a turn (wifi frames move further)
+//===============================================================
+static void BenchmarkIncrements()
+{
+  for (int16_t distance_Degrees : { (int16_t)STEPANGLE_DEGREES, (int16_t)180 })
+  {
+    printf("IncrementAngle by %3d degrees: %.1f ns closed form, %.1f ns stepping (host)\n", distance_Degrees,
+      BenchmarkIncrement(IncrementAngle, distance_Degrees), BenchmarkIncrement(ReferenceIncrementAngle, distance_Degrees));
+  }
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  TestMoveAndDistance();
+  TestIncrementMatchesStepping();
+  TestIncrementLimits();
+  BenchmarkIncrements();
+  return TestResult("AngleHelperTest");
+}
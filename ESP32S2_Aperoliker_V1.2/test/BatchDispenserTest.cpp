@@ -0,0 +1,137 @@
+/**
+ * Host tests for the batch dispenser
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include "TestHelper.h"
+#include "BatchDispenser.h"
+
+//===============================================================
+// Constants
+//===============================================================
+static const double FlowRate_LPerMs = 0.00000416667 * 2;   // Two pumps at 100% duty (500 ml/min)
+
+//===============================================================
+// Settings are limited and locked while running
+//===============================================================
+static void TestSettings()
+{
+  BatchDispenser batch;
+  CHECK_EQUAL(DEFAULT_BATCH_GLASSES, batch.GetGlasses());
+  CHECK(!batch.SetGlasses(MIN_BATCH_GLASSES - 1));
+  CHECK(!batch.SetGlasses(MAX_BATCH_GLASSES + 1));
+  CHECK(batch.SetGlasses(2));
+  CHECK(!batch.SetVolume(MIN_BATCH_VOLUME_ML - 1));
+  CHECK(batch.SetVolume(100));
+  CHECK(!batch.SetPause(MAX_BATCH_PAUSE_MS + 1));
+  CHECK(batch.SetPause(MIN_BATCH_PAUSE_MS));
+
+  batch.Start(0);
+  CHECK(batch.IsRunning());
+  CHECK(!batch.SetGlasses(3));
+  CHECK(!batch.SetVolume(200));
+  CHECK_EQUAL(2, batch.GetGlasses());
+  CHECK_EQUAL(100, batch.GetVolume());
+}
+
+//===============================================================
+// Volume is integrated from the pour time and the flow rate, pours
+// alternate with pauses until all glasses are done
+//===============================================================
+static void TestPourAndPause()
+{
+  BatchDispenser batch;
+  batch.SetGlasses(2);
+  batch.SetVolume(100);
+  batch.SetPause(2000);
+
+  // 100 ml at 500 ml/min take 12 s (updated every 5 ms like the main task)
+  batch.Start(1000);
+  uint32_t time_ms = 1000;
+  BatchAction action = eBatchActionNone;
+  while (action == eBatchActionNone && time_ms < 100000)
+  {
+    time_ms += 5;
+    action = batch.Update(time_ms, FlowRate_LPerMs);
+  }
+  CHECK_EQUAL(eBatchActionStopPour, action);
+  CHECK_NEAR(13000, time_ms, 5);
+  CHECK_EQUAL(1, batch.GetGlassesDone());
+  CHECK_EQUAL(eBatchPause, batch.GetPhase());
+  CHECK_NEAR(0.0, batch.GetPouredVolume(), 0.001);
+
+  // Pause does not pour, even if a flow rate is passed
+  CHECK_EQUAL(eBatchActionNone, batch.Update(time_ms + 1999, FlowRate_LPerMs));
+  CHECK_EQUAL(eBatchActionStartPour, batch.Update(time_ms + 2000, FlowRate_LPerMs));
+  CHECK_NEAR(0.0, batch.GetPouredVolume(), 0.001);
+
+  // Half of the second glass
+  time_ms += 2000;
+  CHECK_EQUAL(eBatchActionNone, batch.Update(time_ms + 6000, FlowRate_LPerMs));
+  CHECK_NEAR(50.0, batch.GetPouredVolume(), 0.1);
+
+  // Second glass finishes the batch
+  CHECK_EQUAL(eBatchActionFinish, batch.Update(time_ms + 12000, FlowRate_LPerMs));
+  CHECK_EQUAL(eBatchFinished, batch.GetPhase());
+  CHECK(!batch.IsRunning());
+  CHECK_EQUAL(2, batch.GetGlassesDone());
+
+  // Two glasses in 12 + 2 + 12 s
+  CHECK_NEAR(2.0 * 60.0 / 26.0, batch.GetGlassesPerMinute(), 0.01);
+  CHECK_EQUAL(eBatchActionNone, batch.Update(time_ms + 20000, FlowRate_LPerMs));
+}
+
+//===============================================================
+// A pump at 100% duty (no falling edges) is counted as well, the
+// flow rate may change while pouring (e.g. mixture from wifi)
+//===============================================================
+static void TestChangingFlowRate()
+{
+  BatchDispenser batch;
+  batch.SetGlasses(1);
+  batch.SetVolume(20);
+
+  batch.Start(0);
+  CHECK_EQUAL(eBatchActionNone, batch.Update(2000, FlowRate_LPerMs / 2));
+  CHECK_NEAR(8.33, batch.GetPouredVolume(), 0.01);
+  CHECK_EQUAL(eBatchActionNone, batch.Update(2000, 0.0));
+  CHECK_EQUAL(eBatchActionNone, batch.Update(4000, 0.0));
+  CHECK_NEAR(8.33, batch.GetPouredVolume(), 0.01);
+  CHECK_EQUAL(eBatchActionFinish, batch.Update(6800, FlowRate_LPerMs));
+}
+
+//===============================================================
+// Abort stops a running batch only
+//===============================================================
+static void TestAbort()
+{
+  BatchDispenser batch;
+  batch.Abort();
+  CHECK_EQUAL(eBatchIdle, batch.GetPhase());
+
+  batch.Start(0);
+  batch.Abort();
+  CHECK_EQUAL(eBatchAborted, batch.GetPhase());
+  CHECK(!batch.IsRunning());
+  CHECK_EQUAL(eBatchActionNone, batch.Update(100000, FlowRate_LPerMs));
+  CHECK_EQUAL(0, batch.GetGlassesDone());
+  CHECK_NEAR(0.0, batch.GetGlassesPerMinute(), 0.001);
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  TestSettings();
+  TestPourAndPause();
+  TestChangingFlowRate();
+  TestAbort();
+  return TestResult("BatchDispenserTest");
+}
@@ -0,0 +1,139 @@
+/**
+ * Host tests for the lock-free command queue
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <thread>
+#include <vector>
+#include "TestHelper.h"
+#include "CommandQueue.h"
+
+//===============================================================
+// Structs
+//===============================================================
+struct TestCommand
+{
+  uint32_t Producer;
+  uint32_t Sequence;
+};
+
+//===============================================================
+// Commands are taken in order, a full queue rejects commands
+//===============================================================
+static void TestSingleProducer()
+{
+  CommandQueue<TestCommand, 8> queue;
+  TestCommand command;
+  CHECK(!queue.Pop(&command));
+
+  // Several rounds for the sequence wrap of the slots
+  for (uint32_t round = 0; round < 5; round++)
+  {
+    for (uint32_t index = 0; index < 8; index++)
+    {
+      CHECK(queue.Push({ round, index }));
+    }
+    CHECK(!queue.Push({ round, 8 }));
+
+    for (uint32_t index = 0; index < 8; index++)
+    {
+      CHECK(queue.Pop(&command));
+      CHECK_EQUAL(round, command.Producer);
+      CHECK_EQUAL(index, command.Sequence);
+    }
+    CHECK(!queue.Pop(&command));
+  }
+
+  // Interleaved push and pop
+  for (uint32_t index = 0; index < 100; index++)
+  {
+    CHECK(queue.Push({ 0, index }));
+    CHECK(queue.Push({ 1, index }));
+    CHECK(queue.Pop(&command));
+    CHECK(queue.Pop(&command));
+    CHECK_EQUAL(1, command.Producer);
+    CHECK_EQUAL(index, command.Sequence);
+  }
+}
+
+//===============================================================
+// Several producer threads and one consumer thread. Every command
+// arrives once and the commands of a producer keep their order
+//===============================================================
+static void TestMultipleProducers()
+{
+  const uint32_t ProducerCount = 4;
+  const uint32_t CommandCount = 50000;
+
+  static CommandQueue<TestCommand, 32> queue;
+  std::vector<std::thread> producers;
+  std::atomic<uint32_t> rejected{0};
+
+  for (uint32_t producer = 0; producer < ProducerCount; producer++)
+  {
+    producers.emplace_back([producer, &rejected]()
+    {
+      for (uint32_t sequence = 0; sequence < CommandCount; sequence++)
+      {
+        // Retry on a full queue
+        while (!queue.Push({ producer, sequence }))
+        {
+          rejected++;
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  uint32_t nextSequences[ProducerCount] = { };
+  uint32_t outOfOrder = 0;
+  uint32_t received = 0;
+  TestCommand command;
+  while (received < ProducerCount * CommandCount)
+  {
+    if (!queue.Pop(&command))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    if (command.Producer >= ProducerCount ||
+      command.Sequence != nextSequences[command.Producer])
+    {
+      outOfOrder++;
+    }
+    else
+    {
+      nextSequences[command.Producer]++;
+    }
+    received++;
+  }
+
+  for (std::thread& producer : producers)
+  {
+    producer.join();
+  }
+
+  CHECK_EQUAL(0, outOfOrder);
+  for (uint32_t producer = 0; producer < ProducerCount; producer++)
+  {
+    CHECK_EQUAL(CommandCount, nextSequences[producer]);
+  }
+  CHECK(!queue.Pop(&command));
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  TestSingleProducer();
+  TestMultipleProducers();
+  return TestResult("CommandQueueTest");
+}
@@ -0,0 +1,301 @@
+/**
+ * Host tests for the encoder and button driver
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <atomic>
+#include <stdlib.h>
+#include <thread>
+#include "TestHelper.h"
+#include "EncoderButtonDriver.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#define PIN_A         1
+#define PIN_B         2
+#define PIN_BUTTON    3
+
+//===============================================================
+// Compile time checks of the acceleration
+//===============================================================
+static_assert(AccelerateEncoderIncrements(1, 1000) == 1, "Slow turning is not accelerated");
+static_assert(AccelerateEncoderIncrements(-1, 100) == -1, "Minimum rate is not accelerated");
+static_assert(AccelerateEncoderIncrements(4, 100) == 4 * ENCODER_ACCEL_MAX_FACTOR, "Maximum rate");
+static_assert(AccelerateEncoderIncrements(-10, 10) == -10 * ENCODER_ACCEL_MAX_FACTOR, "Maximum factor is not exceeded");
+static_assert(AccelerateEncoderIncrements(3, 0) == 3 * ENCODER_ACCEL_MAX_FACTOR, "Elapsed time of 0ms");
+static_assert(AccelerateEncoderIncrements(0, 5) == 0, "No detents");
+
+//===============================================================
+// Global variables
+//===============================================================
+static int detentDirectionSum = 0;
+static int detentCount = 0;
+static std::atomic<int> concurrentDetents{0};
+
+//===============================================================
+// Detent callback, wakes a task on every second detent
+//===============================================================
+static bool OnDetent(int8_t direction)
+{
+  detentDirectionSum += direction;
+  detentCount++;
+  return (detentCount % 2) == 0;
+}
+
+//===============================================================
+// Detent callback of the concurrent test (interrupt thread)
+//===============================================================
+static bool OnConcurrentDetent(int8_t direction)
+{
+  concurrentDetents++;
+  return false;
+}
+
+//===============================================================
+// Presses the button (interrupt on both edges)
+//===============================================================
+static void Press(EncoderButtonDriver& button, uint32_t duration_ms, bool release = true)
+{
+  HostSetPinLevel(PIN_BUTTON, LOW);
+  button.ButtonEvent();
+  HostAdvanceMillis(duration_ms);
+  if (release)
+  {
+    HostSetPinLevel(PIN_BUTTON, HIGH);
+    button.ButtonEvent();
+  }
+}
+
+//===============================================================
+// The acceleration factor grows monotonic with the rate and keeps
+// the direction
+//===============================================================
+static void TestAcceleration()
+{
+  int16_t lastIncrements = 0;
+  for (uint32_t elapsed_ms = 2000; elapsed_ms > 0; elapsed_ms--)
+  {
+    int16_t increments = AccelerateEncoderIncrements(2, elapsed_ms);
+    CHECK(increments >= lastIncrements);
+    CHECK(increments >= 2 && increments <= 2 * ENCODER_ACCEL_MAX_FACTOR);
+    CHECK_EQUAL(-increments, AccelerateEncoderIncrements(-2, elapsed_ms));
+    lastIncrements = increments;
+  }
+
+  // Rate between minimum and maximum (25 detents/s)
+  CHECK_EQUAL(5 * (1 + (25 - ENCODER_ACCEL_MIN_RATE) * (ENCODER_ACCEL_MAX_FACTOR - 1) / (ENCODER_ACCEL_MAX_RATE - ENCODER_ACCEL_MIN_RATE)),
+    AccelerateEncoderIncrements(5, 200));
+}
+
+//===============================================================
+// Detents from the pulse counter, partial detents are kept
+//===============================================================
+static void TestIncrements()
+{
+  EncoderButtonDriver encoder;
+  HostSetMicros(10000000);
+  encoder.Begin(PIN_A, PIN_B, PIN_BUTTON, OnDetent);
+  CHECK_EQUAL(INPUT_PULLUP, HostGetPinMode(PIN_BUTTON));
+
+  // One detent, the callback reports the woken flag
+  CHECK_EQUAL(0, HostPulseCounterCount(ENCODER_COUNTS_PER_DETENT));
+  CHECK_EQUAL(1, detentCount);
+  CHECK_EQUAL(ENCODER_DIRECTION, detentDirectionSum);
+  CHECK_EQUAL(ENCODER_DIRECTION, encoder.GetEncoderIncrements());
+  CHECK_EQUAL(0, encoder.GetEncoderIncrements());
+
+  // Partial detent is kept for the next query
+  HostPulseCounterCount(ENCODER_COUNTS_PER_DETENT / 2);
+  CHECK_EQUAL(0, encoder.GetEncoderIncrements());
+  HostPulseCounterCount(ENCODER_COUNTS_PER_DETENT / 2);
+  CHECK_EQUAL(ENCODER_DIRECTION, encoder.GetEncoderIncrements());
+
+  // Turning back
+  CHECK_EQUAL(1, HostPulseCounterCount(-3 * ENCODER_COUNTS_PER_DETENT));
+  CHECK_EQUAL(-3 * ENCODER_DIRECTION, encoder.GetEncoderIncrements());
+
+  // Slow turning is not accelerated, fast turning is
+  HostAdvanceMillis(1000);
+  HostPulseCounterCount(ENCODER_COUNTS_PER_DETENT);
+  CHECK_EQUAL(ENCODER_DIRECTION, encoder.GetEncoderIncrements(true));
+  HostAdvanceMillis(50);
+  HostPulseCounterCount(2 * ENCODER_COUNTS_PER_DETENT);
+  CHECK_EQUAL(2 * ENCODER_DIRECTION * ENCODER_ACCEL_MAX_FACTOR, encoder.GetEncoderIncrements(true));
+
+  // Suppressed input is discarded
+  encoder.SuppressInput(100);
+  CHECK(encoder.IsInputSuppressed());
+  HostPulseCounterCount(ENCODER_COUNTS_PER_DETENT);
+  CHECK_EQUAL(0, encoder.GetEncoderIncrements());
+  HostAdvanceMillis(100);
+  CHECK(!encoder.IsInputSuppressed());
+  CHECK_EQUAL(0, encoder.GetEncoderIncrements());
+}
+
+//===============================================================
+// Short and long button presses from the button edges
+//===============================================================
+static void TestButton()
+{
+  EncoderButtonDriver button;
+  HostSetMicros(20000000);
+  button.Begin(PIN_A, PIN_B, PIN_BUTTON);
+  HostSetPinLevel(PIN_BUTTON, HIGH);
+
+  // Bounce is no press
+  HostSetPinLevel(PIN_BUTTON, LOW);
+  button.ButtonEvent();
+  HostAdvanceMillis(MINIMUMSHORTTIMEPRESS_MS - 10);
+  HostSetPinLevel(PIN_BUTTON, HIGH);
+  button.ButtonEvent();
+  CHECK(!button.IsButtonPress());
+
+  // Short press
+  HostSetPinLevel(PIN_BUTTON, LOW);
+  button.ButtonEvent();
+  HostAdvanceMillis(100);
+  CHECK(button.IsButtonDown());
+  CHECK(!button.IsLongButtonPress());
+  HostSetPinLevel(PIN_BUTTON, HIGH);
+  button.ButtonEvent();
+  CHECK(button.IsButtonPress());
+  CHECK(!button.IsButtonPress());
+
+  // Long press is reported once while pressed, the release is no short press
+  HostSetPinLevel(PIN_BUTTON, LOW);
+  button.ButtonEvent();
+  HostAdvanceMillis(MINIMUMLONGTIMEPRESS_MS);
+  CHECK(button.IsLongButtonPress());
+  CHECK(!button.IsLongButtonPress());
+  HostSetPinLevel(PIN_BUTTON, HIGH);
+  button.ButtonEvent();
+  CHECK(!button.IsButtonPress());
+}
+
+//===============================================================
+// Edge bursts overflowing the button edge FIFO (main task not
+// running). The lost edges resynchronize the button state from the
+// pin, a press held during the overflow is no short or long press
+//===============================================================
+static void TestButtonEdgeOverflow()
+{
+  EncoderButtonDriver button;
+  HostSetMicros(30000000);
+  button.Begin(PIN_A, PIN_B, PIN_BUTTON);
+  HostSetPinLevel(PIN_BUTTON, HIGH);
+
+  // Burst of 10 presses (20 edges), the last 4 edges are lost
+  for (int press = 0; press < 10; press++)
+  {
+    Press(button, MINIMUMSHORTTIMEPRESS_MS + 10);
+  }
+  CHECK(button.IsButtonPress());
+  CHECK(!button.IsButtonDown());
+  CHECK(!button.IsButtonPress());
+
+  // Burst overflowing while the button is held down
+  for (int press = 0; press < BUTTON_EDGE_FIFO_SIZE / 2; press++)
+  {
+    Press(button, MINIMUMSHORTTIMEPRESS_MS + 10);
+  }
+  Press(button, MINIMUMLONGTIMEPRESS_MS, false);
+  CHECK(button.IsButtonPress());
+  CHECK(button.IsButtonDown());
+  CHECK(!button.IsLongButtonPress());
+  HostSetPinLevel(PIN_BUTTON, HIGH);
+  button.ButtonEvent();
+  CHECK(!button.IsButtonPress());
+  CHECK(!button.IsButtonDown());
+
+  // Presses are classified again after the resynchronization
+  Press(button, 100);
+  CHECK(button.IsButtonPress());
+  Press(button, MINIMUMLONGTIMEPRESS_MS, false);
+  CHECK(button.IsLongButtonPress());
+  HostSetPinLevel(PIN_BUTTON, HIGH);
+  button.ButtonEvent();
+  CHECK(!button.IsButtonPress());
+}
+
+//===============================================================
+// An interrupt thread injects button edges and encoder edges while
+// the main task classifies them concurrently. The interrupt thread
+// waits for the classification of a press (presses within one
+// query are reported once), so no press and no detent may be lost
+//===============================================================
+static void TestConcurrentEdges()
+{
+  const int PressCount = 500;
+  const int DetentCount = 10000;
+
+  EncoderButtonDriver driver;
+  HostSetMicros(40000000);
+  driver.Begin(PIN_A, PIN_B, PIN_BUTTON, OnConcurrentDetent);
+  HostSetPinLevel(PIN_BUTTON, HIGH);
+  concurrentDetents = 0;
+
+  std::atomic<int> presses{0};
+  std::atomic<bool> interruptsRunning{true};
+  int netDetents = 0;
+  std::thread interrupts([&]()
+  {
+    srand(36);
+    for (int press = 0; press < PressCount; press++)
+    {
+      Press(driver, MINIMUMSHORTTIMEPRESS_MS + rand() % 50);
+      HostAdvanceMillis(1 + rand() % 10);
+
+      // Detents edge by edge, partial detents are read by the main task
+      for (int detent = 0; detent < DetentCount / PressCount; detent++)
+      {
+        int direction = rand() % 3 == 0 ? -1 : 1;
+        netDetents += direction;
+        for (int edge = 0; edge < ENCODER_COUNTS_PER_DETENT; edge++)
+        {
+          HostPulseCounterCount(direction);
+        }
+      }
+
+      while (presses < press + 1)
+      {
+        std::this_thread::yield();
+      }
+    }
+    interruptsRunning = false;
+  });
+
+  int increments = 0;
+  while (interruptsRunning)
+  {
+    presses += driver.IsButtonPress() ? 1 : 0;
+    increments += driver.GetEncoderIncrements();
+  }
+  interrupts.join();
+  presses += driver.IsButtonPress() ? 1 : 0;
+  increments += driver.GetEncoderIncrements();
+
+  CHECK_EQUAL(PressCount, presses);
+  CHECK(!driver.IsButtonDown());
+  CHECK_EQUAL(DetentCount, concurrentDetents);
+  CHECK_EQUAL(netDetents * ENCODER_DIRECTION, increments);
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  TestAcceleration();
+  TestIncrements();
+  TestButton();
+  TestButtonEdgeOverflow();
+  TestConcurrentEdges();
+  return TestResult("EncoderButtonDriverTest");
+}
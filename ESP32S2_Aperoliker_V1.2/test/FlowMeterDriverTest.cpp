@@ -0,0 +1,380 @@
+/**
+ * Host tests for the flow meter driver
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TestHelper.h"
+#include "FlowMeterDriver.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#if defined(STORAGE_LITTLEFS)
+#define TEST_FS             LittleFS
+#else
+#define TEST_FS             SPIFFS
+#endif
+
+#define TEST_BATCH_MS       24000   // Flow time of one journal batch (100 ml)
+#define TEST_SECTOR_SIZE    4096    // Erase unit of the flash
+
+//===============================================================
+// Returns the flow times of a snapshot (liters back to ms)
+//===============================================================
+static bool GetFlowTimes(FlowMeterDriver& flowMeter, int64_t* flowTimes_ms)
+{
+  double values_L[LIQUID_COUNT] = { };
+  bool consistent = flowMeter.GetValues(values_L);
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    flowTimes_ms[liquid] = llround(values_L[liquid] / FlowRates[liquid]);
+  }
+  return consistent;
+}
+
+//===============================================================
+// Erases the simulated flash and mounts the storage
+//===============================================================
+static void ClearFlash()
+{
+  TEST_FS.HostClear();
+  Preferences::HostClearAll();
+  Preferences::HostSetAvailable(true);
+  Storage.Begin();
+}
+
+//===============================================================
+// Adds one journal batch to liquid 1 and saves it asynchronously
+//===============================================================
+static void AddBatch(FlowMeterDriver& flowMeter)
+{
+  flowMeter.AddFlowTime({ TEST_BATCH_MS, 1, 2 });
+  flowMeter.RequestSaveAsync();
+  flowMeter.SaveAsync();
+}
+
+//===============================================================
+// Returns the content of the journal
+//===============================================================
+static std::string ReadJournal()
+{
+  File file = Storage.Open(FLOW_JOURNAL_FILE, FILE_READ);
+  std::string content(file.size(), 0);
+  file.read((uint8_t*)&content[0], content.size());
+  return content;
+}
+
+//===============================================================
+// Replaces the content of the journal
+//===============================================================
+static void WriteJournal(const std::string& content)
+{
+  File file = Storage.Open(FLOW_JOURNAL_FILE, FILE_WRITE);
+  file.write((const uint8_t*)content.data(), content.size());
+  file.close();
+}
+
+//===============================================================
+// Checks the flow times of a started driver (batches of liquid 1)
+//===============================================================
+static void CheckBatches(FlowMeterDriver& flowMeter, uint32_t batches)
+{
+  int64_t flowTimes_ms[3] = { };
+  CHECK(GetFlowTimes(flowMeter, flowTimes_ms));
+  CHECK_EQUAL((int64_t)batches * TEST_BATCH_MS, flowTimes_ms[0]);
+  CHECK_EQUAL(batches, flowTimes_ms[1]);
+  CHECK_EQUAL(2 * batches, flowTimes_ms[2]);
+}
+
+//===============================================================
+// Batches are appended to the journal, the preferences are only
+// written when the journal is compacted. Measures the flash wear
+// against a preferences write per batch
+//===============================================================
+static void TestJournalWear()
+{
+  const uint32_t BatchCount = 2000;
+
+  ClearFlash();
+  FlowMeterDriver flowMeter;
+  flowMeter.Begin(true);
+  for (uint32_t batch = 0; batch < BatchCount; batch++)
+  {
+    AddBatch(flowMeter);
+  }
+
+  uint32_t preferencesWrites = Preferences::HostWriteCount();
+  size_t journalBytes = TEST_FS.HostWrittenBytes();
+  printf("%u batches: %u preferences writes (%u without journal), %u journal bytes (%u sector erases)\n",
+    (unsigned int)BatchCount, (unsigned int)preferencesWrites, (unsigned int)BatchCount,
+    (unsigned int)journalBytes, (unsigned int)((journalBytes + TEST_SECTOR_SIZE - 1) / TEST_SECTOR_SIZE));
+  CHECK_EQUAL(BatchCount / FLOW_JOURNAL_MAX_RECORDS, preferencesWrites);
+  CHECK_EQUAL(BatchCount * sizeof(FlowJournalRecord), journalBytes);
+  CheckBatches(flowMeter, BatchCount);
+
+  // Restart: base and journal give the same values
+  FlowMeterDriver restarted;
+  restarted.Begin(true);
+  CheckBatches(restarted, BatchCount);
+  CHECK_EQUAL(BatchCount / FLOW_JOURNAL_MAX_RECORDS, Preferences::HostWriteCount());
+}
+
+//===============================================================
+// Power loss while appending a record: the rest of the record and
+// all later writes are lost. The restart keeps the complete
+// records, compacts them and drops the damaged tail
+//===============================================================
+static void TestPowerLossWhileAppending()
+{
+  ClearFlash();
+  FlowMeterDriver flowMeter;
+  flowMeter.Begin(true);
+  AddBatch(flowMeter);
+  AddBatch(flowMeter);
+  AddBatch(flowMeter);
+
+  TEST_FS.HostSetWriteLimit(TEST_FS.HostWrittenBytes() + sizeof(FlowJournalRecord) / 2);
+  Preferences::HostSetAvailable(false);
+  AddBatch(flowMeter);
+  CHECK_EQUAL(3 * sizeof(FlowJournalRecord) + sizeof(FlowJournalRecord) / 2, ReadJournal().size());
+
+  // Restart
+  TEST_FS.HostSetWriteLimit(SIZE_MAX);
+  Preferences::HostSetAvailable(true);
+  FlowMeterDriver restarted;
+  restarted.Begin(true);
+  CheckBatches(restarted, 3);
+  CHECK(!Storage.Exists(FLOW_JOURNAL_FILE));
+  CHECK_EQUAL(1, Preferences::HostWriteCount());
+
+  // The journal is used again
+  AddBatch(restarted);
+  CHECK_EQUAL(sizeof(FlowJournalRecord), ReadJournal().size());
+  FlowMeterDriver again;
+  again.Begin(true);
+  CheckBatches(again, 4);
+}
+
+//===============================================================
+// Truncated or corrupt tail records are dropped, the records in
+// front of them are kept
+//===============================================================
+static void TestDamagedTail()
+{
+  for (uint32_t damage = 0; damage < 3; damage++)
+  {
+    ClearFlash();
+    FlowMeterDriver flowMeter;
+    flowMeter.Begin(true);
+    for (uint32_t batch = 0; batch < 5; batch++)
+    {
+      AddBatch(flowMeter);
+    }
+
+    std::string journal = ReadJournal();
+    CHECK_EQUAL(5 * sizeof(FlowJournalRecord), journal.size());
+    if (damage == 0)
+    {
+      // Truncated inside the last record
+      journal.resize(journal.size() - 3);
+    }
+    else if (damage == 1)
+    {
+      // Corrupt value of the last record
+      journal[journal.size() - sizeof(FlowJournalRecord) + offsetof(FlowJournalRecord, FlowTimes_ms)] ^= 0x40;
+    }
+    else
+    {
+      // Corrupt CRC of the last record
+      journal[journal.size() - 1] ^= 0x01;
+    }
+    WriteJournal(journal);
+
+    FlowMeterDriver restarted;
+    restarted.Begin(true);
+    CheckBatches(restarted, 4);
+    CHECK(!Storage.Exists(FLOW_JOURNAL_FILE));
+  }
+}
+
+//===============================================================
+// Power loss while compacting (base written, journal not removed
+// yet): the records included in the base are skipped
+//===============================================================
+static void TestPowerLossWhileCompacting()
+{
+  ClearFlash();
+  FlowMeterDriver flowMeter;
+  flowMeter.Begin(true);
+  AddBatch(flowMeter);
+  AddBatch(flowMeter);
+
+  std::string journal = ReadJournal();
+  flowMeter.Save();
+  CHECK(!Storage.Exists(FLOW_JOURNAL_FILE));
+  WriteJournal(journal);
+
+  FlowMeterDriver restarted;
+  restarted.Begin(true);
+  CheckBatches(restarted, 2);
+}
+
+//===============================================================
+// Preferences, which can not be opened at the start, are never
+// overwritten: neither by the compaction of a damaged journal nor
+// by a save. The next start loads base and journal
+//===============================================================
+static void TestPreferencesUnavailable()
+{
+  ClearFlash();
+  FlowMeterDriver flowMeter;
+  flowMeter.Begin(true);
+  AddBatch(flowMeter);
+  flowMeter.Save();
+  AddBatch(flowMeter);
+  AddBatch(flowMeter);
+
+  // Damaged tail would trigger a compaction
+  std::string journal = ReadJournal();
+  journal.resize(journal.size() - 3);
+  WriteJournal(journal);
+  uint32_t preferencesWrites = Preferences::HostWriteCount();
+
+  Preferences::HostSetAvailable(false);
+  FlowMeterDriver unavailable;
+  unavailable.Begin(true);
+  Preferences::HostSetAvailable(true);
+  unavailable.AddFlowTime({ TEST_BATCH_MS, 0, 0 });
+  unavailable.Save();
+  unavailable.RequestSaveAsync();
+  unavailable.SaveAsync();
+  CHECK_EQUAL(preferencesWrites, Preferences::HostWriteCount());
+  CHECK(ReadJournal() == journal);
+
+  FlowMeterDriver restarted;
+  restarted.Begin(true);
+  CheckBatches(restarted, 2);
+}
+
+//===============================================================
+// An interrupt writer and a task writer add flow times while
+// reader threads take snapshots. The interrupt adds (1, 2, 3) and
+// the task (1, 1, 1) per write, so every consistent snapshot is
+// (a + b, 2a + b, 3a + b). No count may be lost at the end
+//===============================================================
+static void TestConcurrentWriters()
+{
+  const uint32_t WriteCount = 100000;
+  const uint32_t ReaderCount = 2;
+
+  ClearFlash();
+  static FlowMeterDriver flowMeter;
+  flowMeter.Begin(false);
+  int64_t start_ms[3] = { };
+  CHECK(GetFlowTimes(flowMeter, start_ms));
+
+  std::atomic<uint32_t> writersRunning{2};
+  std::thread isrWriter([&writersRunning]()
+  {
+    for (uint32_t index = 0; index < WriteCount; index++)
+    {
+      flowMeter.AddFlowTime({ 1, 2, 3 });
+    }
+    writersRunning--;
+  });
+  std::thread taskWriter([&writersRunning]()
+  {
+    for (uint32_t index = 0; index < WriteCount; index++)
+    {
+      flowMeter.AddFlowTime({ 1, 1, 1 });
+      if (index % 64 == 0)
+      {
+        std::this_thread::yield();
+      }
+    }
+    writersRunning--;
+  });
+
+  std::atomic<uint32_t> snapshots{0};
+  std::atomic<uint32_t> inconsistent{0};
+  std::atomic<uint32_t> torn{0};
+  std::atomic<uint32_t> decreasing{0};
+  std::vector<std::thread> readers;
+  for (uint32_t reader = 0; reader < ReaderCount; reader++)
+  {
+    readers.emplace_back([&]()
+    {
+      int64_t last_ms[3] = { start_ms[0], start_ms[1], start_ms[2] };
+      while (writersRunning > 0)
+      {
+        int64_t flowTimes_ms[3];
+        bool consistent = GetFlowTimes(flowMeter, flowTimes_ms);
+        snapshots++;
+        for (uint32_t liquid = 0; liquid < 3; liquid++)
+        {
+          decreasing += flowTimes_ms[liquid] < last_ms[liquid] ? 1 : 0;
+          last_ms[liquid] = flowTimes_ms[liquid];
+          flowTimes_ms[liquid] -= start_ms[liquid];
+        }
+        if (!consistent)
+        {
+          // Bounded retries, the values may miss parts of a write
+          inconsistent++;
+          continue;
+        }
+
+        int64_t isrWrites = flowTimes_ms[1] - flowTimes_ms[0];
+        if (flowTimes_ms[2] - flowTimes_ms[1] != isrWrites ||
+          isrWrites < 0 ||
+          isrWrites > flowTimes_ms[0])
+        {
+          torn++;
+        }
+      }
+    });
+  }
+
+  isrWriter.join();
+  taskWriter.join();
+  for (std::thread& reader : readers)
+  {
+    reader.join();
+  }
+
+  printf("%u snapshots, %u not consistent after %d retries\n", (unsigned int)snapshots, (unsigned int)inconsistent, FLOW_SNAPSHOT_MAX_RETRIES);
+  CHECK(snapshots > 0);
+  CHECK(inconsistent < snapshots);
+  CHECK_EQUAL(0, torn);
+  CHECK_EQUAL(0, decreasing);
+
+  // No lost counts
+  int64_t end_ms[3] = { };
+  CHECK(GetFlowTimes(flowMeter, end_ms));
+  CHECK_EQUAL(2 * WriteCount, end_ms[0] - start_ms[0]);
+  CHECK_EQUAL(3 * WriteCount, end_ms[1] - start_ms[1]);
+  CHECK_EQUAL(4 * WriteCount, end_ms[2] - start_ms[2]);
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  TestJournalWear();
+  TestPowerLossWhileAppending();
+  TestDamagedTail();
+  TestPowerLossWhileCompacting();
+  TestPreferencesUnavailable();
+  TestConcurrentWriters();
+  return TestResult("FlowMeterDriverTest");
+}
@@ -0,0 +1,73 @@
+/**
+ * Host tests for the input event queue
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include "TestHelper.h"
+#include "InputEventQueue.h"
+
+//===============================================================
+// Events are taken in order with their timestamps
+//===============================================================
+static void TestOrder()
+{
+  InputEventQueue queue;
+  InputEvent event;
+  CHECK(!queue.Pop(&event));
+
+  HostSetMicros(1000000);
+  CHECK(queue.Push(eInputEncoder, -1));
+  HostAdvanceMillis(5);
+  CHECK(queue.Push(eInputLever, 1));
+
+  CHECK(queue.Pop(&event));
+  CHECK_EQUAL(1000, event.Timestamp_ms);
+  CHECK_EQUAL(eInputEncoder, event.Type);
+  CHECK_EQUAL(-1, event.Value);
+  CHECK(queue.Pop(&event));
+  CHECK_EQUAL(1005, event.Timestamp_ms);
+  CHECK_EQUAL(eInputLever, event.Type);
+  CHECK_EQUAL(1, event.Value);
+  CHECK(!queue.Pop(&event));
+}
+
+//===============================================================
+// A full queue drops new events, the queue wraps around
+//===============================================================
+static void TestFull()
+{
+  InputEventQueue queue;
+  InputEvent event;
+
+  for (int round = 0; round < 3; round++)
+  {
+    for (int32_t index = 0; index < INPUT_EVENT_QUEUE_SIZE; index++)
+    {
+      CHECK(queue.Push(eInputButton, index));
+    }
+    CHECK(!queue.Push(eInputButton, INPUT_EVENT_QUEUE_SIZE));
+
+    for (int32_t index = 0; index < INPUT_EVENT_QUEUE_SIZE; index++)
+    {
+      CHECK(queue.Pop(&event));
+      CHECK_EQUAL(index, event.Value);
+    }
+    CHECK(!queue.Pop(&event));
+  }
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  TestOrder();
+  TestFull();
+  return TestResult("InputEventQueueTest");
+}
@@ -0,0 +1,426 @@
+/**
+ * Websocket load generator. Runs the whole firmware (with wifi) on
+ * the virtual time of the host like the replay harness, connects
+ * many simulated phones through the host websocket transport and
+ * lets them send liquid increments and full update requests.
+ *
+ * Measured:
+ * - Handling time and allocations (operator new) per message in
+ *   the web server task and per loop in the loop task (host time)
+ * - Heap per connected client (operator new, live bytes): firmware
+ *   state of the clients and the queued messages of the host
+ *   websocket transport (the TCP buffers of the device library are
+ *   not simulated)
+ * - Acknowledge latency of the liquid increments (virtual time,
+ *   includes the broadcast rate limit)
+ * - Pump update period of the loop task. The host handling time
+ *   multiplied by the device factor is added to the virtual time,
+ *   so the period shows the delay imposed by the websocket traffic
+ *
+ * Usage: LoadGenerator [<clients> [<duration_ms> [<interval_ms> [<device_factor>]]]]
+ *
+ * The library keeps DEFAULT_MAX_WS_CLIENTS clients (8), further
+ * clients are closed. Build with -DLOAD_MAX_WS_CLIENTS=<n> to raise
+ * the limit like the build flag of the device.
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <algorithm>
+#include <chrono>
+#include <freertos/task.h>
+#include <filesystem>
+#include <fstream>
+#include <malloc.h>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//===============================================================
+// Sketch (with the prototypes of the Arduino builder)
+//===============================================================
+void Main_Task(void* arg);
+void ISR_Pumps_Enable();
+void ISR_EncoderButton();
+bool ISR_EncoderDetent(int8_t direction);
+
+#include "../ESP32S2_Aperoliker_V1.2.ino"
+
+//===============================================================
+// Defines
+//===============================================================
+#define LOAD_STEP_MS              1       // Messages are sent and delivered after every step
+#define LOAD_START_MS             4000    // Clients connect after the intro
+#define LOAD_FULL_UPDATE_EVERY    10      // Every n-th message of a client is a full update request
+
+//===============================================================
+// Structs
+//===============================================================
+// Simulated phone
+struct LoadClient
+{
+  uint32_t ID;
+  bool Closed;
+  uint16_t Sequence;
+  uint32_t Messages;
+  uint32_t Version;
+  std::map<uint16_t, uint32_t> Pending;   // Sequence -> send time
+};
+
+// Sorted samples with their statistics
+struct LoadSamples
+{
+  std::vector<double> Values;
+
+  void Add(double value) { Values.push_back(value); }
+  double Mean() const { double sum = 0; for (double value : Values) sum += value; return Values.empty() ? 0 : sum / Values.size(); }
+  double Percentile(double percent) { if (Values.empty()) return 0; std::sort(Values.begin(), Values.end()); return Values[std::min(Values.size() - 1, (size_t)(Values.size() * percent / 100))]; }
+  double Max() { return Percentile(100); }
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+static uint64_t loadAllocations = 0;
+static int64_t loadHeapBytes = 0;
+static double loadDeviceFactor = 1;
+static LoadSamples loadLoopDurations_us;
+static LoadSamples loadPumpPeriods_us;
+static uint64_t loadLoopAllocations = 0;
+
+//===============================================================
+// Counted allocations
+//===============================================================
+void* operator new(size_t size)
+{
+  loadAllocations++;
+  void* pointer = malloc(size != 0 ? size : 1);
+  if (pointer == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  loadHeapBytes += malloc_usable_size(pointer);
+  return pointer;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+  loadHeapBytes -= malloc_usable_size(pointer);
+  free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+  operator delete(pointer);
+}
+
+void operator delete(void* pointer, size_t size) noexcept
+{
+  operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t size) noexcept
+{
+  operator delete(pointer);
+}
+
+//===============================================================
+// Returns the host time in microseconds
+//===============================================================
+static double HostNow_us()
+{
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//===============================================================
+// Adds host handling time to the virtual time (device estimate)
+//===============================================================
+static void ChargeDeviceTime(double duration_us)
+{
+  HostAdvanceMicros((uint32_t)(duration_us * loadDeviceFactor));
+}
+
+//===============================================================
+// Loads the data folder of the sketch into the file system
+//===============================================================
+static void LoadDataFolder()
+{
+  for (const auto& entry : std::filesystem::directory_iterator(HOST_SKETCH_DIR "/data"))
+  {
+    std::ifstream input(entry.path(), std::ios::binary);
+    std::stringstream content;
+    content << input.rdbuf();
+    std::string data = content.str();
+
+    File file = Storage.GetFS().open(("/" + entry.path().filename().string()).c_str(), FILE_WRITE);
+    file.write((const uint8_t*)data.data(), data.size());
+    file.close();
+  }
+}
+
+//===============================================================
+// Loop task of the Arduino core, measures the pump update period
+// and the host time of a loop
+//===============================================================
+static void LoopTask(void* arg)
+{
+  setup();
+  uint32_t lastLoop_us = 0;
+  while (true)
+  {
+    uint32_t loop_us = micros();
+    if (lastLoop_us != 0 &&
+      millis() > LOAD_START_MS)
+    {
+      loadPumpPeriods_us.Add(loop_us - lastLoop_us);
+    }
+    lastLoop_us = loop_us;
+
+    uint64_t allocations = loadAllocations;
+    double start_us = HostNow_us();
+    loop();
+    double duration_us = HostNow_us() - start_us;
+    if (millis() > LOAD_START_MS)
+    {
+      loadLoopDurations_us.Add(duration_us);
+      loadLoopAllocations += loadAllocations - allocations;
+    }
+    ChargeDeviceTime(duration_us);
+    vTaskDelay(1);
+  }
+}
+
+//===============================================================
+// Takes the messages of a client, resolves the acknowledged
+// frames ("EVENT:LIQUID_ANGLES:version:angles:id=sequence;...")
+//===============================================================
+static size_t TakeMessages(AsyncWebSocketClient& client, LoadClient& load, LoadSamples& latencies_ms)
+{
+  std::vector<std::string> messages = client.HostTakeMessages();
+  for (const std::string& message : messages)
+  {
+    unsigned int version = 0;
+    if (sscanf(message.c_str(), "MIXTURE_VERSION:%u", &version) == 1 ||
+      sscanf(message.c_str(), "EVENT:LIQUID_ANGLES:%u:", &version) == 1)
+    {
+      load.Version = std::max(load.Version, (uint32_t)version);
+    }
+
+    size_t acks = message.rfind(':');
+    if (message.rfind("EVENT:LIQUID_ANGLES:", 0) != 0 ||
+      acks == std::string::npos)
+    {
+      continue;
+    }
+
+    std::string own = std::to_string(load.ID) + "=";
+    std::stringstream list(message.substr(acks + 1));
+    std::string ack;
+    while (std::getline(list, ack, ';'))
+    {
+      if (ack.rfind(own, 0) != 0)
+      {
+        continue;
+      }
+
+      uint16_t sequence = (uint16_t)atoi(ack.c_str() + own.size());
+      while (!load.Pending.empty() &&
+        load.Pending.begin()->first <= sequence)
+      {
+        latencies_ms.Add(millis() - load.Pending.begin()->second);
+        load.Pending.erase(load.Pending.begin());
+      }
+    }
+  }
+  return messages.size();
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main(int argc, char** argv)
+{
+  uint32_t clientCount = argc > 1 ? atoi(argv[1]) : 8;
+  uint32_t duration_ms = argc > 2 ? atoi(argv[2]) : 10000;
+  uint32_t interval_ms = argc > 3 ? std::max(atoi(argv[3]), 1) : 100;
+  loadDeviceFactor = argc > 4 ? atof(argv[4]) : 1;
+
+  // Errors only (counted for the report)
+  char* logBuffer = NULL;
+  size_t logLength = 0;
+  FILE* log = open_memstream(&logBuffer, &logLength);
+  HostSetLogOutput(log, ESP_LOG_ERROR);
+
+  // Flash content of a device with wifi enabled
+  LoadDataFolder();
+  Preferences settings;
+  settings.begin(SETTINGS_NAME, false);
+  settings.putBool(KEY_WIFIMODE, true);
+  settings.end();
+
+  xTaskCreate(LoopTask, "loopTask", 8192, NULL, 1, NULL);
+
+  std::vector<LoadClient> clients;
+  LoadSamples messageDurations_us;
+  LoadSamples latencies_ms;
+  uint64_t messageAllocations = 0;
+  uint64_t messagesSent = 0;
+  uint64_t messagesReceived = 0;
+  int64_t heapBeforeConnect = 0;
+  double connectedBytesPerClient = 0;
+  size_t connectedClients = 0;
+  uint32_t end_ms = LOAD_START_MS + duration_ms;
+  for (uint32_t time_ms = 0; time_ms <= end_ms; time_ms += LOAD_STEP_MS)
+  {
+    HostRunTasks((uint64_t)time_ms * 1000);
+    AsyncWebSocket* websocket = AsyncWebSocket::HostInstance;
+
+    // Skip the intro (like the recorded traces)
+    if (time_ms == 3200 || time_ms == 3300)
+    {
+      HostTriggerPin(PIN_ENCODER_BUTTON, time_ms == 3200 ? LOW : HIGH);
+    }
+
+    if (time_ms == LOAD_START_MS)
+    {
+      if (websocket == NULL)
+      {
+        fprintf(stderr, "No websocket\n");
+        return 1;
+      }
+      heapBeforeConnect = loadHeapBytes;
+      for (uint32_t index = 0; index < clientCount; index++)
+      {
+        clients.push_back({ websocket->HostConnect()->id(), false, 0, 0, 0, { } });
+      }
+    }
+
+    // Heap of the idle clients (connect messages read), before the
+    // first messages
+    if (time_ms == LOAD_START_MS + interval_ms - LOAD_STEP_MS)
+    {
+      connectedClients = websocket->count();
+      connectedBytesPerClient = connectedClients > 0 ? (double)(loadHeapBytes - heapBeforeConnect) / connectedClients : 0;
+    }
+    if (time_ms < LOAD_START_MS)
+    {
+      continue;
+    }
+
+    // Clients send on their own phase of the interval
+    for (uint32_t index = 0; index < clients.size(); index++)
+    {
+      LoadClient& load = clients[index];
+      if (load.Closed ||
+        time_ms < LOAD_START_MS + interval_ms ||
+        (time_ms - LOAD_START_MS + index * interval_ms / clients.size()) % interval_ms != 0)
+      {
+        continue;
+      }
+      if (websocket->client(load.ID) == NULL)
+      {
+        load.Closed = true;
+        continue;
+      }
+
+      // Liquid increment with the known version or full update
+      load.Sequence++;
+      load.Messages++;
+      uint8_t frame[11] = { WIFI_FRAME_VERSION, eFrameLiquidIncrement, (uint8_t)load.Sequence, (uint8_t)(load.Sequence >> 8),
+        (uint8_t)(load.Messages % LIQUID_COUNT), (uint8_t)(load.Messages % 2 ? 1 : 0xFF), (uint8_t)(load.Messages % 2 ? 0 : 0xFF),
+        (uint8_t)load.Version, (uint8_t)(load.Version >> 8), (uint8_t)(load.Version >> 16), (uint8_t)(load.Version >> 24) };
+      size_t length = sizeof(frame);
+      if (load.Messages % LOAD_FULL_UPDATE_EVERY == 0)
+      {
+        frame[1] = eFrameFullUpdate;
+        length = WIFI_FRAME_HEADER_LENGTH;
+      }
+      else
+      {
+        load.Pending[load.Sequence] = time_ms;
+      }
+
+      uint64_t allocations = loadAllocations;
+      double start_us = HostNow_us();
+      websocket->HostReceive(load.ID, WS_BINARY, frame, length);
+      double duration_us = HostNow_us() - start_us;
+      messageDurations_us.Add(duration_us);
+      messageAllocations += loadAllocations - allocations;
+      messagesSent++;
+      ChargeDeviceTime(duration_us);
+    }
+
+    // Phones read their messages
+    for (LoadClient& load : clients)
+    {
+      AsyncWebSocketClient* client = websocket->client(load.ID);
+      if (client != NULL)
+      {
+        messagesReceived += TakeMessages(*client, load, latencies_ms);
+      }
+    }
+  }
+
+  // Report
+  fclose(log);
+  std::stringstream logLines(std::string(logBuffer, logLength));
+  free(logBuffer);
+  std::map<std::string, uint32_t> errors;
+  uint32_t droppedCommands = 0;
+  std::string line;
+  while (std::getline(logLines, line))
+  {
+    // Message without time and client specific numbers
+    std::string message = line.substr(std::min(line.find(']') + 1, line.size()));
+    message.erase(std::remove_if(message.begin(), message.end(), ::isdigit), message.end());
+    errors[message]++;
+    droppedCommands += message.find("Wifi command") != std::string::npos && message.find("dropped") != std::string::npos ? 1 : 0;
+  }
+
+  size_t closed = 0;
+  size_t unacknowledged = 0;
+  for (LoadClient& load : clients)
+  {
+    closed += load.Closed || AsyncWebSocket::HostInstance->client(load.ID) == NULL ? 1 : 0;
+    unacknowledged += load.Pending.size();
+  }
+  double handling_us = messageDurations_us.Mean();
+  printf("Clients:           %u connected, %u closed by the server (limit %u)\n", (unsigned int)clientCount, (unsigned int)closed, (unsigned int)DEFAULT_MAX_WS_CLIENTS);
+  printf("Messages:          %llu sent in %u ms (%.0f/s), %llu received by the clients\n", (unsigned long long)messagesSent, (unsigned int)duration_ms,
+    messagesSent * 1000.0 / duration_ms, (unsigned long long)messagesReceived);
+  printf("Message handling:  %.1f us mean, %.1f us p99, %.1f us max (host), %.0f messages/s\n", handling_us, messageDurations_us.Percentile(99), messageDurations_us.Max(),
+    handling_us > 0 ? 1000000.0 / handling_us : 0);
+  printf("Allocations:       %.1f per message, %.2f per loop\n", messagesSent > 0 ? (double)messageAllocations / messagesSent : 0,
+    loadLoopDurations_us.Values.empty() ? 0 : (double)loadLoopAllocations / loadLoopDurations_us.Values.size());
+  printf("Acknowledge:       %.1f ms mean, %.0f ms p99, %.0f ms max, %u not acknowledged at the end\n", latencies_ms.Mean(), latencies_ms.Percentile(99), latencies_ms.Max(), (unsigned int)unacknowledged);
+  size_t endClients = AsyncWebSocket::HostInstance->count();
+  printf("Heap per client:   %.0f bytes connected (%u clients), %.0f bytes at the end (%u clients)\n", connectedBytesPerClient, (unsigned int)connectedClients,
+    endClients > 0 ? (double)(loadHeapBytes - heapBeforeConnect) / endClients : 0, (unsigned int)endClients);
+  printf("Loop:              %.1f us mean, %.1f us p99, %.1f us max (host)\n", loadLoopDurations_us.Mean(), loadLoopDurations_us.Percentile(99), loadLoopDurations_us.Max());
+  for (auto& error : errors)
+  {
+    printf("Logged error:      %ux %s\n", (unsigned int)error.second, error.first.c_str());
+  }
+  printf("Pump update:       %.0f us mean, %.0f us p99, %.0f us max (device factor %.1f)\n", loadPumpPeriods_us.Mean(), loadPumpPeriods_us.Percentile(99), loadPumpPeriods_us.Max(), loadDeviceFactor);
+
+  // Fails, if no increment was acknowledged or a command was dropped
+  // (e.g. preset list requests of the connect burst)
+  if (droppedCommands > 0)
+  {
+    fprintf(stderr, "%u wifi commands dropped\n", (unsigned int)droppedCommands);
+    return 1;
+  }
+  return latencies_ms.Values.empty() ? 1 : 0;
+}
@@ -0,0 +1,392 @@
+/**
+ * Scrape test of the metrics endpoint. Runs the whole firmware (with
+ * wifi) on the virtual time of the host like the replay harness,
+ * requests /metrics and parses the Prometheus text format strictly
+ * (help and type per family, sample names and labels, cumulative
+ * histogram buckets)
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <algorithm>
+#include <freertos/task.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "TestHelper.h"
+
+//===============================================================
+// Sketch (with the prototypes of the Arduino builder)
+//===============================================================
+void Main_Task(void* arg);
+void ISR_Pumps_Enable();
+void ISR_EncoderButton();
+bool ISR_EncoderDetent(int8_t direction);
+
+#include "../ESP32S2_Aperoliker_V1.2.ino"
+
+//===============================================================
+// Defines
+//===============================================================
+#define SCRAPE_START_MS         4000    // Client connects after the intro
+
+//===============================================================
+// Structs
+//===============================================================
+// Sample of a scrape
+struct MetricSample
+{
+  std::string Name;
+  std::string Labels;
+  double Value;
+};
+
+// Parsed scrape (type per family and all samples)
+struct MetricScrape
+{
+  std::map<std::string, std::string> Types;
+  std::vector<MetricSample> Samples;
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+static uint32_t scrapeTime_ms = 0;
+static uint32_t scrapeClientID = 0;
+
+//===============================================================
+// Loop task of the Arduino core (one loop per tick on the host)
+//===============================================================
+static void LoopTask(void* arg)
+{
+  setup();
+  while (true)
+  {
+    loop();
+    vTaskDelay(1);
+  }
+}
+
+//===============================================================
+// Runs the firmware for the given time
+//===============================================================
+static void Run(uint32_t duration_ms)
+{
+  for (uint32_t time_ms = 0; time_ms < duration_ms; time_ms++)
+  {
+    HostRunTasks((uint64_t)++scrapeTime_ms * 1000);
+  }
+}
+
+//===============================================================
+// Returns true, if the text is a valid metric or label name
+//===============================================================
+static bool IsValidName(const std::string& name, bool metric)
+{
+  if (name.empty() ||
+    isdigit((unsigned char)name[0]))
+  {
+    return false;
+  }
+  for (char character : name)
+  {
+    if (!isalnum((unsigned char)character) &&
+      character != '_' &&
+      !(metric && character == ':'))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//===============================================================
+// Returns true, if the labels are a valid list of name="value"
+// pairs (without braces)
+//===============================================================
+static bool IsValidLabels(const std::string& labels)
+{
+  size_t position = 0;
+  while (position < labels.size())
+  {
+    size_t equals = labels.find("=\"", position);
+    if (equals == std::string::npos ||
+      !IsValidName(labels.substr(position, equals - position), false))
+    {
+      return false;
+    }
+    size_t end = labels.find('"', equals + 2);
+    if (end == std::string::npos)
+    {
+      return false;
+    }
+    position = end + 1;
+    if (position < labels.size())
+    {
+      if (labels[position] != ',')
+      {
+        return false;
+      }
+      position++;
+    }
+  }
+  return true;
+}
+
+//===============================================================
+// Returns the family of a sample name (histogram samples have a
+// suffix)
+//===============================================================
+static std::string GetFamily(const std::string& name, const MetricScrape& scrape)
+{
+  for (const char* suffix : { "_bucket", "_sum", "_count" })
+  {
+    size_t length = strlen(suffix);
+    if (name.size() > length &&
+      name.compare(name.size() - length, length, suffix) == 0)
+    {
+      std::string family = name.substr(0, name.size() - length);
+      auto type = scrape.Types.find(family);
+      if (type != scrape.Types.end() &&
+        type->second == "histogram")
+      {
+        return family;
+      }
+    }
+  }
+  return name;
+}
+
+//===============================================================
+// Parses a scrape. Every family has help and type before its
+// samples, every sample belongs to the current family
+//===============================================================
+static MetricScrape ParseScrape(const std::string& text)
+{
+  MetricScrape scrape;
+  std::string family;
+  size_t start = 0;
+  CHECK(!text.empty() && text.back() == '\n');
+
+  for (size_t end = text.find('\n'); end != std::string::npos; end = text.find('\n', start))
+  {
+    std::string line = text.substr(start, end - start);
+    start = end + 1;
+    CHECK(!line.empty());
+
+    if (line.rfind("# HELP ", 0) == 0)
+    {
+      // Help is followed by the type of the same family
+      size_t nameEnd = line.find(' ', 7);
+      family = line.substr(7, nameEnd - 7);
+      CHECK(IsValidName(family, true));
+      CHECK(nameEnd != std::string::npos && nameEnd + 1 < line.size());
+      CHECK(scrape.Types.count(family) == 0);
+
+      end = text.find('\n', start);
+      std::string typeLine = end != std::string::npos ? text.substr(start, end - start) : std::string();
+      start = end != std::string::npos ? end + 1 : text.size();
+      std::string prefix = "# TYPE " + family + " ";
+      CHECK(typeLine.rfind(prefix, 0) == 0);
+      std::string type = typeLine.substr(min(prefix.size(), typeLine.size()));
+      CHECK(type == "counter" || type == "gauge" || type == "histogram");
+      scrape.Types[family] = type;
+      continue;
+    }
+    CHECK(line[0] != '#');
+
+    // Sample: name{labels} value
+    MetricSample sample;
+    size_t separator = line.rfind(' ');
+    CHECK(separator != std::string::npos);
+    std::string key = line.substr(0, separator);
+    size_t brace = key.find('{');
+    sample.Name = key.substr(0, brace);
+    if (brace != std::string::npos)
+    {
+      CHECK(key.back() == '}');
+      sample.Labels = key.substr(brace + 1, key.size() - brace - 2);
+      CHECK(IsValidLabels(sample.Labels));
+    }
+    CHECK(IsValidName(sample.Name, true));
+    CHECK(GetFamily(sample.Name, scrape) == family);
+
+    std::string value = line.substr(separator + 1);
+    char* valueEnd = NULL;
+    sample.Value = strtod(value.c_str(), &valueEnd);
+    CHECK(!value.empty() && *valueEnd == '\0');
+    if (scrape.Types[family] != "gauge")
+    {
+      CHECK(sample.Value >= 0);
+    }
+    if (scrape.Types[family] == "counter")
+    {
+      CHECK(family.size() > 6 && family.compare(family.size() - 6, 6, "_total") == 0);
+    }
+    scrape.Samples.push_back(sample);
+  }
+  CHECK_EQUAL(text.size(), start);
+  return scrape;
+}
+
+//===============================================================
+// Returns the value of a sample (-1 if missing)
+//===============================================================
+static double GetValue(const MetricScrape& scrape, const std::string& name, const std::string& labels = std::string())
+{
+  for (const MetricSample& sample : scrape.Samples)
+  {
+    if (sample.Name == name &&
+      sample.Labels == labels)
+    {
+      return sample.Value;
+    }
+  }
+  return -1;
+}
+
+//===============================================================
+// Checks the histograms: increasing bounds up to +Inf, cumulative
+// bucket counts, +Inf equals the count
+//===============================================================
+static void CheckHistograms(const MetricScrape& scrape)
+{
+  for (const auto& type : scrape.Types)
+  {
+    if (type.second != "histogram")
+    {
+      continue;
+    }
+
+    double lastBound = -1;
+    double lastCount = 0;
+    bool infinite = false;
+    for (const MetricSample& sample : scrape.Samples)
+    {
+      if (sample.Name != type.first + "_bucket")
+      {
+        continue;
+      }
+      CHECK(!infinite);
+      CHECK(sample.Labels.rfind("le=\"", 0) == 0 && sample.Labels.back() == '"');
+      std::string bound = sample.Labels.substr(4, sample.Labels.size() - 5);
+      if (bound == "+Inf")
+      {
+        infinite = true;
+      }
+      else
+      {
+        CHECK(atof(bound.c_str()) > lastBound);
+        lastBound = atof(bound.c_str());
+      }
+      CHECK(sample.Value >= lastCount);
+      lastCount = sample.Value;
+    }
+    CHECK(infinite);
+    CHECK_EQUAL(lastCount, GetValue(scrape, type.first + "_count"));
+    CHECK(GetValue(scrape, type.first + "_sum") >= 0);
+  }
+}
+
+//===============================================================
+// Scrapes the metrics endpoint
+//===============================================================
+static MetricScrape Scrape()
+{
+  AsyncWebServerRequest request(HTTP_GET, "/metrics");
+  AsyncWebServerResponse* response = AsyncWebServer::HostInstance->HostHandle(&request);
+  CHECK(response != NULL);
+  if (response == NULL)
+  {
+    return MetricScrape();
+  }
+  CHECK_EQUAL(200, response->HostCode());
+  CHECK(response->HostContentType() == "text/plain; version=0.0.4");
+
+  MetricScrape scrape = ParseScrape(response->HostContent());
+  CheckHistograms(scrape);
+  return scrape;
+}
+
+//===============================================================
+// Scrapes on the dashboard and after a long press on the menu page:
+// all families are exported, the menu page (no doughnut chart)
+// reports its render duration and the state transition
+//===============================================================
+static void TestMenuScrape()
+{
+  MetricScrape dashboard = Scrape();
+  CHECK_EQUAL(eDashboard, Statemachine.GetCurrentState());
+  CHECK_EQUAL(eMetricHistogramCount, std::count_if(dashboard.Types.begin(), dashboard.Types.end(),
+    [](const std::pair<const std::string, std::string>& type) { return type.second == "histogram"; }));
+  CHECK(GetValue(dashboard, "mixer_display_render_duration_us_count") > 0);
+  CHECK(GetValue(dashboard, "mixer_loop_duration_us_count") > 0);
+  CHECK_EQUAL(1, GetValue(dashboard, "mixer_wifi_clients"));
+  for (uint8_t pump = 1; pump <= LIQUID_COUNT; pump++)
+  {
+    CHECK_EQUAL(0, GetValue(dashboard, "mixer_pump_starts_total", "pump=\"" + std::to_string(pump) + "\""));
+  }
+
+  HostTriggerPin(PIN_ENCODER_BUTTON, LOW);
+  Run(MINIMUMLONGTIMEPRESS_MS + 50);
+  HostTriggerPin(PIN_ENCODER_BUTTON, HIGH);
+  Run(50);
+  MetricScrape menu = Scrape();
+  CHECK_EQUAL(eMenu, Statemachine.GetCurrentState());
+  CHECK_EQUAL(GetValue(dashboard, "mixer_state_transitions_total") + 1, GetValue(menu, "mixer_state_transitions_total"));
+  CHECK(GetValue(menu, "mixer_display_render_duration_us_count") > GetValue(dashboard, "mixer_display_render_duration_us_count"));
+}
+
+//===============================================================
+// Counters of the next scrape follow the firmware
+//===============================================================
+static void TestCountersFollow()
+{
+  MetricScrape before = Scrape();
+  const char* message = "FULLUPDATE";
+  AsyncWebSocket::HostInstance->HostReceive(scrapeClientID, WS_TEXT, (const uint8_t*)message, strlen(message));
+  Run(10);
+  MetricScrape after = Scrape();
+
+  CHECK_EQUAL(GetValue(before, "mixer_wifi_messages_total") + 1, GetValue(after, "mixer_wifi_messages_total"));
+  CHECK_EQUAL(GetValue(before, "mixer_wifi_message_duration_us_count") + 1, GetValue(after, "mixer_wifi_message_duration_us_count"));
+  CHECK(GetValue(after, "mixer_loop_duration_us_count") > GetValue(before, "mixer_loop_duration_us_count"));
+  CHECK(GetValue(after, "mixer_uptime_seconds") >= SCRAPE_START_MS / 1000);
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  // Device with wifi enabled
+  Preferences settings;
+  settings.begin(SETTINGS_NAME, false);
+  settings.putBool(KEY_WIFIMODE, true);
+  settings.end();
+
+  // Skip the intro (like the recorded traces) and connect a client
+  xTaskCreate(LoopTask, "loopTask", 8192, NULL, 1, NULL);
+  Run(3200);
+  HostTriggerPin(PIN_ENCODER_BUTTON, LOW);
+  Run(100);
+  HostTriggerPin(PIN_ENCODER_BUTTON, HIGH);
+  Run(SCRAPE_START_MS - scrapeTime_ms);
+  if (AsyncWebServer::HostInstance == NULL ||
+    AsyncWebSocket::HostInstance == NULL)
+  {
+    fprintf(stderr, "No web server\n");
+    return 1;
+  }
+  scrapeClientID = AsyncWebSocket::HostInstance->HostConnect()->id();
+  Run(10);
+
+  TestMenuScrape();
+  TestCountersFollow();
+  return TestResult("MetricsScrapeTest");
+}
@@ -0,0 +1,130 @@
+/**
+ * Host tests for the mixture of N liquids
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <stdlib.h>
+#include "TestHelper.h"
+#include "Mixture.h"
+
+//===============================================================
+// Explicit instantiations, other liquid counts must compile
+//===============================================================
+template class Mixture<2>;
+template class Mixture<3>;
+template class Mixture<4>;
+template class Mixture<5>;
+template class Mixture<6>;
+
+//===============================================================
+// Checks, that the angles are ordered with the minimum distance
+// and all percentages sum up to 100%
+//===============================================================
+template <uint8_t N>
+static void CheckMixture(const Mixture<N>& mixture)
+{
+  int16_t sum_Degrees = 0;
+  for (uint8_t liquid = 0; liquid < N; liquid++)
+  {
+    int16_t distance_Degrees = GetDistanceDegrees(mixture.GetAngle(liquid), mixture.GetAngle((liquid + 1) % N));
+    CHECK(distance_Degrees >= MINANGLE_DEGREES);
+    sum_Degrees += distance_Degrees;
+  }
+  CHECK_EQUAL(360, sum_Degrees);
+  CHECK_NEAR(100.0, mixture.GetSum(), 0.001);
+}
+
+//===============================================================
+// Random increments keep the mixture valid
+//===============================================================
+template <uint8_t N>
+static void TestRandomIncrements()
+{
+  Mixture<N> mixture;
+  int16_t angles_Degrees[N];
+  for (uint8_t liquid = 0; liquid < N; liquid++)
+  {
+    angles_Degrees[liquid] = liquid * (360 / N);
+  }
+  mixture.SetAngles(angles_Degrees);
+  CheckMixture(mixture);
+
+  srand(N);
+  for (int step = 0; step < 20000; step++)
+  {
+    uint32_t revision = mixture.GetRevision();
+    int16_t angle_Degrees = mixture.GetAngle(step % N);
+    mixture.IncrementAngle(step % N, (int16_t)(rand() % 121 - 60));
+    CHECK_EQUAL(angle_Degrees != mixture.GetAngle(step % N), revision != mixture.GetRevision());
+    CheckMixture(mixture);
+  }
+}
+
+//===============================================================
+// Percentages from the angles
+//===============================================================
+static void TestPercentages()
+{
+  Mixture<3> mixture;
+  mixture.SetAngles({ 0, 90, 180 });
+  CHECK_NEAR(25.0, mixture.GetPercentage(0), 0.001);
+  CHECK_NEAR(25.0, mixture.GetPercentage(1), 0.001);
+  CHECK_NEAR(50.0, mixture.GetPercentage(2), 0.001);
+
+  // A liquid at its minimum angle is muted, the greatest one gets its share
+  mixture.SetAngles({ 0, MINANGLE_DEGREES, 180 });
+  CHECK_NEAR(0.0, mixture.GetPercentage(0), 0.001);
+  CHECK_NEAR((180.0 - MINANGLE_DEGREES) * 100.0 / 360.0, mixture.GetPercentage(1), 0.001);
+  CHECK_NEAR((180.0 + MINANGLE_DEGREES) * 100.0 / 360.0, mixture.GetPercentage(2), 0.001);
+
+  // Two liquids
+  Mixture<2> two;
+  two.SetAngles({ 350, 80 });
+  CHECK_NEAR(25.0, two.GetPercentage(0), 0.001);
+  CHECK_NEAR(75.0, two.GetPercentage(1), 0.001);
+
+  // Invalid liquids
+  CHECK_EQUAL(-1, two.GetAngle(2));
+  CHECK_NEAR(0.0, two.GetPercentage(2), 0.001);
+}
+
+//===============================================================
+// Increments are limited by the neighbouring angles
+//===============================================================
+static void TestLimits()
+{
+  Mixture<4> mixture;
+  mixture.SetAngles({ 0, 90, 180, 270 });
+
+  mixture.IncrementAngle(1, 200);
+  CHECK_EQUAL(180 - MINANGLE_DEGREES, mixture.GetAngle(1));
+  mixture.IncrementAngle(0, -200);
+  CHECK_EQUAL(270 + MINANGLE_DEGREES, mixture.GetAngle(0));
+
+  // Limited angles do not change the revision
+  uint32_t revision = mixture.GetRevision();
+  mixture.IncrementAngle(1, 1);
+  mixture.IncrementAngle(4, 1);
+  CHECK_EQUAL(revision, mixture.GetRevision());
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  TestRandomIncrements<2>();
+  TestRandomIncrements<3>();
+  TestRandomIncrements<4>();
+  TestRandomIncrements<5>();
+  TestRandomIncrements<6>();
+  TestPercentages();
+  TestLimits();
+  return TestResult("MixtureTest");
+}
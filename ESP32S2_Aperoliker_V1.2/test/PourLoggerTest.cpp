@@ -0,0 +1,240 @@
+/**
+ * Host tests for the pour logger
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include "TestHelper.h"
+#include "PourLogger.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#if defined(STORAGE_LITTLEFS)
+#define TEST_FS       LittleFS
+#else
+#define TEST_FS       SPIFFS
+#endif
+
+//===============================================================
+// Starts with an empty file system and a new pour log
+//===============================================================
+static void Begin(PourLogger& log)
+{
+  TEST_FS.HostClear();
+  TEST_FS.HostSetMountable(true);
+  CHECK(Storage.Begin());
+  log.Begin(true);
+}
+
+//===============================================================
+// Pours for 100 ms and collects the event
+//===============================================================
+static void Pour(PourLogger& log)
+{
+  log.StartPour(eDashboard);
+  HostAdvanceMillis(100);
+  log.StopPour();
+  log.Update();
+}
+
+//===============================================================
+// Writes the buffered records after the flush interval
+//===============================================================
+static void FlushInterval(PourLogger& log)
+{
+  HostAdvanceMillis(POURLOG_FLUSH_INTERVAL_MS);
+  log.Update();
+}
+
+//===============================================================
+// Exports the records in small parts (lines are carried over),
+// returns the lines without the header
+//===============================================================
+static std::vector<std::string> Export(PourLogger& log)
+{
+  PourLogExport context;
+  log.BeginExport(&context);
+
+  std::string csv;
+  uint8_t buffer[7];
+  size_t length = 0;
+  while ((length = log.ReadExport(&context, buffer, sizeof(buffer))) > 0)
+  {
+    csv.append((const char*)buffer, length);
+  }
+
+  std::vector<std::string> lines;
+  size_t start = csv.find('\n') + 1;
+  for (size_t end = csv.find('\n', start); end != std::string::npos; end = csv.find('\n', start))
+  {
+    lines.push_back(csv.substr(start, end - start));
+    start = end + 1;
+  }
+  CHECK_EQUAL(csv.size(), start);
+  return lines;
+}
+
+//===============================================================
+// Returns the sequences of the exported lines
+//===============================================================
+static std::vector<uint32_t> GetSequences(const std::vector<std::string>& lines)
+{
+  std::vector<uint32_t> sequences;
+  for (const std::string& line : lines)
+  {
+    sequences.push_back((uint32_t)strtoul(line.c_str(), NULL, 10));
+  }
+  return sequences;
+}
+
+//===============================================================
+// Buffered records are exported after the flush interval with
+// their mixture
+//===============================================================
+static void TestExport()
+{
+  static PourLogger log;
+  Begin(log);
+
+  int16_t angles_Degrees[LIQUID_COUNT];
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    angles_Degrees[liquid] = LiquidDefaultAngles_Degrees[liquid];
+  }
+  log.SetMixture(angles_Degrees);
+
+  for (int pour = 0; pour < 3; pour++)
+  {
+    Pour(log);
+  }
+  CHECK_EQUAL(0, Export(log).size());
+
+  FlushInterval(log);
+  std::vector<std::string> lines = Export(log);
+  CHECK_EQUAL(3, lines.size());
+  CHECK((GetSequences(lines) == std::vector<uint32_t>{ 1, 2, 3 }));
+  std::string angles;
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    angles += "," + std::to_string(angles_Degrees[liquid]);
+  }
+  CHECK(lines.size() > 0 && lines[0].find(",100,") != std::string::npos);
+  CHECK(lines.size() > 0 && lines[0].find(angles + "," + std::to_string(eDashboard)) != std::string::npos);
+}
+
+//===============================================================
+// A write failure in the middle of a flush keeps the records not
+// written, the export only contains the written ones. They are
+// written by the next flush after the interval
+//===============================================================
+static void TestPartialWriteFailure()
+{
+  static PourLogger log;
+  Begin(log);
+
+  for (int pour = 0; pour < 5; pour++)
+  {
+    Pour(log);
+  }
+
+  // Room for two and a half records
+  TEST_FS.HostSetWriteLimit(TEST_FS.HostWrittenBytes() + 2 * sizeof(PourRecord) + sizeof(PourRecord) / 2);
+  FlushInterval(log);
+  CHECK((GetSequences(Export(log)) == std::vector<uint32_t>{ 1, 2 }));
+
+  // Retried after the interval only
+  TEST_FS.HostSetWriteLimit(SIZE_MAX);
+  log.Update();
+  CHECK_EQUAL(2, Export(log).size());
+  FlushInterval(log);
+  CHECK((GetSequences(Export(log)) == std::vector<uint32_t>{ 1, 2, 3, 4, 5 }));
+}
+
+//===============================================================
+// Records of a full buffer, which can not be written, are lost.
+// The written sequence never passes them, the next records are
+// exported after the storage recovered
+//===============================================================
+static void TestFullBufferWriteFailure()
+{
+  static PourLogger log;
+  Begin(log);
+
+  Pour(log);
+  FlushInterval(log);
+
+  TEST_FS.HostSetWriteLimit(TEST_FS.HostWrittenBytes());
+  for (int pour = 0; pour < POURLOG_BUFFER_RECORDS; pour++)
+  {
+    Pour(log);
+  }
+  CHECK((GetSequences(Export(log)) == std::vector<uint32_t>{ 1 }));
+
+  TEST_FS.HostSetWriteLimit(SIZE_MAX);
+  Pour(log);
+  FlushInterval(log);
+  CHECK((GetSequences(Export(log)) == std::vector<uint32_t>{ 1, POURLOG_BUFFER_RECORDS + 2 }));
+}
+
+//===============================================================
+// The longest record line (maximum values) is exported completely
+//===============================================================
+static void TestLongestLine()
+{
+  static PourLogger log;
+  TEST_FS.HostClear();
+  TEST_FS.HostSetMountable(true);
+  CHECK(Storage.Begin());
+
+  // Ring file with one record of maximum values
+  PourRecord record;
+  memset(&record, 0xFF, sizeof(record));
+  record.Sequence = 4000000000u;
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    record.Angles[liquid] = INT16_MIN;
+  }
+  std::vector<uint8_t> content(POURLOG_MAX_RECORDS * sizeof(PourRecord));
+  memcpy(content.data() + ((record.Sequence - 1) % POURLOG_MAX_RECORDS) * sizeof(PourRecord), &record, sizeof(record));
+  File file = Storage.Open(POURLOG_FILE, FILE_WRITE);
+  file.write(content.data(), content.size());
+  file.close();
+  log.Begin(true);
+
+  std::string expected = "4000000000,4294967295,4294967295";
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    expected += ",4294967295";
+  }
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    expected += ",-32768";
+  }
+  expected += ",65535";
+
+  std::vector<std::string> lines = Export(log);
+  CHECK_EQUAL(1, lines.size());
+  CHECK(lines.size() == 1 && lines[0] == expected);
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  HostSetMicros(1000000);
+  TestExport();
+  TestPartialWriteFailure();
+  TestFullBufferWriteFailure();
+  TestLongestLine();
+  return TestResult("PourLoggerTest");
+}
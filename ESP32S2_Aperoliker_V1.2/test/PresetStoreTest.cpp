@@ -0,0 +1,151 @@
+/**
+ * Host tests for the recipe presets
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include "TestHelper.h"
+#include "PresetStore.h"
+
+//===============================================================
+// Reference check of a mixture: the angles are in clockwise order
+// and all neighbours have at least the minimum distance
+//===============================================================
+static bool ReferenceIsValid(const int16_t (&angles_Degrees)[LIQUID_COUNT])
+{
+  int16_t a = angles_Degrees[0];
+  int16_t b = angles_Degrees[1];
+  int16_t c = angles_Degrees[2];
+  for (int16_t angle_Degrees : angles_Degrees)
+  {
+    if (angle_Degrees < 0 || angle_Degrees >= 360)
+    {
+      return false;
+    }
+  }
+
+  bool clockwise = (a < b && b < c) || (b < c && c < a) || (c < a && a < b);
+  int16_t minDistance_Degrees = min(min(GetDistanceDegrees(a, b), GetDistanceDegrees(b, c)), GetDistanceDegrees(c, a));
+  return clockwise && minDistance_Degrees >= MINANGLE_DEGREES;
+}
+
+//===============================================================
+// Empty flash results in the default preset
+//===============================================================
+static void TestDefaults()
+{
+  Preferences::HostClearAll();
+  PresetStore presets;
+  presets.Begin();
+
+  int16_t angles_Degrees[LIQUID_COUNT];
+  CHECK_EQUAL(1, presets.GetCount());
+  CHECK(strcmp(presets.GetName(0), "Default") == 0);
+  CHECK(presets.GetAngles(0, angles_Degrees));
+  CHECK_EQUAL(LIQUID1ANGLE_DEGREES, angles_Degrees[0]);
+  CHECK_EQUAL(LIQUID3ANGLE_DEGREES, angles_Degrees[2]);
+  CHECK(!presets.GetAngles(1, angles_Degrees));
+  CHECK(strcmp(presets.GetName(1), "") == 0);
+}
+
+//===============================================================
+// Only valid mixtures are accepted as preset
+//===============================================================
+static void TestValidation()
+{
+  Preferences::HostClearAll();
+  PresetStore presets;
+  presets.Begin();
+
+  int mismatches = 0;
+  for (int16_t a = -4; a < 364; a += 4)
+  {
+    for (int16_t b = 0; b < 360; b += 5)
+    {
+      for (int16_t c = 1; c < 360; c += 7)
+      {
+        int16_t angles_Degrees[LIQUID_COUNT] = { a, b, c };
+        if (presets.SetPreset(0, "Test", angles_Degrees) != ReferenceIsValid(angles_Degrees) &&
+          mismatches++ < 10)
+        {
+          fprintf(stderr, "Preset %d,%d,%d: expected %d\n", a, b, c, ReferenceIsValid(angles_Degrees));
+        }
+      }
+    }
+  }
+  CHECK_EQUAL(0, mismatches);
+  CHECK_EQUAL(1, presets.GetCount());
+
+  // Borders of the minimum distance
+  CHECK(presets.SetPreset(0, "Min", { 0, MINANGLE_DEGREES, 2 * MINANGLE_DEGREES }));
+  CHECK(!presets.SetPreset(0, "Min", { 0, MINANGLE_DEGREES - 1, 2 * MINANGLE_DEGREES }));
+  CHECK(presets.SetPreset(0, "Wrap", { 360 - MINANGLE_DEGREES, 0, 180 }));
+  CHECK(!presets.SetPreset(0, "Wrap", { 360 - MINANGLE_DEGREES + 1, 0, 180 }));
+  CHECK(!presets.SetPreset(0, "Same", { 90, 90, 180 }));
+}
+
+//===============================================================
+// Presets are saved and loaded, damaged blobs are replaced by the
+// default preset
+//===============================================================
+static void TestSaveLoad()
+{
+  Preferences::HostClearAll();
+  {
+    PresetStore presets;
+    presets.Begin();
+    CHECK(presets.SetPreset(1, "Spritz;Light", { 0, 100, 200 }));
+    CHECK(presets.SetPreset(2, "", { 10, 110, 210 }));
+    CHECK(!presets.SetPreset(4, "Gap", { 10, 110, 210 }));
+    CHECK_EQUAL(3, presets.GetCount());
+    CHECK(presets.GetNamesString() == "Default;Spritz Light;Preset 3");
+  }
+
+  {
+    PresetStore presets;
+    presets.Begin();
+    int16_t angles_Degrees[LIQUID_COUNT];
+    CHECK_EQUAL(3, presets.GetCount());
+    CHECK(presets.GetAngles(2, angles_Degrees));
+    CHECK_EQUAL(210, angles_Degrees[2]);
+
+    // The last preset is kept
+    CHECK(presets.RemovePreset(0));
+    CHECK(presets.RemovePreset(0));
+    CHECK(!presets.RemovePreset(0));
+    CHECK(strcmp(presets.GetName(0), "Preset 3") == 0);
+  }
+
+  // Damage one byte of the stored presets
+  Preferences preferences;
+  PresetBlob blob;
+  CHECK(preferences.begin(SETTINGS_NAME, false));
+  size_t length = preferences.getBytes(KEY_PRESETS, &blob, sizeof(blob));
+  CHECK_EQUAL(sizeof(PresetHeader) + sizeof(Preset), length);
+  blob.Presets[0].Angles_Degrees[1] ^= 1;
+  preferences.putBytes(KEY_PRESETS, &blob, length);
+  preferences.end();
+
+  {
+    PresetStore presets;
+    presets.Begin();
+    CHECK_EQUAL(1, presets.GetCount());
+    CHECK(strcmp(presets.GetName(0), "Default") == 0);
+  }
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  TestDefaults();
+  TestValidation();
+  TestSaveLoad();
+  return TestResult("PresetStoreTest");
+}
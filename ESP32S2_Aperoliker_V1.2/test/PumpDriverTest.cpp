@@ -0,0 +1,154 @@
+/**
+ * Host simulation of the error diffusion pump driver. The dispensed
+ * on-times of the pumps are sampled at the pins and compared with
+ * the requested mixture
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <stdlib.h>
+#include "TestHelper.h"
+#include "PumpDriver.h"
+
+//===============================================================
+// Constants
+//===============================================================
+static const uint8_t TestPins[] = { 1, 2, 4, 5, 9, 14 };
+static const double TestPercentages[] = { 55.0, 20.0, 12.5, 7.5, 3.0, 2.0 };
+
+//===============================================================
+// Global variables
+//===============================================================
+static uint64_t onTimes_ms[LIQUID_COUNT] = { };
+
+//===============================================================
+// Runs the pump update like the loop task (every 1 ms). A pump
+// runs while the outputs are enabled and its pin is high
+//===============================================================
+static void RunUpdates(uint32_t duration_ms)
+{
+  for (uint32_t time_ms = 0; time_ms < duration_ms; time_ms++)
+  {
+    for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+    {
+      onTimes_ms[pump] += Pumps.IsEnabled() && digitalRead(TestPins[pump]) == HIGH ? 1 : 0;
+    }
+    HostAdvanceMillis(1);
+    Pumps.Update();
+  }
+}
+
+//===============================================================
+// Starts the pumps with the test mixture, the measured on-times
+// and flow times start at zero
+//===============================================================
+static void Start(double (&duties)[LIQUID_COUNT])
+{
+  Preferences::HostClearAll();
+  Preferences::HostSetAvailable(true);
+  uint8_t pins[LIQUID_COUNT];
+  memcpy(pins, TestPins, sizeof(pins));
+  Pumps.Begin(pins, 24.0);
+
+  double percentages[LIQUID_COUNT];
+  memcpy(percentages, TestPercentages, sizeof(percentages));
+  Pumps.SetPumps(percentages);
+
+  // Duty of the pumps relative to the strongest pump
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    duties[pump] = TestPercentages[pump] / TestPercentages[0];
+    onTimes_ms[pump] = 0;
+  }
+}
+
+//===============================================================
+// Checks the on-times against the requested ratio and the flow
+// times counted by the driver
+//===============================================================
+static void CheckOnTimes(const double (&duties)[LIQUID_COUNT], uint64_t dispensing_ms, const uint32_t (&startFlowTimes_ms)[LIQUID_COUNT], double tolerance_ms)
+{
+  uint32_t flowTimes_ms[LIQUID_COUNT];
+  FlowMeter.GetFlowTimesFromISR(flowTimes_ms);
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    CHECK_NEAR(duties[pump] * dispensing_ms, (double)onTimes_ms[pump], tolerance_ms);
+    CHECK_EQUAL(onTimes_ms[pump], flowTimes_ms[pump] - startFlowTimes_ms[pump]);
+  }
+}
+
+//===============================================================
+// Pumps running for 100 cycles dispense the requested ratio within
+// one slot per pump
+//===============================================================
+static void TestContinuousRatio()
+{
+  double duties[LIQUID_COUNT];
+  Start(duties);
+  uint32_t startFlowTimes_ms[LIQUID_COUNT];
+  FlowMeter.GetFlowTimesFromISR(startFlowTimes_ms);
+
+  const uint32_t slot_ms = Pumps.GetCycleTimespan() / PUMP_SLOTS_PER_CYCLE;
+  const uint32_t dispensing_ms = 100 * Pumps.GetCycleTimespan();
+
+  // Dispensing starts with the first update after enabling
+  Pumps.Enable();
+  RunUpdates(1);
+  RunUpdates(dispensing_ms);
+  Pumps.Disable();
+
+  CheckOnTimes(duties, dispensing_ms, startFlowTimes_ms, slot_ms);
+}
+
+//===============================================================
+// Lever presses cut slots short at random times. The slot rests
+// are corrected by the next update, so the ratio error stays
+// within one slot over all presses (without the correction every
+// press would add up to one slot)
+//===============================================================
+static void TestDisabledSlots()
+{
+  double duties[LIQUID_COUNT];
+  Start(duties);
+  uint32_t startFlowTimes_ms[LIQUID_COUNT];
+  FlowMeter.GetFlowTimesFromISR(startFlowTimes_ms);
+
+  const uint32_t slot_ms = Pumps.GetCycleTimespan() / PUMP_SLOTS_PER_CYCLE;
+  uint64_t dispensing_ms = 0;
+
+  srand(30);
+  for (int press = 0; press < 300; press++)
+  {
+    // Dispensing starts with the first update after enabling
+    Pumps.Enable();
+    RunUpdates(1);
+
+    uint32_t pressed_ms = 20 + rand() % 1500;
+    RunUpdates(pressed_ms);
+    dispensing_ms += pressed_ms;
+    Pumps.Disable();
+
+    RunUpdates(100 + rand() % 700);
+
+    // Error must not grow with the presses
+    if (press == 149 || press == 299)
+    {
+      CheckOnTimes(duties, dispensing_ms, startFlowTimes_ms, slot_ms + 1);
+    }
+  }
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  TestContinuousRatio();
+  TestDisabledSlots();
+  return TestResult("PumpDriverTest");
+}
@@ -0,0 +1,588 @@
+/**
+ * Headless replay harness. Runs the whole firmware (setup, loop
+ * task and main task) on the virtual time of the host and replays
+ * a recorded input trace: encoder detents through the pulse
+ * counter, button and lever edges through their interrupts and
+ * websocket messages through the web server. The output (log,
+ * pump outputs, display texts and websocket messages) is compared
+ * with a golden file
+ *
+ * Trace lines (other text is ignored, so a debug log of the device
+ * with core debug level "Debug" and DEBUG_MIXER is a trace):
+ *   Input <time_ms> encoder|button|lever <value>
+ *   Websocket <time_ms> <client> connect|disconnect
+ *   Websocket <time_ms> <client> text <message>
+ *   Websocket <time_ms> <client> binary <hex>
+ *   End <time_ms>
+ *
+ * Worst-case loop latency (virtual time): the state machine cycles
+ * must not sleep (waits are states with timestamps), so the loop
+ * duration histogram and the time from an input interrupt to its
+ * handling by the main task are checked against their bounds.
+ *
+ * Encoder steps: every step on the dashboard recalculates the
+ * mixture once and results in at most one broadcast to the
+ * websocket clients (counted until the next replayed event).
+ *
+ * Usage: ReplayHarness <trace> [<golden> [--update]]
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <algorithm>
+#include <freertos/task.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <StreamString.h>
+#include <string>
+#include <vector>
+
+//===============================================================
+// Sketch (with the prototypes of the Arduino builder)
+//===============================================================
+void Main_Task(void* arg);
+void ISR_Pumps_Enable();
+void ISR_EncoderButton();
+bool ISR_EncoderDetent(int8_t direction);
+
+#include "../ESP32S2_Aperoliker_V1.2.ino"
+
+//===============================================================
+// Defines
+//===============================================================
+#define REPLAY_STEP_MS          1       // Websocket messages are delivered after every step
+#define REPLAY_TAIL_MS          1000    // Run time after the last event without end line
+#define REPLAY_MAX_LOOP_US      100     // Worst-case state machine cycle (first histogram bucket)
+#define REPLAY_MAX_INPUT_MS     REPLAY_STEP_MS  // Inputs are handled in the step after their interrupt
+
+//===============================================================
+// Enums
+//===============================================================
+enum ReplayEventType
+{
+  eReplayEncoder,
+  eReplayButton,
+  eReplayLever,
+  eReplayConnect,
+  eReplayDisconnect,
+  eReplayText,
+  eReplayBinary,
+  eReplayEnd
+};
+
+//===============================================================
+// Structs
+//===============================================================
+struct ReplayEvent
+{
+  uint32_t Time_ms;
+  ReplayEventType Type;
+  int32_t Value;
+  std::string Payload;
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+static FILE* replayOutput = NULL;
+static std::map<uint32_t, uint32_t> replayClients;
+static bool replayInputPending = false;
+static uint32_t replayInputTime_ms = 0;
+static uint32_t replayInputsHandled = 0;
+static uint32_t replayMaxInputLatency_ms = 0;
+static bool replayStepPending = false;
+static bool replayStepOnDashboard = false;
+static uint32_t replayStepTime_ms = 0;
+static uint32_t replayStepRevision = 0;
+static uint32_t replayStepBroadcasts = 0;
+static uint32_t replaySteps = 0;
+static uint32_t replayStepsFailed = 0;
+
+//===============================================================
+// Parses a trace, returns false if the file can't be read
+//===============================================================
+static bool ParseTrace(const char* path, std::vector<ReplayEvent>& events)
+{
+  std::ifstream file(path);
+  if (!file)
+  {
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(file, line))
+  {
+    ReplayEvent event = { };
+    char type[16] = "";
+    int offset = 0;
+    size_t input = line.find("Input ");
+    size_t websocket = line.find("Websocket ");
+    size_t end = line.find("End ");
+
+    if (input != std::string::npos &&
+      sscanf(line.c_str() + input, "Input %u %15s %d", &event.Time_ms, type, &event.Value) == 3)
+    {
+      // Wifi input events are the result of websocket messages
+      std::string name = type;
+      if (name == "wifi")
+      {
+        continue;
+      }
+      event.Type = name == "encoder" ? eReplayEncoder : (name == "button" ? eReplayButton : eReplayLever);
+      if (name != "encoder" && name != "button" && name != "lever")
+      {
+        fprintf(stderr, "Unknown input '%s'\n", line.c_str());
+        continue;
+      }
+    }
+    else if (websocket != std::string::npos &&
+      sscanf(line.c_str() + websocket, "Websocket %u %d %15s%n", &event.Time_ms, &event.Value, type, &offset) == 3)
+    {
+      std::string name = type;
+      std::string payload = line.substr(websocket + offset);
+      event.Payload = payload.empty() ? payload : payload.substr(1);
+      if (name == "connect")
+      {
+        event.Type = eReplayConnect;
+      }
+      else if (name == "disconnect")
+      {
+        event.Type = eReplayDisconnect;
+      }
+      else if (name == "text")
+      {
+        event.Type = eReplayText;
+      }
+      else if (name == "binary")
+      {
+        event.Type = eReplayBinary;
+      }
+      else
+      {
+        fprintf(stderr, "Unknown websocket event '%s'\n", line.c_str());
+        continue;
+      }
+    }
+    else if (end != std::string::npos &&
+      sscanf(line.c_str() + end, "End %u", &event.Time_ms) == 1)
+    {
+      event.Type = eReplayEnd;
+    }
+    else
+    {
+      continue;
+    }
+    events.push_back(event);
+  }
+
+  // Inputs are logged when processed, websocket messages when received
+  std::stable_sort(events.begin(), events.end(), [](const ReplayEvent& left, const ReplayEvent& right)
+  {
+    return left.Time_ms < right.Time_ms;
+  });
+  return true;
+}
+
+//===============================================================
+// Loads the data folder of the sketch into the file system
+//===============================================================
+static void LoadDataFolder()
+{
+  for (const auto& entry : std::filesystem::directory_iterator(HOST_SKETCH_DIR "/data"))
+  {
+    std::ifstream input(entry.path(), std::ios::binary);
+    std::stringstream content;
+    content << input.rdbuf();
+    std::string data = content.str();
+
+    File file = Storage.GetFS().open(("/" + entry.path().filename().string()).c_str(), FILE_WRITE);
+    file.write((const uint8_t*)data.data(), data.size());
+    file.close();
+  }
+}
+
+//===============================================================
+// Records pump outputs
+//===============================================================
+static void OnPinWrite(uint8_t pin, uint8_t value)
+{
+  for (uint8_t pump = 0; pump < LIQUID_COUNT; pump++)
+  {
+    if (pin == PumpPins[pump])
+    {
+      fprintf(replayOutput, "[%8u][pump] %u %s\n", millis(), pin, value ? "on" : "off");
+    }
+  }
+}
+
+//===============================================================
+// Records display texts
+//===============================================================
+static void OnDisplayText(int16_t x, int16_t y, const char* text)
+{
+  fprintf(replayOutput, "[%8u][tft] %d,%d %s\n", millis(), x, y, text);
+}
+
+//===============================================================
+// Delivers the websocket messages sent to the clients
+//===============================================================
+static void DeliverWebsocketMessages()
+{
+  AsyncWebSocket* websocket = AsyncWebSocket::HostInstance;
+  if (websocket == NULL)
+  {
+    return;
+  }
+
+  for (AsyncWebSocketClient& client : websocket->HostClients())
+  {
+    for (const std::string& message : client.HostTakeMessages())
+    {
+      fprintf(replayOutput, "[%8u][ws %u] %s\n", millis(), (unsigned int)client.id(), message.c_str());
+    }
+  }
+}
+
+//===============================================================
+// Returns the number of interrupt inputs handled by the main task
+//===============================================================
+static uint32_t GetInputsHandled()
+{
+  return Metrics.GetCounter(eMetricInputEventsEncoder) +
+    Metrics.GetCounter(eMetricInputEventsButton) +
+    Metrics.GetCounter(eMetricInputEventsLever);
+}
+
+//===============================================================
+// Starts the latency measurement of an input interrupt (inputs of
+// the setup are not handled by the main task)
+//===============================================================
+static void StartInputLatency()
+{
+  if (mainTaskHandle != NULL &&
+    !replayInputPending)
+  {
+    replayInputPending = true;
+    replayInputTime_ms = millis();
+    replayInputsHandled = GetInputsHandled();
+  }
+}
+
+//===============================================================
+// Stops the latency measurement, once the main task handled the
+// input
+//===============================================================
+static void UpdateInputLatency()
+{
+  if (replayInputPending &&
+    GetInputsHandled() != replayInputsHandled)
+  {
+    replayInputPending = false;
+    replayMaxInputLatency_ms = std::max(replayMaxInputLatency_ms, millis() - replayInputTime_ms);
+  }
+}
+
+//===============================================================
+// Checks the recalculations and broadcasts of the last encoder
+// step, before the next event is replayed
+//===============================================================
+static void FinishEncoderStep()
+{
+  if (!replayStepPending)
+  {
+    return;
+  }
+  replayStepPending = false;
+
+  uint32_t recalculations = Statemachine.GetMixtureRevision() - replayStepRevision;
+  uint32_t broadcasts = Metrics.GetCounter(eMetricWifiBroadcastsSent) - replayStepBroadcasts;
+  replaySteps++;
+  if ((replayStepOnDashboard ? recalculations != 1 : recalculations != 0) ||
+    broadcasts > 1)
+  {
+    replayStepsFailed++;
+    fprintf(stderr, "Encoder step at %u ms: %u recalculations, %u broadcasts\n", replayStepTime_ms, recalculations, broadcasts);
+  }
+}
+
+//===============================================================
+// Starts counting the recalculations and broadcasts of an encoder
+// step
+//===============================================================
+static void StartEncoderStep()
+{
+  if (mainTaskHandle == NULL)
+  {
+    return;
+  }
+
+  replayStepPending = true;
+  replayStepTime_ms = millis();
+  replayStepOnDashboard = Statemachine.GetCurrentState() == eDashboard;
+  replayStepRevision = Statemachine.GetMixtureRevision();
+  replayStepBroadcasts = Metrics.GetCounter(eMetricWifiBroadcastsSent);
+}
+
+//===============================================================
+// Returns the upper bound of the worst-case loop duration from
+// the exported histogram (cumulative buckets)
+//===============================================================
+static uint32_t GetMaxLoopDuration_us()
+{
+  StreamString metrics;
+  Metrics.PrintMetrics(metrics);
+
+  std::istringstream lines(metrics.c_str());
+  std::string line;
+  std::vector<std::pair<uint32_t, uint32_t>> buckets;
+  uint32_t count = 0;
+  while (std::getline(lines, line))
+  {
+    uint32_t bound = 0;
+    uint32_t value = 0;
+    if (sscanf(line.c_str(), "mixer_loop_duration_us_bucket{le=\"%u\"} %u", &bound, &value) == 2)
+    {
+      buckets.push_back({ bound, value });
+    }
+    sscanf(line.c_str(), "mixer_loop_duration_us_count %u", &count);
+  }
+
+  for (const auto& bucket : buckets)
+  {
+    if (bucket.second == count)
+    {
+      return bucket.first;
+    }
+  }
+  return UINT32_MAX;
+}
+
+//===============================================================
+// Replays an event
+//===============================================================
+static void Replay(const ReplayEvent& event)
+{
+  AsyncWebSocket* websocket = AsyncWebSocket::HostInstance;
+  FinishEncoderStep();
+  if (event.Type == eReplayEncoder)
+  {
+    StartEncoderStep();
+  }
+  if (event.Type == eReplayEncoder ||
+    event.Type == eReplayButton ||
+    event.Type == eReplayLever)
+  {
+    StartInputLatency();
+  }
+
+  switch (event.Type)
+  {
+    case eReplayEncoder:
+      fprintf(replayOutput, "[%8u][replay] encoder %d\n", millis(), event.Value);
+      HostPulseCounterCount(event.Value * ENCODER_DIRECTION * ENCODER_COUNTS_PER_DETENT);
+      break;
+    case eReplayButton:
+      fprintf(replayOutput, "[%8u][replay] button %d\n", millis(), event.Value);
+      HostTriggerPin(PIN_ENCODER_BUTTON, event.Value ? LOW : HIGH);
+      break;
+    case eReplayLever:
+      fprintf(replayOutput, "[%8u][replay] lever %d\n", millis(), event.Value);
+      HostTriggerPin(PIN_PUMPS_ENABLE, event.Value ? LOW : HIGH);
+      break;
+    case eReplayConnect:
+      fprintf(replayOutput, "[%8u][replay] websocket %d connect\n", millis(), event.Value);
+      if (websocket == NULL)
+      {
+        fprintf(replayOutput, "[%8u][replay] no websocket\n", millis());
+        break;
+      }
+      replayClients[event.Value] = websocket->HostConnect()->id();
+      break;
+    case eReplayDisconnect:
+      fprintf(replayOutput, "[%8u][replay] websocket %d disconnect\n", millis(), event.Value);
+      if (websocket != NULL &&
+        replayClients.count(event.Value) > 0)
+      {
+        websocket->HostDisconnect(replayClients[event.Value]);
+      }
+      break;
+    case eReplayText:
+    case eReplayBinary:
+    {
+      fprintf(replayOutput, "[%8u][replay] websocket %d %s %s\n", millis(), event.Value, event.Type == eReplayText ? "text" : "binary", event.Payload.c_str());
+      if (websocket == NULL ||
+        replayClients.count(event.Value) == 0)
+      {
+        break;
+      }
+
+      std::string data = event.Payload;
+      if (event.Type == eReplayBinary)
+      {
+        data.clear();
+        for (size_t index = 0; index + 1 < event.Payload.size(); index += 2)
+        {
+          data += (char)strtol(event.Payload.substr(index, 2).c_str(), NULL, 16);
+        }
+      }
+      websocket->HostReceive(replayClients[event.Value], event.Type == eReplayText ? WS_TEXT : WS_BINARY, (const uint8_t*)data.data(), data.size());
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+//===============================================================
+// Loop task of the Arduino core (one loop per tick on the host)
+//===============================================================
+static void LoopTask(void* arg)
+{
+  setup();
+  while (true)
+  {
+    loop();
+    vTaskDelay(1);
+  }
+}
+
+//===============================================================
+// Compares the output with the golden file (or updates it)
+//===============================================================
+static bool CompareGolden(const std::string& output, const char* goldenPath, bool update)
+{
+  if (update)
+  {
+    std::ofstream golden(goldenPath, std::ios::binary);
+    golden << output;
+    printf("Updated %s\n", goldenPath);
+    return true;
+  }
+
+  std::ifstream golden(goldenPath, std::ios::binary);
+  std::stringstream content;
+  content << golden.rdbuf();
+  std::string expected = content.str();
+  if (expected == output)
+  {
+    return true;
+  }
+
+  // Keep the output for a diff and print the first difference
+  std::string actualPath = std::filesystem::path(goldenPath).filename().replace_extension(".actual").string();
+  std::ofstream actual(actualPath, std::ios::binary);
+  actual << output;
+
+  std::istringstream expectedLines(expected);
+  std::istringstream actualLines(output);
+  std::string expectedLine;
+  std::string actualLine;
+  for (int line = 1; ; line++)
+  {
+    bool hasExpected = (bool)std::getline(expectedLines, expectedLine);
+    bool hasActual = (bool)std::getline(actualLines, actualLine);
+    if (!hasExpected && !hasActual)
+    {
+      break;
+    }
+    if (!hasExpected || !hasActual || expectedLine != actualLine)
+    {
+      fprintf(stderr, "%s:%d: differs from %s\n  expected: %s\n  actual:   %s\n", goldenPath, line, actualPath.c_str(),
+        hasExpected ? expectedLine.c_str() : "<end>", hasActual ? actualLine.c_str() : "<end>");
+      break;
+    }
+  }
+  return false;
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <trace> [<golden> [--update]]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<ReplayEvent> events;
+  if (!ParseTrace(argv[1], events))
+  {
+    fprintf(stderr, "Could not read trace '%s'\n", argv[1]);
+    return 2;
+  }
+
+  uint32_t end_ms = events.empty() ? REPLAY_TAIL_MS : events.back().Time_ms;
+  if (events.empty() ||
+    events.back().Type != eReplayEnd)
+  {
+    end_ms += REPLAY_TAIL_MS;
+  }
+
+  // Record everything into one output
+  char* outputBuffer = NULL;
+  size_t outputLength = 0;
+  replayOutput = open_memstream(&outputBuffer, &outputLength);
+  HostSetLogOutput(replayOutput, ESP_LOG_INFO);
+  HostSetPinWriteHandler(OnPinWrite);
+  HostDisplayTextHandler = OnDisplayText;
+
+  // Flash content of a device with wifi enabled
+  LoadDataFolder();
+#if defined(WIFI_MIXER)
+  Preferences settings;
+  settings.begin(SETTINGS_NAME, false);
+  settings.putBool(KEY_WIFIMODE, true);
+  settings.end();
+#endif
+
+  // Run the firmware and replay the events on their time
+  xTaskCreate(LoopTask, "loopTask", 8192, NULL, 1, NULL);
+  size_t next = 0;
+  for (uint32_t time_ms = 0; time_ms <= end_ms; time_ms += REPLAY_STEP_MS)
+  {
+    HostRunTasks((uint64_t)time_ms * 1000);
+    UpdateInputLatency();
+    while (next < events.size() &&
+      events[next].Time_ms <= time_ms)
+    {
+      Replay(events[next++]);
+    }
+    DeliverWebsocketMessages();
+  }
+
+  FinishEncoderStep();
+  fclose(replayOutput);
+  std::string output(outputBuffer, outputLength);
+  free(outputBuffer);
+  printf("Replayed %u events in %u ms\n", (unsigned int)events.size(), end_ms);
+
+  // Worst-case loop latency (not part of the golden output)
+  uint32_t maxLoopDuration_us = GetMaxLoopDuration_us();
+  printf("Worst-case loop duration <= %u us (limit %u us), input latency %u ms (limit %u ms)\n",
+    maxLoopDuration_us, REPLAY_MAX_LOOP_US, replayMaxInputLatency_ms, REPLAY_MAX_INPUT_MS);
+  bool checksOk = maxLoopDuration_us <= REPLAY_MAX_LOOP_US &&
+    replayMaxInputLatency_ms <= REPLAY_MAX_INPUT_MS &&
+    !replayInputPending;
+  if (!checksOk)
+  {
+    fprintf(stderr, "Loop latency exceeds its limit%s\n", replayInputPending ? " (input not handled)" : "");
+  }
+  printf("Encoder steps: %u, with more than one recalculation or broadcast: %u\n", replaySteps, replayStepsFailed);
+  checksOk = checksOk && replayStepsFailed == 0;
+
+  if (argc < 3)
+  {
+    fwrite(output.data(), 1, output.size(), stdout);
+    return checksOk ? 0 : 1;
+  }
+  return CompareGolden(output, argv[2], argc > 3 && strcmp(argv[3], "--update") == 0) && checksOk ? 0 : 1;
+}
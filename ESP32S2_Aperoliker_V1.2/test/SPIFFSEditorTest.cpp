@@ -0,0 +1,332 @@
+/**
+ * Host tests for the uploads and listings of the SPIFFS editor
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <inttypes.h>
+#include <malloc.h>
+#include <new>
+#include <string>
+#include "TestHelper.h"
+#include "SPIFFSEditor.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#define LIST_FILE_COUNT       200
+
+//===============================================================
+// Global variables
+//===============================================================
+static int64_t heapBytes = 0;
+static int64_t heapPeakBytes = 0;
+
+//===============================================================
+// Counts the live and peak heap bytes of all allocations with new
+//===============================================================
+void* operator new(size_t size)
+{
+  void* pointer = malloc(size != 0 ? size : 1);
+  if (pointer == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  heapBytes += malloc_usable_size(pointer);
+  heapPeakBytes = max(heapPeakBytes, heapBytes);
+  return pointer;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+  heapBytes -= malloc_usable_size(pointer);
+  free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+  operator delete(pointer);
+}
+
+void operator delete(void* pointer, size_t size) noexcept
+{
+  operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t size) noexcept
+{
+  operator delete(pointer);
+}
+
+//===============================================================
+// Starts a peak heap measurement
+//===============================================================
+static int64_t StartHeapPeak()
+{
+  heapPeakBytes = heapBytes;
+  return heapBytes;
+}
+
+//===============================================================
+// Print, which only counts the printed bytes
+//===============================================================
+class CountingPrint : public Print
+{
+  public:
+    using Print::write;
+    size_t write(uint8_t value) override { Length++; return 1; }
+    size_t Length = 0;
+};
+
+//===============================================================
+// Creates an upload request of the editor
+//===============================================================
+static AsyncWebServerRequest* CreateUpload(const char* path, size_t length)
+{
+  AsyncWebServerRequest* request = new AsyncWebServerRequest(HTTP_POST, "/edit");
+  request->HostAddParam("data", path, true, true);
+  request->HostSetContentLength(length);
+  return request;
+}
+
+//===============================================================
+// Sends an upload chunk to the editor
+//===============================================================
+static void SendChunk(SPIFFSEditor& editor, AsyncWebServerRequest* request, const char* path, size_t index, const std::string& data, bool final)
+{
+  editor.handleUpload(request, path, index, (uint8_t*)data.data(), data.size(), final);
+}
+
+//===============================================================
+// Returns the progress answer of the editor
+//===============================================================
+static std::string GetProgress(SPIFFSEditor& editor)
+{
+  AsyncWebServerRequest request(HTTP_GET, "/edit");
+  request.HostAddParam("progress", "");
+  editor.handleRequest(&request);
+  return request.HostResponse()->HostContent();
+}
+
+//===============================================================
+// Returns the content of a file
+//===============================================================
+static std::string ReadFile(const char* path)
+{
+  std::string content;
+  File file = Storage.Open(path);
+  while (file.available())
+  {
+    content += (char)file.read();
+  }
+  return content;
+}
+
+//===============================================================
+// Upload in chunks reports its progress and replaces the file
+//===============================================================
+static void TestUpload()
+{
+  SPIFFSEditor editor;
+  std::string data(EDITOR_UPLOAD_BUFFER_SIZE + 100, 'a');
+  AsyncWebServerRequest* request = CreateUpload("/upload.txt", data.size());
+
+  SendChunk(editor, request, "/upload.txt", 0, data.substr(0, 1000), false);
+  CHECK(GetProgress(editor) == "{\"received\":1000,\"total\":4196}");
+  CHECK(Storage.Exists("/upload.txt.tmp"));
+  SendChunk(editor, request, "/upload.txt", 1000, data.substr(1000), true);
+  editor.handleRequest(request);
+
+  CHECK_EQUAL(200, request->HostResponse()->HostCode());
+  CHECK(ReadFile("/upload.txt") == data);
+  CHECK(!Storage.Exists("/upload.txt.tmp"));
+
+  // Progress ends with the request
+  request->HostDisconnect();
+  delete request;
+  CHECK(GetProgress(editor) == "{\"received\":0,\"total\":0}");
+}
+
+//===============================================================
+// A second upload is rejected while the first one is running,
+// the progress stays the one of the first upload
+//===============================================================
+static void TestConcurrentUploads()
+{
+  SPIFFSEditor editor;
+  AsyncWebServerRequest* first = CreateUpload("/first.txt", 6);
+  AsyncWebServerRequest* second = CreateUpload("/second.txt", 100);
+
+  SendChunk(editor, first, "/first.txt", 0, "abc", false);
+  SendChunk(editor, second, "/second.txt", 0, std::string(50, 'b'), false);
+  CHECK(second->_tempObject == NULL);
+  CHECK(GetProgress(editor) == "{\"received\":3,\"total\":6}");
+  SendChunk(editor, second, "/second.txt", 50, std::string(50, 'b'), true);
+  editor.handleRequest(second);
+  CHECK_EQUAL(409, second->HostResponse()->HostCode());
+  CHECK(!Storage.Exists("/second.txt"));
+  CHECK(GetProgress(editor) == "{\"received\":3,\"total\":6}");
+
+  // Rejected request does not end the running upload
+  second->HostDisconnect();
+  delete second;
+  SendChunk(editor, first, "/first.txt", 3, "def", true);
+  editor.handleRequest(first);
+  CHECK_EQUAL(200, first->HostResponse()->HostCode());
+  CHECK(ReadFile("/first.txt") == "abcdef");
+  first->HostDisconnect();
+  delete first;
+
+  // Next upload is accepted
+  AsyncWebServerRequest* third = CreateUpload("/second.txt", 3);
+  SendChunk(editor, third, "/second.txt", 0, "ghi", true);
+  editor.handleRequest(third);
+  CHECK_EQUAL(200, third->HostResponse()->HostCode());
+  CHECK(ReadFile("/second.txt") == "ghi");
+  third->HostDisconnect();
+  delete third;
+}
+
+//===============================================================
+// Aborted upload removes the temp file and keeps the old file
+//===============================================================
+static void TestAbortedUpload()
+{
+  SPIFFSEditor editor;
+  AsyncWebServerRequest* request = CreateUpload("/first.txt", 100);
+  SendChunk(editor, request, "/first.txt", 0, "new", false);
+  request->HostDisconnect();
+  delete request;
+
+  CHECK(!Storage.Exists("/first.txt.tmp"));
+  CHECK(ReadFile("/first.txt") == "abcdef");
+  CHECK(GetProgress(editor) == "{\"received\":0,\"total\":0}");
+}
+
+//===============================================================
+// Sends the listing of the root directory like before the
+// streaming (one growing string, copied into the response)
+//===============================================================
+static void SendStringListing(AsyncWebServerRequest* request)
+{
+  File dir = Storage.Open("/");
+  String output = "[";
+  File entry = dir.openNextFile();
+  while (entry)
+  {
+    if (output != "[")
+    {
+      output += ',';
+    }
+    output += "{\"type\":\"";
+    output += "file";
+    output += "\",\"name\":\"";
+    output += String(entry.name());
+    output += "\",\"size\":";
+    output += String(entry.size());
+    output += "}";
+    entry = dir.openNextFile();
+  }
+  dir.close();
+  output += "]";
+  request->send(200, "application/json", output);
+}
+
+//===============================================================
+// The streamed listing of a large directory equals the string
+// listing, its peak heap is a fraction of the listing size. The
+// string listing needs more than the listing size
+//===============================================================
+static void TestListingPeakHeap()
+{
+  SPIFFSEditor editor;
+  for (int index = 0; index < LIST_FILE_COUNT; index++)
+  {
+    char path[48];
+    snprintf(path, sizeof(path), "/listing_file_with_long_name_%03d.txt", index);
+    File file = Storage.Open(path, FILE_WRITE);
+    file.print(path);
+    file.close();
+  }
+
+  // Same content
+  AsyncWebServerRequest streamed(HTTP_GET, "/edit");
+  streamed.HostAddParam("list", "/");
+  editor.handleRequest(&streamed);
+  AsyncWebServerRequest string(HTTP_GET, "/edit");
+  SendStringListing(&string);
+  CHECK(streamed.HostResponse()->HostContent() == string.HostResponse()->HostContent());
+
+  // Peak heap without the sent content and without the entry list,
+  // which the host file system copies into an opened directory
+  int64_t start = StartHeapPeak();
+  File dir = Storage.Open("/");
+  int64_t directory_Bytes = heapBytes - start;
+  dir.close();
+
+  AsyncWebServerResponse::HostSetKeepContent(false);
+  AsyncWebServerRequest streamedPeak(HTTP_GET, "/edit");
+  streamedPeak.HostAddParam("list", "/");
+  start = StartHeapPeak();
+  editor.handleRequest(&streamedPeak);
+  int64_t streamedPeak_Bytes = heapPeakBytes - start - directory_Bytes;
+
+  AsyncWebServerRequest stringPeak(HTTP_GET, "/edit");
+  start = StartHeapPeak();
+  SendStringListing(&stringPeak);
+  int64_t stringPeak_Bytes = heapPeakBytes - start - directory_Bytes;
+  AsyncWebServerResponse::HostSetKeepContent(true);
+
+  size_t length = streamedPeak.HostResponse()->HostLength();
+  printf("Listing of %d files (%u bytes): peak heap %" PRId64 " bytes streamed, %" PRId64 " bytes as string\n",
+    LIST_FILE_COUNT, (unsigned int)length, streamedPeak_Bytes, stringPeak_Bytes);
+  CHECK(length > LIST_FILE_COUNT * 60);
+  CHECK(streamedPeak_Bytes < (int64_t)length / 10);
+  CHECK(stringPeak_Bytes > (int64_t)length);
+}
+
+//===============================================================
+// The system info is printed without holding it in memory, the
+// string getter needs at least its size
+//===============================================================
+static void TestSystemInfoPeakHeap()
+{
+  CountingPrint output;
+  int64_t start = StartHeapPeak();
+  Systemhelper.PrintSystemInfo(output);
+  int64_t printedPeak_Bytes = heapPeakBytes - start;
+
+  start = StartHeapPeak();
+  String info = Systemhelper.GetSystemInfoString();
+  int64_t stringPeak_Bytes = heapPeakBytes - start;
+
+  printf("System info (%u bytes): peak heap %" PRId64 " bytes printed, %" PRId64 " bytes as string\n",
+    (unsigned int)output.Length, printedPeak_Bytes, stringPeak_Bytes);
+  CHECK_EQUAL(info.length(), output.Length);
+  CHECK(printedPeak_Bytes < (int64_t)output.Length / 4);
+  CHECK(stringPeak_Bytes >= (int64_t)output.Length);
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  Storage.Begin();
+  TestUpload();
+  TestConcurrentUploads();
+  TestAbortedUpload();
+  TestListingPeakHeap();
+  TestSystemInfoPeakHeap();
+  return TestResult("SPIFFSEditorTest");
+}
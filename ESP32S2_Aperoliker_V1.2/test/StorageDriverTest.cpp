@@ -0,0 +1,165 @@
+/**
+ * Host tests for the storage driver
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include "TestHelper.h"
+#include "StorageDriver.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#if defined(STORAGE_LITTLEFS)
+#define TEST_FS       LittleFS
+#else
+#define TEST_FS       SPIFFS
+#endif
+
+//===============================================================
+// A partition, which can not be mounted (other file system), is
+// not formatted and the storage is not available
+//===============================================================
+static void TestMountFailure()
+{
+  TEST_FS.HostClear();
+  TEST_FS.HostSetMountable(false);
+
+  StorageDriver storage;
+  CHECK(!storage.Begin());
+  CHECK(!storage.IsAvailable());
+  CHECK(!TEST_FS.HostWasFormatted());
+  CHECK(!storage.Open("/pourlog.bin", FILE_WRITE));
+  CHECK(!storage.Exists("/pourlog.bin"));
+  CHECK(storage.OpenCached("/pourlog.bin") == NULL);
+  CHECK_EQUAL(0, storage.GetTotalBytes());
+}
+
+//===============================================================
+// An explicit format mounts the partition
+//===============================================================
+static void TestExplicitFormat()
+{
+  TEST_FS.HostSetMountable(false);
+
+  StorageDriver storage;
+  CHECK(!storage.Begin());
+  CHECK(storage.Format());
+  CHECK(TEST_FS.HostWasFormatted());
+  CHECK(storage.IsAvailable());
+
+  File file = storage.Open("/test.txt", FILE_WRITE);
+  CHECK(file);
+  file.print("formatted");
+  file.close();
+  CHECK(storage.Exists("/test.txt"));
+}
+
+//===============================================================
+// Existing files are kept when mounting
+//===============================================================
+static void TestMountKeepsFiles()
+{
+  TEST_FS.HostClear();
+  TEST_FS.HostSetMountable(true);
+  File file = TEST_FS.open("/keep.txt", FILE_WRITE);
+  file.print("keep");
+  file.close();
+
+  StorageDriver storage;
+  CHECK(storage.Begin());
+  CHECK(storage.Exists("/keep.txt"));
+}
+
+//===============================================================
+// Cached read handles are reused and dropped on writes
+//===============================================================
+static void TestCachedHandles()
+{
+  TEST_FS.HostClear();
+  TEST_FS.HostSetMountable(true);
+
+  StorageDriver storage;
+  CHECK(storage.Begin());
+  File file = storage.Open("/cache.txt", FILE_WRITE);
+  file.print("first");
+  file.close();
+
+  // Reused handle is positioned at the file start
+  File* cached = storage.OpenCached("/cache.txt");
+  CHECK(cached != NULL);
+  CHECK_EQUAL('f', cached->read());
+  storage.CloseCached(cached);
+  File* reused = storage.OpenCached("/cache.txt");
+  CHECK(reused == cached);
+  CHECK_EQUAL(0, reused->position());
+
+  // Handle in use stays valid while the file is written, the next
+  // request reads the new content
+  file = storage.Open("/cache.txt", FILE_WRITE);
+  file.print("second");
+  file.close();
+  CHECK(*reused);
+  storage.CloseCached(reused);
+  cached = storage.OpenCached("/cache.txt");
+  CHECK(cached != NULL);
+  CHECK_EQUAL('s', cached->read());
+  storage.CloseCached(cached);
+
+  // Missing files and directories are not cached
+  CHECK(storage.OpenCached("/missing.txt") == NULL);
+}
+
+//===============================================================
+// Content hashes are cached until the file is changed
+//===============================================================
+static void TestContentHash()
+{
+  TEST_FS.HostClear();
+  TEST_FS.HostSetMountable(true);
+
+  StorageDriver storage;
+  CHECK(storage.Begin());
+  File file = storage.Open("/hash.txt", FILE_WRITE);
+  file.print("first");
+  file.close();
+
+  uint32_t hash = 0;
+  CHECK(storage.GetContentHash("/hash.txt", hash));
+  CHECK_EQUAL(esp_rom_crc32_le(0, (const uint8_t*)"first", 5), hash);
+
+  // Same size, new content
+  file = storage.Open("/hash.txt", FILE_WRITE);
+  file.print("other");
+  file.close();
+  CHECK(storage.GetContentHash("/hash.txt", hash));
+  CHECK_EQUAL(esp_rom_crc32_le(0, (const uint8_t*)"other", 5), hash);
+
+  // Replaced by a rename, removed
+  file = storage.Open("/hash.tmp", FILE_WRITE);
+  file.print("third");
+  file.close();
+  CHECK(storage.Rename("/hash.tmp", "/hash.txt"));
+  CHECK(storage.GetContentHash("/hash.txt", hash));
+  CHECK_EQUAL(esp_rom_crc32_le(0, (const uint8_t*)"third", 5), hash);
+  CHECK(storage.Remove("/hash.txt"));
+  CHECK(!storage.GetContentHash("/hash.txt", hash));
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  TestMountFailure();
+  TestExplicitFormat();
+  TestMountKeepsFiles();
+  TestCachedHandles();
+  TestContentHash();
+  return TestResult("StorageDriverTest");
+}
@@ -0,0 +1,76 @@
+/**
+ * Includes the check functions for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef TESTHELPER_H
+#define TESTHELPER_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <stdio.h>
+#include <math.h>
+
+//===============================================================
+// Global variables
+//===============================================================
+inline int testChecks = 0;
+inline int testFailures = 0;
+
+//===============================================================
+// Defines
+//===============================================================
+// Checks a condition, failures are printed with file and line
+#define CHECK(condition) \
+  do \
+  { \
+    testChecks++; \
+    if (!(condition)) \
+    { \
+      testFailures++; \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+    } \
+  } while (0)
+
+// Checks two integer values for equality, failures print both values
+#define CHECK_EQUAL(expected, actual) \
+  do \
+  { \
+    testChecks++; \
+    long long expectedValue = (long long)(expected); \
+    long long actualValue = (long long)(actual); \
+    if (expectedValue != actualValue) \
+    { \
+      testFailures++; \
+      fprintf(stderr, "%s:%d: %s == %s failed: %lld != %lld\n", __FILE__, __LINE__, #expected, #actual, expectedValue, actualValue); \
+    } \
+  } while (0)
+
+// Checks two floating point values for equality within a tolerance
+#define CHECK_NEAR(expected, actual, tolerance) \
+  do \
+  { \
+    testChecks++; \
+    double expectedValue = (double)(expected); \
+    double actualValue = (double)(actual); \
+    if (fabs(expectedValue - actualValue) > (tolerance)) \
+    { \
+      testFailures++; \
+      fprintf(stderr, "%s:%d: %s ~ %s failed: %f != %f\n", __FILE__, __LINE__, #expected, #actual, expectedValue, actualValue); \
+    } \
+  } while (0)
+
+//===============================================================
+// Prints the result, returns the process exit code
+//===============================================================
+inline int TestResult(const char* name)
+{
+  printf("%s: %d checks, %d failures\n", name, testChecks, testFailures);
+  return testFailures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,291 @@
+/**
+ * Host tests and page load measurement of the web assets. The
+ * assets are built by tools/BuildWebAssets.py (test fixture) and
+ * served by the web asset handler
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "TestHelper.h"
+#include "WebAssetHandler.h"
+
+//===============================================================
+// Defines
+//===============================================================
+// Assumed soft AP link of a phone (page load model)
+#define TEST_LINK_BYTES_PER_MS    125     // 1 Mbit/s payload throughput
+#define TEST_ROUND_TRIP_MS        20      // Per request
+
+//===============================================================
+// Structs
+//===============================================================
+// Cached response of the browser
+struct BrowserEntry
+{
+  String ETag;
+  String CacheControl;
+};
+
+// Result of a page visit
+struct VisitResult
+{
+  size_t Requests = 0;
+  size_t NotModified = 0;
+  size_t Bytes = 0;
+  double Handler_us = 0;
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+static AsyncWebServer server(80);
+
+//===============================================================
+// Returns the content of a host file
+//===============================================================
+static std::string ReadHostFile(const std::filesystem::path& path)
+{
+  std::ifstream input(path, std::ios::binary);
+  std::stringstream content;
+  content << input.rdbuf();
+  return content.str();
+}
+
+//===============================================================
+// Replaces the storage content with the files of a host folder
+//===============================================================
+static void LoadFolder(const char* folder)
+{
+  SPIFFS.HostClear();
+  for (const auto& entry : std::filesystem::directory_iterator(folder))
+  {
+    std::string data = ReadHostFile(entry.path());
+    File file = Storage.Open(("/" + entry.path().filename().string()).c_str(), FILE_WRITE);
+    file.write((const uint8_t*)data.data(), data.size());
+    file.close();
+  }
+}
+
+//===============================================================
+// Returns the hashed files of the built folder (requested names)
+//===============================================================
+static std::vector<std::string> GetHashedFiles()
+{
+  std::vector<std::string> files;
+  std::regex pattern("^(.*\\.[0-9a-f]{8}\\.(js|css))\\.gz$");
+  for (const auto& entry : std::filesystem::directory_iterator(WEB_ASSET_BUILD_DIR))
+  {
+    std::smatch match;
+    std::string name = entry.path().filename().string();
+    if (std::regex_match(name, match, pattern))
+    {
+      files.push_back("/" + match[1].str());
+    }
+  }
+  return files;
+}
+
+//===============================================================
+// Returns the quoted content hash of a stored file
+//===============================================================
+static String GetETag(const char* path)
+{
+  std::string data = ReadHostFile(std::string(WEB_ASSET_BUILD_DIR) + path);
+  char etag[16];
+  snprintf(etag, sizeof(etag), "\"%08x\"", esp_rom_crc32_le(0, (const uint8_t*)data.data(), data.size()));
+  return etag;
+}
+
+//===============================================================
+// Requests a file (with optional ETag), returns the response
+//===============================================================
+static AsyncWebServerResponse* Get(AsyncWebServerRequest& request, const String& etag = String())
+{
+  if (etag.length() > 0)
+  {
+    request.HostAddHeader("If-None-Match", etag);
+  }
+  return server.HostHandle(&request);
+}
+
+//===============================================================
+// Visits a page, cached files with immutable cache control are not
+// requested again, others are revalidated by their ETag
+//===============================================================
+static VisitResult Visit(const std::vector<std::string>& urls, std::map<std::string, BrowserEntry>& cache)
+{
+  VisitResult result;
+  for (const std::string& url : urls)
+  {
+    auto cached = cache.find(url);
+    if (cached != cache.end() &&
+      cached->second.CacheControl.indexOf("immutable") >= 0)
+    {
+      continue;
+    }
+
+    AsyncWebServerRequest request(HTTP_GET, url.c_str());
+    auto start = std::chrono::steady_clock::now();
+    AsyncWebServerResponse* response = Get(request, cached != cache.end() ? cached->second.ETag : String());
+    result.Handler_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    result.Requests++;
+    result.Bytes += response->HostContent().size();
+    if (response->HostCode() == 304)
+    {
+      result.NotModified++;
+    }
+    if (response->HostHeader("ETag").length() > 0)
+    {
+      cache[url] = { response->HostHeader("ETag"), response->HostHeader("Cache-Control") };
+    }
+  }
+  return result;
+}
+
+//===============================================================
+// Prints a page visit with the modeled load time
+//===============================================================
+static void PrintVisit(const char* name, const VisitResult& result)
+{
+  printf("%-22s %2d requests (%d not modified), %6d bytes, %4d ms load (model), %6.1f us handler\n",
+    name, (int)result.Requests, (int)result.NotModified, (int)result.Bytes,
+    (int)(result.Requests * TEST_ROUND_TRIP_MS + result.Bytes / TEST_LINK_BYTES_PER_MS), result.Handler_us);
+}
+
+//===============================================================
+// Gzipped files are sent with content encoding, hashed files are
+// immutable, the ETag is the content hash
+//===============================================================
+static void TestBuiltAssets()
+{
+  LoadFolder(WEB_ASSET_BUILD_DIR);
+
+  AsyncWebServerRequest page(HTTP_GET, "/");
+  AsyncWebServerResponse* response = Get(page);
+  CHECK_EQUAL(200, response->HostCode());
+  CHECK(response->HostHeader("Content-Encoding") == "gzip");
+  CHECK(response->HostHeader("Cache-Control") == WEB_ASSET_CACHE_REVALIDATE);
+  CHECK(response->HostHeader("ETag") == GetETag("/index.html.gz"));
+  CHECK(response->HostContent() == ReadHostFile(WEB_ASSET_BUILD_DIR "/index.html.gz"));
+
+  // Hashed scripts and style sheet, the name contains the ETag
+  std::vector<std::string> hashedFiles = GetHashedFiles();
+  CHECK_EQUAL(3, hashedFiles.size());
+  for (const std::string& url : hashedFiles)
+  {
+    AsyncWebServerRequest request(HTTP_GET, url.c_str());
+    response = Get(request);
+    CHECK_EQUAL(200, response->HostCode());
+    CHECK(response->HostHeader("Content-Encoding") == "gzip");
+    CHECK(response->HostHeader("Cache-Control") == WEB_ASSET_CACHE_IMMUTABLE);
+    std::smatch match;
+    CHECK(std::regex_search(url, match, std::regex("\\.([0-9a-f]{8})\\.[a-z]+$")));
+    CHECK(response->HostHeader("ETag") == ("\"" + match[1].str() + "\"").c_str());
+  }
+
+  // Bitmaps of the display are not gzipped
+  AsyncWebServerRequest bitmap(HTTP_GET, "/LogoAperoliker.bmp");
+  response = Get(bitmap);
+  CHECK_EQUAL(200, response->HostCode());
+  CHECK(response->HostHeader("Content-Encoding") == "");
+  CHECK(response->HostHeader("Cache-Control") == WEB_ASSET_CACHE_REVALIDATE);
+
+  // Missing files are not handled
+  AsyncWebServerRequest missing(HTTP_GET, "/missing.js");
+  CHECK(server.HostFindHandler(&missing) == NULL);
+}
+
+//===============================================================
+// Revalidation with the current ETag is answered with 304, a
+// changed file gets a new ETag
+//===============================================================
+static void TestRevalidation()
+{
+  LoadFolder(WEB_ASSET_BUILD_DIR);
+  String etag = GetETag("/index.html.gz");
+
+  AsyncWebServerRequest unchanged(HTTP_GET, "/");
+  AsyncWebServerResponse* response = Get(unchanged, etag);
+  CHECK_EQUAL(304, response->HostCode());
+  CHECK(response->HostContent().empty());
+  CHECK(response->HostHeader("ETag") == etag);
+
+  // File written without a clock (same size, same write time)
+  std::string data = ReadHostFile(WEB_ASSET_BUILD_DIR "/index.html.gz");
+  data[data.size() - 1] ^= 0xFF;
+  File file = Storage.Open("/index.html.gz", FILE_WRITE);
+  file.write((const uint8_t*)data.data(), data.size());
+  file.close();
+
+  AsyncWebServerRequest changed(HTTP_GET, "/");
+  response = Get(changed, etag);
+  CHECK_EQUAL(200, response->HostCode());
+  CHECK(response->HostHeader("ETag") != etag);
+  CHECK(response->HostContent() == data);
+}
+
+//===============================================================
+// Measures the bytes and requests of the first and the repeated
+// page visit (raw data folder and built assets)
+//===============================================================
+static void TestPageLoad()
+{
+  std::vector<std::string> rawUrls = { "/", "/index.css", "/draggableDoughnutChart.js", "/index.js", "/favicon.ico", "/logo_aperoliker.svg" };
+  std::vector<std::string> builtUrls = { "/" };
+  for (const std::string& url : GetHashedFiles())
+  {
+    builtUrls.push_back(url);
+  }
+  builtUrls.push_back("/favicon.ico");
+  builtUrls.push_back("/logo_aperoliker.svg");
+
+  std::map<std::string, BrowserEntry> rawCache;
+  LoadFolder(WEB_ASSET_SOURCE_DIR);
+  VisitResult rawFirst = Visit(rawUrls, rawCache);
+  VisitResult rawRepeat = Visit(rawUrls, rawCache);
+
+  std::map<std::string, BrowserEntry> builtCache;
+  LoadFolder(WEB_ASSET_BUILD_DIR);
+  VisitResult builtFirst = Visit(builtUrls, builtCache);
+  VisitResult builtRepeat = Visit(builtUrls, builtCache);
+
+  PrintVisit("Raw first visit", rawFirst);
+  PrintVisit("Raw repeated visit", rawRepeat);
+  PrintVisit("Built first visit", builtFirst);
+  PrintVisit("Built repeated visit", builtRepeat);
+
+  CHECK_EQUAL(6, rawFirst.Requests);
+  CHECK_EQUAL(6, builtFirst.Requests);
+  CHECK(builtFirst.Bytes * 3 < rawFirst.Bytes);
+  CHECK_EQUAL(6, rawRepeat.NotModified);
+  CHECK_EQUAL(3, builtRepeat.Requests);
+  CHECK_EQUAL(3, builtRepeat.NotModified);
+  CHECK_EQUAL(0, builtRepeat.Bytes);
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  Storage.Begin();
+  server.addHandler(new WebAssetHandler());
+  TestBuiltAssets();
+  TestRevalidation();
+  TestPageLoad();
+  return TestResult("WebAssetTest");
+}
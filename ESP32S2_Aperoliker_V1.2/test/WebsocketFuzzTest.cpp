@@ -0,0 +1,381 @@
+/**
+ * Websocket message fuzz test. Runs the whole firmware (with wifi)
+ * on the virtual time of the host like the replay harness and sends
+ * truncated and random binary frames and text messages of a client.
+ * Structurally invalid frames must be answered as invalid, the
+ * mixture must stay valid and the firmware must still execute a
+ * valid frame afterwards.
+ *
+ * Benchmark: parser throughput of the binary frames and the text
+ * messages (host time, including the command queue)
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <chrono>
+#include <freertos/task.h>
+#include <string>
+#include <vector>
+#include "TestHelper.h"
+
+//===============================================================
+// Sketch (with the prototypes of the Arduino builder)
+//===============================================================
+void Main_Task(void* arg);
+void ISR_Pumps_Enable();
+void ISR_EncoderButton();
+bool ISR_EncoderDetent(int8_t direction);
+
+#include "../ESP32S2_Aperoliker_V1.2.ino"
+
+//===============================================================
+// Defines
+//===============================================================
+#define FUZZ_START_MS           4000    // Client connects after the intro
+#define FUZZ_MESSAGES_PER_MS    8       // Messages between two main task runs (below the command queue size)
+#define FUZZ_RANDOM_FRAMES      20000
+#define FUZZ_RANDOM_TEXTS       5000
+#define FUZZ_BENCHMARK_MESSAGES 40000
+
+//===============================================================
+// Constants
+//===============================================================
+static const char* InvalidFrame = "Invalid frame received!";
+static const char* TextCommands[] =
+{
+  "FULLUPDATE", "LIQUID_INCREMENT:1,10", "CYCLE_TIMESPAN:600", "PRESET_APPLY:1",
+  "PRESET_SAVE:2,Spritz", "PRESET_DELETE:2", "SAVE"
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+static uint32_t fuzzTime_ms = 0;
+static uint32_t fuzzClientID = 0;
+static uint32_t fuzzMessages = 0;
+
+//===============================================================
+// Loop task of the Arduino core (one loop per tick on the host)
+//===============================================================
+static void LoopTask(void* arg)
+{
+  setup();
+  while (true)
+  {
+    loop();
+    vTaskDelay(1);
+  }
+}
+
+//===============================================================
+// Runs the firmware for the given time
+//===============================================================
+static void Run(uint32_t duration_ms)
+{
+  for (uint32_t time_ms = 0; time_ms < duration_ms; time_ms++)
+  {
+    HostRunTasks((uint64_t)++fuzzTime_ms * 1000);
+  }
+}
+
+//===============================================================
+// Returns true, if the payload length is valid for the opcode
+// (see WifiFrameOpcode)
+//===============================================================
+static bool IsValidPayloadLength(uint8_t opcode, size_t payloadLength)
+{
+  switch (opcode)
+  {
+    case eFrameLiquidIncrement:
+      return payloadLength == 3 || payloadLength == 7;
+    case eFrameCycleTimespan:
+      return payloadLength == 2;
+    case eFrameSave:
+      return payloadLength == 0;
+    case eFramePresetApply:
+    case eFramePresetDelete:
+      return payloadLength == 1;
+    case eFramePresetSave:
+      return payloadLength >= 1 && payloadLength <= PRESET_NAME_LENGTH;
+    case eFrameFullUpdate:
+      return true;
+    default:
+      return false;
+  }
+}
+
+//===============================================================
+// Returns true, if the frame is structurally valid
+//===============================================================
+static bool IsValidFrame(const std::vector<uint8_t>& frame)
+{
+  return frame.size() >= WIFI_FRAME_HEADER_LENGTH &&
+    frame[0] == WIFI_FRAME_VERSION &&
+    IsValidPayloadLength(frame[1], frame.size() - WIFI_FRAME_HEADER_LENGTH);
+}
+
+//===============================================================
+// Sends a message of the client and returns true, if it was
+// answered as invalid frame. The main task runs after every few
+// messages
+//===============================================================
+static bool Send(AwsFrameType type, const uint8_t* data, size_t len)
+{
+  AsyncWebSocket* websocket = AsyncWebSocket::HostInstance;
+  websocket->HostReceive(fuzzClientID, type, data, len);
+  if (++fuzzMessages % FUZZ_MESSAGES_PER_MS == 0)
+  {
+    Run(1);
+  }
+
+  bool invalid = false;
+  for (const std::string& message : websocket->client(fuzzClientID)->HostTakeMessages())
+  {
+    invalid = invalid || message == InvalidFrame;
+  }
+  return invalid;
+}
+
+//===============================================================
+// Checks the mixture: clockwise ordered angles with the minimum
+// distance, which sum up to 360°
+//===============================================================
+static void CheckMixture()
+{
+  int16_t sum_Degrees = 0;
+  for (uint8_t liquid = 0; liquid < LIQUID_COUNT; liquid++)
+  {
+    int16_t angle_Degrees = Statemachine.GetAngle((MixtureLiquid)liquid);
+    int16_t distance_Degrees = GetDistanceDegrees(angle_Degrees, Statemachine.GetAngle((MixtureLiquid)((liquid + 1) % LIQUID_COUNT)));
+    CHECK(angle_Degrees >= 0 && angle_Degrees < 360);
+    CHECK(distance_Degrees >= MINANGLE_DEGREES);
+    sum_Degrees += distance_Degrees;
+  }
+  CHECK_EQUAL(360, sum_Degrees);
+}
+
+//===============================================================
+// Returns a valid frame with the longest payload of the opcode
+//===============================================================
+static std::vector<uint8_t> GetFullFrame(uint8_t opcode, uint16_t sequence)
+{
+  std::vector<uint8_t> frame = { WIFI_FRAME_VERSION, opcode, (uint8_t)sequence, (uint8_t)(sequence >> 8) };
+  switch (opcode)
+  {
+    case eFrameLiquidIncrement:
+      frame.insert(frame.end(), { 1, 10, 0, 0, 0, 0, 0 });
+      break;
+    case eFrameCycleTimespan:
+      frame.insert(frame.end(), { 0x58, 0x02 });
+      break;
+    case eFramePresetApply:
+    case eFramePresetDelete:
+      frame.push_back(1);
+      break;
+    case eFramePresetSave:
+      frame.push_back(2);
+      frame.insert(frame.end(), PRESET_NAME_LENGTH - 1, 'A');
+      break;
+    default:
+      break;
+  }
+  return frame;
+}
+
+//===============================================================
+// Every valid frame and text command truncated at every length.
+// Truncated binary frames are invalid unless their length is valid
+// for the opcode (e.g. without the optional base version)
+//===============================================================
+static void TestTruncatedMessages()
+{
+  for (uint8_t opcode = eFrameLiquidIncrement; opcode <= eFrameFullUpdate; opcode++)
+  {
+    std::vector<uint8_t> frame = GetFullFrame(opcode, opcode);
+    for (size_t length = 0; length <= frame.size(); length++)
+    {
+      std::vector<uint8_t> truncated(frame.begin(), frame.begin() + length);
+      bool invalid = Send(WS_BINARY, truncated.data(), truncated.size());
+      if (!IsValidFrame(truncated))
+      {
+        CHECK(invalid);
+      }
+    }
+  }
+
+  for (const char* command : TextCommands)
+  {
+    for (size_t length = 0; length <= strlen(command); length++)
+    {
+      CHECK(!Send(WS_TEXT, (const uint8_t*)command, length));
+    }
+  }
+
+  Run(10);
+  CheckMixture();
+}
+
+//===============================================================
+// Random frames (mostly with the valid version and a known opcode
+// to get past the header checks) and random text messages (known
+// commands with random values)
+//===============================================================
+static void TestRandomMessages()
+{
+  srand(41);
+  uint32_t invalidFrames = 0;
+  for (uint32_t index = 0; index < FUZZ_RANDOM_FRAMES; index++)
+  {
+    std::vector<uint8_t> frame(rand() % 24);
+    for (uint8_t& value : frame)
+    {
+      value = (uint8_t)rand();
+    }
+    if (frame.size() > 1)
+    {
+      frame[0] = rand() % 10 != 0 ? WIFI_FRAME_VERSION : frame[0];
+      frame[1] = rand() % 10 != 0 ? 1 + rand() % eFrameFullUpdate : frame[1];
+    }
+
+    bool invalid = Send(WS_BINARY, frame.data(), frame.size());
+    invalidFrames += invalid ? 1 : 0;
+    if (!IsValidFrame(frame))
+    {
+      CHECK(invalid);
+    }
+    if (index % 1000 == 0)
+    {
+      CheckMixture();
+    }
+  }
+
+  for (uint32_t index = 0; index < FUZZ_RANDOM_TEXTS; index++)
+  {
+    std::string text = TextCommands[rand() % (sizeof(TextCommands) / sizeof(TextCommands[0]))];
+    text.resize(text.find(':') != std::string::npos ? text.find(':') + 1 : text.size());
+    size_t length = rand() % (2 * WIFI_TEXT_MESSAGE_LENGTH);
+    for (size_t character = 0; character < length; character++)
+    {
+      text += rand() % 4 != 0 ? "0123456789,-"[rand() % 12] : (char)rand();
+    }
+    CHECK(!Send(WS_TEXT, (const uint8_t*)text.data(), text.size()));
+  }
+
+  Run(10);
+  CheckMixture();
+  printf("%u random frames, %u answered as invalid\n", FUZZ_RANDOM_FRAMES, (unsigned int)invalidFrames);
+  CHECK(invalidFrames > 0 && invalidFrames < FUZZ_RANDOM_FRAMES);
+}
+
+//===============================================================
+// The firmware still executes a valid frame
+//===============================================================
+static void TestValidFrameAfterFuzzing()
+{
+  // Still on the dashboard (wifi commands don't change the state)
+  Run(1000);
+  CHECK_EQUAL(eDashboard, Statemachine.GetCurrentState());
+
+  // Liquid with space to its next angle (clockwise)
+  uint8_t liquid = 0;
+  while (GetDistanceDegrees(Statemachine.GetAngle((MixtureLiquid)liquid), Statemachine.GetAngle((MixtureLiquid)((liquid + 1) % LIQUID_COUNT))) < MINANGLE_DEGREES + 3)
+  {
+    liquid++;
+  }
+
+  uint32_t revision = Statemachine.GetMixtureRevision();
+  int16_t angle_Degrees = Statemachine.GetAngle((MixtureLiquid)liquid);
+  std::vector<uint8_t> frame = { WIFI_FRAME_VERSION, eFrameLiquidIncrement, 1, 0, liquid, 3, 0 };
+  CHECK(!Send(WS_BINARY, frame.data(), frame.size()));
+  Run(10);
+  CHECK_EQUAL(revision + 1, Statemachine.GetMixtureRevision());
+  CHECK_EQUAL(Move360(angle_Degrees, 3), Statemachine.GetAngle((MixtureLiquid)liquid));
+  CheckMixture();
+}
+
+//===============================================================
+// Parser throughput of a message (host time of the web server
+// task, the main task drains the commands in between)
+//===============================================================
+static double Benchmark(AwsFrameType type, const uint8_t* data, size_t len)
+{
+  AsyncWebSocket* websocket = AsyncWebSocket::HostInstance;
+  std::chrono::duration<double> duration(0);
+  for (uint32_t index = 0; index < FUZZ_BENCHMARK_MESSAGES; index++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    websocket->HostReceive(fuzzClientID, type, data, len);
+    duration += std::chrono::steady_clock::now() - start;
+
+    if ((index + 1) % FUZZ_MESSAGES_PER_MS == 0)
+    {
+      Run(1);
+      websocket->client(fuzzClientID)->HostTakeMessages();
+    }
+  }
+  return FUZZ_BENCHMARK_MESSAGES / duration.count();
+}
+
+//===============================================================
+// Compares the parser throughput of binary frames and text messages
+// (increment and decrement, so the mixture stays)
+//===============================================================
+static void BenchmarkParser()
+{
+  const uint8_t increment[] = { WIFI_FRAME_VERSION, eFrameLiquidIncrement, 1, 0, 1, 0, 0 };
+  const char* text = "LIQUID_INCREMENT:1,0";
+  const uint8_t timespan[] = { WIFI_FRAME_VERSION, eFrameCycleTimespan, 1, 0, 0x58, 0x02 };
+  const char* timespanText = "CYCLE_TIMESPAN:600";
+
+  double binaryIncrements = Benchmark(WS_BINARY, increment, sizeof(increment));
+  double textIncrements = Benchmark(WS_TEXT, (const uint8_t*)text, strlen(text));
+  double binaryTimespans = Benchmark(WS_BINARY, timespan, sizeof(timespan));
+  double textTimespans = Benchmark(WS_TEXT, (const uint8_t*)timespanText, strlen(timespanText));
+  printf("Liquid increment: %.0f binary frames/s, %.0f text messages/s (host)\n", binaryIncrements, textIncrements);
+  printf("Cycle timespan:   %.0f binary frames/s, %.0f text messages/s (host)\n", binaryTimespans, textTimespans);
+  CHECK(binaryIncrements > 0 && textIncrements > 0);
+}
+
+//===============================================================
+// Main function
+//===============================================================
+int main()
+{
+  // Invalid frames are logged as errors
+  FILE* log = fopen("/dev/null", "w");
+  HostSetLogOutput(log, ESP_LOG_ERROR);
+
+  // Device with wifi enabled
+  Preferences settings;
+  settings.begin(SETTINGS_NAME, false);
+  settings.putBool(KEY_WIFIMODE, true);
+  settings.end();
+
+  // Skip the intro (like the recorded traces) and connect a client
+  xTaskCreate(LoopTask, "loopTask", 8192, NULL, 1, NULL);
+  Run(3200);
+  HostTriggerPin(PIN_ENCODER_BUTTON, LOW);
+  Run(100);
+  HostTriggerPin(PIN_ENCODER_BUTTON, HIGH);
+  Run(FUZZ_START_MS - fuzzTime_ms);
+  if (AsyncWebSocket::HostInstance == NULL)
+  {
+    fprintf(stderr, "No websocket\n");
+    return 1;
+  }
+  fuzzClientID = AsyncWebSocket::HostInstance->HostConnect()->id();
+  Run(10);
+  AsyncWebSocket::HostInstance->client(fuzzClientID)->HostTakeMessages();
+
+  TestTruncatedMessages();
+  TestRandomMessages();
+  TestValidFrameAfterFuzzing();
+  BenchmarkParser();
+  fclose(log);
+  return TestResult("WebsocketFuzzTest");
+}
@@ -0,0 +1,123 @@
+/**
+ * Host replacement of the Adafruit graphics library for the host
+ * tests. Drawing is discarded, printed texts are passed to an
+ * optional handler (e.g. to record the display content)
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_ADAFRUIT_GFX_H
+#define HOST_ADAFRUIT_GFX_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <vector>
+
+//===============================================================
+// Structs
+//===============================================================
+typedef struct
+{
+  const uint8_t* bitmap;
+  const void* glyph;
+  uint16_t first;
+  uint16_t last;
+  uint8_t yAdvance;
+} GFXfont;
+
+//===============================================================
+// Global variables
+//===============================================================
+// Called for every printed text with the cursor position
+inline void (*HostDisplayTextHandler)(int16_t x, int16_t y, const char* text) = NULL;
+
+//===============================================================
+// Class for the graphics functions of the host
+//===============================================================
+class Adafruit_GFX : public Print
+{
+  public:
+    Adafruit_GFX(int16_t width, int16_t height) : _width(width), _height(height) { }
+
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) { }
+    virtual void writePixel(int16_t x, int16_t y, uint16_t color) { drawPixel(x, y, color); }
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) { }
+    void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) { }
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) { }
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) { }
+    void fillScreen(uint16_t color) { }
+    void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color) { }
+    void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color) { }
+    void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) { }
+    void drawXBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h, uint16_t color) { }
+    void setRotation(uint8_t rotation) { }
+    void setFont(const GFXfont* font) { }
+    void setTextWrap(bool wrap) { }
+    void setTextSize(uint8_t size) { _textSize = size; }
+    void setTextColor(uint16_t color) { }
+    void setTextColor(uint16_t color, uint16_t background) { }
+    void setCursor(int16_t x, int16_t y) { _cursorX = x; _cursorY = y; }
+
+    // Fixed 6x8 pixel characters (scaled by the text size)
+    void getTextBounds(const String& text, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h)
+    {
+      *x1 = x;
+      *y1 = y;
+      *w = (uint16_t)(text.length() * 6 * _textSize);
+      *h = (uint16_t)(8 * _textSize);
+    }
+
+    size_t write(uint8_t value) override
+    {
+      return write(&value, 1);
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override
+    {
+      if (HostDisplayTextHandler != NULL)
+      {
+        std::string text((const char*)buffer, size);
+        HostDisplayTextHandler(_cursorX, _cursorY, text.c_str());
+      }
+      _cursorX += (int16_t)(size * 6 * _textSize);
+      return size;
+    }
+
+  protected:
+    int16_t _width;
+    int16_t _height;
+    int16_t _cursorX = 0;
+    int16_t _cursorY = 0;
+    uint8_t _textSize = 1;
+};
+
+//===============================================================
+// Class for a 16 bit canvas in RAM
+//===============================================================
+class GFXcanvas16 : public Adafruit_GFX
+{
+  public:
+    GFXcanvas16(uint16_t width, uint16_t height) : Adafruit_GFX(width, height), _buffer(width * height) { }
+
+    uint16_t* getBuffer() { return _buffer.data(); }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override
+    {
+      if (x >= 0 && y >= 0 && x < _width && y < _height)
+      {
+        _buffer[y * _width + x] = color;
+      }
+    }
+
+  private:
+    std::vector<uint16_t> _buffer;
+};
+
+#endif
@@ -0,0 +1,32 @@
+/**
+ * Host replacement of the Adafruit SPI display base for the host
+ * tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_ADAFRUIT_SPITFT_H
+#define HOST_ADAFRUIT_SPITFT_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Adafruit_GFX.h>
+#include <SPI.h>
+
+//===============================================================
+// Class for a display on the SPI bus (nothing is transferred)
+//===============================================================
+class Adafruit_SPITFT : public Adafruit_GFX
+{
+  public:
+    Adafruit_SPITFT(uint16_t width, uint16_t height) : Adafruit_GFX(width, height) { }
+
+    void startWrite() { }
+    void endWrite() { }
+    void invertDisplay(bool invert) { }
+};
+
+#endif
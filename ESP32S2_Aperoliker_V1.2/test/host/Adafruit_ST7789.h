@@ -0,0 +1,33 @@
+/**
+ * Host replacement of the ST7789 display driver for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_ADAFRUIT_ST7789_H
+#define HOST_ADAFRUIT_ST7789_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Adafruit_ST77xx.h>
+#include <Adafruit_SPITFT.h>
+
+//===============================================================
+// Class for the ST7789 display of the host
+//===============================================================
+class Adafruit_ST7789 : public Adafruit_SPITFT
+{
+  public:
+    Adafruit_ST7789(SPIClass* spi, int8_t cs, int8_t dc, int8_t rst) : Adafruit_SPITFT(240, 320) { }
+
+    void init(uint16_t width, uint16_t height, uint8_t spiMode = SPI_MODE0)
+    {
+      _width = width;
+      _height = height;
+    }
+};
+
+#endif
@@ -0,0 +1,257 @@
+/**
+ * Host replacement of the Arduino core for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+
+//===============================================================
+// Defines
+//===============================================================
+#define IRAM_ATTR
+#define PROGMEM
+#define HIGH                0x1
+#define LOW                 0x0
+#define INPUT               0x01
+#define OUTPUT              0x03
+#define INPUT_PULLUP        0x05
+#define RISING              0x01
+#define FALLING             0x02
+#define CHANGE              0x03
+#define DEC                 10
+#define HEX                 16
+#define HOST_PIN_COUNT      48
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+//===============================================================
+// Time (virtual, only advanced by the test)
+//===============================================================
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void yield();
+
+// Returns, sets and advances the virtual time
+uint64_t HostGetMicros();
+void HostSetMicros(uint64_t time_us);
+void HostAdvanceMillis(uint32_t duration_ms);
+void HostAdvanceMicros(uint32_t duration_us);
+
+//===============================================================
+// GPIO (simulated pin levels and modes)
+//===============================================================
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int digitalPinToInterrupt(int pin);
+void attachInterrupt(int pin, void (*handler)(), int mode);
+void detachInterrupt(int pin);
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+uint32_t analogReadMilliVolts(uint8_t pin);
+void sei();
+void cli();
+
+// Returns the simulated pin mode and sets an input level without
+// calling the interrupt handler
+uint8_t HostGetPinMode(uint8_t pin);
+void HostSetPinLevel(uint8_t pin, uint8_t value);
+
+// Sets an input level and calls the attached interrupt handler on
+// a matching edge
+void HostTriggerPin(uint8_t pin, uint8_t value);
+
+// Sets a handler called on level changes of output pins
+void HostSetPinWriteHandler(void (*handler)(uint8_t pin, uint8_t value));
+
+//===============================================================
+// Math and conversion (the random numbers are reproducible)
+//===============================================================
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+char* dtostrf(double value, signed char width, unsigned char precision, char* buffer);
+
+//===============================================================
+// String (subset of the Arduino string class)
+//===============================================================
+class String
+{
+  public:
+    String(const char* value = "") : _value(value != NULL ? value : "") { }
+    String(const std::string& value) : _value(value) { }
+    explicit String(char value) : _value(1, value) { }
+    String(int value, unsigned char base = DEC) : _value(FromInteger((long long)value, base)) { }
+    String(unsigned int value, unsigned char base = DEC) : _value(FromInteger((unsigned long long)value, base)) { }
+    String(long value, unsigned char base = DEC) : _value(FromInteger((long long)value, base)) { }
+    String(unsigned long value, unsigned char base = DEC) : _value(FromInteger((unsigned long long)value, base)) { }
+    String(long long value, unsigned char base = DEC) : _value(FromInteger(value, base)) { }
+    String(unsigned long long value, unsigned char base = DEC) : _value(FromInteger(value, base)) { }
+    String(double value, unsigned int decimals = 2) : _value(FromDouble(value, decimals)) { }
+    String(float value, unsigned int decimals = 2) : _value(FromDouble(value, decimals)) { }
+
+    const char* c_str() const { return _value.c_str(); }
+    unsigned int length() const { return (unsigned int)_value.length(); }
+    bool isEmpty() const { return _value.empty(); }
+    bool reserve(unsigned int size) { _value.reserve(size); return true; }
+    char operator[](unsigned int index) const { return index < _value.length() ? _value[index] : 0; }
+
+    String& operator+=(const String& value) { _value += value._value; return *this; }
+    String& operator+=(const char* value) { _value += value; return *this; }
+    String& operator+=(char value) { _value += value; return *this; }
+    String& operator+=(int value) { return *this += String(value); }
+    String& operator+=(unsigned int value) { return *this += String(value); }
+    String& operator+=(long value) { return *this += String(value); }
+    String& operator+=(unsigned long value) { return *this += String(value); }
+    String& concat(const String& value) { return *this += value; }
+
+    friend String operator+(const String& left, const String& right) { return String(left._value + right._value); }
+    friend String operator+(const String& left, const char* right) { return String(left._value + right); }
+    friend String operator+(const char* left, const String& right) { return String(left + right._value); }
+
+    bool operator==(const String& value) const { return _value == value._value; }
+    bool operator!=(const String& value) const { return _value != value._value; }
+    bool operator==(const char* value) const { return _value == value; }
+    bool operator!=(const char* value) const { return _value != value; }
+    bool equals(const String& value) const { return _value == value._value; }
+    bool equalsIgnoreCase(const String& value) const { return strcasecmp(_value.c_str(), value._value.c_str()) == 0; }
+    void toLowerCase() { for (char& character : _value) character = (char)tolower((unsigned char)character); }
+    void toUpperCase() { for (char& character : _value) character = (char)toupper((unsigned char)character); }
+    void trim() { size_t first = _value.find_first_not_of(" \t\r\n"); size_t last = _value.find_last_not_of(" \t\r\n"); _value = first == std::string::npos ? "" : _value.substr(first, last - first + 1); }
+    float toFloat() const { return strtof(_value.c_str(), NULL); }
+
+    bool startsWith(const String& value) const { return _value.compare(0, value._value.length(), value._value) == 0; }
+    bool endsWith(const String& value) const { return _value.length() >= value._value.length() && _value.compare(_value.length() - value._value.length(), value._value.length(), value._value) == 0; }
+    int indexOf(char value, unsigned int from = 0) const { size_t index = _value.find(value, from); return index == std::string::npos ? -1 : (int)index; }
+    int indexOf(const char* value, unsigned int from = 0) const { size_t index = _value.find(value, from); return index == std::string::npos ? -1 : (int)index; }
+    String substring(unsigned int from) const { return from < _value.length() ? String(_value.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const { return from < to && from < _value.length() ? String(_value.substr(from, to - from)) : String(); }
+    long toInt() const { return strtol(_value.c_str(), NULL, 10); }
+
+  private:
+    std::string _value;
+
+    static std::string FromInteger(long long value, unsigned char base)
+    {
+      return value < 0 ? "-" + FromInteger((unsigned long long)-value, base) : FromInteger((unsigned long long)value, base);
+    }
+
+    static std::string FromInteger(unsigned long long value, unsigned char base)
+    {
+      char buffer[32];
+      snprintf(buffer, sizeof(buffer), base == HEX ? "%llx" : "%llu", value);
+      return buffer;
+    }
+
+    static std::string FromDouble(double value, unsigned int decimals)
+    {
+      char buffer[64];
+      snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+      return buffer;
+    }
+};
+
+//===============================================================
+// Print (subset of the Arduino print class)
+//===============================================================
+class Print
+{
+  public:
+    virtual ~Print() { }
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size)
+    {
+      size_t count = 0;
+      while (count < size && write(buffer[count]) == 1)
+      {
+        count++;
+      }
+      return count;
+    }
+
+    size_t write(const char* value) { return write((const uint8_t*)value, strlen(value)); }
+    size_t print(const String& value) { return write(value.c_str()); }
+    size_t print(const char* value) { return write(value); }
+    size_t print(char value) { return write((uint8_t)value); }
+    size_t print(int value) { return print(String(value)); }
+    size_t print(unsigned int value) { return print(String(value)); }
+    size_t print(long value) { return print(String(value)); }
+    size_t print(unsigned long value) { return print(String(value)); }
+    size_t print(double value, int decimals = 2) { return print(String(value, (unsigned int)decimals)); }
+    size_t println() { return write("\r\n"); }
+    size_t println(const String& value) { return print(value) + println(); }
+    size_t println(const char* value) { return print(value) + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)))
+    {
+      char buffer[256];
+      va_list arguments;
+      va_start(arguments, format);
+      int length = vsnprintf(buffer, sizeof(buffer), format, arguments);
+      va_end(arguments);
+      return length > 0 ? write((const uint8_t*)buffer, min((size_t)length, sizeof(buffer) - 1)) : 0;
+    }
+};
+
+//===============================================================
+// Stream (subset of the Arduino stream class)
+//===============================================================
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    size_t readBytes(uint8_t* buffer, size_t length)
+    {
+      size_t count = 0;
+      int value;
+      while (count < length && (value = read()) >= 0)
+      {
+        buffer[count++] = (uint8_t)value;
+      }
+      return count;
+    }
+};
+
+//===============================================================
+// Serial port (output is discarded, logs go through esp_log.h)
+//===============================================================
+class HardwareSerial : public Print
+{
+  public:
+    void begin(unsigned long baud) { }
+    size_t write(uint8_t value) override { return 1; }
+};
+
+inline HardwareSerial Serial;
+
+#endif
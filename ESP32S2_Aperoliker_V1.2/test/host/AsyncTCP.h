@@ -0,0 +1,18 @@
+/**
+ * Host replacement of the asynchronous TCP library for the host
+ * tests (the web server fake has no TCP layer)
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_ASYNCTCP_H
+#define HOST_ASYNCTCP_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+
+#endif
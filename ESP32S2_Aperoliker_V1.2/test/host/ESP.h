@@ -0,0 +1,46 @@
+/**
+ * Host replacement of the ESP class for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_ESP_H
+#define HOST_ESP_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+
+//===============================================================
+// Class with the chip information of a simulated ESP32-S2
+//===============================================================
+class EspClass
+{
+  public:
+    uint64_t getEfuseMac() { return 0x0000AABBCCDDEEFFull; }
+    const char* getChipModel() { return "ESP32-S2 (host)"; }
+    uint8_t getChipRevision() { return 0; }
+    uint8_t getChipCores() { return 1; }
+    const char* getSdkVersion() { return "host"; }
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getFlashChipSize() { return 4 * 1024 * 1024; }
+    uint32_t getHeapSize() { return 320 * 1024; }
+    uint32_t getFreeHeap() { return 200 * 1024; }
+    uint32_t getMinFreeHeap() { return 150 * 1024; }
+    uint32_t getMaxAllocHeap() { return 100 * 1024; }
+    uint32_t getPsramSize() { return 0; }
+    uint32_t getFreePsram() { return 0; }
+    uint32_t getSketchSize() { return 1024 * 1024; }
+    uint32_t getFreeSketchSpace() { return 1024 * 1024; }
+    void restart() { exit(0); }
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+inline EspClass ESP;
+
+#endif
@@ -0,0 +1,491 @@
+/**
+ * Host replacement of the asynchronous web server for the host
+ * tests. There is no TCP layer: requests and websocket frames are
+ * injected by the test and answers are kept in memory (websocket
+ * messages in a per client queue, like the send queue of the
+ * library, which the test takes as delivered)
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_ESPASYNCWEBSERVER_H
+#define HOST_ESPASYNCWEBSERVER_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <FS.h>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+//===============================================================
+// Defines
+//===============================================================
+#ifndef WS_MAX_QUEUED_MESSAGES
+#define WS_MAX_QUEUED_MESSAGES      32      // Build flags of the library
+#endif
+#ifndef DEFAULT_MAX_WS_CLIENTS
+#define DEFAULT_MAX_WS_CLIENTS      8
+#endif
+#define HOST_RESPONSE_CHUNK_SIZE    1436    // Typical TCP segment payload of a chunked response
+
+//===============================================================
+// Enums
+//===============================================================
+typedef enum
+{
+  HTTP_GET = 0b00000001,
+  HTTP_POST = 0b00000010,
+  HTTP_DELETE = 0b00000100,
+  HTTP_PUT = 0b00001000,
+  HTTP_PATCH = 0b00010000,
+  HTTP_HEAD = 0b00100000,
+  HTTP_OPTIONS = 0b01000000,
+  HTTP_ANY = 0b01111111
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+typedef enum
+{
+  WS_DISCONNECTED,
+  WS_CONNECTED,
+  WS_DISCONNECTING
+} AwsClientStatus;
+
+typedef enum
+{
+  WS_CONTINUATION,
+  WS_TEXT,
+  WS_BINARY,
+  WS_DISCONNECT = 0x08,
+  WS_PING,
+  WS_PONG
+} AwsFrameType;
+
+typedef enum
+{
+  WS_EVT_CONNECT,
+  WS_EVT_DISCONNECT,
+  WS_EVT_PING,
+  WS_EVT_PONG,
+  WS_EVT_ERROR,
+  WS_EVT_DATA
+} AwsEventType;
+
+//===============================================================
+// Structs
+//===============================================================
+typedef struct
+{
+  uint8_t message_opcode;
+  uint32_t num;
+  uint8_t final;
+  uint8_t masked;
+  uint8_t opcode;
+  uint64_t len;
+  uint8_t mask[4];
+  uint64_t index;
+} AwsFrameInfo;
+
+//===============================================================
+// Forward declarations and typedefs
+//===============================================================
+class AsyncWebServerRequest;
+class AsyncWebSocket;
+class AsyncWebSocketClient;
+
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(void)> ArDisconnectHandler;
+typedef std::function<size_t(uint8_t* buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+typedef std::function<void(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len)> AwsEventHandler;
+typedef std::shared_ptr<std::vector<uint8_t>> AsyncWebSocketSharedBuffer;
+
+//===============================================================
+// Request parameter
+//===============================================================
+class AsyncWebParameter
+{
+  public:
+    AsyncWebParameter(const String& name, const String& value, bool form = false, bool file = false, size_t size = 0) :
+      _name(name), _value(value), _size(size), _isForm(form), _isFile(file) { }
+
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+    size_t size() const { return _size; }
+    bool isPost() const { return _isForm; }
+    bool isFile() const { return _isFile; }
+
+  private:
+    String _name;
+    String _value;
+    size_t _size;
+    bool _isForm;
+    bool _isFile;
+};
+
+//===============================================================
+// Response (the content is completed when the request is sent)
+//===============================================================
+class AsyncWebServerResponse
+{
+  public:
+    AsyncWebServerResponse(int code, const String& contentType = String(), const std::string& content = std::string()) :
+      _code(code), _contentType(contentType), _content(content), _length(content.size()) { }
+    virtual ~AsyncWebServerResponse() { }
+
+    void setCode(int code) { _code = code; }
+    void addHeader(const String& name, const String& value) { _headers.push_back(std::make_pair(name, value)); }
+
+    // Reads the streamed content of the response
+    virtual void HostFill() { }
+
+    // Sent content is only counted, not kept (e.g. for heap
+    // measurements of large responses)
+    static void HostSetKeepContent(bool keep) { _hostKeepContent = keep; }
+
+    // Returns the response code, content, content type and headers
+    int HostCode() const { return _code; }
+    const std::string& HostContent() const { return _content; }
+    size_t HostLength() const { return _length; }
+    const String& HostContentType() const { return _contentType; }
+    String HostHeader(const String& name) const;
+
+  protected:
+    int _code;
+    String _contentType;
+    std::string _content;
+    size_t _length = 0;
+    std::vector<std::pair<String, String>> _headers;
+
+    // Adds sent content
+    void HostAppend(const char* data, size_t length);
+
+  private:
+    static bool _hostKeepContent;
+};
+
+// Response printed into memory
+class AsyncResponseStream : public AsyncWebServerResponse, public Print
+{
+  public:
+    AsyncResponseStream(const String& contentType) : AsyncWebServerResponse(200, contentType) { }
+
+    using Print::write;
+    size_t write(uint8_t value) override { HostAppend((const char*)&value, 1); return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { HostAppend((const char*)buffer, size); return size; }
+};
+
+// Response filled chunk by chunk by a callback
+class AsyncChunkedResponse : public AsyncWebServerResponse
+{
+  public:
+    AsyncChunkedResponse(const String& contentType, AwsResponseFiller filler) :
+      AsyncWebServerResponse(200, contentType), _filler(filler) { }
+
+    void HostFill() override;
+
+    // Number of chunks of the response
+    size_t HostChunks() const { return _chunks; }
+
+  private:
+    AwsResponseFiller _filler;
+    size_t _chunks = 0;
+};
+
+// Response of a file (a gzipped file of a path without '.gz' is sent
+// with content encoding)
+class AsyncFileResponse : public AsyncWebServerResponse
+{
+  public:
+    AsyncFileResponse(File content, const String& path, const String& contentType = String(), bool download = false);
+
+    void HostFill() override;
+
+  private:
+    File _file;
+};
+
+//===============================================================
+// Request
+//===============================================================
+class AsyncWebServerRequest
+{
+  public:
+    AsyncWebServerRequest(WebRequestMethodComposite method, const String& url) : _method(method), _url(url) { }
+    ~AsyncWebServerRequest();
+
+    // Free for the handlers (the temp object is freed with free())
+    File _tempFile;
+    void* _tempObject = NULL;
+
+    WebRequestMethodComposite method() const { return _method; }
+    const String& url() const { return _url; }
+    size_t contentLength() const { return _contentLength; }
+    void onDisconnect(ArDisconnectHandler handler) { _onDisconnect = handler; }
+    void addInterestingHeader(const char* name) { }
+
+    bool hasParam(const String& name, bool post = false, bool file = false) const { return getParam(name, post, file) != NULL; }
+    const AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false) const;
+    bool hasArg(const char* name) const;
+    const String& arg(const String& name) const;
+    bool hasHeader(const String& name) const;
+    const String& header(const String& name) const;
+
+    void send(AsyncWebServerResponse* response);
+    void send(int code, const char* contentType = "", const char* content = "") { send(beginResponse(code, String(contentType), String(content))); }
+    void send(int code, const String& contentType, const char* content = "") { send(beginResponse(code, contentType, String(content))); }
+    void send(int code, const String& contentType, const String& content) { send(beginResponse(code, contentType, content)); }
+    void send(FS& fs, const String& path, const String& contentType = String(), bool download = false) { send(beginResponse(fs, path, contentType, download)); }
+    void send(File content, const String& path, const String& contentType = String(), bool download = false) { send(new AsyncFileResponse(content, path, contentType, download)); }
+
+    AsyncWebServerResponse* beginResponse(int code, const String& contentType = String(), const String& content = String()) { return new AsyncWebServerResponse(code, contentType, content.c_str()); }
+    AsyncWebServerResponse* beginResponse(int code, const String& contentType, const uint8_t* content, size_t len) { return new AsyncWebServerResponse(code, contentType, std::string((const char*)content, len)); }
+    AsyncWebServerResponse* beginResponse(FS& fs, const String& path, const String& contentType = String(), bool download = false);
+    AsyncWebServerResponse* beginResponse(File content, const String& path, const String& contentType = String(), bool download = false) { return new AsyncFileResponse(content, path, contentType, download); }
+    AsyncWebServerResponse* beginResponse_P(int code, const String& contentType, const uint8_t* content, size_t len) { return beginResponse(code, contentType, content, len); }
+    AsyncWebServerResponse* beginChunkedResponse(const String& contentType, AwsResponseFiller filler) { return new AsyncChunkedResponse(contentType, filler); }
+    AsyncResponseStream* beginResponseStream(const String& contentType, size_t bufferSize = 1460) { return new AsyncResponseStream(contentType); }
+
+    // Adds parameters and headers and sets the content length
+    void HostAddParam(const String& name, const String& value, bool post = false, bool file = false);
+    void HostAddHeader(const String& name, const String& value);
+    void HostSetContentLength(size_t length) { _contentLength = length; }
+
+    // Simulates a closed connection (calls the disconnect handler)
+    void HostDisconnect();
+
+    // Returns the sent response (NULL if none was sent yet)
+    AsyncWebServerResponse* HostResponse() const { return _response; }
+
+  private:
+    WebRequestMethodComposite _method;
+    String _url;
+    size_t _contentLength = 0;
+    std::vector<AsyncWebParameter> _params;
+    std::vector<std::pair<String, String>> _headers;
+    ArDisconnectHandler _onDisconnect;
+    AsyncWebServerResponse* _response = NULL;
+};
+
+//===============================================================
+// Handlers
+//===============================================================
+class AsyncWebHandler
+{
+  public:
+    virtual ~AsyncWebHandler() { }
+    virtual bool canHandle(AsyncWebServerRequest* request) const { return false; }
+    virtual void handleRequest(AsyncWebServerRequest* request) { }
+    virtual void handleUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final) { }
+    virtual bool isRequestHandlerTrivial() const { return true; }
+};
+
+// Handler of a callback for an URL
+class AsyncCallbackWebHandler : public AsyncWebHandler
+{
+  public:
+    AsyncCallbackWebHandler(const String& uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload) :
+      _uri(uri), _method(method), _onRequest(onRequest), _onUpload(onUpload) { }
+
+    bool canHandle(AsyncWebServerRequest* request) const override { return (request->method() & _method) && request->url() == _uri; }
+    void handleRequest(AsyncWebServerRequest* request) override { if (_onRequest) _onRequest(request); else request->send(500); }
+    void handleUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final) override { if (_onUpload) _onUpload(request, filename, index, data, len, final); }
+
+  private:
+    String _uri;
+    WebRequestMethodComposite _method;
+    ArRequestHandlerFunction _onRequest;
+    ArUploadHandlerFunction _onUpload;
+};
+
+// Handler of static files (gzipped variants first, the ETag is the
+// file size, because the host files have no write time)
+class AsyncStaticWebHandler : public AsyncWebHandler
+{
+  public:
+    AsyncStaticWebHandler(const char* uri, FS& fs, const char* path, const char* cacheControl);
+
+    AsyncStaticWebHandler& setDefaultFile(const char* filename) { _defaultFile = filename; return *this; }
+    AsyncStaticWebHandler& setCacheControl(const char* cacheControl) { _cacheControl = cacheControl; return *this; }
+    AsyncStaticWebHandler& setTryGzipFirst(bool value) { _tryGzipFirst = value; return *this; }
+
+    bool canHandle(AsyncWebServerRequest* request) const override;
+    void handleRequest(AsyncWebServerRequest* request) override;
+
+  private:
+    String _uri;
+    FS& _fs;
+    String _path;
+    String _defaultFile;
+    String _cacheControl;
+    bool _tryGzipFirst = true;
+
+    // Opens the file (or its gzipped variant) into the request
+    bool SearchFile(AsyncWebServerRequest* request, const String& path) const;
+};
+
+//===============================================================
+// Websocket message buffer (written in place, then sent)
+//===============================================================
+class AsyncWebSocketMessageBuffer
+{
+  friend AsyncWebSocket;
+  friend AsyncWebSocketClient;
+
+  public:
+    AsyncWebSocketMessageBuffer() : _buffer(std::make_shared<std::vector<uint8_t>>()) { }
+    explicit AsyncWebSocketMessageBuffer(size_t size) : _buffer(std::make_shared<std::vector<uint8_t>>(size)) { }
+    AsyncWebSocketMessageBuffer(const uint8_t* data, size_t size) : _buffer(std::make_shared<std::vector<uint8_t>>(data, data + size)) { }
+
+    bool reserve(size_t size) { _buffer->resize(size); return true; }
+    uint8_t* get() { return _buffer->data(); }
+    size_t length() const { return _buffer->size(); }
+
+  private:
+    AsyncWebSocketSharedBuffer _buffer;
+};
+
+//===============================================================
+// Websocket client
+//===============================================================
+class AsyncWebSocketClient
+{
+  public:
+    AsyncWebSocketClient(AsyncWebSocket* server, uint32_t id) : _server(server), _id(id) { }
+
+    uint32_t id() const { return _id; }
+    AwsClientStatus status() const { return _status; }
+    AsyncWebSocket* server() { return _server; }
+    void close(uint16_t code = 0, const char* message = NULL) { _status = WS_DISCONNECTING; }
+    bool ping(const uint8_t* data = NULL, size_t len = 0) { return true; }
+
+    bool queueIsFull() const { return _queue.size() >= WS_MAX_QUEUED_MESSAGES || _status != WS_CONNECTED; }
+    size_t queueLen() const { return _queue.size(); }
+    bool canSend() const { return !queueIsFull(); }
+
+    bool text(AsyncWebSocketSharedBuffer buffer);
+    bool text(const uint8_t* message, size_t len) { return text(std::make_shared<std::vector<uint8_t>>(message, message + len)); }
+    bool text(const char* message, size_t len) { return text((const uint8_t*)message, len); }
+    bool text(const char* message) { return text(message, strlen(message)); }
+    bool text(const String& message) { return text(message.c_str(), message.length()); }
+    bool text(AsyncWebSocketMessageBuffer* buffer);
+    bool binary(const uint8_t* message, size_t len) { return text(message, len); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    // Takes the queued messages as delivered, simulates a closed
+    // connection or a client, which stops reading
+    std::vector<std::string> HostTakeMessages();
+    void HostDisconnect() { _status = WS_DISCONNECTED; }
+    void HostSetReading(bool reading) { _reading = reading; }
+    bool HostIsReading() const { return _reading; }
+
+    // Messages dropped because of a full queue
+    uint32_t HostDropped = 0;
+
+  private:
+    AsyncWebSocket* _server;
+    uint32_t _id;
+    AwsClientStatus _status = WS_CONNECTED;
+    bool _reading = true;
+    std::list<AsyncWebSocketSharedBuffer> _queue;
+};
+
+//===============================================================
+// Websocket server
+//===============================================================
+class AsyncWebSocket : public AsyncWebHandler
+{
+  public:
+    explicit AsyncWebSocket(const String& url) : _url(url) { HostInstance = this; }
+
+    const char* url() const { return _url.c_str(); }
+    void onEvent(AwsEventHandler handler) { _eventHandler = handler; }
+
+    size_t count() const;
+    AsyncWebSocketClient* client(uint32_t id);
+    bool availableForWriteAll();
+    bool availableForWrite(uint32_t id);
+    void cleanupClients(uint16_t maxClients = DEFAULT_MAX_WS_CLIENTS);
+
+    bool text(uint32_t id, const char* message);
+    bool text(uint32_t id, const String& message) { return text(id, message.c_str()); }
+    bool text(uint32_t id, AsyncWebSocketMessageBuffer* buffer);
+    void textAll(AsyncWebSocketSharedBuffer buffer);
+    void textAll(const char* message, size_t len) { textAll(std::make_shared<std::vector<uint8_t>>((const uint8_t*)message, (const uint8_t*)message + len)); }
+    void textAll(const char* message) { textAll(message, strlen(message)); }
+    void textAll(const String& message) { textAll(message.c_str(), message.length()); }
+    void textAll(AsyncWebSocketMessageBuffer* buffer);
+    AsyncWebSocketMessageBuffer* makeBuffer(size_t size = 0) { return new AsyncWebSocketMessageBuffer(size); }
+
+    // Connects a client, returns the client (calls the event handler)
+    AsyncWebSocketClient* HostConnect();
+
+    // Disconnects a client (calls the event handler)
+    void HostDisconnect(uint32_t id);
+
+    // Passes a complete frame of a client to the event handler
+    void HostReceive(uint32_t id, AwsFrameType opcode, const uint8_t* data, size_t len);
+
+    // Returns the connected clients
+    std::list<AsyncWebSocketClient>& HostClients() { return _clients; }
+
+    // Last created websocket (the firmware keeps it private)
+    inline static AsyncWebSocket* HostInstance = NULL;
+
+  private:
+    String _url;
+    AwsEventHandler _eventHandler;
+    std::list<AsyncWebSocketClient> _clients;
+    uint32_t _nextID = 1;
+};
+
+//===============================================================
+// Server events (only kept for the interface)
+//===============================================================
+class AsyncEventSource : public AsyncWebHandler
+{
+  public:
+    explicit AsyncEventSource(const String& url) { }
+    void send(const char* message, const char* event = NULL, uint32_t id = 0, uint32_t reconnect = 0) { }
+    size_t count() const { return 0; }
+};
+
+//===============================================================
+// Web server
+//===============================================================
+class AsyncWebServer
+{
+  public:
+    AsyncWebServer(uint16_t port) { HostInstance = this; }
+    ~AsyncWebServer();
+
+    void begin() { }
+    AsyncWebHandler& addHandler(AsyncWebHandler* handler) { _handlers.push_back(handler); return *handler; }
+    AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload = nullptr);
+    AsyncStaticWebHandler& serveStatic(const char* uri, FS& fs, const char* path, const char* cacheControl = NULL);
+    void onNotFound(ArRequestHandlerFunction handler) { _notFound = handler; }
+
+    // Returns the handler of the request (NULL -> not found)
+    AsyncWebHandler* HostFindHandler(AsyncWebServerRequest* request);
+
+    // Handles a request (with optional upload chunks of a file),
+    // returns the sent response
+    AsyncWebServerResponse* HostHandle(AsyncWebServerRequest* request, const String& filename = String(), const std::vector<std::string>& chunks = { });
+
+    // Last created web server (the firmware keeps it private)
+    inline static AsyncWebServer* HostInstance = NULL;
+
+  private:
+    std::vector<AsyncWebHandler*> _handlers;
+    ArRequestHandlerFunction _notFound;
+};
+
+#endif
@@ -0,0 +1,32 @@
+/**
+ * Host replacement of the mDNS responder for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_ESPMDNS_H
+#define HOST_ESPMDNS_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+
+//===============================================================
+// Class for the mDNS responder of the host (no network)
+//===============================================================
+class MDNSResponder
+{
+  public:
+    bool begin(const String& hostName) { return true; }
+    bool addService(const char* service, const char* protocol, uint16_t port) { return true; }
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+inline MDNSResponder MDNS;
+
+#endif
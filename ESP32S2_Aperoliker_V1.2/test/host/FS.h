@@ -0,0 +1,135 @@
+/**
+ * Host replacement of the Arduino file system for the host tests.
+ * Files are kept in memory, every file system has its own files
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+//===============================================================
+// Defines
+//===============================================================
+#define FILE_READ       "r"
+#define FILE_WRITE      "w"
+#define FILE_APPEND     "a"
+
+namespace fs
+{
+
+class FS;
+
+//===============================================================
+// Enums
+//===============================================================
+enum SeekMode
+{
+  SeekSet = 0,
+  SeekCur = 1,
+  SeekEnd = 2
+};
+
+//===============================================================
+// Open file (content is shared with the file system)
+//===============================================================
+struct HostOpenFile
+{
+  std::shared_ptr<std::string> Content;
+  std::string Path;
+  size_t Position = 0;
+  bool Readable = false;
+  bool Writable = false;
+  bool Append = false;
+  bool Directory = false;
+  std::vector<std::string> Entries;
+  size_t NextEntry = 0;
+  FS* Owner = NULL;
+};
+
+//===============================================================
+// File handle
+//===============================================================
+class File : public Stream
+{
+  public:
+    File() { }
+    explicit File(std::shared_ptr<HostOpenFile> file) : _file(file) { }
+
+    using Print::write;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t* buffer, size_t size);
+    bool seek(uint32_t position, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void flush() { }
+    void close() { _file.reset(); }
+    bool isDirectory() const { return _file && _file->Directory; }
+    File openNextFile(const char* mode = FILE_READ);
+    const char* path() const { return _file ? _file->Path.c_str() : ""; }
+    const char* name() const;
+    operator bool() const { return (bool)_file; }
+
+  private:
+    std::shared_ptr<HostOpenFile> _file;
+};
+
+//===============================================================
+// File system
+//===============================================================
+class FS
+{
+  public:
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* fromPath, const char* toPath);
+    bool rename(const String& fromPath, const String& toPath) { return rename(fromPath.c_str(), toPath.c_str()); }
+    bool mkdir(const char* path) { return true; }
+    bool rmdir(const char* path) { return true; }
+
+    // Host functions (files of the simulated flash, written bytes
+    // as measure of the flash wear, power loss or full flash after
+    // a number of written bytes)
+    void HostClear() { _files.clear(); _writtenBytes = 0; _writeLimit = SIZE_MAX; }
+    size_t HostUsedBytes();
+    size_t HostWrittenBytes() { return _writtenBytes; }
+    void HostSetWriteLimit(size_t bytes) { _writeLimit = bytes; }
+
+    // Returns the part of a write, which fits into the write limit
+    size_t HostTakeWrite(size_t size);
+
+  private:
+    std::map<std::string, std::shared_ptr<std::string>> _files;
+    size_t _writtenBytes = 0;
+    size_t _writeLimit = SIZE_MAX;
+};
+
+}
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif
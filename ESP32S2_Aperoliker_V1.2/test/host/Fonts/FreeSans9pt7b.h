@@ -0,0 +1,23 @@
+/**
+ * Host replacement of the FreeSans font for the host tests (texts
+ * are measured with the fixed host character size)
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_FREESANS9PT7B_H
+#define HOST_FREESANS9PT7B_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Adafruit_GFX.h>
+
+//===============================================================
+// Global variables
+//===============================================================
+inline const GFXfont FreeSans9pt7b = { NULL, NULL, 0x20, 0x7E, 22 };
+
+#endif
@@ -0,0 +1,240 @@
+/**
+ * Host replacement of the Arduino core for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/task.h>
+#include <esp32s2/rom/rtc.h>
+
+//===============================================================
+// Global variables
+//===============================================================
+static std::atomic<uint64_t> hostTime_us{0};    // Test threads may delay concurrently
+static uint8_t hostPinModes[HOST_PIN_COUNT] = { };
+static uint8_t hostPinLevels[HOST_PIN_COUNT] = { };
+static void (*hostPinHandlers[HOST_PIN_COUNT])() = { };
+static int hostPinHandlerModes[HOST_PIN_COUNT] = { };
+static uint32_t hostRandomState = 1;
+static int hostLogLevel = -1;
+static FILE* hostLogFile = NULL;
+static void (*hostPinWriteHandler)(uint8_t pin, uint8_t value) = NULL;
+
+//===============================================================
+// Time
+//===============================================================
+uint32_t millis()
+{
+  return (uint32_t)(hostTime_us / 1000);
+}
+
+uint32_t micros()
+{
+  return (uint32_t)hostTime_us;
+}
+
+void delay(uint32_t ms)
+{
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void yield()
+{
+  taskYIELD();
+}
+
+uint64_t HostGetMicros()
+{
+  return hostTime_us;
+}
+
+void HostSetMicros(uint64_t time_us)
+{
+  hostTime_us = time_us;
+}
+
+void HostAdvanceMillis(uint32_t duration_ms)
+{
+  hostTime_us += (uint64_t)duration_ms * 1000;
+}
+
+void HostAdvanceMicros(uint32_t duration_us)
+{
+  hostTime_us += duration_us;
+}
+
+//===============================================================
+// GPIO
+//===============================================================
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (pin < HOST_PIN_COUNT)
+  {
+    hostPinModes[pin] = mode;
+    hostPinLevels[pin] = mode == INPUT_PULLUP ? HIGH : hostPinLevels[pin];
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  if (pin < HOST_PIN_COUNT)
+  {
+    if (hostPinWriteHandler != NULL &&
+      hostPinModes[pin] == OUTPUT &&
+      hostPinLevels[pin] != value)
+    {
+      hostPinWriteHandler(pin, value);
+    }
+    hostPinLevels[pin] = value;
+  }
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pin < HOST_PIN_COUNT ? hostPinLevels[pin] : LOW;
+}
+
+int digitalPinToInterrupt(int pin)
+{
+  return pin;
+}
+
+void attachInterrupt(int pin, void (*handler)(), int mode)
+{
+  if (pin >= 0 && pin < HOST_PIN_COUNT)
+  {
+    hostPinHandlers[pin] = handler;
+    hostPinHandlerModes[pin] = mode;
+  }
+}
+
+void detachInterrupt(int pin)
+{
+  if (pin >= 0 && pin < HOST_PIN_COUNT)
+  {
+    hostPinHandlers[pin] = NULL;
+  }
+}
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration)
+{
+}
+
+uint32_t analogReadMilliVolts(uint8_t pin)
+{
+  return 0;
+}
+
+void sei()
+{
+}
+
+void cli()
+{
+}
+
+uint8_t HostGetPinMode(uint8_t pin)
+{
+  return pin < HOST_PIN_COUNT ? hostPinModes[pin] : 0;
+}
+
+void HostSetPinLevel(uint8_t pin, uint8_t value)
+{
+  digitalWrite(pin, value);
+}
+
+void HostSetPinWriteHandler(void (*handler)(uint8_t pin, uint8_t value))
+{
+  hostPinWriteHandler = handler;
+}
+
+void HostTriggerPin(uint8_t pin, uint8_t value)
+{
+  if (pin >= HOST_PIN_COUNT)
+  {
+    return;
+  }
+
+  uint8_t lastValue = hostPinLevels[pin];
+  hostPinLevels[pin] = value;
+
+  int mode = hostPinHandlerModes[pin];
+  if (hostPinHandlers[pin] != NULL &&
+    lastValue != value &&
+    (mode == CHANGE || (mode == RISING && value == HIGH) || (mode == FALLING && value == LOW)))
+  {
+    hostPinHandlers[pin]();
+  }
+}
+
+//===============================================================
+// Math and conversion
+//===============================================================
+long random(long max)
+{
+  // Linear congruential generator, the same sequence on all hosts
+  hostRandomState = hostRandomState * 1103515245 + 12345;
+  return max > 0 ? (long)((hostRandomState >> 8) % (uint32_t)max) : 0;
+}
+
+long random(long min, long max)
+{
+  return min < max ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed)
+{
+  hostRandomState = (uint32_t)seed;
+}
+
+char* dtostrf(double value, signed char width, unsigned char precision, char* buffer)
+{
+  sprintf(buffer, "%*.*f", width, precision, value);
+  return buffer;
+}
+
+//===============================================================
+// Logging
+//===============================================================
+void HostLog(esp_log_level_t level, const char* tag, const char* format, ...)
+{
+  if (hostLogLevel < 0)
+  {
+    const char* value = getenv("HOST_LOG_LEVEL");
+    hostLogLevel = value != NULL ? atoi(value) : ESP_LOG_ERROR;
+  }
+
+  if ((int)level > hostLogLevel)
+  {
+    return;
+  }
+
+  FILE* file = hostLogFile != NULL ? hostLogFile : stderr;
+  fprintf(file, "[%8u][%c][%s] ", millis(), "NEWIDV"[level], tag);
+  va_list arguments;
+  va_start(arguments, format);
+  vfprintf(file, format, arguments);
+  va_end(arguments);
+  fputc('\n', file);
+}
+
+void HostSetLogOutput(FILE* file, int level)
+{
+  hostLogFile = file;
+  hostLogLevel = level;
+}
+
+//===============================================================
+// ROM functions
+//===============================================================
+int rtc_get_reset_reason(int cpu)
+{
+  return 1;
+}
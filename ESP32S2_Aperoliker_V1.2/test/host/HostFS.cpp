@@ -0,0 +1,227 @@
+/**
+ * Host replacement of the Arduino file system for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <LittleFS.h>
+#include <SPIFFS.h>
+
+//===============================================================
+// Global variables
+//===============================================================
+HostFlashFS LittleFS;
+HostFlashFS SPIFFS;
+
+namespace fs
+{
+
+//===============================================================
+// File functions
+//===============================================================
+size_t File::write(uint8_t value)
+{
+  return write(&value, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size)
+{
+  if (!_file || !_file->Writable)
+  {
+    return 0;
+  }
+
+  size = _file->Owner->HostTakeWrite(size);
+  std::string& content = *_file->Content;
+  if (_file->Append)
+  {
+    _file->Position = content.size();
+  }
+  if (_file->Position + size > content.size())
+  {
+    content.resize(_file->Position + size);
+  }
+  content.replace(_file->Position, size, (const char*)buffer, size);
+  _file->Position += size;
+  return size;
+}
+
+int File::available()
+{
+  if (!_file || !_file->Readable)
+  {
+    return 0;
+  }
+  return (int)(_file->Content->size() - min(_file->Position, _file->Content->size()));
+}
+
+int File::read()
+{
+  uint8_t value;
+  return read(&value, 1) == 1 ? value : -1;
+}
+
+int File::peek()
+{
+  return available() > 0 ? (uint8_t)(*_file->Content)[_file->Position] : -1;
+}
+
+size_t File::read(uint8_t* buffer, size_t size)
+{
+  size_t count = min(size, (size_t)available());
+  if (count > 0)
+  {
+    memcpy(buffer, _file->Content->data() + _file->Position, count);
+    _file->Position += count;
+  }
+  return count;
+}
+
+bool File::seek(uint32_t position, SeekMode mode)
+{
+  if (!_file)
+  {
+    return false;
+  }
+
+  size_t base = mode == SeekSet ? 0 : mode == SeekCur ? _file->Position : _file->Content->size();
+  if (base + position > _file->Content->size())
+  {
+    return false;
+  }
+  _file->Position = base + position;
+  return true;
+}
+
+size_t File::position() const
+{
+  return _file ? _file->Position : 0;
+}
+
+size_t File::size() const
+{
+  return _file ? _file->Content->size() : 0;
+}
+
+File File::openNextFile(const char* mode)
+{
+  if (!isDirectory() ||
+    _file->NextEntry >= _file->Entries.size())
+  {
+    return File();
+  }
+  return _file->Owner->open(_file->Entries[_file->NextEntry++].c_str(), mode);
+}
+
+const char* File::name() const
+{
+  const char* path = this->path();
+  const char* separator = strrchr(path, '/');
+  return separator != NULL ? separator + 1 : path;
+}
+
+//===============================================================
+// File system functions
+//===============================================================
+File FS::open(const char* path, const char* mode, bool create)
+{
+  auto entry = _files.find(path);
+  bool read = mode[0] == 'r';
+  bool update = strchr(mode, '+') != NULL;
+
+  if (entry == _files.end())
+  {
+    if (read)
+    {
+      // Directories only exist as path prefix of their files
+      std::string prefix = path;
+      if (prefix.empty() || prefix.back() != '/')
+      {
+        prefix += '/';
+      }
+
+      auto directory = std::make_shared<HostOpenFile>();
+      for (auto& file : _files)
+      {
+        if (file.first.compare(0, prefix.length(), prefix) == 0)
+        {
+          directory->Entries.push_back(file.first);
+        }
+      }
+      if (directory->Entries.empty() &&
+        prefix != "/")
+      {
+        return File();
+      }
+
+      directory->Content = std::make_shared<std::string>();
+      directory->Path = path;
+      directory->Directory = true;
+      directory->Owner = this;
+      return File(directory);
+    }
+    entry = _files.emplace(path, std::make_shared<std::string>()).first;
+  }
+  else if (mode[0] == 'w')
+  {
+    entry->second->clear();
+  }
+
+  auto file = std::make_shared<HostOpenFile>();
+  file->Content = entry->second;
+  file->Path = path;
+  file->Readable = read || update;
+  file->Writable = !read || update;
+  file->Append = mode[0] == 'a';
+  file->Owner = this;
+  return File(file);
+}
+
+bool FS::exists(const char* path)
+{
+  return _files.count(path) > 0;
+}
+
+bool FS::remove(const char* path)
+{
+  return _files.erase(path) > 0;
+}
+
+bool FS::rename(const char* fromPath, const char* toPath)
+{
+  auto entry = _files.find(fromPath);
+  if (entry == _files.end())
+  {
+    return false;
+  }
+
+  // Replaces the target like LittleFS
+  std::shared_ptr<std::string> content = entry->second;
+  _files.erase(entry);
+  _files[toPath] = content;
+  return true;
+}
+
+size_t FS::HostTakeWrite(size_t size)
+{
+  size = min(size, _writeLimit - min(_writtenBytes, _writeLimit));
+  _writtenBytes += size;
+  return size;
+}
+
+size_t FS::HostUsedBytes()
+{
+  size_t used = 0;
+  for (auto& entry : _files)
+  {
+    used += entry.second->size();
+  }
+  return used;
+}
+
+}
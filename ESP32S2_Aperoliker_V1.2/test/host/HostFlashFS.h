@@ -0,0 +1,52 @@
+/**
+ * Host replacement of a flash file system (LittleFS, SPIFFS) for
+ * the host tests. Mounting can be set to fail for tests of
+ * unformatted or foreign partitions
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_FLASHFS_H
+#define HOST_FLASHFS_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <FS.h>
+
+//===============================================================
+// Defines
+//===============================================================
+#define HOST_FLASH_SIZE     (2 * 1024 * 1024)
+
+//===============================================================
+// Class for a simulated flash file system
+//===============================================================
+class HostFlashFS : public fs::FS
+{
+  public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/", uint8_t maxOpenFiles = 10, const char* partitionLabel = NULL)
+    {
+      if (!_mountable && formatOnFail)
+      {
+        format();
+      }
+      return _mountable;
+    }
+    bool format() { HostClear(); _mountable = true; _formatted = true; return true; }
+    void end() { }
+    size_t totalBytes() { return HOST_FLASH_SIZE; }
+    size_t usedBytes() { return HostUsedBytes(); }
+
+    // Host functions (partition contains another file system)
+    void HostSetMountable(bool mountable) { _mountable = mountable; }
+    bool HostWasFormatted() { return _formatted; }
+
+  private:
+    bool _mountable = true;
+    bool _formatted = false;
+};
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ * Host replacement of the preferences and ROM CRC functions for the
+ * host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+
+//===============================================================
+// Global variables
+//===============================================================
+// Namespaces with their keys and values
+static std::map<std::string, std::map<std::string, std::string>> hostPreferences;
+static bool hostPreferencesAvailable = true;
+static uint32_t hostPreferencesWrites = 0;
+
+//===============================================================
+// Preferences functions
+//===============================================================
+bool Preferences::begin(const char* name, bool readOnly, const char* partitionLabel)
+{
+  if (_started ||
+    !hostPreferencesAvailable)
+  {
+    return false;
+  }
+
+  _name = name;
+  _readOnly = readOnly;
+  _started = true;
+  return true;
+}
+
+void Preferences::end()
+{
+  _started = false;
+}
+
+bool Preferences::clear()
+{
+  if (!_started || _readOnly)
+  {
+    return false;
+  }
+  hostPreferences[_name].clear();
+  return true;
+}
+
+bool Preferences::remove(const char* key)
+{
+  if (!_started || _readOnly)
+  {
+    return false;
+  }
+  return hostPreferences[_name].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key)
+{
+  return _started && hostPreferences[_name].count(key) > 0;
+}
+
+size_t Preferences::getBytesLength(const char* key)
+{
+  if (!isKey(key))
+  {
+    return 0;
+  }
+  return hostPreferences[_name][key].size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength)
+{
+  size_t length = getBytesLength(key);
+  if (length == 0 || length > maxLength)
+  {
+    return 0;
+  }
+  memcpy(buffer, hostPreferences[_name][key].data(), length);
+  return length;
+}
+
+size_t Preferences::PutValue(const char* key, const void* value, size_t length)
+{
+  if (!_started || _readOnly)
+  {
+    return 0;
+  }
+  hostPreferences[_name][key] = std::string((const char*)value, length);
+  hostPreferencesWrites++;
+  return length;
+}
+
+void Preferences::HostClearAll()
+{
+  hostPreferences.clear();
+  hostPreferencesWrites = 0;
+}
+
+void Preferences::HostSetAvailable(bool available)
+{
+  hostPreferencesAvailable = available;
+}
+
+uint32_t Preferences::HostWriteCount()
+{
+  return hostPreferencesWrites;
+}
+
+//===============================================================
+// ROM CRC functions
+//===============================================================
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buffer, uint32_t length)
+{
+  crc = ~crc;
+  for (uint32_t index = 0; index < length; index++)
+  {
+    crc ^= buffer[index];
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
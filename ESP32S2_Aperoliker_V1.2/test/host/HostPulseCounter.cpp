@@ -0,0 +1,154 @@
+/**
+ * Host replacement of the pulse counter driver for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <mutex>
+#include <driver/pulse_cnt.h>
+
+//===============================================================
+// Structs
+//===============================================================
+struct HostPulseCounterUnit
+{
+  pcnt_unit_config_t Config;
+  int Count;
+  int Accumulated;
+  bool Running;
+  pcnt_watch_cb_t OnReach;
+  void* UserContext;
+};
+
+struct HostPulseCounterChannel
+{
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+static HostPulseCounterUnit hostUnit = { };
+static HostPulseCounterChannel hostChannels[2] = { };
+static int hostChannelCount = 0;
+static std::mutex hostCountMutex;    // Test threads may count and read concurrently (atomic in hardware)
+
+//===============================================================
+// Pulse counter functions
+//===============================================================
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t* config, pcnt_unit_handle_t* unit)
+{
+  hostUnit = { };
+  hostUnit.Config = *config;
+  hostChannelCount = 0;
+  *unit = &hostUnit;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t unit, const pcnt_glitch_filter_config_t* config)
+{
+  return ESP_OK;
+}
+
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit, const pcnt_chan_config_t* config, pcnt_channel_handle_t* channel)
+{
+  if (hostChannelCount >= 2)
+  {
+    return ESP_FAIL;
+  }
+  *channel = &hostChannels[hostChannelCount++];
+  return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t channel, pcnt_channel_edge_action_t positive, pcnt_channel_edge_action_t negative)
+{
+  return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t channel, pcnt_channel_level_action_t high, pcnt_channel_level_action_t low)
+{
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unit, int value)
+{
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_register_event_callbacks(pcnt_unit_handle_t unit, const pcnt_event_callbacks_t* callbacks, void* userContext)
+{
+  unit->OnReach = callbacks->on_reach;
+  unit->UserContext = userContext;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unit)
+{
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit)
+{
+  std::lock_guard<std::mutex> lock(hostCountMutex);
+  unit->Count = 0;
+  unit->Accumulated = 0;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit)
+{
+  unit->Running = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int* value)
+{
+  std::lock_guard<std::mutex> lock(hostCountMutex);
+  *value = unit->Accumulated + unit->Count;
+  return ESP_OK;
+}
+
+//===============================================================
+// Counts quadrature edges, the counter wraps at the limits (watch
+// points) and accumulates like the hardware
+//===============================================================
+int HostPulseCounterCount(int edges)
+{
+  int woken = 0;
+  if (!hostUnit.Running)
+  {
+    return 0;
+  }
+
+  for (int edge = 0; edge < (edges < 0 ? -edges : edges); edge++)
+  {
+    pcnt_watch_event_data_t eventData = { };
+    {
+      std::lock_guard<std::mutex> lock(hostCountMutex);
+      hostUnit.Count += edges < 0 ? -1 : 1;
+      if (hostUnit.Count != hostUnit.Config.high_limit &&
+        hostUnit.Count != hostUnit.Config.low_limit)
+      {
+        continue;
+      }
+
+      eventData = { hostUnit.Count, 0 };
+      if (hostUnit.Config.flags.accum_count)
+      {
+        hostUnit.Accumulated += hostUnit.Count;
+      }
+      hostUnit.Count = 0;
+    }
+
+    if (hostUnit.OnReach != NULL &&
+      hostUnit.OnReach(&hostUnit, &eventData, hostUnit.UserContext))
+    {
+      woken++;
+    }
+  }
+  return woken;
+}
@@ -0,0 +1,259 @@
+/**
+ * Host replacement of the FreeRTOS tasks for the host tests. Tasks
+ * run cooperatively on the virtual time: a task runs until it
+ * blocks (delay, notification wait), then the ready task with the
+ * highest priority continues. If no task is ready, the virtual time
+ * jumps to the next wake up. Without running tasks, delays only
+ * advance the virtual time
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <ucontext.h>
+#include <vector>
+
+//===============================================================
+// Defines
+//===============================================================
+#define HOST_TASK_STACK_SIZE    (1024 * 1024)         // Host code (printf) needs more stack than the firmware tasks
+#define HOST_WAIT_FOREVER       UINT64_MAX
+
+//===============================================================
+// Structs
+//===============================================================
+struct HostTask
+{
+  const char* Name;
+  UBaseType_t Priority;
+  void (*Function)(void*);
+  void* Parameter;
+  ucontext_t Context;
+  uint8_t* Stack;
+  uint64_t Wake_us;
+  bool WaitsForNotify;
+  uint32_t NotifyCount;
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+static std::vector<HostTask*> hostTasks;
+static HostTask* hostCurrentTask = NULL;
+static ucontext_t hostSchedulerContext;
+static size_t hostNextTaskIndex = 0;
+
+//===============================================================
+// Task entry (the firmware tasks never return)
+//===============================================================
+static void HostTaskEntry()
+{
+  hostCurrentTask->Function(hostCurrentTask->Parameter);
+  ESP_LOGE("host", "Task '%s' returned", hostCurrentTask->Name);
+  hostCurrentTask->Wake_us = HOST_WAIT_FOREVER;
+  swapcontext(&hostCurrentTask->Context, &hostSchedulerContext);
+}
+
+//===============================================================
+// Blocks the current task until the wake up time (or a
+// notification) and returns to the scheduler
+//===============================================================
+static void HostBlock(uint64_t wake_us, bool waitsForNotify)
+{
+  HostTask* task = hostCurrentTask;
+  task->Wake_us = wake_us;
+  task->WaitsForNotify = waitsForNotify;
+  swapcontext(&task->Context, &hostSchedulerContext);
+}
+
+//===============================================================
+// Returns the ready task with the highest priority (round robin
+// between equal priorities)
+//===============================================================
+static HostTask* HostGetReadyTask()
+{
+  HostTask* readyTask = NULL;
+  uint64_t now_us = HostGetMicros();
+  for (size_t offset = 0; offset < hostTasks.size(); offset++)
+  {
+    HostTask* task = hostTasks[(hostNextTaskIndex + offset) % hostTasks.size()];
+    if (task->Wake_us <= now_us &&
+      (readyTask == NULL || task->Priority > readyTask->Priority))
+    {
+      readyTask = task;
+    }
+  }
+  return readyTask;
+}
+
+//===============================================================
+// Runs the tasks until the virtual time, returns false if no task
+// was created
+//===============================================================
+bool HostRunTasks(uint64_t until_us)
+{
+  if (hostTasks.empty() ||
+    hostCurrentTask != NULL)
+  {
+    return false;
+  }
+
+  while (true)
+  {
+    HostTask* task = HostGetReadyTask();
+    if (task != NULL)
+    {
+      for (size_t index = 0; index < hostTasks.size(); index++)
+      {
+        if (hostTasks[index] == task)
+        {
+          hostNextTaskIndex = index + 1;
+        }
+      }
+
+      hostCurrentTask = task;
+      swapcontext(&hostSchedulerContext, &task->Context);
+      hostCurrentTask = NULL;
+      continue;
+    }
+
+    // No task ready, jump to the next wake up
+    uint64_t wake_us = HOST_WAIT_FOREVER;
+    for (HostTask* task : hostTasks)
+    {
+      wake_us = std::min(wake_us, task->Wake_us);
+    }
+    if (wake_us > until_us)
+    {
+      HostSetMicros(std::max(HostGetMicros(), until_us));
+      return true;
+    }
+    HostSetMicros(wake_us);
+  }
+}
+
+//===============================================================
+// Returns the name of the running task (NULL outside of tasks)
+//===============================================================
+const char* HostGetTaskName()
+{
+  return hostCurrentTask != NULL ? hostCurrentTask->Name : NULL;
+}
+
+//===============================================================
+// FreeRTOS functions
+//===============================================================
+void vTaskDelay(TickType_t ticks)
+{
+  if (hostCurrentTask == NULL)
+  {
+    HostAdvanceMillis(ticks * portTICK_PERIOD_MS);
+    return;
+  }
+
+  HostBlock(HostGetMicros() + (uint64_t)ticks * portTICK_PERIOD_MS * 1000, false);
+}
+
+void taskYIELD()
+{
+  if (hostCurrentTask != NULL)
+  {
+    HostBlock(HostGetMicros(), false);
+  }
+}
+
+BaseType_t xTaskCreate(void (*function)(void*), const char* name, uint32_t stackSize, void* parameter, UBaseType_t priority, TaskHandle_t* handle)
+{
+  HostTask* task = new HostTask();
+  task->Name = name;
+  task->Priority = priority;
+  task->Function = function;
+  task->Parameter = parameter;
+  task->Stack = new uint8_t[HOST_TASK_STACK_SIZE];
+  task->Wake_us = HostGetMicros();
+
+  getcontext(&task->Context);
+  task->Context.uc_stack.ss_sp = task->Stack;
+  task->Context.uc_stack.ss_size = HOST_TASK_STACK_SIZE;
+  task->Context.uc_link = NULL;
+  makecontext(&task->Context, HostTaskEntry, 0);
+  hostTasks.push_back(task);
+
+  if (handle != NULL)
+  {
+    *handle = task;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle)
+{
+  // Without created tasks the handle is only a placeholder
+  HostTask* task = (HostTask*)handle;
+  if (task != NULL &&
+    !hostTasks.empty())
+  {
+    task->NotifyCount++;
+    if (task->WaitsForNotify)
+    {
+      task->Wake_us = HostGetMicros();
+      task->WaitsForNotify = false;
+    }
+  }
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t handle, BaseType_t* higherPriorityTaskWoken)
+{
+  // Without created tasks every handle counts as woken
+  HostTask* task = (HostTask*)handle;
+  bool woken = task != NULL && (hostTasks.empty() || task->WaitsForNotify);
+  xTaskNotifyGive(handle);
+  *higherPriorityTaskWoken = woken ? pdTRUE : pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticks)
+{
+  HostTask* task = hostCurrentTask;
+  if (task == NULL)
+  {
+    return 0;
+  }
+
+  if (task->NotifyCount == 0 &&
+    ticks > 0)
+  {
+    HostBlock(ticks == portMAX_DELAY ? HOST_WAIT_FOREVER : HostGetMicros() + (uint64_t)ticks * portTICK_PERIOD_MS * 1000, true);
+    task->WaitsForNotify = false;
+  }
+
+  uint32_t count = task->NotifyCount;
+  task->NotifyCount = clearCountOnExit ? 0 : (count > 0 ? count - 1 : 0);
+  return count;
+}
+
+//===============================================================
+// Semaphores (the tasks never preempt each other)
+//===============================================================
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+  static int mutex = 0;
+  return &mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+  return pdTRUE;
+}
@@ -0,0 +1,535 @@
+/**
+ * Host replacement of the asynchronous web server for the host
+ * tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+//===============================================================
+// Includes
+//===============================================================
+#include <ESPAsyncWebServer.h>
+
+//===============================================================
+// Responses
+//===============================================================
+bool AsyncWebServerResponse::_hostKeepContent = true;
+
+void AsyncWebServerResponse::HostAppend(const char* data, size_t length)
+{
+  if (_hostKeepContent)
+  {
+    _content.append(data, length);
+  }
+  _length += length;
+}
+
+String AsyncWebServerResponse::HostHeader(const String& name) const
+{
+  for (auto& header : _headers)
+  {
+    if (header.first == name)
+    {
+      return header.second;
+    }
+  }
+  return String();
+}
+
+void AsyncChunkedResponse::HostFill()
+{
+  uint8_t buffer[HOST_RESPONSE_CHUNK_SIZE];
+  size_t length;
+  while ((length = _filler(buffer, sizeof(buffer), _length)) > 0)
+  {
+    HostAppend((const char*)buffer, length);
+    _chunks++;
+  }
+}
+
+AsyncFileResponse::AsyncFileResponse(File content, const String& path, const String& contentType, bool download) :
+  AsyncWebServerResponse(200, contentType), _file(content)
+{
+  if (String(_file.name()).endsWith(".gz") &&
+    !path.endsWith(".gz"))
+  {
+    addHeader("Content-Encoding", "gzip");
+  }
+  if (download)
+  {
+    addHeader("Content-Disposition", String("attachment; filename=\"") + _file.name() + "\"");
+  }
+}
+
+void AsyncFileResponse::HostFill()
+{
+  uint8_t buffer[HOST_RESPONSE_CHUNK_SIZE];
+  size_t length;
+  while ((length = _file.read(buffer, sizeof(buffer))) > 0)
+  {
+    HostAppend((const char*)buffer, length);
+  }
+  _file.close();
+}
+
+//===============================================================
+// Request
+//===============================================================
+AsyncWebServerRequest::~AsyncWebServerRequest()
+{
+  delete _response;
+  if (_tempObject != NULL)
+  {
+    free(_tempObject);
+  }
+}
+
+const AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post, bool file) const
+{
+  for (const AsyncWebParameter& param : _params)
+  {
+    if (param.name() == name &&
+      param.isPost() == post &&
+      param.isFile() == file)
+    {
+      return &param;
+    }
+  }
+  return NULL;
+}
+
+bool AsyncWebServerRequest::hasArg(const char* name) const
+{
+  for (const AsyncWebParameter& param : _params)
+  {
+    if (param.name() == name)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+const String& AsyncWebServerRequest::arg(const String& name) const
+{
+  static const String empty;
+  for (const AsyncWebParameter& param : _params)
+  {
+    if (param.name() == name)
+    {
+      return param.value();
+    }
+  }
+  return empty;
+}
+
+bool AsyncWebServerRequest::hasHeader(const String& name) const
+{
+  for (auto& header : _headers)
+  {
+    if (header.first == name)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+const String& AsyncWebServerRequest::header(const String& name) const
+{
+  static const String empty;
+  for (auto& header : _headers)
+  {
+    if (header.first == name)
+    {
+      return header.second;
+    }
+  }
+  return empty;
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse* response)
+{
+  if (_response != NULL)
+  {
+    ESP_LOGE("host", "Request '%s' answered twice", _url.c_str());
+    delete response;
+    return;
+  }
+  _response = response;
+  _response->HostFill();
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(FS& fs, const String& path, const String& contentType, bool download)
+{
+  File file = fs.open(path, FILE_READ);
+  if (!file)
+  {
+    return new AsyncWebServerResponse(404);
+  }
+  return new AsyncFileResponse(file, path, contentType, download);
+}
+
+void AsyncWebServerRequest::HostAddParam(const String& name, const String& value, bool post, bool file)
+{
+  _params.push_back(AsyncWebParameter(name, value, post, file, value.length()));
+}
+
+void AsyncWebServerRequest::HostAddHeader(const String& name, const String& value)
+{
+  _headers.push_back(std::make_pair(name, value));
+}
+
+void AsyncWebServerRequest::HostDisconnect()
+{
+  if (_onDisconnect)
+  {
+    _onDisconnect();
+  }
+}
+
+//===============================================================
+// Static files
+//===============================================================
+AsyncStaticWebHandler::AsyncStaticWebHandler(const char* uri, FS& fs, const char* path, const char* cacheControl) :
+  _uri(uri), _fs(fs), _path(path), _cacheControl(cacheControl != NULL ? cacheControl : "")
+{
+  // The root URI matches all paths
+  if (_uri.endsWith("/"))
+  {
+    _uri = _uri.substring(0, _uri.length() - 1);
+  }
+  if (_path.endsWith("/"))
+  {
+    _path = _path.substring(0, _path.length() - 1);
+  }
+}
+
+bool AsyncStaticWebHandler::canHandle(AsyncWebServerRequest* request) const
+{
+  if (request->method() != HTTP_GET ||
+    !request->url().startsWith(_uri))
+  {
+    return false;
+  }
+
+  String path = _path + request->url().substring(_uri.length());
+  if (!path.endsWith("/") &&
+    SearchFile(request, path))
+  {
+    return true;
+  }
+  return _defaultFile.length() > 0 &&
+    SearchFile(request, (path.endsWith("/") ? path : path + "/") + _defaultFile);
+}
+
+bool AsyncStaticWebHandler::SearchFile(AsyncWebServerRequest* request, const String& path) const
+{
+  String gzip = path + ".gz";
+  const String* candidates[2] = { &gzip, &path };
+  if (!_tryGzipFirst)
+  {
+    std::swap(candidates[0], candidates[1]);
+  }
+
+  for (const String* candidate : candidates)
+  {
+    if (_fs.exists(*candidate))
+    {
+      request->_tempFile = _fs.open(*candidate, FILE_READ);
+      request->_tempObject = strdup(candidate->c_str());
+      return true;
+    }
+  }
+  return false;
+}
+
+void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest* request)
+{
+  String filename = (const char*)request->_tempObject;
+  free(request->_tempObject);
+  request->_tempObject = NULL;
+
+  String etag = String((unsigned int)request->_tempFile.size());
+  if (_cacheControl.length() > 0 &&
+    request->header("If-None-Match") == etag)
+  {
+    request->_tempFile.close();
+    AsyncWebServerResponse* response = new AsyncWebServerResponse(304);
+    response->addHeader("Cache-Control", _cacheControl);
+    response->addHeader("ETag", etag);
+    request->send(response);
+    return;
+  }
+
+  String path = filename.endsWith(".gz") ? filename.substring(0, filename.length() - 3) : filename;
+  AsyncWebServerResponse* response = new AsyncFileResponse(request->_tempFile, path);
+  if (_cacheControl.length() > 0)
+  {
+    response->addHeader("Cache-Control", _cacheControl);
+    response->addHeader("ETag", etag);
+  }
+  request->send(response);
+}
+
+//===============================================================
+// Websocket client
+//===============================================================
+bool AsyncWebSocketClient::text(AsyncWebSocketSharedBuffer buffer)
+{
+  if (_status != WS_CONNECTED)
+  {
+    return false;
+  }
+
+  // A full queue closes the client like the library
+  if (_queue.size() >= WS_MAX_QUEUED_MESSAGES)
+  {
+    HostDropped++;
+    _status = WS_DISCONNECTING;
+    return false;
+  }
+
+  _queue.push_back(buffer);
+  return true;
+}
+
+bool AsyncWebSocketClient::text(AsyncWebSocketMessageBuffer* buffer)
+{
+  bool queued = buffer != NULL && text(buffer->_buffer);
+  delete buffer;
+  return queued;
+}
+
+size_t AsyncWebSocketClient::printf(const char* format, ...)
+{
+  char buffer[256];
+  va_list arguments;
+  va_start(arguments, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, arguments);
+  va_end(arguments);
+  length = std::min(std::max(length, 0), (int)sizeof(buffer) - 1);
+  return text(buffer, (size_t)length) ? (size_t)length : 0;
+}
+
+std::vector<std::string> AsyncWebSocketClient::HostTakeMessages()
+{
+  std::vector<std::string> messages;
+  for (AsyncWebSocketSharedBuffer& buffer : _queue)
+  {
+    messages.push_back(std::string(buffer->begin(), buffer->end()));
+  }
+  _queue.clear();
+  return messages;
+}
+
+//===============================================================
+// Websocket server
+//===============================================================
+size_t AsyncWebSocket::count() const
+{
+  size_t connected = 0;
+  for (const AsyncWebSocketClient& client : _clients)
+  {
+    connected += client.status() == WS_CONNECTED ? 1 : 0;
+  }
+  return connected;
+}
+
+AsyncWebSocketClient* AsyncWebSocket::client(uint32_t id)
+{
+  for (AsyncWebSocketClient& client : _clients)
+  {
+    if (client.id() == id &&
+      client.status() == WS_CONNECTED)
+    {
+      return &client;
+    }
+  }
+  return NULL;
+}
+
+bool AsyncWebSocket::availableForWriteAll()
+{
+  for (AsyncWebSocketClient& client : _clients)
+  {
+    if (client.queueIsFull())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool AsyncWebSocket::availableForWrite(uint32_t id)
+{
+  AsyncWebSocketClient* found = client(id);
+  return found != NULL && !found->queueIsFull();
+}
+
+void AsyncWebSocket::cleanupClients(uint16_t maxClients)
+{
+  // The library closes the oldest client above the limit (one per
+  // call), closed connections report the disconnect when removed
+  if (count() > maxClients)
+  {
+    _clients.front().close();
+  }
+  for (AsyncWebSocketClient& client : _clients)
+  {
+    if (client.status() == WS_DISCONNECTING)
+    {
+      HostDisconnect(client.id());
+    }
+  }
+  _clients.remove_if([](const AsyncWebSocketClient& client) { return client.status() != WS_CONNECTED; });
+}
+
+bool AsyncWebSocket::text(uint32_t id, const char* message)
+{
+  AsyncWebSocketClient* found = client(id);
+  return found != NULL && found->text(message);
+}
+
+bool AsyncWebSocket::text(uint32_t id, AsyncWebSocketMessageBuffer* buffer)
+{
+  AsyncWebSocketClient* found = client(id);
+  if (found == NULL)
+  {
+    delete buffer;
+    return false;
+  }
+  return found->text(buffer);
+}
+
+void AsyncWebSocket::textAll(AsyncWebSocketSharedBuffer buffer)
+{
+  for (AsyncWebSocketClient& client : _clients)
+  {
+    client.text(buffer);
+  }
+}
+
+void AsyncWebSocket::textAll(AsyncWebSocketMessageBuffer* buffer)
+{
+  if (buffer != NULL)
+  {
+    textAll(buffer->_buffer);
+    delete buffer;
+  }
+}
+
+AsyncWebSocketClient* AsyncWebSocket::HostConnect()
+{
+  _clients.emplace_back(this, _nextID++);
+  AsyncWebSocketClient* client = &_clients.back();
+  if (_eventHandler)
+  {
+    _eventHandler(this, client, WS_EVT_CONNECT, NULL, NULL, 0);
+  }
+  return client;
+}
+
+void AsyncWebSocket::HostDisconnect(uint32_t id)
+{
+  for (AsyncWebSocketClient& client : _clients)
+  {
+    if (client.id() == id &&
+      client.status() != WS_DISCONNECTED)
+    {
+      client.HostDisconnect();
+      if (_eventHandler)
+      {
+        _eventHandler(this, &client, WS_EVT_DISCONNECT, NULL, NULL, 0);
+      }
+    }
+  }
+}
+
+void AsyncWebSocket::HostReceive(uint32_t id, AwsFrameType opcode, const uint8_t* data, size_t len)
+{
+  AsyncWebSocketClient* found = client(id);
+  if (found == NULL ||
+    !_eventHandler)
+  {
+    return;
+  }
+
+  AwsFrameInfo info = { };
+  info.message_opcode = opcode;
+  info.opcode = opcode;
+  info.final = 1;
+  info.index = 0;
+  info.len = len;
+
+  // The library passes the frame in its receive buffer
+  std::vector<uint8_t> frame(data, data + len);
+  _eventHandler(this, found, WS_EVT_DATA, &info, frame.data(), len);
+}
+
+//===============================================================
+// Web server
+//===============================================================
+AsyncWebServer::~AsyncWebServer()
+{
+  for (AsyncWebHandler* handler : _handlers)
+  {
+    delete handler;
+  }
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload)
+{
+  AsyncCallbackWebHandler* handler = new AsyncCallbackWebHandler(uri, method, onRequest, onUpload);
+  _handlers.push_back(handler);
+  return *handler;
+}
+
+AsyncStaticWebHandler& AsyncWebServer::serveStatic(const char* uri, FS& fs, const char* path, const char* cacheControl)
+{
+  AsyncStaticWebHandler* handler = new AsyncStaticWebHandler(uri, fs, path, cacheControl);
+  _handlers.push_back(handler);
+  return *handler;
+}
+
+AsyncWebHandler* AsyncWebServer::HostFindHandler(AsyncWebServerRequest* request)
+{
+  for (AsyncWebHandler* handler : _handlers)
+  {
+    if (handler->canHandle(request))
+    {
+      return handler;
+    }
+  }
+  return NULL;
+}
+
+AsyncWebServerResponse* AsyncWebServer::HostHandle(AsyncWebServerRequest* request, const String& filename, const std::vector<std::string>& chunks)
+{
+  AsyncWebHandler* handler = HostFindHandler(request);
+  if (handler == NULL)
+  {
+    if (_notFound)
+    {
+      _notFound(request);
+    }
+    else
+    {
+      request->send(404);
+    }
+    return request->HostResponse();
+  }
+
+  size_t index = 0;
+  for (size_t chunk = 0; chunk < chunks.size(); chunk++)
+  {
+    std::string data = chunks[chunk];
+    handler->handleUpload(request, filename, index, (uint8_t*)data.data(), data.size(), chunk + 1 == chunks.size());
+    index += data.size();
+  }
+
+  handler->handleRequest(request);
+  return request->HostResponse();
+}
@@ -0,0 +1,22 @@
+/**
+ * Host replacement of LittleFS for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include "HostFlashFS.h"
+
+//===============================================================
+// Global variables
+//===============================================================
+extern HostFlashFS LittleFS;
+
+#endif
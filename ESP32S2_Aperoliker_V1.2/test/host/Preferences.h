@@ -0,0 +1,72 @@
+/**
+ * Host replacement of the preferences (non volatile storage) for
+ * the host tests. Values are kept in memory and shared by all
+ * instances like the flash
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+#include <map>
+#include <string>
+
+//===============================================================
+// Class for the preferences of one namespace
+//===============================================================
+class Preferences
+{
+  public:
+    bool begin(const char* name, bool readOnly = false, const char* partitionLabel = NULL);
+    void end();
+
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putBool(const char* key, bool value) { return PutValue(key, &value, sizeof(value)); }
+    size_t putLong(const char* key, int32_t value) { return PutValue(key, &value, sizeof(value)); }
+    size_t putULong(const char* key, uint32_t value) { return PutValue(key, &value, sizeof(value)); }
+    size_t putDouble(const char* key, double value) { return PutValue(key, &value, sizeof(value)); }
+    size_t putBytes(const char* key, const void* value, size_t length) { return PutValue(key, value, length); }
+
+    bool getBool(const char* key, bool defaultValue = false) { return GetValue(key, defaultValue); }
+    int32_t getLong(const char* key, int32_t defaultValue = 0) { return GetValue(key, defaultValue); }
+    uint32_t getULong(const char* key, uint32_t defaultValue = 0) { return GetValue(key, defaultValue); }
+    double getDouble(const char* key, double defaultValue = NAN) { return GetValue(key, defaultValue); }
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buffer, size_t maxLength);
+
+    // Host functions (erases the simulated flash, lets begin fail,
+    // counts the written values as measure of the flash wear)
+    static void HostClearAll();
+    static void HostSetAvailable(bool available);
+    static uint32_t HostWriteCount();
+
+  private:
+    std::string _name;
+    bool _started = false;
+    bool _readOnly = true;
+
+    size_t PutValue(const char* key, const void* value, size_t length);
+
+    template <typename T>
+    T GetValue(const char* key, T defaultValue)
+    {
+      T value = defaultValue;
+      if (getBytesLength(key) == sizeof(T))
+      {
+        getBytes(key, &value, sizeof(T));
+      }
+      return value;
+    }
+};
+
+#endif
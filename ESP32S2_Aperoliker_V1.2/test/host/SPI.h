@@ -0,0 +1,35 @@
+/**
+ * Host replacement of the SPI bus for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+
+//===============================================================
+// Defines
+//===============================================================
+#define FSPI        0
+#define HSPI        1
+#define SPI_MODE0   0
+#define SPI_MODE3   3
+
+//===============================================================
+// Class for the SPI bus of the host (no device attached)
+//===============================================================
+class SPIClass
+{
+  public:
+    SPIClass(uint8_t bus = FSPI) { }
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) { }
+};
+
+#endif
@@ -0,0 +1,22 @@
+/**
+ * Host replacement of SPIFFS for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_SPIFFS_H
+#define HOST_SPIFFS_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include "HostFlashFS.h"
+
+//===============================================================
+// Global variables
+//===============================================================
+extern HostFlashFS SPIFFS;
+
+#endif
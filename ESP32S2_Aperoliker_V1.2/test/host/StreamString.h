@@ -0,0 +1,32 @@
+/**
+ * Host replacement of the stream string for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_STREAMSTRING_H
+#define HOST_STREAMSTRING_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+
+//===============================================================
+// String, which can be printed to
+//===============================================================
+class StreamString : public Print, public String
+{
+  public:
+    using Print::write;
+
+    size_t write(uint8_t value) override
+    {
+      *this += (char)value;
+      return 1;
+    }
+};
+
+#endif
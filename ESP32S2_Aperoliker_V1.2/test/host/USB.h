@@ -0,0 +1,42 @@
+/**
+ * Host replacement of the USB stack for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_USB_H
+#define HOST_USB_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+
+//===============================================================
+// Class for the USB device of the host (never enumerated)
+//===============================================================
+class ESPUSB
+{
+  public:
+    bool begin() { return true; }
+};
+
+//===============================================================
+// Class for the USB CDC port of the host (output is discarded)
+//===============================================================
+class USBCDC : public Print
+{
+  public:
+    void begin(unsigned long baud = 0) { }
+    size_t write(uint8_t value) override { return 1; }
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+inline ESPUSB USB;
+inline USBCDC USBSerial;
+
+#endif
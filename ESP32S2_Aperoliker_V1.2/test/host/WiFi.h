@@ -0,0 +1,93 @@
+/**
+ * Host replacement of the wifi types for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <Arduino.h>
+
+//===============================================================
+// Enums
+//===============================================================
+typedef enum
+{
+  WIFI_POWER_19_5dBm = 78,
+  WIFI_POWER_19dBm = 76,
+  WIFI_POWER_18_5dBm = 74,
+  WIFI_POWER_17dBm = 68,
+  WIFI_POWER_15dBm = 60,
+  WIFI_POWER_13dBm = 52,
+  WIFI_POWER_11dBm = 44,
+  WIFI_POWER_8_5dBm = 34,
+  WIFI_POWER_7dBm = 28,
+  WIFI_POWER_5dBm = 20,
+  WIFI_POWER_2dBm = 8,
+  WIFI_POWER_MINUS_1dBm = -4
+} wifi_power_t;
+
+typedef enum
+{
+  WIFI_MODE_NULL = 0,
+  WIFI_MODE_STA,
+  WIFI_MODE_AP,
+  WIFI_MODE_APSTA
+} wifi_mode_t;
+
+#define WIFI_OFF    WIFI_MODE_NULL
+#define WIFI_STA    WIFI_MODE_STA
+#define WIFI_AP     WIFI_MODE_AP
+
+//===============================================================
+// Class for an IPv4 address
+//===============================================================
+class IPAddress
+{
+  public:
+    IPAddress(uint8_t first = 0, uint8_t second = 0, uint8_t third = 0, uint8_t fourth = 0) : _address { first, second, third, fourth } { }
+    uint8_t operator[](int index) const { return _address[index]; }
+
+  private:
+    uint8_t _address[4];
+};
+
+//===============================================================
+// Class for the wifi of the host (the station is never connected,
+// the access point only keeps its state)
+//===============================================================
+class WiFiClass
+{
+  public:
+    String macAddress() { return "AA:BB:CC:DD:EE:FF"; }
+    String SSID() { return ""; }
+    String BSSIDstr() { return ""; }
+    int32_t channel() { return 0; }
+    wifi_power_t getTxPower() { return _txPower; }
+    bool setTxPower(wifi_power_t power) { _txPower = power; return true; }
+
+    bool softAP(const char* ssid, const char* password = NULL) { _apStarted = true; return true; }
+    bool softAPConfig(IPAddress localIP, IPAddress gateway, IPAddress subnet) { return true; }
+    bool softAPdisconnect(bool wifiOff = false) { _apStarted = false; return true; }
+    uint8_t softAPgetStationNum() { return _apStarted ? HostStations : 0; }
+
+    // Stations connected to the access point (set by the test)
+    uint8_t HostStations = 0;
+
+  private:
+    wifi_power_t _txPower = WIFI_POWER_19_5dBm;
+    bool _apStarted = false;
+};
+
+//===============================================================
+// Global variables
+//===============================================================
+inline WiFiClass WiFi;
+
+#endif
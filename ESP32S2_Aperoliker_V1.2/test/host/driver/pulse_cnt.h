@@ -0,0 +1,101 @@
+/**
+ * Host replacement of the pulse counter driver for the host tests.
+ * Encoder edges are injected with HostPulseCounterCount, the watch
+ * point callbacks are called like by the interrupt
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_PULSE_CNT_H
+#define HOST_PULSE_CNT_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <stdint.h>
+#include <stddef.h>
+
+//===============================================================
+// Defines
+//===============================================================
+#ifndef ESP_OK
+#define ESP_OK                          0
+#define ESP_FAIL                        -1
+#endif
+
+//===============================================================
+// Typedefs
+//===============================================================
+typedef int esp_err_t;
+typedef struct HostPulseCounterUnit* pcnt_unit_handle_t;
+typedef struct HostPulseCounterChannel* pcnt_channel_handle_t;
+
+typedef struct
+{
+  int low_limit;
+  int high_limit;
+  int intr_priority;
+  struct { uint32_t accum_count : 1; } flags;
+} pcnt_unit_config_t;
+
+typedef struct
+{
+  int edge_gpio_num;
+  int level_gpio_num;
+  struct { uint32_t invert_edge_input : 1; uint32_t invert_level_input : 1; } flags;
+} pcnt_chan_config_t;
+
+typedef struct
+{
+  uint32_t max_glitch_ns;
+} pcnt_glitch_filter_config_t;
+
+typedef enum
+{
+  PCNT_CHANNEL_EDGE_ACTION_HOLD,
+  PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+  PCNT_CHANNEL_EDGE_ACTION_DECREASE
+} pcnt_channel_edge_action_t;
+
+typedef enum
+{
+  PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+  PCNT_CHANNEL_LEVEL_ACTION_INVERSE,
+  PCNT_CHANNEL_LEVEL_ACTION_HOLD
+} pcnt_channel_level_action_t;
+
+typedef struct
+{
+  int watch_point_value;
+  int zero_cross_mode;
+} pcnt_watch_event_data_t;
+
+typedef bool (*pcnt_watch_cb_t)(pcnt_unit_handle_t unit, const pcnt_watch_event_data_t* eventData, void* userContext);
+
+typedef struct
+{
+  pcnt_watch_cb_t on_reach;
+} pcnt_event_callbacks_t;
+
+//===============================================================
+// Declarations
+//===============================================================
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t* config, pcnt_unit_handle_t* unit);
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t unit, const pcnt_glitch_filter_config_t* config);
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit, const pcnt_chan_config_t* config, pcnt_channel_handle_t* channel);
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t channel, pcnt_channel_edge_action_t positive, pcnt_channel_edge_action_t negative);
+esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t channel, pcnt_channel_level_action_t high, pcnt_channel_level_action_t low);
+esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unit, int value);
+esp_err_t pcnt_unit_register_event_callbacks(pcnt_unit_handle_t unit, const pcnt_event_callbacks_t* callbacks, void* userContext);
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unit);
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit);
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit);
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int* value);
+
+// Counts quadrature edges on the last created unit (positive or
+// negative), returns the number of woken flags of the callbacks
+int HostPulseCounterCount(int edges);
+
+#endif
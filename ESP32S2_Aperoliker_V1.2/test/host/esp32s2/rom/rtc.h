@@ -0,0 +1,17 @@
+/**
+ * Host replacement of the ROM reset reason for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_ROM_RTC_H
+#define HOST_ROM_RTC_H
+
+//===============================================================
+// Declarations
+//===============================================================
+int rtc_get_reset_reason(int cpu);
+
+#endif
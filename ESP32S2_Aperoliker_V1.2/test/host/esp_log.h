@@ -0,0 +1,51 @@
+/**
+ * Host replacement of the ESP-IDF logging for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_ESP_LOG_H
+#define HOST_ESP_LOG_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <stdint.h>
+#include <stdio.h>
+
+//===============================================================
+// Enums
+//===============================================================
+typedef enum
+{
+  ESP_LOG_NONE = 0,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+//===============================================================
+// Declarations
+//===============================================================
+// Prints a log line to stderr, if the level is enabled (errors by
+// default, environment variable HOST_LOG_LEVEL=0-5)
+void HostLog(esp_log_level_t level, const char* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+// Redirects the log lines to a file (NULL -> stderr) and sets the
+// log level (overrides HOST_LOG_LEVEL)
+void HostSetLogOutput(FILE* file, int level);
+
+//===============================================================
+// Defines
+//===============================================================
+#define ESP_LOGE(tag, format, ...) HostLog(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HostLog(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HostLog(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HostLog(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) HostLog(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#endif
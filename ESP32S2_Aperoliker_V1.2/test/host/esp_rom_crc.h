@@ -0,0 +1,23 @@
+/**
+ * Host replacement of the ROM CRC functions for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_ESP_ROM_CRC_H
+#define HOST_ESP_ROM_CRC_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <stdint.h>
+
+//===============================================================
+// Declarations
+//===============================================================
+// CRC32 (little endian, polynomial 0xEDB88320) like the ROM function
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buffer, uint32_t length);
+
+#endif
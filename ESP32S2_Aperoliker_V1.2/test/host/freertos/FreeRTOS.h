@@ -0,0 +1,57 @@
+/**
+ * Host replacement of the FreeRTOS types for the host tests. The
+ * host runs the firmware tasks cooperatively on one thread, so the
+ * critical sections only keep the firmware interface
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include <stdint.h>
+
+//===============================================================
+// Typedefs
+//===============================================================
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef struct { int Locked; } portMUX_TYPE;
+
+//===============================================================
+// Defines
+//===============================================================
+#define pdTRUE                          1
+#define pdFALSE                         0
+#define pdPASS                          1
+#define portMAX_DELAY                   0xFFFFFFFFu
+#define portTICK_PERIOD_MS              1
+#define pdMS_TO_TICKS(ms)               ((TickType_t)(ms))
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+#define portYIELD_FROM_ISR(...)         ((void)0)
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux)     ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)      ((void)(mux))
+#define portENTER_CRITICAL_SAFE(mux)    ((void)(mux))
+#define portEXIT_CRITICAL_SAFE(mux)     ((void)(mux))
+
+//===============================================================
+// Declarations
+//===============================================================
+void vTaskDelay(TickType_t ticks);
+void taskYIELD();
+BaseType_t xTaskCreate(void (*task)(void*), const char* name, uint32_t stackSize, void* parameter, UBaseType_t priority, TaskHandle_t* handle);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticks);
+
+#endif
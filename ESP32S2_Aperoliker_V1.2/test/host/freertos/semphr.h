@@ -0,0 +1,24 @@
+/**
+ * Host replacement of the FreeRTOS semaphores for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_SEMPHR_H
+#define HOST_SEMPHR_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include "freertos/FreeRTOS.h"
+
+//===============================================================
+// Declarations
+//===============================================================
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+#endif
@@ -0,0 +1,27 @@
+/**
+ * Host replacement of the FreeRTOS tasks for the host tests
+ *
+ * @author    Florian Staeblein
+ * @date      2024/01/28
+ * @copyright © 2024 Florian Staeblein
+ */
+
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+//===============================================================
+// Includes
+//===============================================================
+#include "freertos/FreeRTOS.h"
+
+//===============================================================
+// Declarations
+//===============================================================
+// Runs the created tasks cooperatively until the virtual time,
+// returns false if no task was created (or called from a task)
+bool HostRunTasks(uint64_t until_us);
+
+// Returns the name of the running task (NULL outside of tasks)
+const char* HostGetTaskName();
+
+#endif
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""
+Builds the web assets of the data folder for the storage upload
+
+Text files (html, js, css, svg, ico) are minified (comments and
+indentation, line breaks are kept) and gzipped. Scripts and style
+sheets referenced by a html file get the content hash in their name
+(e.g. 'index.0123abcd.js.gz') and the references are rewritten, the
+web asset handler serves them with an immutable cache control. All
+other files (e.g. the bitmaps of the display) are copied unchanged.
+
+python3 tools/BuildWebAssets.py data <output folder>
+
+Upload the output folder instead of the data folder (file system
+image or SPIFFS editor).
+
+@author    Florian Staeblein
+@date      2024/01/28
+@copyright © 2024 Florian Staeblein
+"""
+
+import gzip
+import os
+import re
+import sys
+import zlib
+
+# Maximum path length of the storage (STORAGE_PATH_LENGTH without
+# the zero terminator)
+MAX_PATH_LENGTH = 31
+
+# Content hash digits in file names (WEB_ASSET_HASH_LENGTH)
+HASH_LENGTH = 8
+
+# Gzipped file types and file types with hashed names
+GZIP_EXTENSIONS = (".html", ".js", ".css", ".svg", ".ico")
+HASH_EXTENSIONS = (".js", ".css")
+
+
+def minify(name, data):
+    """Removes comments and indentation of a text file"""
+    extension = os.path.splitext(name)[1]
+    if extension not in (".html", ".js", ".css"):
+        return data
+
+    text = data.decode("utf-8")
+    if extension == ".html":
+        # Comments, except conditional comments ('<!--[if IE]>')
+        text = re.sub(r"<!--(?!\[if).*?-->", "", text, flags=re.S)
+    elif extension == ".css":
+        text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    else:
+        # Only comments on own lines, strings may contain '//' or '/*'
+        text = re.sub(r"^[ \t]*/\*.*?\*/[ \t]*$", "", text, flags=re.S | re.M)
+        text = re.sub(r"^[ \t]*//.*$", "", text, flags=re.M)
+
+    lines = (line.strip() for line in text.splitlines())
+    return ("\n".join(line for line in lines if line) + "\n").encode("utf-8")
+
+
+def compress(data):
+    """Gzips the data reproducibly (no time stamp)"""
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def content_hash(data):
+    """Returns the CRC32 of the data (same as the firmware ETag)"""
+    return "%08x" % zlib.crc32(data)
+
+
+def hashed_name(name, data):
+    """Inserts the content hash of the gzipped data into the name,
+    shortens the base name to the maximum path length"""
+    base, extension = os.path.splitext(name)
+    length = MAX_PATH_LENGTH - len("/.gz") - len(extension) - HASH_LENGTH - 1
+    return "%s.%s%s" % (base[:length], content_hash(data)[:HASH_LENGTH], extension)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("Usage: %s <data folder> <output folder>" % sys.argv[0])
+        return 1
+
+    source, target = sys.argv[1], sys.argv[2]
+    os.makedirs(target, exist_ok=True)
+
+    names = sorted(name for name in os.listdir(source) if os.path.isfile(os.path.join(source, name)))
+    contents = {}
+    for name in names:
+        with open(os.path.join(source, name), "rb") as file:
+            contents[name] = file.read()
+
+    # Referenced scripts and style sheets
+    pages = [name for name in names if name.endswith(".html")]
+    referenced = set()
+    for name in names:
+        if name.endswith(HASH_EXTENSIONS):
+            pattern = re.compile(r"""(src|href)=["']%s["']""" % re.escape(name))
+            if any(pattern.search(contents[page].decode("utf-8")) for page in pages):
+                referenced.add(name)
+
+    # Hashed files first, the pages reference them
+    renames = {}
+    outputs = []
+    for name in sorted(names, key=lambda name: name.endswith(".html")):
+        data = contents[name]
+        minified = minify(name, data)
+        if name in pages:
+            text = minified.decode("utf-8")
+            for original, renamed in renames.items():
+                text = re.sub(r"""((src|href)=["'])%s(["'])""" % re.escape(original), r"\g<1>%s\g<3>" % renamed, text)
+            minified = text.encode("utf-8")
+
+        if name.endswith(GZIP_EXTENSIONS):
+            stored = compress(minified)
+            outputName = name
+            if name in referenced:
+                outputName = hashed_name(name, stored)
+                renames[name] = outputName
+            outputName += ".gz"
+        else:
+            stored = data
+            outputName = name
+
+        if len("/" + outputName) > MAX_PATH_LENGTH:
+            print("Path of '%s' is longer than %d characters" % (outputName, MAX_PATH_LENGTH))
+            return 1
+
+        with open(os.path.join(target, outputName), "wb") as file:
+            file.write(stored)
+        outputs.append((name, outputName, len(data), len(minified), len(stored)))
+
+    # Files of an earlier build (e.g. old hashed names) must not be uploaded
+    built = set(output[1] for output in outputs)
+    for name in os.listdir(target):
+        if name not in built and os.path.isfile(os.path.join(target, name)):
+            os.remove(os.path.join(target, name))
+
+    # Summary
+    print("%-28s %-32s %8s %8s %8s" % ("File", "Output", "Raw", "Minified", "Stored"))
+    for name, outputName, raw, minified, stored in outputs:
+        print("%-28s %-32s %8d %8d %8d" % (name, outputName, raw, minified, stored))
+    web = [output for output in outputs if output[0].endswith(GZIP_EXTENSIONS)]
+    print("Web assets: %d bytes raw, %d bytes stored" % (sum(output[2] for output in web), sum(output[4] for output in web)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -266,9 +266,10 @@ void DisplayDriver::ShowSettingsPage()
   // Draw header information
   DrawHeader("Settings");
 
-  double valueLiquid1 = FlowMeter.GetValueLiquid1();
-  double valueLiquid2 = FlowMeter.GetValueLiquid2();
-  double valueLiquid3 = FlowMeter.GetValueLiquid3();
+  double valueLiquid1 = 0.0;
+  double valueLiquid2 = 0.0;
+  double valueLiquid3 = 0.0;
+  FlowMeter.GetValues(&valueLiquid1, &valueLiquid2, &valueLiquid3);
 
   // Fill in settings text
   _tft->setTextSize(1);
@@ -27,9 +27,10 @@ void FlowMeterDriver::Load()
 {
   if (_preferences.begin(SETTINGS_NAME, true))
   {
-    _valueLiquid1_L = _preferences.getDouble(KEY_FLOW_LIQUID1, 0.0);
-    _valueLiquid2_L = _preferences.getDouble(KEY_FLOW_LIQUID2, 0.0);
-    _valueLiquid3_L = _preferences.getDouble(KEY_FLOW_LIQUID3, 0.0);
+    // Values are stored in liters, convert them to flow times
+    _flowTimeLiquid1_ms = (uint32_t)(_preferences.getDouble(KEY_FLOW_LIQUID1, 0.0) / FLOWRATE + 0.5);
+    _flowTimeLiquid2_ms = (uint32_t)(_preferences.getDouble(KEY_FLOW_LIQUID2, 0.0) / FLOWRATE + 0.5);
+    _flowTimeLiquid3_ms = (uint32_t)(_preferences.getDouble(KEY_FLOW_LIQUID3, 0.0) / FLOWRATE + 0.5);
     _preferences.end();
   }
 }
@@ -39,11 +40,17 @@ void FlowMeterDriver::Load()
 //===============================================================
 void FlowMeterDriver::Save()
 {
+  // Get consistent snapshot of all values
+  double valueLiquid1_L = 0.0;
+  double valueLiquid2_L = 0.0;
+  double valueLiquid3_L = 0.0;
+  GetValues(&valueLiquid1_L, &valueLiquid2_L, &valueLiquid3_L);
+
   if (_preferences.begin(SETTINGS_NAME, false))
   {
-    _preferences.putDouble(KEY_FLOW_LIQUID1, _valueLiquid1_L);
-    _preferences.putDouble(KEY_FLOW_LIQUID2, _valueLiquid2_L);
-    _preferences.putDouble(KEY_FLOW_LIQUID3, _valueLiquid3_L); 
+    _preferences.putDouble(KEY_FLOW_LIQUID1, valueLiquid1_L);
+    _preferences.putDouble(KEY_FLOW_LIQUID2, valueLiquid2_L);
+    _preferences.putDouble(KEY_FLOW_LIQUID3, valueLiquid3_L); 
     _preferences.end();
   }
 }
@@ -54,9 +61,8 @@ void FlowMeterDriver::Save()
 //===============================================================
 void FlowMeterDriver::SaveAsync()
 {
-  if (_isSavePending)
+  if (_isSavePending.exchange(false))
   {
-    _isSavePending = false;
     Save();
   }
 }
@@ -66,7 +72,7 @@ void FlowMeterDriver::SaveAsync()
 //===============================================================
 double FlowMeterDriver::GetValueLiquid1()
 {
-  return _valueLiquid1_L;
+  return (double)_flowTimeLiquid1_ms.load() * FLOWRATE;
 }
 
 //===============================================================
@@ -74,7 +80,7 @@ double FlowMeterDriver::GetValueLiquid1()
 //===============================================================
 double FlowMeterDriver::GetValueLiquid2()
 {
-  return _valueLiquid2_L;
+  return (double)_flowTimeLiquid2_ms.load() * FLOWRATE;
 }
 
 //===============================================================
@@ -82,17 +88,44 @@ double FlowMeterDriver::GetValueLiquid2()
 //===============================================================
 double FlowMeterDriver::GetValueLiquid3()
 {
-  return _valueLiquid3_L;
+  return (double)_flowTimeLiquid3_ms.load() * FLOWRATE;
+}
+
+//===============================================================
+// Returns a consistent snapshot of all flow meter values
+//===============================================================
+void FlowMeterDriver::GetValues(double* valueLiquid1_L, double* valueLiquid2_L, double* valueLiquid3_L)
+{
+  uint32_t flowTimeLiquid1_ms = 0;
+  uint32_t flowTimeLiquid2_ms = 0;
+  uint32_t flowTimeLiquid3_ms = 0;
+  GetFlowTimes(&flowTimeLiquid1_ms, &flowTimeLiquid2_ms, &flowTimeLiquid3_ms);
+
+  // Convert flow times to liters outside of the interrupt context
+  *valueLiquid1_L = (double)flowTimeLiquid1_ms * FLOWRATE;
+  *valueLiquid2_L = (double)flowTimeLiquid2_ms * FLOWRATE;
+  *valueLiquid3_L = (double)flowTimeLiquid3_ms * FLOWRATE;
 }
 
 //===============================================================
-// Adds flow time (@100% pump power) to flow meter
+// Adds flow time (@100% pump power) to flow meter. May be called
+// from interrupt and task context at the same time
 //===============================================================
 void FlowMeterDriver::AddFlowTime(uint32_t valueLiquid1_ms, uint32_t valueLiquid2_ms, uint32_t valueLiquid3_ms)
 {
-  _valueLiquid1_L += (double)valueLiquid1_ms * FLOWRATE;
-  _valueLiquid2_L += (double)valueLiquid2_ms * FLOWRATE;
-  _valueLiquid3_L += (double)valueLiquid3_ms * FLOWRATE;
+  if (valueLiquid1_ms == 0 &&
+    valueLiquid2_ms == 0 &&
+    valueLiquid3_ms == 0)
+  {
+    return;
+  }
+
+  // Mark write in progress, add values and mark write finished
+  _writeBegin.fetch_add(1);
+  _flowTimeLiquid1_ms.fetch_add(valueLiquid1_ms);
+  _flowTimeLiquid2_ms.fetch_add(valueLiquid2_ms);
+  _flowTimeLiquid3_ms.fetch_add(valueLiquid3_ms);
+  _writeEnd.fetch_add(1);
 }
 
 //===============================================================
@@ -102,3 +135,34 @@ void FlowMeterDriver::RequestSaveAsync()
 {
   _isSavePending = true;
 }
+
+//===============================================================
+// Returns a consistent snapshot of all flow times. Must not be
+// called from interrupt context
+//===============================================================
+void FlowMeterDriver::GetFlowTimes(uint32_t* flowTimeLiquid1_ms, uint32_t* flowTimeLiquid2_ms, uint32_t* flowTimeLiquid3_ms)
+{
+  while (true)
+  {
+    // Check for a write in progress (all started writes are finished)
+    uint32_t writeEnd = _writeEnd.load();
+    uint32_t writeBegin = _writeBegin.load();
+    if (writeBegin != writeEnd)
+    {
+      // The writer may be a preempted lower priority task
+      vTaskDelay(1);
+      continue;
+    }
+
+    // Read values
+    *flowTimeLiquid1_ms = _flowTimeLiquid1_ms.load();
+    *flowTimeLiquid2_ms = _flowTimeLiquid2_ms.load();
+    *flowTimeLiquid3_ms = _flowTimeLiquid3_ms.load();
+
+    // Snapshot is consistent, if no write started while reading
+    if (_writeBegin.load() == writeBegin)
+    {
+      return;
+    }
+  }
+}
@@ -13,6 +13,7 @@
 // Includes
 //===============================================================
 #include <Arduino.h>
+#include <atomic>
 #include <Preferences.h>
 #include "Config.h"
 
@@ -49,6 +50,9 @@ class FlowMeterDriver
     double GetValueLiquid2();
     double GetValueLiquid3();
 
+    // Returns a consistent snapshot of all flow meter values
+    void GetValues(double* valueLiquid1_L, double* valueLiquid2_L, double* valueLiquid3_L);
+
     // Adds flow time (@100% pump power) to flow meter
     void IRAM_ATTR AddFlowTime(uint32_t valueLiquid1_ms, uint32_t valueLiquid2_ms, uint32_t valueLiquid3_ms);
 
@@ -56,13 +60,25 @@ class FlowMeterDriver
     void IRAM_ATTR RequestSaveAsync();
     
   private:
-    // Flow meter variables
+    // Preferences variable
     Preferences _preferences;
-    double _valueLiquid1_L;
-    double _valueLiquid2_L;
-    double _valueLiquid3_L;
 
-    bool _isSavePending = false;
+    // Flow meter variables (pump on-time @100% pump power in ms, uint32
+    // covers ~49 days of on-time per pump). Integer atomics keep the
+    // interrupt path free of floating point and lost updates
+    std::atomic<uint32_t> _flowTimeLiquid1_ms{0};
+    std::atomic<uint32_t> _flowTimeLiquid2_ms{0};
+    std::atomic<uint32_t> _flowTimeLiquid3_ms{0};
+
+    // Write counters for consistent snapshots (begin is incremented
+    // before, end after each write)
+    std::atomic<uint32_t> _writeBegin{0};
+    std::atomic<uint32_t> _writeEnd{0};
+    
+    std::atomic<bool> _isSavePending{false};
+
+    // Returns a consistent snapshot of all flow times
+    void GetFlowTimes(uint32_t* flowTimeLiquid1_ms, uint32_t* flowTimeLiquid2_ms, uint32_t* flowTimeLiquid3_ms);
 };
 
 